@@ -39,8 +39,8 @@ class MySocket : public evio::Socket
   http::ResponseHeadersDecoder m_input_decoder;
   GridInfoDecoder m_grid_info_decoder;
   GridInfo m_grid_info;
-  evio::protocol::xmlrpc::Decoder m_xml_rpc_decoder;
   xmlrpc::LoginResponse m_login_response;
+  xmlrpc::LoginResponseDecoder m_xml_rpc_decoder;
   evio::OutputStream m_output_stream;
 
  public:
@@ -50,7 +50,7 @@ class MySocket : public evio::Socket
          {"text/xml", m_xml_rpc_decoder}}
         ),
     m_grid_info_decoder(m_grid_info),
-    m_xml_rpc_decoder(m_login_response)
+    m_xml_rpc_decoder(m_login_response, vulkan::Application::instance().medium_priority_queue())
   {
     set_source(m_output_stream);
     set_protocol_decoder(m_input_decoder);
@@ -63,11 +63,11 @@ class MyTestFile : public evio::File
 {
  private:
   LinuxViewerApplication* m_application;
-  evio::protocol::xmlrpc::Decoder m_xml_rpc_decoder;
   xmlrpc::LoginResponse m_login_response;
+  xmlrpc::LoginResponseDecoder m_xml_rpc_decoder;
 
  public:
-  MyTestFile(LinuxViewerApplication* application) : m_application(application), m_xml_rpc_decoder(m_login_response)
+  MyTestFile(LinuxViewerApplication* application) : m_application(application), m_xml_rpc_decoder(m_login_response, application->medium_priority_queue())
   {
     set_protocol_decoder(m_xml_rpc_decoder);
   }
@@ -75,6 +75,7 @@ class MyTestFile : public evio::File
   void closed(int& CWDEBUG_ONLY(allow_deletion_count)) override
   {
     DoutEntering(dc::notice, "MyTestFile::closed({" << allow_deletion_count << "})");
+    Dout(dc::notice, "Decoding the login response took " << std::chrono::duration<double, std::milli>(m_xml_rpc_decoder.decode_time()).count() << " ms.");
     m_application->quit();
   }
 };
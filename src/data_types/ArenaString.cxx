@@ -0,0 +1,114 @@
+#include "sys.h"
+#include "ArenaString.h"
+#include "DecodeArena.h"
+#include "utils/AIAlert.h"
+#include "utils/print_using.h"
+#include "utils/c_escape.h"
+#include <charconv>
+#include <cstring>
+#ifdef CWDEBUG
+#include <iostream>
+#endif
+
+namespace {
+
+// Write the UTF-8 encoding of code_point to out and return the number of bytes written.
+size_t encode_utf8(uint32_t code_point, char* out)
+{
+  if (code_point < 0x80)
+  {
+    out[0] = code_point;
+    return 1;
+  }
+  if (code_point < 0x800)
+  {
+    out[0] = 0xc0 | (code_point >> 6);
+    out[1] = 0x80 | (code_point & 0x3f);
+    return 2;
+  }
+  if (code_point < 0x10000)
+  {
+    out[0] = 0xe0 | (code_point >> 12);
+    out[1] = 0x80 | ((code_point >> 6) & 0x3f);
+    out[2] = 0x80 | (code_point & 0x3f);
+    return 3;
+  }
+  out[0] = 0xf0 | (code_point >> 18);
+  out[1] = 0x80 | ((code_point >> 12) & 0x3f);
+  out[2] = 0x80 | ((code_point >> 6) & 0x3f);
+  out[3] = 0x80 | (code_point & 0x3f);
+  return 4;
+}
+
+// Unescape the xml data into out, which must be at least data.size() bytes (no entity is shorter than what it encodes).
+// Returns the number of bytes written, or 0 if data contains an invalid entity (data is never empty here).
+size_t xml_unescape(std::string_view data, char* out)
+{
+  char* const begin = out;
+  for (size_t pos = data.find('&'); pos != std::string_view::npos; pos = data.find('&'))
+  {
+    std::memcpy(out, data.data(), pos);
+    out += pos;
+    data.remove_prefix(pos + 1);
+    size_t const end = data.find(';');
+    if (end == std::string_view::npos)
+      return 0;
+    std::string_view const entity = data.substr(0, end);
+    data.remove_prefix(end + 1);
+    if (entity == "lt")
+      *out++ = '<';
+    else if (entity == "gt")
+      *out++ = '>';
+    else if (entity == "amp")
+      *out++ = '&';
+    else if (entity == "quot")
+      *out++ = '"';
+    else if (entity == "apos")
+      *out++ = '\'';
+    else if (entity.size() > 1 && entity[0] == '#')
+    {
+      // A character reference: &#1234; or &#x4d2;.
+      bool const hex = entity[1] == 'x';
+      char const* const digits = entity.data() + (hex ? 2 : 1);
+      char const* const digits_end = entity.data() + entity.size();
+      uint32_t code_point;
+      auto [ptr, ec] = std::from_chars(digits, digits_end, code_point, hex ? 16 : 10);
+      if (ec != std::errc{} || ptr != digits_end || digits == digits_end || code_point > 0x10ffff)
+        return 0;
+      out += encode_utf8(code_point, out);
+    }
+    else
+      return 0;
+  }
+  std::memcpy(out, data.data(), data.size());
+  return out + data.size() - begin;
+}
+
+} // namespace
+
+void ArenaString::assign_from_xmlrpc_string(std::string_view const& data)
+{
+  if (data.empty())
+  {
+    m_view = {};
+    return;
+  }
+  char* const buffer = DecodeArena::current().allocate_chars(data.size());
+  if (data.find('&') == std::string_view::npos)
+  {
+    std::memcpy(buffer, data.data(), data.size());
+    m_view = {buffer, data.size()};
+    return;
+  }
+  size_t const size = xml_unescape(data, buffer);
+  if (size == 0)
+    THROW_ALERT("Invalid xml entity in \"[DATA]\"", AIArgs("[DATA]", utils::print_using(data, utils::c_escape)));
+  m_view = {buffer, size};
+}
+
+#ifdef CWDEBUG
+void ArenaString::print_on(std::ostream& os) const
+{
+  os << '"' << utils::print_using(m_view, utils::c_escape) << '"';
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#ifdef CWDEBUG
+#include <iosfwd>
+#endif
+
+// A string member of an XML-RPC response whose characters are stored in the DecodeArena of that response.
+//
+// Decoding does not allocate memory from the heap (nor does destruction free any); the xml is only
+// unescaped when it contains a '&', otherwise the characters are copied verbatim. The string stays
+// valid as long as the response that it is part of.
+class ArenaString
+{
+ private:
+  std::string_view m_view;
+
+ public:
+  ArenaString() = default;
+
+  // Accessors.
+  std::string_view view() const { return m_view; }
+  operator std::string_view() const { return m_view; }
+  std::string str() const { return std::string{m_view}; }
+  bool empty() const { return m_view.empty(); }
+  size_t size() const { return m_view.size(); }
+
+  void assign_from_xmlrpc_string(std::string_view const& data);
+
+#ifdef CWDEBUG
+  void print_on(std::ostream& os) const;
+#endif
+};
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "UUID.h"
+#include "ArenaString.h"
 #include "evio/protocol/xmlrpc/macros.h"
 
 #define xmlrpc_Category_FOREACH_MEMBER(X) \
-  X(std::string, category_name) \
+  X(ArenaString, category_name) \
   X(int32_t, category_id)
 
 class Category
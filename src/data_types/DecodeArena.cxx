@@ -0,0 +1,16 @@
+#include "sys.h"
+#include "DecodeArena.h"
+#include "utils/macros.h"
+#include "utils/AIAlert.h"
+
+//static
+thread_local DecodeArena::handle_type DecodeArena::s_current;
+
+//static
+DecodeArena& DecodeArena::current()
+{
+  DecodeArena* arena = s_current ? s_current->m_arena.load(std::memory_order::acquire) : nullptr;
+  if (AI_UNLIKELY(!arena))
+    THROW_ALERT("No current DecodeArena: this member can only be decoded as part of a response that owns an arena");
+  return *arena;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include "debug.h"
+
+// Monotonic memory for the data of a decoded XML-RPC response.
+//
+// A response object (see xmlrpc::LoginResponseData) owns a DecodeArena and makes it the current
+// arena of the decoding thread before any of its members is decoded: preferably only for the
+// duration of a decode call, with ScopedCurrent (see xmlrpc::LoginResponseDecoder), otherwise
+// with make_current. Members like ArenaString then allocate their data from DecodeArena::current()
+// instead of from the heap: that is a pointer increment, and everything is freed at once when the
+// response is destroyed.
+//
+// Data types that use the current arena may therefore only be decoded as part of such a response;
+// decoding them without a current arena throws. That includes the case where the arena that was
+// made current was destroyed since (by any thread).
+class DecodeArena
+{
+ public:
+  static constexpr size_t s_initial_size = 64 * 1024;
+
+ private:
+  // What the thread-local current arena refers to; reset by the destructor of the arena, so that
+  // a thread that still has it as its current arena doesn't end up with a dangling pointer.
+  struct Handle
+  {
+    std::atomic<DecodeArena*> m_arena;
+  };
+  using handle_type = std::shared_ptr<Handle>;
+
+  std::pmr::monotonic_buffer_resource m_resource;
+  handle_type m_handle;
+  static thread_local handle_type s_current;
+
+ public:
+  DecodeArena() : m_resource(s_initial_size), m_handle(std::make_shared<Handle>(this)) { }
+  ~DecodeArena()
+  {
+    m_handle->m_arena.store(nullptr, std::memory_order::release);
+    if (s_current == m_handle)
+      s_current.reset();
+  }
+
+  DecodeArena(DecodeArena const&) = delete;
+  DecodeArena& operator=(DecodeArena const&) = delete;
+
+  // Allocate size bytes for a string (no alignment).
+  char* allocate_chars(size_t size) { return static_cast<char*>(m_resource.allocate(size, 1)); }
+
+  // Make this the arena that current() returns, for the calling thread.
+  void make_current() { s_current = m_handle; }
+
+  // Make arena the current arena of the calling thread for the lifetime of this object,
+  // and restore the arena that was current before (if any) upon destruction.
+  class ScopedCurrent
+  {
+   private:
+    handle_type m_previous;
+
+   public:
+    ScopedCurrent(DecodeArena& arena) : m_previous(std::exchange(s_current, arena.m_handle)) { }
+    ~ScopedCurrent() { s_current = std::move(m_previous); }
+
+    ScopedCurrent(ScopedCurrent const&) = delete;
+    ScopedCurrent& operator=(ScopedCurrent const&) = delete;
+  };
+
+  // Return the arena of the response that is being decoded by the calling thread.
+  // Throws AIAlert::Error if there is none (the data type is being decoded outside of a response).
+  static DecodeArena& current();
+};
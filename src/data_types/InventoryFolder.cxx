@@ -14,6 +14,12 @@ evio::protocol::xmlrpc::ElementDecoder* InventoryFolder::create_member_decoder(m
   AI_NEVER_REACHED
 }
 
+bool InventoryFolder::assign_member(std::string_view name, std::string_view data)
+{
+  xmlrpc_InventoryFolder_FOREACH_MEMBER(XMLRPC_ASSIGN_MEMBER_BY_NAME)
+  return false;
+}
+
 #ifdef CWDEBUG
 void InventoryFolder::print_on(std::ostream& os) const
 {
@@ -1,16 +1,22 @@
 #pragma once
 
 #include "UUID.h"
+#include "ArenaString.h"
 #include "protocols/xmlrpc/initialize.h"
 #include "evio/protocol/xmlrpc/macros.h"
 
 #define xmlrpc_InventoryFolder_FOREACH_MEMBER(X) \
-  X(std::string, name) \
+  X(ArenaString, name) \
   X(int32_t, version) \
   X(UUID, folder_id) \
   X(int32_t, type_default) \
   X(UUID, parent_id)
 
+// A folder of the inventory skeleton in a login response.
+//
+// The name is an ArenaString: it is stored in the DecodeArena of the xmlrpc::LoginResponseData that
+// this folder was decoded as part of, and is only valid while that LoginResponseData is alive.
+// Decoding (or calling assign_member) outside of a LoginResponse throws, because there is no current arena.
 class InventoryFolder
 {
  private:
@@ -23,6 +29,16 @@ class InventoryFolder
 
   evio::protocol::xmlrpc::ElementDecoder* create_member_decoder(members member);
 
+  // Accessors.
+  std::string_view get_name() const { return m_name; }
+  int32_t get_version() const { return m_version; }
+  UUID const& get_folder_id() const { return m_folder_id; }
+  int32_t get_type_default() const { return m_type_default; }
+  UUID const& get_parent_id() const { return m_parent_id; }
+
+  // Assign data to the member called name. Returns false if there is no such member (see xmlrpc::ParallelArrayDecoder).
+  bool assign_member(std::string_view name, std::string_view data);
+
 #ifdef CWDEBUG
   void print_on(std::ostream& os) const;
 #endif
@@ -0,0 +1,367 @@
+#include "sys.h"
+#include "InventorySkeleton.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unistd.h>
+#ifdef CWDEBUG
+#include <iostream>
+#endif
+#include "debug.h"
+
+namespace {
+
+// The header of the cache file, followed by number_of_folders FolderRecord's and names_size bytes of names.
+struct FileHeader
+{
+  static constexpr uint32_t s_magic = 0x534e5649;       // "IVNS" (little endian).
+
+  uint32_t magic;
+  uint32_t version;
+  uint64_t number_of_folders;
+  uint64_t names_size;
+};
+
+struct FolderRecord
+{
+  uint8_t folder_id[16];
+  uint8_t parent_id[16];
+  int32_t version;
+  int32_t type_default;
+  uint32_t name_offset;
+  uint32_t name_size;
+};
+
+} // namespace
+
+void InventorySkeleton::clear()
+{
+  m_folder_id.clear();
+  m_parent_id.clear();
+  m_version.clear();
+  m_type_default.clear();
+  m_name_offset.clear();
+  m_name_size.clear();
+  m_names.clear();
+  m_live_names_size = 0;
+  m_index.clear();
+  m_tree_dirty = true;
+}
+
+void InventorySkeleton::set_name(index_type folder, std::string_view name)
+{
+  m_live_names_size += name.size() - m_name_size[folder];
+  m_name_offset[folder] = m_names.size();
+  m_name_size[folder] = name.size();
+  m_names.append(name);
+}
+
+void InventorySkeleton::compact_names()
+{
+  std::string names;
+  names.reserve(live_names_size());
+  for (index_type folder = 0; folder < size(); ++folder)
+  {
+    std::string_view const old_name = name(folder);
+    m_name_offset[folder] = names.size();
+    names.append(old_name);
+  }
+  m_names = std::move(names);
+}
+
+void InventorySkeleton::compact_names_if_mostly_garbage()
+{
+  if (m_names.size() > 2 * live_names_size())
+    compact_names();
+}
+
+InventorySkeleton::index_type InventorySkeleton::add(UUID const& folder_id, UUID const& parent_id,
+    int32_t version, int32_t type_default, std::string_view name)
+{
+  index_type const folder = m_folder_id.size();
+  m_folder_id.push_back(folder_id);
+  m_parent_id.push_back(parent_id);
+  m_version.push_back(version);
+  m_type_default.push_back(type_default);
+  m_name_offset.emplace_back();
+  m_name_size.emplace_back();
+  set_name(folder, name);
+  m_tree_dirty = true;
+  return folder;
+}
+
+void InventorySkeleton::build(std::vector<InventoryFolder> const& folders)
+{
+  DoutEntering(dc::notice, "InventorySkeleton::build(" << folders.size() << " folders)");
+  clear();
+  m_folder_id.reserve(folders.size());
+  m_parent_id.reserve(folders.size());
+  m_version.reserve(folders.size());
+  m_type_default.reserve(folders.size());
+  m_name_offset.reserve(folders.size());
+  m_name_size.reserve(folders.size());
+  m_index.reserve(folders.size());
+  for (InventoryFolder const& folder : folders)
+    update(folder);
+  rebuild_tree();
+}
+
+InventorySkeleton::UpdateResult InventorySkeleton::update(InventoryFolder const& folder)
+{
+  auto [index, inserted] = m_index.try_emplace(folder.get_folder_id(), s_no_index);
+  if (inserted)
+  {
+    *index = add(folder.get_folder_id(), folder.get_parent_id(), folder.get_version(), folder.get_type_default(), folder.get_name());
+    return added;
+  }
+  index_type const existing = *index;
+  if (folder.get_version() <= m_version[existing])
+    return unchanged;
+  m_version[existing] = folder.get_version();
+  m_type_default[existing] = folder.get_type_default();
+  if (name(existing) != folder.get_name())
+  {
+    set_name(existing, folder.get_name());
+    compact_names_if_mostly_garbage();
+  }
+  if (m_parent_id[existing] != folder.get_parent_id())
+  {
+    m_parent_id[existing] = folder.get_parent_id();
+    m_tree_dirty = true;
+  }
+  return updated;
+}
+
+void InventorySkeleton::remove(index_type folder)
+{
+  // Move the last folder into the hole.
+  index_type const last = m_folder_id.size() - 1;
+  m_index.erase(m_folder_id[folder]);
+  m_live_names_size -= m_name_size[folder];
+  if (folder != last)
+  {
+    m_folder_id[folder] = m_folder_id[last];
+    m_parent_id[folder] = m_parent_id[last];
+    m_version[folder] = m_version[last];
+    m_type_default[folder] = m_type_default[last];
+    m_name_offset[folder] = m_name_offset[last];
+    m_name_size[folder] = m_name_size[last];
+    *m_index.find(m_folder_id[folder]) = folder;
+  }
+  m_folder_id.pop_back();
+  m_parent_id.pop_back();
+  m_version.pop_back();
+  m_type_default.pop_back();
+  m_name_offset.pop_back();
+  m_name_size.pop_back();
+  m_tree_dirty = true;
+}
+
+bool InventorySkeleton::remove(UUID const& folder_id)
+{
+  index_type const folder = find(folder_id);
+  if (folder == s_no_index)
+    return false;
+  remove(folder);
+  return true;
+}
+
+InventorySkeleton::DiffStatistics InventorySkeleton::apply(std::vector<InventoryFolder> const& folders)
+{
+  DoutEntering(dc::notice, "InventorySkeleton::apply(" << folders.size() << " folders)");
+  DiffStatistics statistics{};
+  std::vector<bool> seen(size());
+  for (InventoryFolder const& folder : folders)
+  {
+    switch (update(folder))
+    {
+      case added:
+        ++statistics.m_added;
+        seen.push_back(true);
+        break;
+      case updated:
+        ++statistics.m_updated;
+        seen[find(folder.get_folder_id())] = true;
+        break;
+      case unchanged:
+        ++statistics.m_unchanged;
+        seen[find(folder.get_folder_id())] = true;
+        break;
+    }
+  }
+  // Going backwards, the folder that remove moves into the hole was already seen.
+  for (index_type folder = seen.size(); folder-- > 0;)
+    if (!seen[folder])
+    {
+      remove(folder);
+      ++statistics.m_removed;
+    }
+  compact_names_if_mostly_garbage();
+  if (m_tree_dirty)
+    rebuild_tree();
+  Dout(dc::notice, "Applied " << statistics);
+  return statistics;
+}
+
+void InventorySkeleton::rebuild_tree()
+{
+  index_type const number_of_folders = size();
+  m_parent.resize(number_of_folders);
+  m_first_child.assign(number_of_folders + 1, 0);
+  m_roots.clear();
+  // Count the children of every folder (shifted by one, so that the prefix sum below gives the first child).
+  for (index_type folder = 0; folder < number_of_folders; ++folder)
+  {
+    index_type const parent = find(m_parent_id[folder]);
+    // A folder that is its own parent would make a cycle; treat it as a root.
+    m_parent[folder] = parent == folder ? s_no_index : parent;
+    if (m_parent[folder] == s_no_index)
+      m_roots.push_back(folder);
+    else
+      ++m_first_child[m_parent[folder] + 1];
+  }
+  for (index_type folder = 0; folder < number_of_folders; ++folder)
+    m_first_child[folder + 1] += m_first_child[folder];
+  // Fill in the children, in order of index.
+  m_children.resize(number_of_folders - m_roots.size());
+  std::vector<index_type> next_child(m_first_child.begin(), m_first_child.end() - 1);
+  for (index_type folder = 0; folder < number_of_folders; ++folder)
+    if (m_parent[folder] != s_no_index)
+      m_children[next_child[m_parent[folder]]++] = folder;
+  m_tree_dirty = false;
+}
+
+bool InventorySkeleton::save(std::filesystem::path const& filename) const
+{
+  DoutEntering(dc::notice, "InventorySkeleton::save(" << filename << ")");
+
+  // Only write the names that are still in use.
+  std::string names;
+  std::vector<FolderRecord> records(size());
+  for (index_type folder = 0; folder < size(); ++folder)
+  {
+    FolderRecord& record = records[folder];
+    std::memcpy(record.folder_id, m_folder_id[folder].begin(), sizeof(record.folder_id));
+    std::memcpy(record.parent_id, m_parent_id[folder].begin(), sizeof(record.parent_id));
+    record.version = m_version[folder];
+    record.type_default = m_type_default[folder];
+    record.name_offset = names.size();
+    record.name_size = m_name_size[folder];
+    names.append(name(folder));
+  }
+  FileHeader const header{
+    .magic = FileHeader::s_magic,
+    .version = file_format_version,
+    .number_of_folders = records.size(),
+    .names_size = names.size()
+  };
+
+  // Write to a temporary file first, so that a crash never leaves a partially written cache behind.
+  std::filesystem::path tmp_filename = filename;
+  tmp_filename += ".tmp." + std::to_string(getpid());
+  std::error_code ec;
+  {
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (file)
+    {
+      file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+      file.write(reinterpret_cast<char const*>(records.data()), records.size() * sizeof(FolderRecord));
+      file.write(names.data(), names.size());
+      file.close();
+    }
+    if (!file)
+    {
+      Dout(dc::warning, "Failed to write inventory skeleton file " << tmp_filename << ".");
+      std::filesystem::remove(tmp_filename, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp_filename, filename, ec);
+  if (ec)
+  {
+    Dout(dc::warning, "Failed to rename " << tmp_filename << " to " << filename << ": " << ec.message());
+    std::filesystem::remove(tmp_filename, ec);
+    return false;
+  }
+  return true;
+}
+
+bool InventorySkeleton::load(std::filesystem::path const& filename)
+{
+  DoutEntering(dc::notice, "InventorySkeleton::load(" << filename << ")");
+
+  clear();
+  std::ifstream file(filename, std::ios::binary);
+  if (!file)
+  {
+    rebuild_tree();
+    return false;
+  }
+
+  FileHeader header;
+  std::vector<FolderRecord> records;
+  bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+      header.magic == FileHeader::s_magic &&
+      header.version == file_format_version &&
+      header.number_of_folders < s_no_index && header.names_size <= std::numeric_limits<uint32_t>::max();
+  if (valid)
+  {
+    // Don't allocate anything based on the header before knowing that the file is large enough (this can't overflow, given the above).
+    std::error_code ec;
+    uintmax_t const file_size = std::filesystem::file_size(filename, ec);
+    valid = !ec && file_size == sizeof(FileHeader) + header.number_of_folders * sizeof(FolderRecord) + header.names_size;
+  }
+  if (valid)
+  {
+    records.resize(header.number_of_folders);
+    m_names.resize(header.names_size);
+    valid = file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(FolderRecord)) &&
+        file.read(m_names.data(), m_names.size()) &&
+        file.peek() == std::ifstream::traits_type::eof();
+  }
+  if (valid)
+  {
+    m_folder_id.resize(records.size());
+    m_parent_id.resize(records.size());
+    m_version.resize(records.size());
+    m_type_default.resize(records.size());
+    m_name_offset.resize(records.size());
+    m_name_size.resize(records.size());
+    m_index.reserve(records.size());
+    for (index_type folder = 0; valid && folder < records.size(); ++folder)
+    {
+      FolderRecord const& record = records[folder];
+      std::memcpy(m_folder_id[folder].begin(), record.folder_id, sizeof(record.folder_id));
+      std::memcpy(m_parent_id[folder].begin(), record.parent_id, sizeof(record.parent_id));
+      m_version[folder] = record.version;
+      m_type_default[folder] = record.type_default;
+      m_name_offset[folder] = record.name_offset;
+      m_name_size[folder] = record.name_size;
+      m_live_names_size += record.name_size;
+      valid = static_cast<uint64_t>(record.name_offset) + record.name_size <= m_names.size() &&
+          m_index.try_emplace(m_folder_id[folder], folder).second;
+    }
+  }
+  if (!valid)
+  {
+    Dout(dc::warning, "Ignoring corrupt or outdated inventory skeleton file " << filename << ".");
+    clear();
+  }
+  rebuild_tree();
+  if (valid)
+    Dout(dc::notice, "Loaded " << size() << " folders from " << filename << ".");
+  return valid;
+}
+
+#ifdef CWDEBUG
+void InventorySkeleton::DiffStatistics::print_on(std::ostream& os) const
+{
+  os << "{added:" << m_added << ", updated:" << m_updated << ", unchanged:" << m_unchanged << ", removed:" << m_removed << '}';
+}
+
+void InventorySkeleton::print_on(std::ostream& os) const
+{
+  os << "{folders:" << size() << ", roots:" << m_roots.size() << ", names_bytes:" << m_names.size() << '}';
+}
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "InventoryFolder.h"
+#include "UUID.h"
+#include "UUIDMap.h"
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef CWDEBUG
+#include <iosfwd>
+#endif
+
+// The folder tree of an inventory, built from the flat list of InventoryFolder's of a login response
+// (inventory_skeleton or inventory_skel_lib).
+//
+// Folders are addressed by index (from zero till size()). All data is stored as struct of arrays:
+// one vector per field, plus all names concatenated in one string. The index of a folder is found
+// from its UUID with a UUIDMap. The tree is stored as a children index: the children of a folder are
+// a contiguous range of m_children, so walking the tree only touches a few cache lines.
+//
+// The skeleton can be updated incrementally with update (add a folder, or replace it if the new version
+// is larger than the one we have) and remove, after which rebuild_tree must be called before the tree
+// is used again. apply does all of that for the folder list of a new login response, so that loading
+// the skeleton of the previous session (see save and load) and applying the new list only touches the
+// folders that changed.
+class InventorySkeleton
+{
+ public:
+  using index_type = uint32_t;
+  static constexpr index_type s_no_index = ~index_type{0};
+  static constexpr uint32_t file_format_version = 1;
+
+  enum UpdateResult {
+    added,              // The folder was new.
+    updated,            // The folder existed with a smaller version.
+    unchanged           // The folder existed with the same or a larger version; nothing was changed.
+  };
+
+  struct DiffStatistics
+  {
+    size_t m_added;
+    size_t m_updated;
+    size_t m_unchanged;
+    size_t m_removed;
+
+#ifdef CWDEBUG
+    void print_on(std::ostream& os) const;
+#endif
+  };
+
+ private:
+  // The folders.
+  std::vector<UUID> m_folder_id;
+  std::vector<UUID> m_parent_id;
+  std::vector<int32_t> m_version;
+  std::vector<int32_t> m_type_default;
+  std::vector<uint32_t> m_name_offset;          // The offset of the name of the folder in m_names.
+  std::vector<uint32_t> m_name_size;            // The size of that name.
+  std::string m_names;                          // The names of all folders (and old names of updated folders).
+  size_t m_live_names_size{0};                  // The sum of m_name_size.
+  UUIDMap<index_type> m_index;                  // Maps folder_id to the index of the folder.
+
+  // The tree; calculated by rebuild_tree.
+  std::vector<index_type> m_parent;             // The index of the parent, or s_no_index if the parent isn't in the skeleton.
+  std::vector<index_type> m_first_child;        // The children of folder i are m_children[m_first_child[i] .. m_first_child[i + 1]).
+  std::vector<index_type> m_children;
+  std::vector<index_type> m_roots;              // The folders without parent (in the skeleton).
+  bool m_tree_dirty{false};                     // Set by update and remove.
+
+ public:
+  // Replace the content with folders and build the tree.
+  void build(std::vector<InventoryFolder> const& folders);
+
+  // Add folder, or replace the existing folder with the same folder_id if folder has a larger version.
+  UpdateResult update(InventoryFolder const& folder);
+
+  // Remove the folder with folder_id. Returns false if there is no such folder.
+  bool remove(UUID const& folder_id);
+
+  // Make the skeleton equal to folders, only changing those folders that are new, have a
+  // larger version or no longer exist; then rebuild the tree if anything changed.
+  DiffStatistics apply(std::vector<InventoryFolder> const& folders);
+
+  // Recalculate the tree after calls to update and/or remove.
+  void rebuild_tree();
+
+  // Write the skeleton to filename; returns false on failure.
+  bool save(std::filesystem::path const& filename) const;
+
+  // Replace the content with what was written to filename by save. Returns false, leaving
+  // the skeleton empty, if the file doesn't exist or is invalid.
+  bool load(std::filesystem::path const& filename);
+
+  // Accessors.
+  size_t size() const { return m_folder_id.size(); }
+  bool empty() const { return m_folder_id.empty(); }
+
+  // Return the index of folder_id, or s_no_index if it isn't in the skeleton.
+  index_type find(UUID const& folder_id) const
+  {
+    index_type const* index = m_index.find(folder_id);
+    return index ? *index : s_no_index;
+  }
+
+  UUID const& folder_id(index_type folder) const { return m_folder_id[folder]; }
+  UUID const& parent_id(index_type folder) const { return m_parent_id[folder]; }
+  int32_t version(index_type folder) const { return m_version[folder]; }
+  int32_t type_default(index_type folder) const { return m_type_default[folder]; }
+  std::string_view name(index_type folder) const { return {m_names.data() + m_name_offset[folder], m_name_size[folder]}; }
+
+  // The tree. Only valid after rebuild_tree (which build, apply and load call).
+  index_type parent(index_type folder) const { ASSERT(!m_tree_dirty); return m_parent[folder]; }
+  std::span<index_type const> children(index_type folder) const
+  {
+    ASSERT(!m_tree_dirty);
+    return {m_children.data() + m_first_child[folder], m_children.data() + m_first_child[folder + 1]};
+  }
+  std::span<index_type const> roots() const { ASSERT(!m_tree_dirty); return m_roots; }
+
+#ifdef CWDEBUG
+  void print_on(std::ostream& os) const;
+#endif
+
+ private:
+  void clear();
+  void set_name(index_type folder, std::string_view name);
+  size_t live_names_size() const { return m_live_names_size; }
+  void compact_names();                         // Drop the old names of updated and removed folders from m_names.
+  void compact_names_if_mostly_garbage();       // Call compact_names if less than half of m_names is still in use.
+  index_type add(UUID const& folder_id, UUID const& parent_id, int32_t version, int32_t type_default, std::string_view name);
+  void remove(index_type folder);
+};
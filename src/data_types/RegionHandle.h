@@ -17,6 +17,10 @@ class RegionHandle
 
   void set_position(int x, int y) { m_x = x; m_y = y; }
 
+  // Accessors.
+  int get_x() const { return m_x; }
+  int get_y() const { return m_y; }
+
   void assign_from_xmlrpc_string(std::string_view const& data);
 
 #ifdef CWDEBUG
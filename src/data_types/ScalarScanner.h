@@ -0,0 +1,129 @@
+#pragma once
+
+#include <charconv>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+// A scanner for the strings of XML-RPC scalars that encode a tuple, like
+// "[r254208,r261120]" (RegionHandle) or "[r0.8928223,r0.450409,r0]" (Vector3d).
+//
+// It works directly on the std::string_view that it is constructed with and
+// never allocates. The accepted syntax is the same as that of the std::istream
+// based decoders that it replaced:
+// - white space is skipped in front of every expected character and number;
+// - numbers may start with a '+';
+// - floating point numbers must start with a digit or '.' (after the sign), so
+//   "inf" and "nan" are rejected;
+// - a float that underflows becomes (nearly) zero, one that overflows is an error.
+class ScalarScanner
+{
+ private:
+  char const* m_pos;
+  char const* m_end;
+
+  static bool is_space(char c) { return c == ' ' || ('\t' <= c && c <= '\r'); }
+
+  void skip_space()
+  {
+    while (m_pos != m_end && is_space(*m_pos))
+      ++m_pos;
+  }
+
+  // Return true if the (non-zero) floating point number [begin, end) is less than one in absolute value.
+  static bool is_fraction(char const* begin, char const* end);
+
+ public:
+  ScalarScanner(std::string_view data) : m_pos(data.data()), m_end(data.data() + data.size()) { }
+
+  // Skip white space and then consume c. Returns false if the next character is not c.
+  bool expect(char c)
+  {
+    skip_space();
+    if (m_pos == m_end || *m_pos != c)
+      return false;
+    ++m_pos;
+    return true;
+  }
+
+  // Skip white space and then read a number into value.
+  // Returns false if there is no number, or if it doesn't fit in T.
+  template<typename T>
+  bool number(T& value);
+
+  // The part of the string that wasn't consumed yet.
+  std::string_view rest() const { return {m_pos, static_cast<size_t>(m_end - m_pos)}; }
+};
+
+template<typename T>
+bool ScalarScanner::number(T& value)
+{
+  skip_space();
+  char const* begin = m_pos;
+  // std::from_chars does not accept a leading '+'.
+  if (begin != m_end && *begin == '+')
+  {
+    ++begin;
+    if (begin != m_end && *begin == '-')
+      return false;
+  }
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    char const* digits = begin + (begin != m_end && *begin == '-');
+    if (digits == m_end || !(('0' <= *digits && *digits <= '9') || *digits == '.'))
+      return false;
+  }
+  std::from_chars_result result = std::from_chars(begin, m_end, value);
+  if constexpr (std::is_floating_point_v<T>)
+  {
+    // std::istream accepts values that underflow, but not those that overflow.
+    if (result.ec == std::errc::result_out_of_range && is_fraction(begin, result.ptr))
+    {
+      value = *begin == '-' ? -T{0} : T{0};
+      result.ec = std::errc{};
+    }
+  }
+  if (result.ec != std::errc{})
+    return false;
+  m_pos = result.ptr;
+  return true;
+}
+
+//static
+inline bool ScalarScanner::is_fraction(char const* begin, char const* end)
+{
+  // Calculate the decimal exponent of the first significant digit.
+  char const* p = begin + (*begin == '-');
+  while (p != end && *p == '0')
+    ++p;
+  char const* const integer_digits = p;
+  while (p != end && '0' <= *p && *p <= '9')
+    ++p;
+  long long exponent = p - integer_digits - 1;
+  if (p != end && *p == '.')
+  {
+    char const* const fraction = ++p;
+    if (p == integer_digits + 1)
+    {
+      // All integer digits are zero.
+      while (p != end && *p == '0')
+        ++p;
+      exponent = fraction - p - 1;
+    }
+    while (p != end && '0' <= *p && *p <= '9')
+      ++p;
+  }
+  if (p != end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    bool const negative = p != end && *p == '-';
+    if (p != end && *p == '+')
+      ++p;
+    long long e = 0;
+    if (std::from_chars(p, end, e).ec == std::errc::result_out_of_range)
+      e = negative ? std::numeric_limits<long long>::min() / 2 : std::numeric_limits<long long>::max() / 2;
+    exponent += e;
+  }
+  return exponent < 0;
+}
@@ -1,9 +1,87 @@
 #include "sys.h"
 #include "UUID.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #ifdef CWDEBUG
 #include <iostream>
 #endif
 
+namespace {
+
+// The 32 hex digits of a canonical UUID string, without the dashes.
+void copy_hex_digits(char* hex, char const* str)
+{
+  // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+  // 0       8    13   18   23         35
+  std::memcpy(hex, str, 8);
+  std::memcpy(hex + 8, str + 9, 4);
+  std::memcpy(hex + 12, str + 14, 4);
+  std::memcpy(hex + 16, str + 19, 4);
+  std::memcpy(hex + 20, str + 24, 12);
+}
+
+#ifdef __SSE2__
+// Decode 16 hex digits into 8 bytes, stored in the low byte of each 16-bit lane of the result.
+// Sets all bits of the corresponding byte of valid_out for each character that is a hex digit.
+inline __m128i decode_hex16(__m128i chars, __m128i& valid_out)
+{
+  // SSE2 has no unsigned byte compare, but x <= n is the same as min(x, n) == x.
+  __m128i const digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  __m128i const is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  __m128i const alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i const is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+  __m128i const value = _mm_or_si128(_mm_and_si128(is_digit, digit),
+                                     _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+  valid_out = _mm_or_si128(is_digit, is_alpha);
+  // Each 16-bit lane now contains high_nibble | (low_nibble << 8); turn that into (high_nibble << 4) | low_nibble.
+  return _mm_and_si128(_mm_or_si128(_mm_slli_epi16(value, 4), _mm_srli_epi16(value, 8)), _mm_set1_epi16(0x00ff));
+}
+#else
+// The value of each hex digit, or 0x80 for characters that are not a hex digit.
+constexpr std::array<uint8_t, 256> s_hex_value = []{
+  std::array<uint8_t, 256> table{};
+  for (int c = 0; c < 256; ++c)
+    table[c] = ('0' <= c && c <= '9') ? c - '0' : ('a' <= c && c <= 'f') ? c - 'a' + 10 : ('A' <= c && c <= 'F') ? c - 'A' + 10 : 0x80;
+  return table;
+}();
+#endif
+
+} // namespace
+
+bool UUID::assign_from_canonical_string(std::string_view const& sv)
+{
+  if (sv.size() != 36)
+    return false;
+  char const* const str = sv.data();
+  unsigned int const dashes = (str[8] ^ '-') | (str[13] ^ '-') | (str[18] ^ '-') | (str[23] ^ '-');
+
+  alignas(16) char hex[32];
+  copy_hex_digits(hex, str);
+
+#ifdef __SSE2__
+  __m128i valid0, valid1;
+  __m128i const bytes0 = decode_hex16(_mm_load_si128(reinterpret_cast<__m128i const*>(hex)), valid0);
+  __m128i const bytes1 = decode_hex16(_mm_load_si128(reinterpret_cast<__m128i const*>(hex + 16)), valid1);
+  bool const valid = dashes == 0 && _mm_movemask_epi8(_mm_and_si128(valid0, valid1)) == 0xffff;
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(begin()), _mm_packus_epi16(bytes0, bytes1));
+#else
+  unsigned int invalid = dashes;
+  for (int i = 0; i < 16; ++i)
+  {
+    uint8_t const high = s_hex_value[static_cast<unsigned char>(hex[2 * i])];
+    uint8_t const low = s_hex_value[static_cast<unsigned char>(hex[2 * i + 1])];
+    invalid |= (high | low) & 0x80;
+    begin()[i] = (high << 4) | low;
+  }
+  bool const valid = invalid == 0;
+#endif
+  return valid;
+}
+
 #ifdef CWDEBUG
 void UUID::print_on(std::ostream& os) const
 {
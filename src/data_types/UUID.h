@@ -14,14 +14,21 @@ class UUID : public boost::uuids::uuid
   // Default constructor creates an uninitialized UUID object!
   UUID() { }
   // Generate from string view.
-  UUID(std::string_view const& sv) : boost::uuids::uuid(boost::uuids::string_generator()(sv.begin(), sv.end())) { }
+  UUID(std::string_view const& sv) { assign_from_string(sv); }
 
+  // Throws std::runtime_error if sv is not a valid UUID.
   void assign_from_string(std::string_view const& sv)
   {
-    // I don't like this. It seems slow.
-    new(this) boost::uuids::uuid{boost::uuids::string_generator()(sv.begin(), sv.end())};
+    // Practically every UUID that we receive is in the canonical form; leave everything else
+    // (including throwing on invalid input) to boost.
+    if (!assign_from_canonical_string(sv))
+      new(this) boost::uuids::uuid{boost::uuids::string_generator()(sv.begin(), sv.end())};
   }
 
+  // Decode the canonical form "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" (hex digits in either case).
+  // Returns false if sv isn't exactly that, in which case the value of this UUID is unspecified.
+  bool assign_from_canonical_string(std::string_view const& sv);
+
   void assign_from_xmlrpc_string(std::string_view const& uuid_data)
   {
     // UUID does not need xml unescaping, since it does not contain any of '"<>&.
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "UUID.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include "debug.h"
+
+// A hash map from UUID to T, using open addressing with linear probing.
+//
+// Optimized for the many (tens of thousands) of inventory and asset UUIDs that we get from the
+// grid: the slots (key and value) are stored in a single array, so that a lookup usually touches
+// a single cache line; next to that one byte of control data per slot is kept that holds seven
+// bits of the hash, so that most non-matching slots are skipped without comparing the UUID.
+//
+// Nearly all UUIDs are random (version 4), so they don't need a real hash function: folding the
+// two halves together and a Fibonacci multiplication is enough to also cope with the few that
+// aren't (like the null UUID or sequential ones).
+//
+// Erasing uses backward shifting instead of tombstones, so that lookups never slow down over time.
+// Pointers returned by find and try_emplace are invalidated by every insert that grows the table
+// and by every erase.
+//
+// T must be default constructible and move assignable.
+template<typename T>
+class UUIDMap
+{
+ public:
+  using key_type = UUID;
+  using mapped_type = T;
+
+ private:
+  struct Slot
+  {
+    UUID m_key;
+    [[no_unique_address]] T m_value;
+  };
+
+  static constexpr uint8_t s_empty = 0;                 // Control byte of an unused slot; all used slots have bit 7 set.
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::unique_ptr<uint8_t[]> m_control;                 // One byte per slot: s_empty or 0x80 | seven bits of the hash.
+  size_t m_mask{0};                                     // The number of slots minus one (the number of slots is a power of two).
+  int m_shift{64};                                      // 64 minus log2 of the number of slots.
+  size_t m_size{0};                                     // The number of used slots.
+
+  static uint64_t hash(UUID const& key)
+  {
+    uint64_t half[2];
+    std::memcpy(half, key.begin(), sizeof(half));
+    return (half[0] ^ half[1]) * 0x9e3779b97f4a7c15UL;
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+  size_t home_index(uint64_t h) const { return h >> m_shift; }
+  static uint8_t control_byte(uint64_t h) { return 0x80 | (h & 0x7f); }
+
+  // Return the index of the slot that contains key, or the empty slot where it should go.
+  size_t probe(UUID const& key, uint8_t control) const
+  {
+    size_t index = home_index(hash(key));
+    for (;; index = (index + 1) & m_mask)
+    {
+      uint8_t const c = m_control[index];
+      if (c == s_empty || (c == control && m_slots[index].m_key == key))
+        return index;
+    }
+  }
+
+  void rehash(size_t new_capacity)
+  {
+    // new_capacity must be a power of two.
+    ASSERT(new_capacity > 0 && (new_capacity & (new_capacity - 1)) == 0);
+    std::unique_ptr<Slot[]> old_slots = std::move(m_slots);
+    std::unique_ptr<uint8_t[]> old_control = std::move(m_control);
+    size_t const old_capacity = old_control ? capacity() : 0;
+    m_slots = std::make_unique<Slot[]>(new_capacity);
+    m_control = std::make_unique<uint8_t[]>(new_capacity);      // Value-initialized: all s_empty.
+    m_mask = new_capacity - 1;
+    m_shift = 64 - std::countr_zero(new_capacity);
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+      if (old_control[i] == s_empty)
+        continue;
+      size_t index = home_index(hash(old_slots[i].m_key));
+      while (m_control[index] != s_empty)
+        index = (index + 1) & m_mask;
+      m_control[index] = old_control[i];
+      m_slots[index] = std::move(old_slots[i]);
+    }
+  }
+
+  // Keep the load factor below 3/4; linear probing gets slow when it becomes higher than that.
+  static size_t capacity_for(size_t size)
+  {
+    return std::bit_ceil(std::max(size_t{16}, size + size / 3 + 1));
+  }
+
+ public:
+  UUIDMap() = default;
+
+  // The moved-from map is left empty.
+  UUIDMap(UUIDMap&& orig) noexcept :
+    m_slots(std::move(orig.m_slots)), m_control(std::move(orig.m_control)),
+    m_mask(std::exchange(orig.m_mask, 0)), m_shift(std::exchange(orig.m_shift, 64)), m_size(std::exchange(orig.m_size, 0)) { }
+
+  UUIDMap& operator=(UUIDMap&& orig) noexcept
+  {
+    if (this != &orig)
+    {
+      m_slots = std::move(orig.m_slots);
+      m_control = std::move(orig.m_control);
+      m_mask = std::exchange(orig.m_mask, 0);
+      m_shift = std::exchange(orig.m_shift, 64);
+      m_size = std::exchange(orig.m_size, 0);
+    }
+    return *this;
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // Make room for at least size elements without growing.
+  void reserve(size_t size)
+  {
+    size_t const new_capacity = capacity_for(size);
+    if (!m_control || new_capacity > capacity())
+      rehash(new_capacity);
+  }
+
+  void clear()
+  {
+    if (m_control)
+      std::memset(m_control.get(), s_empty, capacity());
+    m_size = 0;
+  }
+
+  // Return a pointer to the value of key, or nullptr if key isn't in the map.
+  T* find(UUID const& key)
+  {
+    if (m_size == 0)
+      return nullptr;
+    uint64_t const h = hash(key);
+    size_t const index = probe(key, control_byte(h));
+    return m_control[index] == s_empty ? nullptr : &m_slots[index].m_value;
+  }
+
+  T const* find(UUID const& key) const { return const_cast<UUIDMap*>(this)->find(key); }
+
+  bool contains(UUID const& key) const { return find(key) != nullptr; }
+
+  // Insert (key, value) unless key is already in the map.
+  // Returns a pointer to the value of key and true if it was inserted.
+  std::pair<T*, bool> try_emplace(UUID const& key, T value = {})
+  {
+    if (!m_control || m_size + 1 > capacity() - capacity() / 4)
+      rehash(capacity_for(m_size + 1));
+    uint8_t const control = control_byte(hash(key));
+    size_t const index = probe(key, control);
+    if (m_control[index] != s_empty)
+      return {&m_slots[index].m_value, false};
+    m_control[index] = control;
+    m_slots[index].m_key = key;
+    m_slots[index].m_value = std::move(value);
+    ++m_size;
+    return {&m_slots[index].m_value, true};
+  }
+
+  // Return a reference to the value of key, inserting a default constructed value first if key isn't in the map.
+  T& operator[](UUID const& key) { return *try_emplace(key).first; }
+
+  // Remove key. Returns false if it wasn't in the map.
+  bool erase(UUID const& key)
+  {
+    if (m_size == 0)
+      return false;
+    uint64_t const h = hash(key);
+    size_t hole = probe(key, control_byte(h));
+    if (m_control[hole] == s_empty)
+      return false;
+    // Move later elements of the same cluster back into the hole when that doesn't put them before their home slot.
+    for (size_t index = (hole + 1) & m_mask; m_control[index] != s_empty; index = (index + 1) & m_mask)
+    {
+      size_t const home = home_index(hash(m_slots[index].m_key));
+      // The element at index may be moved to hole if hole lies cyclically in [home, index).
+      if (((index - home) & m_mask) >= ((index - hole) & m_mask))
+      {
+        m_control[hole] = m_control[index];
+        m_slots[hole] = std::move(m_slots[index]);
+        hole = index;
+      }
+    }
+    m_control[hole] = s_empty;
+    m_slots[hole].m_value = T{};                        // Release resources held by the value, if any.
+    --m_size;
+    return true;
+  }
+
+  // Call func(key, value) for every element, in unspecified order.
+  template<typename F>
+  void for_each(F&& func) const
+  {
+    for (size_t i = 0; m_size > 0 && i < capacity(); ++i)
+      if (m_control[i] != s_empty)
+        func(m_slots[i].m_key, m_slots[i].m_value);
+  }
+};
+
+// A set of UUIDs, with the same properties as UUIDMap.
+class UUIDSet
+{
+ private:
+  struct Empty { };
+  UUIDMap<Empty> m_map;
+
+ public:
+  size_t size() const { return m_map.size(); }
+  bool empty() const { return m_map.empty(); }
+  void reserve(size_t size) { m_map.reserve(size); }
+  void clear() { m_map.clear(); }
+
+  bool contains(UUID const& key) const { return m_map.contains(key); }
+  // Returns true if key was inserted (it wasn't in the set yet).
+  bool insert(UUID const& key) { return m_map.try_emplace(key).second; }
+  // Returns true if key was removed.
+  bool erase(UUID const& key) { return m_map.erase(key); }
+
+  template<typename F>
+  void for_each(F&& func) const { m_map.for_each([&](UUID const& key, Empty){ func(key); }); }
+};
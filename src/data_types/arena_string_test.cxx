@@ -0,0 +1,79 @@
+#include "sys.h"
+#include "ArenaString.h"
+#include "DecodeArena.h"
+#include "utils/AIAlert.h"
+#include <cassert>
+#include <memory>
+#include <thread>
+#include "debug.h"
+
+int main()
+{
+  Debug(debug::init());
+
+  ArenaString s;
+
+  // Without a current arena decoding throws.
+  try
+  {
+    s.assign_from_xmlrpc_string("My Inventory");
+    assert(false);
+  }
+  catch (AIAlert::Error const& error)
+  {
+    Dout(dc::notice, error);
+  }
+
+  // Nor does it after the current arena was destroyed, also when that happened in another thread.
+  {
+    auto destroyed_arena = std::make_unique<DecodeArena>();
+    destroyed_arena->make_current();
+    std::thread([&]{ destroyed_arena.reset(); }).join();
+    try
+    {
+      s.assign_from_xmlrpc_string("My Inventory");
+      assert(false);
+    }
+    catch (AIAlert::Error const& error)
+    {
+      Dout(dc::notice, error);
+    }
+  }
+
+  DecodeArena arena;
+  arena.make_current();
+
+  // ScopedCurrent restores the previous current arena.
+  {
+    DecodeArena other_arena;
+    DecodeArena::ScopedCurrent current_arena(other_arena);
+    assert(&DecodeArena::current() == &other_arena);
+  }
+  assert(&DecodeArena::current() == &arena);
+
+  s.assign_from_xmlrpc_string("My Inventory");
+  assert(s.view() == "My Inventory");
+
+  s.assign_from_xmlrpc_string("Fish &amp; Chips &lt;3 &quot;&apos;&gt;");
+  assert(s.view() == "Fish & Chips <3 \"'>");
+
+  s.assign_from_xmlrpc_string("&#65;&#x42;&#xe9;&#x20AC;&#x1F600;");
+  assert(s.view() == "ABé€\U0001F600");
+
+  s.assign_from_xmlrpc_string("");
+  assert(s.empty());
+
+  for (char const* invalid : { "&", "a&b", "&foo;", "&#;", "&#x;", "&#12a;", "&#x110000;" })
+  {
+    try
+    {
+      s.assign_from_xmlrpc_string(invalid);
+      assert(false);
+    }
+    catch (AIAlert::Error const& error)
+    {
+      Dout(dc::notice, error);
+    }
+  }
+  Dout(dc::notice, "Success!");
+}
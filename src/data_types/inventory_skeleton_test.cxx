@@ -0,0 +1,210 @@
+#include "sys.h"
+#include "InventorySkeleton.h"
+#include "DecodeArena.h"
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "debug.h"
+
+// Check InventorySkeleton on a small tree, then measure build, apply, save and load
+// for the number of folders of a large inventory.
+
+namespace {
+
+constexpr int number_of_folders = 100000;
+constexpr int repeat = 10;
+
+InventoryFolder make_folder(UUID const& folder_id, UUID const& parent_id, int version, std::string_view name)
+{
+  InventoryFolder folder;
+  [[maybe_unused]] bool known =
+    folder.assign_member("name", name) &&
+    folder.assign_member("version", std::to_string(version)) &&
+    folder.assign_member("folder_id", boost::uuids::to_string(folder_id)) &&
+    folder.assign_member("type_default", "-1") &&
+    folder.assign_member("parent_id", boost::uuids::to_string(parent_id));
+  assert(known);
+  return folder;
+}
+
+UUID new_id()
+{
+  static boost::uuids::random_generator generator;
+  UUID id;
+  static_cast<boost::uuids::uuid&>(id) = generator();
+  return id;
+}
+
+template<typename F>
+double measure_ms(F&& func, int times = repeat)
+{
+  auto const start = std::chrono::steady_clock::now();
+  for (int r = 0; r < times; ++r)
+    func();
+  std::chrono::duration<double, std::milli> const duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / times;
+}
+
+std::vector<InventorySkeleton::index_type> sorted(std::span<InventorySkeleton::index_type const> indices)
+{
+  std::vector<InventorySkeleton::index_type> result(indices.begin(), indices.end());
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(debug::init());
+
+  DecodeArena arena;
+  arena.make_current();
+  std::filesystem::path const filename = std::filesystem::temp_directory_path() / "inventory_skeleton_test.cache";
+
+  // A small tree:
+  //   root
+  //    ├── a
+  //    │   └── c
+  //    └── b
+  UUID const null_id;
+  UUID const root_id = new_id(), a_id = new_id(), b_id = new_id(), c_id = new_id();
+  std::vector<InventoryFolder> folders = {
+    make_folder(c_id, a_id, 1, "c"),
+    make_folder(root_id, null_id, 1, "My Inventory"),
+    make_folder(a_id, root_id, 1, "a"),
+    make_folder(b_id, root_id, 1, "b")
+  };
+  InventorySkeleton skeleton;
+  skeleton.build(folders);
+  {
+    assert(skeleton.size() == 4);
+    auto root = skeleton.find(root_id), a = skeleton.find(a_id), b = skeleton.find(b_id), c = skeleton.find(c_id);
+    assert(skeleton.find(new_id()) == InventorySkeleton::s_no_index);
+    assert(skeleton.roots().size() == 1 && skeleton.roots()[0] == root);
+    assert(skeleton.name(root) == "My Inventory");
+    assert(sorted(skeleton.children(root)) == sorted(std::vector{a, b}));
+    assert(skeleton.children(a).size() == 1 && skeleton.children(a)[0] == c);
+    assert(skeleton.children(b).empty() && skeleton.children(c).empty());
+    assert(skeleton.parent(c) == a && skeleton.parent(root) == InventorySkeleton::s_no_index);
+  }
+
+  // Only a larger version replaces a folder.
+  assert(skeleton.update(make_folder(b_id, root_id, 1, "old b")) == InventorySkeleton::unchanged);
+  assert(skeleton.name(skeleton.find(b_id)) == "b");
+  assert(skeleton.update(make_folder(c_id, root_id, 2, "moved c")) == InventorySkeleton::updated);
+  skeleton.rebuild_tree();
+  assert(skeleton.name(skeleton.find(c_id)) == "moved c");
+  assert(skeleton.parent(skeleton.find(c_id)) == skeleton.find(root_id));
+  assert(skeleton.children(skeleton.find(a_id)).empty());
+
+  // Save and load.
+  assert(skeleton.save(filename));
+  {
+    InventorySkeleton loaded;
+    assert(loaded.load(filename));
+    assert(loaded.size() == skeleton.size());
+    for (InventorySkeleton::index_type folder = 0; folder < skeleton.size(); ++folder)
+    {
+      auto const other = loaded.find(skeleton.folder_id(folder));
+      assert(other != InventorySkeleton::s_no_index);
+      assert(loaded.parent_id(other) == skeleton.parent_id(folder));
+      assert(loaded.version(other) == skeleton.version(folder));
+      assert(loaded.name(other) == skeleton.name(folder));
+      assert(loaded.children(other).size() == skeleton.children(folder).size());
+    }
+    assert(!loaded.load(filename.string() + ".does_not_exist"));
+    assert(loaded.empty() && loaded.roots().empty());
+
+    // A header that claims more data than the file contains is rejected before anything is allocated.
+    {
+      std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+      uint32_t const magic_and_version[2] = { 0x534e5649, InventorySkeleton::file_format_version };
+      uint64_t const sizes[2] = { 0xfffffffe, 0xffffffff };
+      file.write(reinterpret_cast<char const*>(magic_and_version), sizeof(magic_and_version));
+      file.write(reinterpret_cast<char const*>(sizes), sizeof(sizes));
+    }
+    assert(!loaded.load(filename));
+    assert(loaded.empty());
+  }
+
+  // Renaming a folder many times keeps the name correct (update compacts the names).
+  for (int version = 2; version < 1000; ++version)
+    assert(skeleton.update(make_folder(b_id, root_id, version, "b" + std::to_string(version))) == InventorySkeleton::updated);
+  assert(skeleton.name(skeleton.find(b_id)) == "b999" && skeleton.name(skeleton.find(root_id)) == "My Inventory");
+  assert(skeleton.update(make_folder(b_id, root_id, 1000, "b")) == InventorySkeleton::updated);
+
+  // Apply the folder list of the next login: a is gone, c has a new version and d is new.
+  UUID const d_id = new_id();
+  std::vector<InventoryFolder> next_login = {
+    make_folder(root_id, null_id, 1, "My Inventory"),
+    make_folder(b_id, root_id, 1, "b"),
+    make_folder(c_id, b_id, 3, "c"),
+    make_folder(d_id, c_id, 1, "d")
+  };
+  InventorySkeleton::DiffStatistics statistics = skeleton.apply(next_login);
+  assert(statistics.m_added == 1 && statistics.m_updated == 1 && statistics.m_unchanged == 2 && statistics.m_removed == 1);
+  assert(skeleton.size() == 4 && skeleton.find(a_id) == InventorySkeleton::s_no_index);
+  for (InventoryFolder const& folder : next_login)
+  {
+    auto const index = skeleton.find(folder.get_folder_id());
+    assert(skeleton.name(index) == folder.get_name());
+    assert(skeleton.parent(index) == skeleton.find(folder.get_parent_id()) ||
+        (folder.get_parent_id() == null_id && skeleton.parent(index) == InventorySkeleton::s_no_index));
+  }
+  Dout(dc::notice, "Small tree: " << skeleton);
+
+  // Benchmark: a random tree of number_of_folders folders.
+  std::mt19937 rng(42);
+  std::vector<UUID> ids(number_of_folders);
+  for (UUID& id : ids)
+    id = new_id();
+  folders.clear();
+  folders.reserve(number_of_folders);
+  for (int i = 0; i < number_of_folders; ++i)
+  {
+    UUID const& parent_id = i == 0 ? null_id : ids[std::uniform_int_distribution<int>(0, i - 1)(rng)];
+    folders.push_back(make_folder(ids[i], parent_id, 1, "Folder " + std::to_string(i)));
+  }
+  std::shuffle(folders.begin(), folders.end(), rng);
+
+  double const build_ms = measure_ms([&]{ skeleton.build(folders); });
+  assert(skeleton.size() == number_of_folders && skeleton.roots().size() == 1);
+
+  double const apply_unchanged_ms = measure_ms([&]{ skeleton.apply(folders); });
+
+  // One percent of the folders changed, was removed or is new.
+  std::vector<InventoryFolder> changed = folders;
+  for (int i = 0; i < number_of_folders / 100; ++i)
+  {
+    InventoryFolder& folder = changed[std::uniform_int_distribution<int>(0, number_of_folders - 1)(rng)];
+    folder = make_folder(folder.get_folder_id(), folder.get_parent_id(), folder.get_version() + 1, "Renamed");
+  }
+  changed.resize(changed.size() - number_of_folders / 300);
+  for (int i = 0; i < number_of_folders / 300; ++i)
+    changed.push_back(make_folder(new_id(), ids[0], 1, "New"));
+  double apply_changed_ms = 0;
+  for (int r = 0; r < repeat; ++r)
+  {
+    skeleton.build(folders);
+    apply_changed_ms += measure_ms([&]{ statistics = skeleton.apply(changed); }, 1) / repeat;
+    Dout(dc::notice, statistics);
+  }
+  assert(skeleton.size() == changed.size());
+
+  double const save_ms = measure_ms([&]{ skeleton.save(filename); });
+  double const load_ms = measure_ms([&]{ skeleton.load(filename); });
+  assert(skeleton.size() == changed.size());
+  std::filesystem::remove(filename);
+
+  std::cout << number_of_folders << " folders: build: " << build_ms << " ms, apply (no changes): " << apply_unchanged_ms <<
+    " ms, apply (1% changed): " << apply_changed_ms << " ms, save: " << save_ms << " ms, load: " << load_ms << " ms." << std::endl;
+}
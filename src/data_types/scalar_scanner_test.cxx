@@ -0,0 +1,198 @@
+#include "sys.h"
+#include "RegionHandle.h"
+#include "Vector3d.h"
+#include "RegionPositionLookAt.h"
+#include "utils/AIAlert.h"
+#include <boost/iostreams/stream.hpp>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "debug.h"
+
+// Checks that RegionHandle and Vector3d accept and reject exactly the same strings as the
+// std::istream based decoders that they used before, and compares the speed of both.
+
+namespace {
+
+// The old decoder, returning false instead of throwing.
+// N is the number of elements; T is the type of the elements.
+template<typename T, int N>
+bool istream_decode(std::string_view data, std::array<T, N>& out)
+{
+  boost::iostreams::stream<boost::iostreams::basic_array_source<char>> stream(data.begin(), data.end());
+  char expected = '[';
+  char c;
+  int i = 0;
+  for (;;)
+  {
+    stream >> c;
+    if (stream.eof() || c != expected)
+    {
+      if (std::isspace(c))
+        continue;
+      return false;
+    }
+    if (expected == '[')
+      expected = 'r';
+    else if (expected == ',')
+    {
+      ++i;
+      expected = 'r';
+    }
+    else if (expected == 'r')
+    {
+      expected = (i == N - 1) ? ']' : ',';
+      stream >> out[i];
+    }
+    else
+      break;
+  }
+  return true;
+}
+
+bool new_decode(std::string_view data, std::array<int, 2>& out)
+{
+  try
+  {
+    RegionHandle region_handle;
+    region_handle.assign_from_xmlrpc_string(data);
+    out = { region_handle.get_x(), region_handle.get_y() };
+  }
+  catch (AIAlert::Error const&)
+  {
+    return false;
+  }
+  return true;
+}
+
+bool new_decode(std::string_view data, std::array<float, 3>& out)
+{
+  try
+  {
+    Vector3d vec;
+    evio::protocol::xmlrpc::initialize(vec, data);
+    for (int i = 0; i < 3; ++i)
+      out[i] = vec[i];
+  }
+  catch (AIAlert::Error const&)
+  {
+    return false;
+  }
+  return true;
+}
+
+// The tuple scalars of a login response: region handles and vectors (home, look_at, ...).
+std::vector<std::string> const region_handles = {
+  "[r254208,r261120]",
+  "[r256000,r256000]",
+  "[r261888,r254720]"
+};
+
+std::vector<std::string> const vectors = {
+  "[r42.90096,r47.87543,r23.00385]",
+  "[r-0.9883952,r-0.02419114,r0.1499664]",
+  "[r0.8928223,r0.450409,r0]",
+  "[r128,r128,r21.5]",
+  "[r1,r0,r0]",
+  "[r0.7071068,r-0.7071068,r0]"
+};
+
+// Return a random mutation of one of inputs.
+std::string random_input(std::vector<std::string> const& inputs, std::mt19937& rng)
+{
+  static constexpr std::string_view alphabet = "[]r,0123456789.-+eE \t\nxinfa";
+  std::string str = inputs[rng() % inputs.size()];
+  int const mutations = rng() % 4;
+  for (int m = 0; m < mutations; ++m)
+  {
+    size_t const pos = rng() % (str.size() + 1);
+    char const c = alphabet[rng() % alphabet.size()];
+    switch (rng() % 4)
+    {
+      case 0:
+        str.insert(pos, 1, c);
+        break;
+      case 1:
+        if (pos < str.size())
+          str[pos] = c;
+        break;
+      case 2:
+        if (pos < str.size())
+          str.erase(pos, 1);
+        break;
+      case 3:
+        // Exponents that under- or overflow.
+        str.insert(pos, (rng() % 2) ? "e-50" : "e50");
+        break;
+    }
+  }
+  return str;
+}
+
+template<typename T, int N>
+void fuzz(std::vector<std::string> const& inputs, std::mt19937& rng, int iterations)
+{
+  int accepted = 0;
+  for (int n = 0; n < iterations; ++n)
+  {
+    std::string const str = random_input(inputs, rng);
+    std::array<T, N> expected, result;
+    bool const old_accepts = istream_decode<T, N>(str, expected);
+    bool const new_accepts = new_decode(str, result);
+    if (old_accepts != new_accepts || (old_accepts && expected != result))
+    {
+      std::cerr << "Mismatch for \"" << str << "\": old " << (old_accepts ? "accepts" : "rejects") <<
+        ", new " << (new_accepts ? "accepts" : "rejects") << "." << std::endl;
+      assert(false);
+    }
+    accepted += old_accepts;
+  }
+  Dout(dc::notice, "Fuzzed " << iterations << " strings with " << N << " elements; " << accepted << " were accepted.");
+}
+
+template<typename T, int N>
+void benchmark(std::vector<std::string> const& inputs, char const* what)
+{
+  constexpr int iterations = 100000;
+  std::array<T, N> out;
+  T sum = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (int n = 0; n < iterations; ++n)
+    for (std::string const& str : inputs)
+      if (istream_decode<T, N>(str, out))
+        sum += out[0];
+  auto const middle = std::chrono::steady_clock::now();
+  for (int n = 0; n < iterations; ++n)
+    for (std::string const& str : inputs)
+      if (new_decode(str, out))
+        sum -= out[0];
+  auto const end = std::chrono::steady_clock::now();
+  double const old_ns = std::chrono::duration<double, std::nano>(middle - start).count() / (iterations * inputs.size());
+  double const new_ns = std::chrono::duration<double, std::nano>(end - middle).count() / (iterations * inputs.size());
+  std::cout << what << ": std::istream: " << old_ns << " ns, ScalarScanner: " << new_ns << " ns (" <<
+    old_ns / new_ns << " times faster); checksum " << sum << "." << std::endl;
+}
+
+} // namespace
+
+int main()
+{
+  Debug(debug::init());
+
+  std::mt19937 rng(123);
+  fuzz<int, 2>(region_handles, rng, 200000);
+  fuzz<float, 3>(vectors, rng, 200000);
+
+  // How RegionHandle and Vector3d are decoded as part of the login response.
+  RegionPositionLookAt home;
+  home.assign_from_xmlrpc_string("{'region_handle':[r254208,r261120], 'position':[r42.90096,r47.87543,r23.00385], 'look_at':[r-0.9883952,r-0.02419114,r0.1499664]}");
+  Dout(dc::notice, "home = " << home);
+
+  benchmark<int, 2>(region_handles, "RegionHandle");
+  benchmark<float, 3>(vectors, "Vector3d");
+}
@@ -0,0 +1,81 @@
+#include "sys.h"
+#include "UUID.h"
+#include "UUIDMap.h"
+#include <boost/container_hash/hash.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "debug.h"
+
+// Compare UUID::assign_from_string with the boost::uuids::string_generator path that it replaced,
+// and UUIDMap with std::unordered_map, for the number of UUIDs that a login response contains.
+
+namespace {
+
+constexpr int number_of_uuids = 50000;
+constexpr int repeat = 20;
+
+template<typename F>
+double measure_ns_per_uuid(F&& func)
+{
+  auto const start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r)
+    func();
+  std::chrono::duration<double, std::nano> const duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / (repeat * number_of_uuids);
+}
+
+} // namespace
+
+int main()
+{
+  Debug(debug::init());
+
+  boost::uuids::random_generator generator;
+  std::vector<std::string> strings;
+  std::vector<UUID> uuids(number_of_uuids);
+  for (int i = 0; i < number_of_uuids; ++i)
+    strings.push_back(boost::uuids::to_string(generator()));
+
+  double const boost_ns = measure_ns_per_uuid([&]{
+    for (int i = 0; i < number_of_uuids; ++i)
+      new(&uuids[i]) boost::uuids::uuid{boost::uuids::string_generator()(strings[i].begin(), strings[i].end())};
+  });
+  double const uuid_ns = measure_ns_per_uuid([&]{
+    for (int i = 0; i < number_of_uuids; ++i)
+      uuids[i].assign_from_string(strings[i]);
+  });
+  std::cout << "Parsing: boost::uuids::string_generator: " << boost_ns << " ns/UUID, UUID::assign_from_string: " <<
+    uuid_ns << " ns/UUID (" << boost_ns / uuid_ns << " times faster)." << std::endl;
+
+  std::unordered_map<boost::uuids::uuid, int, boost::hash<boost::uuids::uuid>> unordered_map;
+  UUIDMap<int> uuid_map;
+  for (int i = 0; i < number_of_uuids; ++i)
+  {
+    unordered_map.emplace(uuids[i], i);
+    uuid_map.try_emplace(uuids[i], i);
+  }
+  // Half of the lookups miss.
+  std::vector<UUID> lookups(uuids);
+  for (int i = 0; i < number_of_uuids; i += 2)
+    static_cast<boost::uuids::uuid&>(lookups[i]) = generator();
+  long sum = 0;
+  double const unordered_map_ns = measure_ns_per_uuid([&]{
+    for (UUID const& key : lookups)
+      if (auto it = unordered_map.find(key); it != unordered_map.end())
+        sum += it->second;
+  });
+  double const uuid_map_ns = measure_ns_per_uuid([&]{
+    for (UUID const& key : lookups)
+      if (int const* value = uuid_map.find(key))
+        sum -= *value;
+  });
+  std::cout << "Lookup: std::unordered_map: " << unordered_map_ns << " ns/UUID, UUIDMap: " <<
+    uuid_map_ns << " ns/UUID (" << unordered_map_ns / uuid_map_ns << " times faster)." << std::endl;
+
+  // Both loops added the same values.
+  return sum == 0 ? 0 : 1;
+}
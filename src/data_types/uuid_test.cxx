@@ -1,5 +1,11 @@
 #include "sys.h"
 #include "UUID.h"
+#include "UUIDMap.h"
+#include <boost/uuid/random_generator.hpp>
+#include <cassert>
+#include <cctype>
+#include <random>
+#include <stdexcept>
 #include "debug.h"
 
 int main()
@@ -12,4 +18,64 @@ int main()
   UUID uuid(sv);
 
   Dout(dc::notice, uuid);
+
+  // Non-canonical forms are still accepted (by boost).
+  assert(UUID("{359062B2-ACEA-4DDA-AA3F-28FA4EA987CE}") == uuid);
+  assert(UUID("359062b2acea4ddaaa3f28fa4ea987ce") == uuid);
+
+  // The canonical decoder must agree with boost on every (in)valid string.
+  boost::uuids::random_generator generator;
+  std::mt19937 rng(42);
+  for (int n = 0; n < 100000; ++n)
+  {
+    std::string str = boost::uuids::to_string(generator());
+    if (n % 2 == 1)
+      for (char& c : str)
+        if (rng() % 2)
+          c = std::toupper(c);
+    if (n % 3 == 0)
+      str[rng() % str.size()] = static_cast<char>(rng() % 256);
+    bool valid = true;
+    boost::uuids::uuid expected;
+    try
+    {
+      expected = boost::uuids::string_generator()(str.begin(), str.end());
+    }
+    catch (std::runtime_error const&)
+    {
+      valid = false;
+    }
+    UUID decoded;
+    assert(decoded.assign_from_canonical_string(str) == valid);
+    assert(!valid || decoded == expected);
+  }
+  assert(!UUID().assign_from_canonical_string("359062b2-acea-4dda-aa3f-28fa4ea987c"));
+
+  // UUIDMap / UUIDSet.
+  UUIDMap<int> map;
+  UUIDSet set;
+  std::vector<UUID> keys(1000);
+  for (int i = 0; i < 1000; ++i)
+  {
+    static_cast<boost::uuids::uuid&>(keys[i]) = generator();
+    assert(map.try_emplace(keys[i], i).second);
+    assert(set.insert(keys[i]));
+  }
+  assert(map.size() == 1000 && set.size() == 1000);
+  for (int i = 0; i < 1000; i += 2)
+    assert(map.erase(keys[i]) && set.erase(keys[i]));
+  for (int i = 0; i < 1000; ++i)
+  {
+    int const* value = map.find(keys[i]);
+    assert((value != nullptr) == (i % 2 == 1) && (!value || *value == i));
+    assert(set.contains(keys[i]) == (i % 2 == 1));
+  }
+  // Moving leaves the source empty but usable.
+  UUIDMap<int> moved(std::move(map));
+  assert(moved.size() == 500 && map.empty() && !map.find(keys[1]));
+  map[keys[0]] = 42;
+  assert(map.size() == 1 && *map.find(keys[0]) == 42);
+  map = std::move(moved);
+  assert(map.size() == 500 && moved.empty() && !moved.contains(keys[1]) && *map.find(keys[1]) == 1);
+  Dout(dc::notice, "Success!");
 }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "evio/protocol/xmlrpc/ElementDecoder.h"
+#include <string_view>
+
+namespace xmlrpc {
+
+// An element decoder that accepts any value (scalar, array or struct, nested to any depth) and throws it away.
+//
+// Used to let the streaming decoder skip over members that are decoded otherwise, like the inventory
+// arrays of a login response that are decoded with ParallelArrayDecoder (see LoginResponseDecoder):
+// nothing is constructed for the skipped elements and no memory is allocated.
+class DiscardDecoder : public evio::protocol::xmlrpc::ElementDecoder
+{
+ public:
+  DiscardDecoder() = default;
+
+ protected:
+  evio::protocol::xmlrpc::ElementDecoder* get_member_decoder(std::string_view const& UNUSED_ARG(name)) override { return this; }
+  evio::protocol::xmlrpc::ElementDecoder* get_array_decoder() override { return this; }
+  evio::protocol::xmlrpc::ElementDecoder* get_struct_decoder() override { return this; }
+  void got_member_type(evio::protocol::xmlrpc::data_type UNUSED_ARG(type), char const* UNUSED_ARG(struct_name)) override { }
+  void got_characters(std::string_view const& UNUSED_ARG(data)) override { }
+  void got_data() override { }
+};
+
+} // namespace xmlrpc
@@ -0,0 +1,202 @@
+#include "sys.h"
+#include "ParallelArrayDecoder.h"
+#include "threadpool/AIThreadPool.h"
+#include "utils/AIAlert.h"
+#include "utils/print_using.h"
+#include "utils/c_escape.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include "debug.h"
+
+namespace xmlrpc {
+
+namespace {
+
+// Return the contents of the next tag at or after pos (for example "value", "/value" or "value/")
+// and set pos to just after it. Returns an empty string_view if there are no more tags.
+std::string_view next_tag(std::string_view xml, size_t& pos, size_t* tag_start = nullptr)
+{
+  size_t const lt = xml.find('<', pos);
+  if (lt == std::string_view::npos)
+    return {};
+  size_t const gt = xml.find('>', lt);
+  if (gt == std::string_view::npos)
+    THROW_ALERT("Unterminated tag in XML-RPC data \"[DATA]\"", AIArgs("[DATA]", utils::print_using(xml.substr(lt, 32), utils::c_escape)));
+  if (tag_start)
+    *tag_start = lt;
+  pos = gt + 1;
+  return xml.substr(lt + 1, gt - lt - 1);
+}
+
+void expect_tag(std::string_view xml, size_t& pos, std::string_view expected)
+{
+  std::string_view const tag = next_tag(xml, pos);
+  if (tag != expected)
+    THROW_ALERT("Expected <[EXPECTED]> in XML-RPC data, got <[TAG]>", AIArgs("[EXPECTED]", expected)("[TAG]", tag));
+}
+
+// The ranges of one ParallelArrayDecoder::decode call.
+//
+// The jobs that are posted to the thread pool keep this alive, because they might only run after
+// the call already returned (when the calling thread decoded all ranges itself). decode_range is
+// only called for a range that was claimed, which can't happen anymore once the call returned.
+class Ranges
+{
+ private:
+  int const m_number_of_ranges;
+  std::function<void(int)> const m_decode_range;
+  std::atomic<int> m_next_range{0};
+  std::atomic<int> m_finished_ranges{0};
+
+ public:
+  Ranges(int number_of_ranges, std::function<void(int)> decode_range) :
+    m_number_of_ranges(number_of_ranges), m_decode_range(std::move(decode_range)) { }
+
+  // Claim and decode ranges until there are none left.
+  void work()
+  {
+    for (int range = m_next_range.fetch_add(1); range < m_number_of_ranges; range = m_next_range.fetch_add(1))
+    {
+      m_decode_range(range);
+      if (m_finished_ranges.fetch_add(1) + 1 == m_number_of_ranges)
+        m_finished_ranges.notify_all();
+    }
+  }
+
+  // Block until every range is finished.
+  void wait()
+  {
+    for (int finished = m_finished_ranges.load(); finished < m_number_of_ranges; finished = m_finished_ranges.load())
+      m_finished_ranges.wait(finished);
+  }
+};
+
+} // namespace
+
+void ParallelArrayDecoder::run_ranges(int number_of_ranges, std::function<void(int)> decode_range)
+{
+  auto ranges = std::make_shared<Ranges>(number_of_ranges, std::move(decode_range));
+  if (number_of_ranges > 1)
+  {
+    auto& queue = AIThreadPool::instance().get_queue(m_queue);
+    for (int job = 1; job < number_of_ranges; ++job)
+    {
+      {
+        auto queue_access = queue.producer_access();
+        if (queue_access.length() >= static_cast<int>(queue.capacity()))
+          break;        // The queue is full; the calling thread decodes the remaining ranges.
+        queue_access.move_in([ranges]() -> bool { ranges->work(); return false; });
+      }
+      queue.notify_one();
+    }
+  }
+  ranges->work();
+  ranges->wait();
+}
+
+std::string_view find_array_data(std::string_view response_xml, std::string_view member_name)
+{
+  std::string const name_element = "<name>" + std::string{member_name} + "</name>";
+  size_t pos = response_xml.find(name_element);
+  if (pos == std::string_view::npos)
+    THROW_ALERT("No member \"[NAME]\" in XML-RPC response", AIArgs("[NAME]", member_name));
+  pos += name_element.size();
+  expect_tag(response_xml, pos, "value");
+  expect_tag(response_xml, pos, "array");
+  std::string_view const data_tag = next_tag(response_xml, pos);
+  if (data_tag == "data/")
+    return {};
+  if (data_tag != "data")
+    THROW_ALERT("Expected <data> in XML-RPC array \"[NAME]\", got <[TAG]>", AIArgs("[NAME]", member_name)("[TAG]", data_tag));
+  // The end of the array is found by split_array_elements.
+  return response_xml.substr(pos);
+}
+
+std::vector<std::string_view> split_array_elements(std::string_view array_data)
+{
+  std::vector<std::string_view> elements;
+  if (array_data.empty())       // An empty array: <data/>.
+    return elements;
+  // This is the part that is not done in parallel, so it is kept as simple as possible:
+  // jump from '<' to '<' and only look at the few tags that matter.
+  auto at = [&](char const* p, std::string_view s){ return static_cast<size_t>(array_data.data() + array_data.size() - p) >= s.size() && std::memcmp(p, s.data(), s.size()) == 0; };
+  char const* const end = array_data.data() + array_data.size();
+  char const* element_start = nullptr;
+  int depth = 0;
+  for (char const* p = array_data.data(); (p = static_cast<char const*>(std::memchr(p, '<', end - p))); ++p)
+  {
+    if (at(p, "<value>"))
+    {
+      if (depth++ == 0)
+        element_start = p;
+    }
+    else if (at(p, "</value>"))
+    {
+      if (--depth == 0)
+        elements.emplace_back(element_start, p + 8 - element_start);
+      else if (depth < 0)
+        THROW_ALERT("Unbalanced </value> in XML-RPC array");
+    }
+    else if (depth == 0)
+    {
+      if (at(p, "</data>"))
+        return elements;
+      if (at(p, "<value/>"))
+        elements.emplace_back(p, 8);
+    }
+  }
+  THROW_ALERT("Unterminated XML-RPC array");
+}
+
+StructScanner::StructScanner(std::string_view element_xml) : m_xml(element_xml), m_pos(0)
+{
+  expect_tag(m_xml, m_pos, "value");
+  expect_tag(m_xml, m_pos, "struct");
+}
+
+bool StructScanner::next_member(std::string_view& name, std::string_view& data)
+{
+  std::string_view tag = next_tag(m_xml, m_pos);
+  if (tag == "/struct")
+    return false;
+  if (tag != "member")
+    THROW_ALERT("Expected <member> in XML-RPC struct, got <[TAG]>", AIArgs("[TAG]", tag));
+  expect_tag(m_xml, m_pos, "name");
+  size_t const name_begin = m_pos;
+  size_t name_end;
+  next_tag(m_xml, m_pos, &name_end);
+  name = m_xml.substr(name_begin, name_end - name_begin);
+  expect_tag(m_xml, m_pos, "value");
+
+  size_t const data_begin = m_pos;
+  size_t data_end;
+  tag = next_tag(m_xml, m_pos, &data_end);
+  if (tag == "/value")
+  {
+    // A value without type is a string.
+    data = m_xml.substr(data_begin, data_end - data_begin);
+  }
+  else if (!tag.empty() && tag.back() == '/')
+  {
+    // An empty value, like <string/>.
+    data = {};
+    expect_tag(m_xml, m_pos, "/value");
+  }
+  else
+  {
+    if (tag == "struct" || tag == "array")
+      THROW_ALERT("The value of member \"[NAME]\" is not a scalar", AIArgs("[NAME]", name));
+    size_t const typed_data_begin = m_pos;
+    std::string_view const type = tag;
+    tag = next_tag(m_xml, m_pos, &data_end);
+    if (tag.size() != type.size() + 1 || tag[0] != '/' || tag.substr(1) != type)
+      THROW_ALERT("Expected </[TYPE]> in XML-RPC value, got <[TAG]>", AIArgs("[TYPE]", type)("[TAG]", tag));
+    data = m_xml.substr(typed_data_begin, data_end - typed_data_begin);
+    expect_tag(m_xml, m_pos, "/value");
+  }
+  expect_tag(m_xml, m_pos, "/member");
+  return true;
+}
+
+} // namespace xmlrpc
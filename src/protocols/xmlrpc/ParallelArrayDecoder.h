@@ -0,0 +1,144 @@
+#pragma once
+
+#include "data_types/DecodeArena.h"
+#include "threadpool/AIQueueHandle.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+namespace xmlrpc {
+
+// Return the part of the fully buffered XML-RPC response response_xml that follows the <data> tag of
+// the array that is the value of the member member_name. Throws if there is no such member.
+std::string_view find_array_data(std::string_view response_xml, std::string_view member_name);
+
+// Return the <value> elements of array_data (as returned by find_array_data), in order, up till the
+// </data> tag that ends the array. This is a structural pre-scan: it only looks at the tags, not at
+// the text in between.
+std::vector<std::string_view> split_array_elements(std::string_view array_data);
+
+// Iterates over the members of a single "<value><struct>...</struct></value>" element.
+// Only scalar member values are supported.
+class StructScanner
+{
+ private:
+  std::string_view m_xml;
+  size_t m_pos;
+
+ public:
+  StructScanner(std::string_view element_xml);
+
+  // Return the name and (still xml escaped) data of the next member, or false if there are no more members.
+  bool next_member(std::string_view& name, std::string_view& data);
+};
+
+// Decodes an array member of a fully buffered XML-RPC response, like the inventory_skeleton of the
+// login response, using the threads of the thread pool.
+//
+// When the whole response is available the elements of an array are independent of each other:
+// the pre-scan (split_array_elements) finds the boundaries of the elements, which are then divided
+// into contiguous ranges. Up to one job less than there are ranges is posted to the thread pool
+// queue; the calling thread decodes ranges too, and then waits until every range is finished. Each
+// range is decoded directly into the preallocated slots of the output vector, so the order of the
+// elements is kept without any stitching. If the pool is busy (or the queue is full) the calling
+// thread simply decodes more of the ranges itself.
+//
+// Every range uses its own DecodeArena (for ArenaString members). Those arenas are owned by the
+// ParallelArrayDecoder, which therefore must live at least as long as the decoded elements.
+//
+// T must have a member function `bool assign_member(std::string_view name, std::string_view data)`
+// that returns false for unknown members (see XMLRPC_ASSIGN_MEMBER_BY_NAME).
+class ParallelArrayDecoder
+{
+ public:
+  static constexpr size_t s_min_elements_per_thread = 512;      // Don't create a range with less than this number of elements.
+
+  struct Timing
+  {
+    size_t m_elements;                  // The number of decoded elements.
+    int m_threads;                      // The number of ranges (that is, the maximum number of threads that decoded concurrently).
+    double m_scan_ms;                   // The time spent in the pre-scan.
+    double m_decode_ms;                 // The time spent decoding the elements (wall clock).
+  };
+
+ private:
+  AIQueueHandle m_queue;                // The thread pool queue that the jobs are posted to.
+  int m_number_of_threads;
+  std::vector<std::unique_ptr<DecodeArena>> m_arenas;
+
+  // Call decode_range(range) for every range in [0, number_of_ranges), on the calling thread and
+  // the thread pool, and return when all of them are finished.
+  void run_ranges(int number_of_ranges, std::function<void(int)> decode_range);
+
+ public:
+  ParallelArrayDecoder(AIQueueHandle queue, int number_of_threads = 0) :        // Zero means: use std::thread::hardware_concurrency.
+    m_queue(queue), m_number_of_threads(number_of_threads > 0 ? number_of_threads : std::max(1U, std::thread::hardware_concurrency())) { }
+
+  // Decode the array member member_name of response_xml into out, replacing its previous content.
+  // The current DecodeArena of the calling thread is left unchanged.
+  template<typename T>
+  Timing decode(std::string_view response_xml, std::string_view member_name, std::vector<T>& out);
+};
+
+template<typename T>
+ParallelArrayDecoder::Timing ParallelArrayDecoder::decode(std::string_view response_xml, std::string_view member_name, std::vector<T>& out)
+{
+  using clock_type = std::chrono::steady_clock;
+  clock_type::time_point const start = clock_type::now();
+  std::vector<std::string_view> const elements = split_array_elements(find_array_data(response_xml, member_name));
+  clock_type::time_point const scanned = clock_type::now();
+
+  size_t const number_of_elements = elements.size();
+  int const number_of_ranges = std::clamp(static_cast<int>(number_of_elements / s_min_elements_per_thread), 1, m_number_of_threads);
+  out.clear();
+  out.resize(number_of_elements);
+
+  // Add new arenas; the ones of previous calls might still be in use by elements decoded back then.
+  size_t const first_arena = m_arenas.size();
+  for (int i = 0; i < number_of_ranges; ++i)
+    m_arenas.push_back(std::make_unique<DecodeArena>());
+
+  std::vector<std::exception_ptr> errors(number_of_ranges);
+  std::vector<size_t> unknown_members(number_of_ranges);
+  run_ranges(number_of_ranges, [&](int range){
+    DecodeArena::ScopedCurrent current_arena(*m_arenas[first_arena + range]);
+    size_t const begin = number_of_elements * range / number_of_ranges;
+    size_t const end = number_of_elements * (range + 1) / number_of_ranges;
+    try
+    {
+      for (size_t i = begin; i < end; ++i)
+      {
+        StructScanner scanner(elements[i]);
+        std::string_view name, data;
+        while (scanner.next_member(name, data))
+          if (!out[i].assign_member(name, data))
+            ++unknown_members[range];
+      }
+    }
+    catch (...)
+    {
+      errors[range] = std::current_exception();
+    }
+  });
+  for (std::exception_ptr const& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+  Dout(dc::warning(std::ranges::any_of(unknown_members, [](size_t n){ return n > 0; })),
+      "Ignored unknown members in the elements of " << member_name << ".");
+
+  clock_type::time_point const decoded = clock_type::now();
+  return {
+    .m_elements = number_of_elements,
+    .m_threads = number_of_ranges,
+    .m_scan_ms = std::chrono::duration<double, std::milli>(scanned - start).count(),
+    .m_decode_ms = std::chrono::duration<double, std::milli>(decoded - scanned).count()
+  };
+}
+
+} // namespace xmlrpc
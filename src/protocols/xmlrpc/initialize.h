@@ -8,4 +8,25 @@
 
 namespace xmlrpc {
 
+// Return true if the XML-RPC member name xml_name refers to the C++ member identifier.
+// XML-RPC member names sometimes use dashes where the identifier has an underscore (for example "inventory-skeleton").
+inline bool is_member_name(std::string_view xml_name, std::string_view identifier)
+{
+  if (xml_name.size() != identifier.size())
+    return false;
+  for (size_t i = 0; i < xml_name.size(); ++i)
+    if (xml_name[i] != identifier[i] && !(xml_name[i] == '-' && identifier[i] == '_'))
+      return false;
+  return true;
+}
+
 } // namespace xmlrpc
+
+// Use as xmlrpc_<Struct>_FOREACH_MEMBER(XMLRPC_ASSIGN_MEMBER_BY_NAME) in the body of
+// bool assign_member(std::string_view name, std::string_view data), followed by return false.
+#define XMLRPC_ASSIGN_MEMBER_BY_NAME(type, el) \
+  if (xmlrpc::is_member_name(name, #el)) \
+  { \
+    evio::protocol::xmlrpc::initialize(m_##el, data); \
+    return true; \
+  }
@@ -0,0 +1,133 @@
+#include "sys.h"
+#include "response/LoginResponse.h"
+#include "data_types/InventoryFolder.h"
+#include "evio/EventLoop.h"
+#include "evio/File.h"
+#include "threadpool/AIThreadPool.h"
+#include "utils/threading/Gate.h"
+#include "utils/AIAlert.h"
+#include <boost/uuid/random_generator.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+// Report the time it takes to decode a whole login response, versus the number of folders in its
+// inventory-skeleton: first with the streaming decoder only (serial), and then with the inventory
+// arrays decoded in parallel, with 1 up to the number of hardware threads.
+
+namespace {
+
+// Return a login response with (only) an inventory-skeleton of number_of_folders folders.
+std::string login_response(int number_of_folders)
+{
+  boost::uuids::random_generator generator;
+  std::string root = boost::uuids::to_string(generator());
+  std::string xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?><methodResponse><params><param><value><struct>"
+    "<member><name>inventory-skeleton</name><value><array><data>";
+  for (int i = 0; i < number_of_folders; ++i)
+  {
+    xml += "<value><struct>";
+    xml += "<member><name>name</name><value><string>Folder " + std::to_string(i) + (i % 10 == 0 ? " &amp; more" : "") + "</string></value></member>";
+    xml += "<member><name>version</name><value><i4>" + std::to_string(i % 100) + "</i4></value></member>";
+    xml += "<member><name>folder_id</name><value><string>" + boost::uuids::to_string(generator()) + "</string></value></member>";
+    xml += "<member><name>type_default</name><value><i4>-1</i4></value></member>";
+    xml += "<member><name>parent_id</name><value><string>" + root + "</string></value></member>";
+    xml += "</struct></value>\n";
+  }
+  xml += "</data></array></value></member></struct></value></param></params></methodResponse>";
+  return xml;
+}
+
+// Reads a login response from disk and opens the gate when done.
+class LoginResponseFile : public evio::File
+{
+ private:
+  xmlrpc::LoginResponse m_login_response;
+  xmlrpc::LoginResponseDecoder m_decoder;
+  utils::threading::Gate& m_finished;
+
+ public:
+  // Serial decoding.
+  LoginResponseFile(utils::threading::Gate& finished) : m_decoder(m_login_response), m_finished(finished)
+  {
+    set_protocol_decoder(m_decoder);
+  }
+
+  // Decode the inventory arrays with up to number_of_threads threads of queue.
+  LoginResponseFile(utils::threading::Gate& finished, AIQueueHandle queue, int number_of_threads) :
+    m_decoder(m_login_response, queue, number_of_threads), m_finished(finished)
+  {
+    set_protocol_decoder(m_decoder);
+  }
+
+  size_t number_of_folders() const { return m_login_response.get_inventory_skeleton().size(); }
+  double decode_ms() const { return std::chrono::duration<double, std::milli>(m_decoder.decode_time()).count(); }
+
+  void closed(int& UNUSED_ARG(allow_deletion_count)) override
+  {
+    m_finished.open();
+  }
+};
+
+// Decode the login response in path; if number_of_threads is empty, serially. Return the decode time in milliseconds.
+double decode_login_response(std::filesystem::path const& path, AIQueueHandle queue, std::optional<int> number_of_threads, size_t expected_folders)
+{
+  utils::threading::Gate finished;
+  boost::intrusive_ptr<LoginResponseFile> file = number_of_threads ?
+      evio::create<LoginResponseFile>(finished, queue, *number_of_threads) : evio::create<LoginResponseFile>(finished);
+  file->open(path.string(), std::ios_base::in);
+  finished.wait();
+  if (file->number_of_folders() != expected_folders)
+    THROW_ALERT("Decoded [DECODED] folders instead of [EXPECTED].", AIArgs("[DECODED]", file->number_of_folders())("[EXPECTED]", expected_folders));
+  return file->decode_ms();
+}
+
+} // namespace
+
+int main()
+{
+  Debug(debug::init());
+
+  int const hardware_threads = std::max(1U, std::thread::hardware_concurrency());
+  // The decoding thread decodes one of the ranges itself; one more thread for the event loop.
+  AIThreadPool thread_pool(hardware_threads + 1);
+  AIQueueHandle const event_loop_queue = thread_pool.new_queue(8);
+  AIQueueHandle const decode_queue = thread_pool.new_queue(hardware_threads);
+  evio::EventLoop event_loop(event_loop_queue);
+
+  std::filesystem::path const path = std::filesystem::temp_directory_path() / "parallel_decode_benchmark.xml";
+  try
+  {
+    std::cout << std::setw(10) << "folders" << std::setw(9) << "threads" << std::setw(12) << "decode ms" << std::setw(10) << "speedup" << std::endl;
+    for (int number_of_folders : { 1000, 10000, 100000, 300000 })
+    {
+      {
+        std::ofstream ofs(path);
+        ofs << login_response(number_of_folders);
+        if (!ofs.flush())
+          THROW_ALERT("Could not write [PATH].", AIArgs("[PATH]", path.string()));
+      }
+      double const serial_ms = decode_login_response(path, decode_queue, std::nullopt, number_of_folders);
+      std::cout << std::setw(10) << number_of_folders << std::setw(9) << "serial" << std::setw(12) << serial_ms << std::setw(10) << 1.0 << std::endl;
+      for (int threads = 1; threads <= hardware_threads; ++threads)
+      {
+        double const parallel_ms = decode_login_response(path, decode_queue, threads, number_of_folders);
+        std::cout << std::setw(10) << number_of_folders << std::setw(9) << threads << std::setw(12) << parallel_ms << std::setw(10) << serial_ms / parallel_ms << std::endl;
+      }
+    }
+  }
+  catch (AIAlert::Error const& error)
+  {
+    std::cerr << error << std::endl;
+  }
+  std::filesystem::remove(path);
+
+  event_loop.join();
+}
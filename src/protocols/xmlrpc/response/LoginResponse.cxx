@@ -1,6 +1,8 @@
 #include "sys.h"
 #include "LoginResponse.h"
 #include "evio/protocol/xmlrpc/create_member_decoder.h"
+#include "utils/AIAlert.h"
+#include "debug.h"
 
 namespace xmlrpc {
 
@@ -52,6 +54,24 @@ std::array<char const*, LoginResponse::s_number_of_members> LoginResponse::s_mem
 
 evio::protocol::xmlrpc::ElementDecoder* LoginResponseData::create_member_decoder(members member)
 {
+  // This is called, by the decoding thread, before each member is decoded.
+  // LoginResponseDecoder already made m_arena current for the duration of the decode call (and will restore
+  // the previous arena afterwards); this is for other decoders, which leave it current after decoding.
+  m_arena.make_current();
+  if (m_parallel_array_decoder)
+  {
+    // Let the streaming decoder skip the inventory arrays; they are decoded by decode_skipped_inventory.
+    if (member == member_inventory_skeleton)
+    {
+      m_skipped_inventory_skeleton = true;
+      return &m_discard_decoder;
+    }
+    if (member == member_inventory_skel_lib)
+    {
+      m_skipped_inventory_skel_lib = true;
+      return &m_discard_decoder;
+    }
+  }
   switch (member)
   {
     xmlrpc_LoginResponse_FOREACH_MEMBER(XMLRPC_CASE_RETURN_MEMBER_DECODER)
@@ -59,6 +79,27 @@ evio::protocol::xmlrpc::ElementDecoder* LoginResponseData::create_member_decoder
   AI_NEVER_REACHED
 }
 
+void LoginResponseData::skip_inventory_arrays(AIQueueHandle queue, int number_of_threads)
+{
+  m_parallel_array_decoder = std::make_unique<ParallelArrayDecoder>(queue, number_of_threads);
+}
+
+void LoginResponseData::decode_skipped_inventory(std::string_view response_xml)
+{
+  DoutEntering(dc::notice, "LoginResponseData::decode_skipped_inventory(" << response_xml.size() << " bytes)");
+  ASSERT(m_parallel_array_decoder);
+  if (m_skipped_inventory_skeleton)
+  {
+    ParallelArrayDecoder::Timing const t = m_parallel_array_decoder->decode(response_xml, "inventory-skeleton", m_inventory_skeleton);
+    Dout(dc::notice, "Decoded " << t.m_elements << " folders of inventory-skeleton with " << t.m_threads << " threads: pre-scan " << t.m_scan_ms << " ms, decode " << t.m_decode_ms << " ms.");
+  }
+  if (m_skipped_inventory_skel_lib)
+  {
+    ParallelArrayDecoder::Timing const t = m_parallel_array_decoder->decode(response_xml, "inventory-skel-lib", m_inventory_skel_lib);
+    Dout(dc::notice, "Decoded " << t.m_elements << " folders of inventory-skel-lib with " << t.m_threads << " threads: pre-scan " << t.m_scan_ms << " ms, decode " << t.m_decode_ms << " ms.");
+  }
+}
+
 #ifdef CWDEBUG
 void LoginResponseData::print_on(std::ostream& os) const
 {
@@ -69,4 +110,42 @@ void LoginResponseData::print_on(std::ostream& os) const
 }
 #endif
 
+namespace {
+
+// Return true if response_xml ends with the closing tag of an XML-RPC response (ignoring trailing white space).
+bool is_complete_response(std::string_view response_xml)
+{
+  static constexpr std::string_view end_tag = "</methodResponse>";
+  size_t const last = response_xml.find_last_not_of(" \t\r\n");
+  return last != std::string_view::npos && response_xml.substr(0, last + 1).ends_with(end_tag);
+}
+
+} // namespace
+
+void LoginResponseDecoder::decode(int& allow_deletion_count, evio::MsgBlock&& msg)
+{
+  clock_type::time_point const start = clock_type::now();
+  if (m_parallel)
+    m_response_xml.append(msg.get_start(), msg.get_size());
+  {
+    DecodeArena::ScopedCurrent current_arena(m_response_data.m_arena);
+    evio::protocol::xmlrpc::Decoder::decode(allow_deletion_count, std::move(msg));
+  }
+  if (m_parallel && !m_finished && is_complete_response(m_response_xml))
+  {
+    m_finished = true;
+    try
+    {
+      m_response_data.decode_skipped_inventory(m_response_xml);
+    }
+    catch (AIAlert::Error const& error)
+    {
+      Dout(dc::warning, error);
+    }
+    // The decoded inventory doesn't refer to the buffered response.
+    std::string().swap(m_response_xml);
+  }
+  m_decode_time += clock_type::now() - start;
+}
+
 } // namespace xmlrpc
@@ -16,8 +16,18 @@
 #include "data_types/LoginFlags.h"
 #include "data_types/Vector3d.h"
 #include "data_types/UIConfig.h"
+#include "data_types/DecodeArena.h"
+#include "protocols/xmlrpc/ParallelArrayDecoder.h"
+#include "protocols/xmlrpc/DiscardDecoder.h"
+#include "threadpool/AIQueueHandle.h"
 #include "evio/protocol/xmlrpc/SingleStructResponse.h"
+#include "evio/protocol/xmlrpc/Decoder.h"
 #include "evio/protocol/xmlrpc/macros.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 // FIXME: event_notifications has unknown struct (not std::string)
 #define xmlrpc_LoginResponse_FOREACH_MEMBER(X) \
@@ -65,10 +75,23 @@
 
 namespace xmlrpc {
 
+// The string members of the (potentially huge) arrays of the login response, like the name of every
+// InventoryFolder in inventory_skeleton, are ArenaString's: they are stored in m_arena and freed all at
+// once together with the response.
+//
+// When decoded by a LoginResponseDecoder that was constructed with a thread pool queue, the streaming
+// decoder skips inventory_skeleton and inventory_skel_lib; those are decoded with a ParallelArrayDecoder
+// once the whole response was received instead.
 class LoginResponseData
 {
  private:
+  friend class LoginResponseDecoder;
+  DecodeArena m_arena;                  // Must be declared before the members that use it.
+  std::unique_ptr<ParallelArrayDecoder> m_parallel_array_decoder;      // Idem. Only set when the inventory arrays are decoded in parallel.
   xmlrpc_LoginResponse_FOREACH_MEMBER(XMLRPC_DECLARE_MEMBER)
+  DiscardDecoder m_discard_decoder;                                    // Given to the streaming decoder for the inventory arrays that are decoded in parallel.
+  bool m_skipped_inventory_skeleton = false;                           // Set when the streaming decoder skipped inventory_skeleton.
+  bool m_skipped_inventory_skel_lib = false;                           // Idem for inventory_skel_lib.
 
  public:
   enum members : unsigned char {
@@ -77,10 +100,21 @@ class LoginResponseData
 
   evio::protocol::xmlrpc::ElementDecoder* create_member_decoder(members member);
 
+  // Accessors.
+  std::vector<InventoryFolder> const& get_inventory_skeleton() const { return m_inventory_skeleton; }
+  std::vector<InventoryFolder> const& get_inventory_skel_lib() const { return m_inventory_skel_lib; }
+
 #ifdef CWDEBUG
   void print_on(std::ostream& os) const;
   friend std::ostream& operator<<(std::ostream& os, LoginResponseData const& data) { data.print_on(os); return os; }
 #endif
+
+ private:
+  // Called by LoginResponseDecoder, before decoding starts: let the streaming decoder skip the inventory
+  // arrays, which are going to be decoded with up to number_of_threads threads of the thread pool queue queue.
+  void skip_inventory_arrays(AIQueueHandle queue, int number_of_threads);
+  // Called by LoginResponseDecoder once the whole response, response_xml, was received: decode the skipped arrays.
+  void decode_skipped_inventory(std::string_view response_xml);
 };
 
 struct LoginResponse : public LoginResponseData, public evio::protocol::xmlrpc::SingleStructResponse<LoginResponseData>
@@ -88,4 +122,43 @@ struct LoginResponse : public LoginResponseData, public evio::protocol::xmlrpc::
   LoginResponse() : evio::protocol::xmlrpc::SingleStructResponse<LoginResponseData>(static_cast<LoginResponseData&>(*this)) { }
 };
 
+// The protocol decoder to use for a LoginResponse.
+//
+// It makes the DecodeArena of the response the current arena of the decoding thread only for the
+// duration of each decode call, restoring the previous one afterwards. Hence nothing is left behind
+// in the thread-local current arena once the response is decoded, and responses that are decoded
+// interleaved on the same thread never put their strings in each other's arena.
+//
+// When constructed with a thread pool queue, the (potentially huge) inventory arrays are not decoded
+// by the streaming decoder: the received data is kept and, once the end of the response is received,
+// the arrays are decoded with up to number_of_threads threads of that queue (see ParallelArrayDecoder).
+class LoginResponseDecoder : public evio::protocol::xmlrpc::Decoder
+{
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+ private:
+  LoginResponseData& m_response_data;
+  bool const m_parallel;                                // Set if the inventory arrays are decoded in parallel.
+  std::string m_response_xml;                           // The data received so far. Only used when m_parallel is set.
+  bool m_finished = false;                              // Set once the end of the response was received.
+  clock_type::duration m_decode_time{};                 // The total time spent in decode.
+
+ public:
+  LoginResponseDecoder(LoginResponse& response) :
+    evio::protocol::xmlrpc::Decoder(response), m_response_data(response), m_parallel(false) { }
+
+  LoginResponseDecoder(LoginResponse& response, AIQueueHandle parallel_decode_queue, int number_of_threads = 0) :
+    evio::protocol::xmlrpc::Decoder(response), m_response_data(response), m_parallel(true)
+  {
+    m_response_data.skip_inventory_arrays(parallel_decode_queue, number_of_threads);
+  }
+
+  // Return the time spent decoding the response: the streaming decode plus, if any, the parallel decode of the inventory arrays.
+  clock_type::duration decode_time() const { return m_decode_time; }
+
+ protected:
+  void decode(int& allow_deletion_count, evio::MsgBlock&& msg) override;
+};
+
 } // namespace xmlrpc
@@ -13,14 +13,14 @@
 //
 class RandomPositions final : public vulkan::shader_builder::VertexShaderInputSet<InstanceData>
 {
-  std::random_device m_random_device;
   std::mt19937 m_generator;
   std::uniform_real_distribution<float> m_distribution_xy;
   std::uniform_real_distribution<float> m_distribution_z;
 
  public:
   // Constructor. Initialize the random number generator and distributions.
-  RandomPositions() : m_generator(m_random_device()), m_distribution_xy(-1.0f, 1.0f), m_distribution_z(0.0f, 1.0f) { }
+  // Use Application::random_seed() for seed, so that the positions are the same every benchmark run.
+  RandomPositions(uint32_t seed) : m_generator(seed), m_distribution_xy(-1.0f, 1.0f), m_distribution_z(0.0f, 1.0f) { }
 
  private:
   // Returns the number of instances.
@@ -1,17 +1,23 @@
 #pragma once
 
+#include <array>
+
 struct SampleParameters
 {
   static constexpr int s_max_object_count = 3000;
   static constexpr int s_quad_tessellation = 300;
+  static constexpr int s_max_recording_threads = 8;
 
   int ObjectCount;
   int PreSubmitCpuWorkTime;
   int PostSubmitCpuWorkTime;
   int SwapchainCount;
   int FrameResourcesCount;
+  int RecordingThreads;
+  bool DrawCallPerObject;
   float m_frame_generation_time;
   float m_total_frame_time;
+  std::array<float, s_max_recording_threads> m_recording_time;  // Average CPU time spent recording the main pass, per number of recording threads.
   bool m_show_fps = true;
 
   SampleParameters() :
@@ -20,8 +26,11 @@ struct SampleParameters
     PostSubmitCpuWorkTime(4),
     SwapchainCount(3),
     FrameResourcesCount(2),
+    RecordingThreads(1),
+    DrawCallPerObject(false),
     m_frame_generation_time(0),
-    m_total_frame_time(0)
+    m_total_frame_time(0),
+    m_recording_time{}
   {
   }
 };
@@ -17,7 +17,7 @@
 #include <vulkan/queues/CopyDataToImage.h>
 #include <vulkan/shader_builder/ShaderIndex.h>
 #include <vulkan/shader_builder/shader_resource/CombinedImageSampler.h>
-#include <vulkan/vk_utils/ImageData.h>
+#include <vulkan/vk_utils/PNGImageDataFeeder.h>
 #include <utils/threading/aithreadid.h>
 
 #include <imgui.h>
@@ -67,7 +67,7 @@ class Window : public vulkan::task::SynchronousWindow
 
   // Vertex buffer generators.
   HeavyRectangle m_heavy_rectangle;             // Vertex buffer.
-  RandomPositions m_random_positions;           // Instance buffer.
+  RandomPositions m_random_positions{application().random_seed()};    // Instance buffer.
 
   // Push constant ranges.
   vulkan::PushConstantRange m_push_constant_range_aspect_scale{typeid(PushConstant), offsetof(PushConstant, aspect_scale), sizeof(float)};
@@ -77,6 +77,7 @@ class Window : public vulkan::task::SynchronousWindow
   vulkan::Pipeline m_graphics_pipeline;
 
   imgui::StatsWindow m_imgui_stats_window;
+  imgui::GpuProfilerWindow m_imgui_gpu_profiler_window;
   SampleParameters m_sample_parameters;
   int m_frame_count = 0;
 
@@ -132,7 +133,8 @@ class Window : public vulkan::task::SynchronousWindow
 
     // Background texture.
     {
-      vk_utils::stbi::ImageData texture_data(m_application->path_of(Directory::resources) / "textures/background.png", 4);
+      auto texture_data_feeder = std::make_unique<vk_utils::libpng::ImageDataFeeder>(m_application->path_of(Directory::resources) / "textures/background.png", 4);
+      vk::Extent2D const extent = texture_data_feeder->extent();
 
       // Create descriptor resources.
       static vulkan::ImageKind const background_image_kind({
@@ -145,21 +147,22 @@ class Window : public vulkan::task::SynchronousWindow
       m_background_texture =
         vulkan::Texture(
             m_logical_device,
-            texture_data.extent(), background_image_view_kind,
+            extent, background_image_view_kind,
             { .mipmapMode = vk::SamplerMipmapMode::eNearest,
               .anisotropyEnable = VK_FALSE },
             graphics_settings(),
             { .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
             COMMA_CWDEBUG_ONLY(debug_name_prefix("m_background_texture")));
 
-      m_background_texture.upload(texture_data.extent(), background_image_view_kind, this, std::make_unique<vk_utils::stbi::ImageDataFeeder>(std::move(texture_data)), this, background_texture_uploaded);
+      m_background_texture.upload(extent, background_image_view_kind, this, std::move(texture_data_feeder), this, background_texture_uploaded);
     }
 
     m_combined_image_samplers[0].update_image_sampler(&m_background_texture, m_pipeline_factory_characteristic_id);
 
     // Sample texture.
     {
-      vk_utils::stbi::ImageData texture_data(m_application->path_of(Directory::resources) / "textures/frame_resources.png", 4);
+      auto texture_data_feeder = std::make_unique<vk_utils::libpng::ImageDataFeeder>(m_application->path_of(Directory::resources) / "textures/frame_resources.png", 4);
+      vk::Extent2D const extent = texture_data_feeder->extent();
 
       // Create descriptor resources.
       static vulkan::ImageKind const sample_image_kind({
@@ -171,14 +174,14 @@ class Window : public vulkan::task::SynchronousWindow
 
       m_benchmark_texture = vulkan::Texture(
           m_logical_device,
-          texture_data.extent(), sample_image_view_kind,
+          extent, sample_image_view_kind,
           { .mipmapMode = vk::SamplerMipmapMode::eNearest,
             .anisotropyEnable = VK_FALSE },
           graphics_settings(),
           { .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
           COMMA_CWDEBUG_ONLY(debug_name_prefix("m_benchmark_texture")));
 
-      m_benchmark_texture.upload(texture_data.extent(), sample_image_view_kind, this, std::make_unique<vk_utils::stbi::ImageDataFeeder>(std::move(texture_data)), this, sample_texture_uploaded);
+      m_benchmark_texture.upload(extent, sample_image_view_kind, this, std::move(texture_data_feeder), this, sample_texture_uploaded);
     }
 
     m_combined_image_samplers[1].update_image_sampler(&m_benchmark_texture, m_pipeline_factory_characteristic_id);
@@ -494,24 +497,60 @@ void main()
           number_of_frame_resources(), m_current_frame.m_resource_index);
       CwTracyVkNamedZone(presentation_surface().tracy_context(), __main_pass2, static_cast<vk::CommandBuffer>(command_buffer), main_pass.name(), true,
           number_of_swapchain_images(), swapchain_index);
+      vulkan::GpuProfiler::Scope main_pass_scope(gpu_profiler(), command_buffer, main_pass);
 
-      command_buffer.beginRenderPass(main_pass.begin_info(), vk::SubpassContents::eInline);
+      auto recording_begin_time = std::chrono::high_resolution_clock::now();
+      int const recording_threads = m_sample_parameters.RecordingThreads;
+      command_buffer.beginRenderPass(main_pass.begin_info(),
+          recording_threads > 1 ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
 // FIXME: this is a hack - what we really need is a vector with RenderProxy objects.
 if (!m_graphics_pipeline.handle())
   Dout(dc::warning, "Pipeline not available");
 else
 {
-      command_buffer.setViewport(0, { viewport });
-      command_buffer.setScissor(0, { scissor });
-      command_buffer.bindVertexBuffers(m_vertex_buffers);
-
-      command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vh_graphics_pipeline(m_graphics_pipeline.handle()));
-      command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_graphics_pipeline.layout(), 0 /* uint32_t first_set */,
-          m_graphics_pipeline.vhv_descriptor_sets(m_current_frame.m_resource_index), {});
-
-      command_buffer.pushConstants(m_graphics_pipeline.layout(), m_push_constant_range_aspect_scale, aspect_scale);
-      command_buffer.draw(6 * SampleParameters::s_quad_tessellation * SampleParameters::s_quad_tessellation, m_sample_parameters.ObjectCount, 0, 0);
+      // Record the draw calls for the objects in the range [first_object, first_object + object_count) into command_buffer.
+      auto record_objects = [&](vulkan::handle::CommandBuffer recording_buffer, int first_object, int object_count){
+        recording_buffer.setViewport(0, { viewport });
+        recording_buffer.setScissor(0, { scissor });
+        recording_buffer.bindVertexBuffers(m_vertex_buffers);
+
+        recording_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vh_graphics_pipeline(m_graphics_pipeline.handle()));
+        recording_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, m_graphics_pipeline.layout(), 0 /* uint32_t first_set */,
+            m_graphics_pipeline.vhv_descriptor_sets(m_current_frame.m_resource_index), {});
+
+        recording_buffer.pushConstants(m_graphics_pipeline.layout(), m_push_constant_range_aspect_scale, aspect_scale);
+        uint32_t const vertex_count = 6 * SampleParameters::s_quad_tessellation * SampleParameters::s_quad_tessellation;
+        if (m_sample_parameters.DrawCallPerObject)
+        {
+          for (int object = first_object; object < first_object + object_count; ++object)
+            recording_buffer.draw(vertex_count, 1, 0, object);
+        }
+        else if (object_count > 0)
+          recording_buffer.draw(vertex_count, object_count, 0, first_object);
+      };
+
+      int const object_count = m_sample_parameters.ObjectCount;
+      if (recording_threads == 1)
+        record_objects(command_buffer, 0, object_count);
+      else
+      {
+        // Divide the objects over the jobs; the secondary command buffers are executed in job order.
+        frame_resources->m_secondary_command_buffers.record(recording_threads, main_pass.begin_info(), 0,
+            [&](int job_index, vulkan::handle::CommandBuffer secondary_command_buffer){
+              int const first_object = object_count * job_index / recording_threads;
+              int const end_object = object_count * (job_index + 1) / recording_threads;
+              record_objects(secondary_command_buffer, first_object, end_object - first_object);
+            }
+            COMMA_CWDEBUG_ONLY(debug_name_prefix("m_current_frame.m_frame_resources->m_secondary_command_buffers")));
+        // Record jobs on this thread too, until the helper tasks finished theirs.
+        while (!frame_resources->m_secondary_command_buffers.poll())
+          ;
+        frame_resources->m_secondary_command_buffers.execute(command_buffer);
+      }
 }
+      auto recording_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - recording_begin_time);
+      float& average_recording_time = m_sample_parameters.m_recording_time[recording_threads - 1];
+      average_recording_time = average_recording_time * 0.99f + static_cast<float>(recording_time.count() * 0.001f) * 0.01f;
       command_buffer.endRenderPass();
       TracyVkCollect(presentation_surface().tracy_context(), static_cast<vk::CommandBuffer>(command_buffer));
     }
@@ -526,6 +565,7 @@ else
           number_of_frame_resources(), m_current_frame.m_resource_index);
       CwTracyVkNamedZone(presentation_surface().tracy_context(), __imgui_pass2, static_cast<vk::CommandBuffer>(command_buffer), imgui_pass.name(), true,
           number_of_swapchain_images(), swapchain_index);
+      vulkan::GpuProfiler::Scope imgui_pass_scope(gpu_profiler(), command_buffer, imgui_pass);
       command_buffer.beginRenderPass(imgui_pass.begin_info(), vk::SubpassContents::eInline);
       m_imgui.render_frame(command_buffer, m_current_frame.m_resource_index COMMA_CWDEBUG_ONLY(debug_name_prefix("m_imgui")));
       command_buffer.endRenderPass();
@@ -564,6 +604,9 @@ else
     ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 120.0f, 20.0f));
     m_imgui_stats_window.draw(io, m_imgui_timer);
 
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 260.0f, 140.0f), ImGuiCond_FirstUseEver);
+    m_imgui_gpu_profiler_window.draw(gpu_profiler());
+
     ImGui::SetNextWindowPos(ImVec2(20.0f, 20.0f));
     ImGui::Begin(reinterpret_cast<char const*>(application().application_name().c_str()), nullptr, ImGuiWindowFlags_AlwaysAutoResize);
     static std::string const hardware_name = "Hardware: " + static_cast<std::string>(logical_device()->vh_physical_device().getProperties().deviceName);
@@ -574,8 +617,13 @@ else
     ImGui::SliderInt("Frame resources count", &m_sample_parameters.FrameResourcesCount, 1, number_of_frame_resources().get_value());
     ImGui::SliderInt("Pre-submit CPU work time [ms]", &m_sample_parameters.PreSubmitCpuWorkTime, 0, 20);
     ImGui::SliderInt("Post-submit CPU work time [ms]", &m_sample_parameters.PostSubmitCpuWorkTime, 0, 20);
+    ImGui::SliderInt("Recording threads", &m_sample_parameters.RecordingThreads, 1, SampleParameters::s_max_recording_threads);
+    ImGui::Checkbox("Draw call per object", &m_sample_parameters.DrawCallPerObject);
     ImGui::Text("Frame generation time: %5.2f ms", m_sample_parameters.m_frame_generation_time);
     ImGui::Text("Total frame time: %5.2f ms", m_sample_parameters.m_total_frame_time);
+    for (int threads = 1; threads <= SampleParameters::s_max_recording_threads; ++threads)
+      if (m_sample_parameters.m_recording_time[threads - 1] > 0.0f)
+        ImGui::Text("Main pass recording time (%d thread%s): %5.3f ms", threads, threads == 1 ? "" : "s", m_sample_parameters.m_recording_time[threads - 1]);
     ImGui::End();
 
     if (current_SwapchainCount != m_sample_parameters.SwapchainCount)
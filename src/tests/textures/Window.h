@@ -20,12 +20,17 @@
 #include <vulkan/pipeline/AddFragmentShader.h>
 #include <vulkan/pipeline/AddPushConstant.h>
 #include <vulkan/pipeline/Characteristic.h>
-#include <vulkan/vk_utils/ImageData.h>
+#include <vulkan/TextureDecodePool.h>
+#include <vulkan/vk_utils/BCnEncoder.h>
+#include <vulkan/vk_utils/format.h>
 #include <statefultask/AITimer.h>
 
 #include <vulkan/lv_inline_definitions.h>
 
 #include <imgui.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include "debug.h"
 #include <vulkan/tracy/CwTracy.h>
 #ifdef TRACY_ENABLE
@@ -34,6 +39,9 @@
 
 #define ENABLE_IMGUI 1
 #define SEPARATE_FRAGMENT_SHADER_CHARACTERISTIC 1
+// 0: R8G8B8A8 without mip levels, 1: R8G8B8A8 with mip levels, 2: BC1 with mip levels, 3: BC3 with mip levels.
+// Modes 2 and 3 fall back to mode 1 if the device can't sample that format.
+#define TEXTURE_UPLOAD_MODE 1
 
 class Window : public vulkan::task::SynchronousWindow
 {
@@ -42,7 +50,6 @@ class Window : public vulkan::task::SynchronousWindow
 
  public:
   using vulkan::task::SynchronousWindow::SynchronousWindow;
-  static constexpr condition_type texture_uploaded = free_condition;
 
  private:
   // Define renderpass / attachment objects.
@@ -54,6 +61,9 @@ class Window : public vulkan::task::SynchronousWindow
   static constexpr std::array<char const*, number_of_combined_image_samplers> glsl_id_postfixes{ "top", "bottom0", "bottom1" };
   using combined_image_samplers_t = std::array<vulkan::shader_builder::shader_resource::CombinedImageSampler, 3>;
   combined_image_samplers_t m_combined_image_samplers;
+  // The image (view) kinds depend on the extent of the texture (the number of mip levels); they must outlive m_textures.
+  std::array<std::unique_ptr<vulkan::ImageKind>, number_of_combined_image_samplers> m_texture_image_kinds;
+  std::array<std::unique_ptr<vulkan::ImageViewKind>, number_of_combined_image_samplers> m_texture_image_view_kinds;
   std::array<vulkan::Texture, number_of_combined_image_samplers> m_textures;
 
   enum class LocalShaderIndex {
@@ -79,6 +89,7 @@ class Window : public vulkan::task::SynchronousWindow
   std::array<vulkan::Pipeline, number_of_pipeline_factories> m_graphics_pipelines;
 
   imgui::StatsWindow m_imgui_stats_window;
+  imgui::GpuProfilerWindow m_imgui_gpu_profiler_window;
   int m_frame_count = 0;
 
  private:
@@ -113,8 +124,18 @@ class Window : public vulkan::task::SynchronousWindow
   boost::intrusive_ptr<AITimer> m_timer;
   int m_loop_var;
 
+  std::array<vulkan::TextureDecodePool::request_handle_type, number_of_combined_image_samplers> m_texture_decode_requests;
+  std::atomic<int> m_uploaded_textures{0};
+
  public:
-  ~Window() { if (m_timer) m_timer->abort(); }
+  ~Window()
+  {
+    for (auto const& request : m_texture_decode_requests)
+      if (request)
+        m_application->texture_decode_pool().cancel(request);
+    if (m_timer)
+      m_timer->abort();
+  }
 
  private:
   void create_textures() override
@@ -135,22 +156,61 @@ class Window : public vulkan::task::SynchronousWindow
 
     std::string const name_prefix("m_textures[");
 
+    vulkan::TextureDecodePool& texture_decode_pool = m_application->texture_decode_pool();
     for (int t = 0; t < number_of_combined_image_samplers; ++t)
     {
-      vk_utils::stbi::ImageData texture_data(m_application->path_of(Directory::resources) / textures_names[t], 4);
-
-      m_textures[t] = vulkan::Texture(m_logical_device,
-          texture_data.extent(),
-          { .mipmapMode = vk::SamplerMipmapMode::eNearest,
-            .anisotropyEnable = VK_FALSE },
-          graphics_settings(),
-          { .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
-          COMMA_CWDEBUG_ONLY(debug_name_prefix(name_prefix + glsl_id_postfixes[t] + ']')));
-
-      m_textures[t].upload(texture_data.extent(), this,
-          std::make_unique<vk_utils::stbi::ImageDataFeeder>(std::move(texture_data)), this, texture_uploaded);
+      // The textures are shown in this order; decode the first one first.
+      float const importance = number_of_combined_image_samplers - t;
+      m_texture_decode_requests[t] = texture_decode_pool.decode(m_application->path_of(Directory::resources) / textures_names[t], 4, importance,
+          [this, t, name_prefix](vk::Extent2D extent, std::unique_ptr<vulkan::DataFeeder> texture_data_feeder){
+            if (!texture_data_feeder)
+              return;           // Keep showing the loading texture.
+
+            auto const upload_start = std::chrono::steady_clock::now();
+            vk::Format format = vk::Format::eR8G8B8A8Unorm;
+            uint32_t const mip_levels = TEXTURE_UPLOAD_MODE == 0 ? 1 : vk_utils::mip_level_count(extent);
+#if TEXTURE_UPLOAD_MODE >= 2
+            vk::Format const bc_format = TEXTURE_UPLOAD_MODE == 2 ? vk::Format::eBc1RgbaUnormBlock : vk::Format::eBc3UnormBlock;
+            if (m_logical_device->supports_texture_compression_bc() && m_logical_device->supports_sampled_format(bc_format))
+            {
+              format = bc_format;
+              texture_data_feeder = std::make_unique<vk_utils::BCnDataFeeder>(std::move(texture_data_feeder), format, extent, mip_levels);
+            }
+            else
+              Dout(dc::warning, "Block compressed textures are not supported; falling back to " << format << ".");
+#endif
+            m_texture_image_kinds[t] = std::make_unique<vulkan::ImageKind>(vulkan::ImageKindPOD{
+                .format = format,
+                .mip_levels = mip_levels,
+                .usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled });
+            m_texture_image_view_kinds[t] = std::make_unique<vulkan::ImageViewKind>(*m_texture_image_kinds[t], vulkan::ImageViewKindPOD{
+                .subresource_range = vk_defaults::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, mip_levels} });
+
+            m_textures[t] = vulkan::Texture(m_logical_device,
+                extent, *m_texture_image_view_kinds[t],
+                { .mipmapMode = vk::SamplerMipmapMode::eLinear,
+                  .anisotropyEnable = VK_FALSE,
+                  .maxLod = static_cast<float>(mip_levels) },
+                graphics_settings(),
+                { .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
+                COMMA_CWDEBUG_ONLY(debug_name_prefix(name_prefix + glsl_id_postfixes[t] + ']')));
+
+            size_t const texture_size = vk_utils::image_data_size(format, extent, mip_levels);
+            m_textures[t].upload(extent, *m_texture_image_view_kinds[t], this, std::move(texture_data_feeder),
+                [this, t, format, texture_size, upload_start](bool success){
+              // Print the memory footprint and upload time, to compare the TEXTURE_UPLOAD_MODE's.
+              Dout(dc::notice, "Texture " << t << " (" << format << "): " << texture_size << " bytes, uploaded in " <<
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count() << " ms.");
+              // Start using the textures once all of them are resident.
+              if (success && ++m_uploaded_textures == number_of_combined_image_samplers)
+                start_timer();
+            });
+          });
     }
+  }
 
+  void start_timer()
+  {
     m_timer = statefultask::create<AITimer>(CWDEBUG_ONLY(true));
     m_loop_var = 0;
     m_timer->set_interval(threadpool::Interval<200, std::chrono::milliseconds>());
@@ -692,6 +752,7 @@ void main()
           number_of_frame_resources(), m_current_frame.m_resource_index);
       CwTracyVkNamedZone(presentation_surface().tracy_context(), __main_pass2, static_cast<vk::CommandBuffer>(command_buffer), main_pass.name(), true,
           number_of_swapchain_images(), swapchain_index);
+      vulkan::GpuProfiler::Scope main_pass_scope(gpu_profiler(), command_buffer, main_pass);
 
       command_buffer.beginRenderPass(main_pass.begin_info(), vk::SubpassContents::eInline);
 // FIXME: this is a hack - what we really need is a vector with RenderProxy objects.
@@ -733,6 +794,7 @@ else
           number_of_frame_resources(), m_current_frame.m_resource_index);
       CwTracyVkNamedZone(presentation_surface().tracy_context(), __imgui_pass2, static_cast<vk::CommandBuffer>(command_buffer), imgui_pass.name(), true,
           number_of_swapchain_images(), swapchain_index);
+      vulkan::GpuProfiler::Scope imgui_pass_scope(gpu_profiler(), command_buffer, imgui_pass);
       command_buffer.beginRenderPass(imgui_pass.begin_info(), vk::SubpassContents::eInline);
       m_imgui.render_frame(command_buffer, m_current_frame.m_resource_index COMMA_CWDEBUG_ONLY(debug_name_prefix("m_imgui")));
       command_buffer.endRenderPass();
@@ -767,5 +829,8 @@ else
 
     ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 120.0f, 20.0f));
     m_imgui_stats_window.draw(io, m_imgui_timer);
+
+    ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 260.0f, 140.0f), ImGuiCond_FirstUseEver);
+    m_imgui_gpu_profiler_window.draw(gpu_profiler());
   }
 };
@@ -15,7 +15,7 @@
 #include <vulkan/shader_builder/shader_resource/UniformBuffer.h>
 #include <vulkan/shader_builder/shader_resource/CombinedImageSampler.h>
 #include <vulkan/descriptor/SetKeyPreference.h>
-#include <vulkan/vk_utils/ImageData.h>
+#include <vulkan/vk_utils/PNGImageDataFeeder.h>
 #include <imgui.h>
 #include "debug.h"
 #include <vulkan/tracy/CwTracy.h>
@@ -98,7 +98,8 @@ class Window : public vulkan::task::SynchronousWindow
 
     // Sample texture.
     {
-      vk_utils::stbi::ImageData texture_data(m_application->path_of(Directory::resources) / "textures/vort3_128x128.png", 4);
+      auto texture_data_feeder = std::make_unique<vk_utils::libpng::ImageDataFeeder>(m_application->path_of(Directory::resources) / "textures/vort3_128x128.png", 4);
+      vk::Extent2D const extent = texture_data_feeder->extent();
 
       // Create descriptor resources.
       static vulkan::ImageKind const sample_image_kind({
@@ -109,15 +110,15 @@ class Window : public vulkan::task::SynchronousWindow
       static vulkan::ImageViewKind const sample_image_view_kind(sample_image_kind, {});
 
       m_sample_texture = vulkan::Texture(m_logical_device,
-          texture_data.extent(), sample_image_view_kind,
+          extent, sample_image_view_kind,
           { .mipmapMode = vk::SamplerMipmapMode::eNearest,
             .anisotropyEnable = VK_FALSE },
           graphics_settings(),
           { .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
           COMMA_CWDEBUG_ONLY(debug_name_prefix("m_sample_texture")));
 
-      m_sample_texture.upload(texture_data.extent(), sample_image_view_kind, this,
-          std::make_unique<vk_utils::stbi::ImageDataFeeder>(std::move(texture_data)), this, sample_texture_uploaded);
+      m_sample_texture.upload(extent, sample_image_view_kind, this,
+          std::move(texture_data_feeder), this, sample_texture_uploaded);
     }
 
     m_combined_image_sampler.update_image_sampler(&m_sample_texture, m_pipeline_factory_characteristic_id0);
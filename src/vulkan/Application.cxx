@@ -3,7 +3,6 @@
 #include "FrameResourcesData.h"
 #include "PersistentAsyncTask.h"
 #include "shader_builder/ShaderIndex.h"
-#include "pipeline/PipelineCache.h"
 #include "infos/ApplicationInfo.h"
 #include "infos/InstanceCreateInfo.h"
 #include "evio/EventLoop.h"
@@ -13,6 +12,7 @@
 #include <chrono>
 #include <iterator>
 #include <cctype>
+#include <random>
 #ifdef CWDEBUG
 #include "debug/DebugUtilsMessengerCreateInfoEXT.h"
 #include "debug/vulkan_print_on.h"
@@ -57,6 +57,23 @@ void Application::parse_command_line_parameters(int argc, char* argv[])
   DoutEntering(dc::vulkan, "vulkan::Application::parse_command_line_parameters(" << argc << ", " << NAMESPACE_DEBUG::print_argv(argv) << ")");
 }
 
+void Application::parse_builtin_parameters(int argc, char* argv[])
+{
+  DoutEntering(dc::vulkan, "vulkan::Application::parse_builtin_parameters(" << argc << ", " << NAMESPACE_DEBUG::print_argv(argv) << ")");
+  for (int i = 1; i < argc; ++i)
+    if (!m_headless_settings.parse_argument(argv[i]))
+      m_benchmark_settings.parse_argument(argv[i]);
+  Dout(dc::vulkan(m_headless_settings.enabled), "Running headless: " << m_headless_settings);
+  Dout(dc::vulkan(m_benchmark_settings.enabled()), "Running benchmark: " << m_benchmark_settings);
+}
+
+uint32_t Application::random_seed() const
+{
+  if (m_benchmark_settings.enabled())
+    return m_benchmark_settings.seed;
+  return std::random_device{}();
+}
+
 //virtual
 std::u8string Application::application_name() const
 {
@@ -95,11 +112,20 @@ void Application::initialize(int argc, char** argv)
 
     // Allow the user to override stuff.
     if (argc > 0)
+    {
+      parse_builtin_parameters(argc, argv);
       parse_command_line_parameters(argc, argv);
+    }
 
     // Initialize base directories.
     m_directories.initialize(application_name(), argv[0]);
 
+    // Initialize the persistent SPIR-V cache.
+    m_spirv_disk_cache.initialize(m_directories.path_of(Directory::cache) / "spirv");
+
+    // Load the persistent descriptor set partition cache.
+    m_partition_cache.initialize(m_directories.path_of(Directory::cache) / "partition_cache");
+
     // Initialize the thread pool.
     m_thread_pool.change_number_of_threads_to(thread_pool_number_of_worker_threads());
     Debug(m_thread_pool.set_color_functions([](int color){
@@ -158,7 +184,9 @@ void Application::initialize(int argc, char** argv)
 
   // Initialize the remaining thread pool queues.
   m_medium_priority_queue = m_thread_pool.new_queue(thread_pool_queue_capacity(QueuePriority::medium), thread_pool_reserved_threads(QueuePriority::medium));
-  m_low_priority_queue    = m_thread_pool.new_queue(thread_pool_queue_capacity(QueuePriority::low));
+  m_low_priority_queue    = m_thread_pool.new_queue(thread_pool_queue_capacity(QueuePriority::low), thread_pool_reserved_threads(QueuePriority::low));
+  m_texture_decode_queue  = m_thread_pool.new_queue(thread_pool_queue_capacity(QueuePriority::texture_decode));
+  m_texture_decode_pool.initialize(m_texture_decode_queue, texture_decode_pool_max_decoders());
 
   // Set up the I/O event loop.
   m_event_loop = std::make_unique<evio::EventLoop>(m_low_priority_queue COMMA_CWDEBUG_ONLY("\e[36m", "\e[0m"));
@@ -305,15 +333,24 @@ void Application::run()
   m_until_windows_terminated.wait();
 
   Dout(dc::notice, "======= Program terminating ======");
+  Dout(dc::notice, "SPIR-V disk cache statistics: " << m_spirv_disk_cache);
+  Dout(dc::notice, "Partition cache statistics: " << m_partition_cache);
+  m_partition_cache.save();
+  m_texture_decode_pool.terminate();
+  Dout(dc::notice, "Texture decode pool statistics: " << m_texture_decode_pool);
 
   // Terminate all running PersistentAsyncTask's.
   task::PersistentAsyncTask::terminate_and_wait();
 
-  // Wait till all logical devices are idle.
+  // Wait till all logical devices are idle and write their pipeline cache to disk.
   {
     logical_device_list_t::rat logical_device_list_r(m_logical_device_list);
     for (auto& device : *logical_device_list_r)
+    {
       device->wait_idle();
+      Dout(dc::notice, "Pipeline cache statistics: " << device->pipeline_cache());
+      device->pipeline_cache().save();
+    }
   }
 
   // Stop the broker tasks.
@@ -380,73 +417,9 @@ shader_builder::ShaderInfoCache& Application::get_shader_info(shader_builder::Sh
 
 void Application::run_pipeline_factory(boost::intrusive_ptr<task::PipelineFactory> const& factory, task::SynchronousWindow* window, PipelineFactoryIndex index)
 {
-  // Remember that this factory is running.
-  {
-    pipeline_factory_list_t::wat pipeline_factory_list_w(m_pipeline_factory_list);
-    pipeline_factory_list_w->operator[](window->pipeline_cache_name()).window_list.push_back(window);
-  }
   factory->run(m_medium_priority_queue);
 }
 
-void Application::pipeline_factory_done(task::SynchronousWindow const* window, boost::intrusive_ptr<task::PipelineCache>&& pipeline_cache_task)
-{
-  DoutEntering(dc::vulkan, "Application::pipeline_factory_done(" << window << ", " << static_cast<AIStatefulTask*>(pipeline_cache_task.get()) << ")");
-
-  std::u8string const pipeline_cache_name = window->pipeline_cache_name();
-  pipeline_factory_list_container_t::iterator pipeline_cache_merger_iter;
-  boost::intrusive_ptr<task::PipelineCache> merged_pipeline_cache;
-  // A factory stopped running.
-  PipelineCacheMerger* pipeline_cache_merger = nullptr;
-  bool last_window = false;
-  {
-    pipeline_factory_list_t::wat pipeline_factory_list_w(m_pipeline_factory_list);
-    pipeline_cache_merger_iter = pipeline_factory_list_w->find(pipeline_cache_name);
-    // Paranoia check: it was added before in Application::run_pipeline_factory.
-    ASSERT(pipeline_cache_merger_iter != pipeline_factory_list_w->end());
-    // Use a reference to the merger instead of the iterator for convenience.
-    pipeline_cache_merger = &pipeline_cache_merger_iter->second;
-    // Find a matching window pointer in the list, note that for each factory of the same window, the window was added multiple times.
-    auto& windows_with_pipeline_cache_name = pipeline_cache_merger->window_list;
-    auto iter = std::find(windows_with_pipeline_cache_name.begin(), windows_with_pipeline_cache_name.end(), window);
-    // Idem.
-    ASSERT(iter != windows_with_pipeline_cache_name.end());
-    // Was this the first factory?
-    if (!pipeline_cache_merger->merged_pipeline_cache)
-    {
-      // If this is the first time a factory finished - then just copy its task::PipelineCache to the PipelineCacheMerger.
-      pipeline_cache_merger->merged_pipeline_cache = std::move(pipeline_cache_task);
-    }
-    else
-    {
-      pipeline_cache_merger->merged_pipeline_cache->have_new_datum(pipeline_cache_task->detach_pipeline_cache());
-      pipeline_cache_merger = nullptr;          // pipeline_cache_task is not the merger (this is not the first factory that finishes).
-    }
-    // Was this the last window?
-    windows_with_pipeline_cache_name.erase(iter);
-    last_window = windows_with_pipeline_cache_name.empty();
-  }
-  if (pipeline_cache_merger)
-  {
-    // pipeline_cache_task was moved to pipeline_cache_merger->merged_pipeline_cache.
-    pipeline_cache_merger->merged_pipeline_cache->set_is_merger();
-    pipeline_cache_merger->merged_pipeline_cache->signal(task::PipelineCache::factory_finished);
-  }
-  else
-  {
-    // This deletes the task.
-    pipeline_cache_task->signal(task::PipelineCache::factory_finished);
-  }
-  // Was this the last window (now with unlocked m_pipeline_factory_list)?
-  if (last_window)
-  {
-    Dout(dc::notice, "That was the last factory with name " << pipeline_cache_name << ".");
-    merged_pipeline_cache = std::move(pipeline_cache_merger_iter->second.merged_pipeline_cache);
-    // We merged all pipeline caches. Now make it write to disk.
-    ASSERT(merged_pipeline_cache->running());
-    merged_pipeline_cache->set_producer_finished();
-  }
-}
-
 void Application::on_mouse_enter(task::SynchronousWindow* window, int x, int y, bool entered)
 {
 #ifdef TRACY_ENABLE
@@ -6,8 +6,13 @@
 #include "Directories.h"
 #include "Concepts.h"
 #include "GraphicsSettings.h"
+#include "HeadlessSettings.h"
+#include "BenchmarkSettings.h"
 #include "shader_builder/VertexAttribute.h"
 #include "shader_builder/ShaderInfos.h"
+#include "shader_builder/SPIRVDiskCache.h"
+#include "pipeline/partitions/PartitionCache.h"
+#include "TextureDecodePool.h"
 #include "descriptor/SetKeyContext.h"
 #include "pipeline/PipelineFactoryCategory.h"
 #include "statefultask/DefaultMemoryPagePool.h"
@@ -39,7 +44,6 @@ class Scope;
 namespace vulkan {
 
 namespace task {
-class PipelineCache;
 class SynchronousWindow;
 } // namespace task
 
@@ -57,12 +61,14 @@ class Application
   // Set up the thread pool for the application.
   static constexpr int default_number_of_threads = 8;                           // Use a thread pool of 8 threads.
   static constexpr int default_reserved_threads = 1;                            // Reserve 1 thread for each priority.
+  static constexpr int default_texture_decoders = 2;                            // Decode at most 2 textures concurrently.
   static constexpr vk::Offset2D default_root_window_position = { 0, 0 };        // Default top-left corner.
 
   enum class QueuePriority {
     high,
     medium,
-    low
+    low,
+    texture_decode      // Only used by the TextureDecodePool.
   };
 
   // Accessed by tasks that depend on objects of this class (or derived classes).
@@ -89,6 +95,7 @@ class Application
   AIQueueHandle m_high_priority_queue;
   AIQueueHandle m_medium_priority_queue;
   AIQueueHandle m_low_priority_queue;
+  AIQueueHandle m_texture_decode_queue;
 
   // Set up the I/O event loop.
   std::unique_ptr<evio::EventLoop> m_event_loop;
@@ -128,8 +135,7 @@ class Application
   bool m_debug_XcbConnection{false};                    // Also turns on Broker<XcbConnection>.
   bool m_debug_SemaphoreWatcher{false};
   bool m_debug_AsyncSemaphoreWatcher{false};
-  bool m_debug_PipelineCache{false};                    // Only prints debug output when also the associated PipelineFactory is turned on.
-  bool m_MoveNewPipelines{false};                       // Idem.
+  bool m_MoveNewPipelines{false};                       // Only prints debug output when also the associated PipelineFactory is turned on.
   bool m_CopyDataToBuffer{false};
   bool m_CopyDataToImage{false};
   bool m_ImmediateSubmitQueue{false};                   // Only prints debug output when also the associated CopyDataTo* is turned on.
@@ -146,20 +152,20 @@ class Application
  private:
   static Application* s_instance;                       // There can only be one instance of Application. Allow global access.
   vulkan::GraphicsSettings m_graphics_settings;         // Global configuration values for graphics settings.
+  HeadlessSettings m_headless_settings;                 // Set by parse_builtin_parameters; copied to every window that is created.
+  BenchmarkSettings m_benchmark_settings;               // Set by parse_builtin_parameters; copied to every window that is created.
 
   // Storage for all shader templates.
   mutable vulkan::shader_builder::ShaderInfos m_shader_infos;    // Mutable because it is updated by register_shaders, which is threadsafe-"const".
 
-  // We have one of these for each pipeline cache filename.
-  struct PipelineCacheMerger
-  {
-    boost::intrusive_ptr<task::PipelineCache> merged_pipeline_cache;    // The pipeline cache to merge into and finally write to disk.
-    std::vector<task::SynchronousWindow const*> window_list;            // A list of all windows that use the same pipeline cache filename.
-  };
+  // Persistent cache of compiled shaders.
+  mutable vulkan::shader_builder::SPIRVDiskCache m_spirv_disk_cache;    // Mutable because it is thread-safe.
+
+  // Persistent cache of descriptor set partitions.
+  mutable vulkan::pipeline::partitions::PartitionCache m_partition_cache;       // Mutable because it is thread-safe.
 
-  using pipeline_factory_list_container_t = std::map<std::u8string, PipelineCacheMerger>;
-  using pipeline_factory_list_t = threadsafe::Unlocked<pipeline_factory_list_container_t, threadsafe::policy::Primitive<std::mutex>>;
-  pipeline_factory_list_t m_pipeline_factory_list;
+  // Decoder of texture images.
+  mutable vulkan::TextureDecodePool m_texture_decode_pool;                     // Mutable because it is thread-safe.
 
 #ifdef TRACY_ENABLE
   task::SynchronousWindow* m_tracy_window{};
@@ -222,7 +228,6 @@ class Application
   void initialize(int argc = 0, char** argv = nullptr);
 
 #ifdef CWDEBUG
-  bool debug_PipelineCache() const { return m_debug_PipelineCache; }
   bool debug_SemaphoreWatcher() const { return m_debug_SemaphoreWatcher; }
   bool debug_AsyncSemaphoreWatcher() const { return m_debug_AsyncSemaphoreWatcher; }
   bool debug_MoveNewPipelines() const { return m_MoveNewPipelines; }
@@ -241,6 +246,7 @@ class Application
   AIQueueHandle high_priority_queue() const { return m_high_priority_queue; }
   AIQueueHandle medium_priority_queue() const { return m_medium_priority_queue; }
   AIQueueHandle low_priority_queue() const { return m_low_priority_queue; }
+  AIQueueHandle texture_decode_queue() const { return m_texture_decode_queue; }
 
   std::filesystem::path path_of(Directory directory) const
   {
@@ -323,10 +329,27 @@ class Application
   // Return a reference to the ShaderInfoCache that corresponds to shader_index, as added by a call to register_shaders.
   vulkan::shader_builder::ShaderInfoCache& get_shader_info(vulkan::shader_builder::ShaderIndex shader_index) const;
 
+  // Return a reference to the on-disk SPIR-V cache. The returned object is thread-safe.
+  vulkan::shader_builder::SPIRVDiskCache& spirv_disk_cache() const { return m_spirv_disk_cache; }
+
+  // Return a reference to the persistent cache of descriptor set partitions. The returned object is thread-safe.
+  vulkan::pipeline::partitions::PartitionCache& partition_cache() const { return m_partition_cache; }
+
+  // Return a reference to the texture decode pool. The returned object is thread-safe.
+  vulkan::TextureDecodePool& texture_decode_pool() const { return m_texture_decode_pool; }
+
+  // Return the headless settings, as passed on the command line.
+  HeadlessSettings const& headless_settings() const { return m_headless_settings; }
+
+  // Return the benchmark settings, as passed on the command line.
+  BenchmarkSettings const& benchmark_settings() const { return m_benchmark_settings; }
+
+  // Return a seed for random number generators that influence what is rendered.
+  // While benchmarking this returns BenchmarkSettings::seed, so that the results of different runs are comparable.
+  uint32_t random_seed() const;
+
   // Called by SynchronousWindow::create_pipeline_factory.
   void run_pipeline_factory(boost::intrusive_ptr<task::PipelineFactory> const& factory, task::SynchronousWindow* window, PipelineFactoryIndex index);
-  // Called by SynchronousWindow::pipeline_factory_done.
-  void pipeline_factory_done(task::SynchronousWindow const* window, boost::intrusive_ptr<task::PipelineCache>&& pipeline_cache);
 
   // Called by SynchronousWindow::consume_input_events.
   void on_mouse_enter(task::SynchronousWindow* window, int x, int y, bool entered);
@@ -337,6 +360,10 @@ class Application
 
   virtual void parse_command_line_parameters(int argc, char* argv[]);
 
+  // Called before parse_command_line_parameters. Handles the --headless* options (see HeadlessSettings)
+  // and the --benchmark* options (see BenchmarkSettings).
+  void parse_builtin_parameters(int argc, char* argv[]);
+
   // Override this function to change the number of worker threads.
   virtual int thread_pool_number_of_worker_threads() const;
 
@@ -346,6 +373,9 @@ class Application
   // Override this function to change the number of reserved threads for each queue (except the last, of course).
   virtual int thread_pool_reserved_threads(QueuePriority UNUSED_ARG(priority)) const;
 
+  // Override this function to change the maximum number of textures that are decoded concurrently.
+  virtual int texture_decode_pool_max_decoders() const;
+
   // Override this function to add Instance layers and/or extensions.
   virtual void prepare_instance_info(vulkan::InstanceCreateInfo& instance_create_info) const { }
 
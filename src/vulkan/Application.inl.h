@@ -46,6 +46,8 @@ boost::intrusive_ptr<task::SynchronousWindow const> Application::create_window(
   window_task->set_offset(geometry.offset);
   window_task->set_request_cookie(request_cookie);
   window_task->set_logical_device_task(logical_device_task);
+  window_task->set_headless_settings(m_headless_settings);
+  window_task->set_benchmark_settings(m_benchmark_settings);
   // The key passed to set_xcb_connection_broker_and_key MUST be canonicalized!
   m_main_display_broker_key.canonicalize();
   window_task->set_xcb_connection_broker_and_key(m_xcb_connection_broker, &m_main_display_broker_key);
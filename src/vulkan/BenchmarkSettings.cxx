@@ -0,0 +1,77 @@
+#include "sys.h"
+#include "BenchmarkSettings.h"
+#include "utils/AIAlert.h"
+#include <charconv>
+#include <string>
+#ifdef CWDEBUG
+#include <iostream>
+#endif
+#include "debug.h"
+
+namespace vulkan {
+
+namespace {
+
+template<typename T>
+void parse_value(std::string_view option, std::string_view value, T& value_out)
+{
+  auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), value_out);
+  if (ec != std::errc{} || ptr != value.data() + value.size())
+    THROW_ALERT("Invalid value for [OPTION]: \"[VALUE]\"", AIArgs("[OPTION]", std::string(option))("[VALUE]", std::string(value)));
+}
+
+} // namespace
+
+bool BenchmarkSettings::parse_argument(std::string_view argument)
+{
+  static constexpr std::string_view output_option = "--benchmark";
+  static constexpr std::string_view frames_option = "--benchmark-frames";
+  static constexpr std::string_view warmup_option = "--benchmark-warmup";
+  static constexpr std::string_view seed_option = "--benchmark-seed";
+  static constexpr std::string_view pipeline_cache_option = "--benchmark-pipeline-cache";
+
+  auto const equal_sign = argument.find('=');
+  if (equal_sign == std::string_view::npos)
+    return false;
+  std::string_view const option = argument.substr(0, equal_sign);
+  std::string_view const value = argument.substr(equal_sign + 1);
+
+  if (option == output_option)
+  {
+    if (value.empty())
+      THROW_ALERT("--benchmark requires a filename");
+    output = value;
+  }
+  else if (option == frames_option)
+    parse_value(option, value, frame_count);
+  else if (option == warmup_option)
+    parse_value(option, value, warmup_frames);
+  else if (option == seed_option)
+    parse_value(option, value, seed);
+  else if (option == pipeline_cache_option)
+  {
+    if (value != "cold" && value != "warm")
+      THROW_ALERT("Invalid value for [OPTION]: \"[VALUE]\" (expected \"cold\" or \"warm\")",
+          AIArgs("[OPTION]", std::string(option))("[VALUE]", std::string(value)));
+    cold_pipeline_cache = value == "cold";
+  }
+  else
+    return false;
+
+  return true;
+}
+
+#ifdef CWDEBUG
+void BenchmarkSettings::print_on(std::ostream& os) const
+{
+  os << '{';
+  os << "output:" << output <<
+      ", frame_count:" << frame_count <<
+      ", warmup_frames:" << warmup_frames <<
+      ", seed:" << seed <<
+      ", cold_pipeline_cache:" << std::boolalpha << cold_pipeline_cache;
+  os << '}';
+}
+#endif
+
+} // namespace vulkan
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#ifdef CWDEBUG
+#include <iosfwd>
+#endif
+
+namespace vulkan {
+
+// Settings for measuring frame times (see Application::parse_builtin_parameters and FrameTimeBenchmark).
+//
+// A benchmark run renders warmup_frames + frame_count frames, records the CPU time spent in each
+// phase of the frames after the warm-up as well as the GPU time of their command buffers, and then
+// closes the window and writes percentiles and histograms of the timings as JSON to output.
+// Combine with --headless-unthrottled to run unattended and without a frame rate limit.
+struct BenchmarkSettings
+{
+  static constexpr uint32_t s_default_seed = 1;
+
+  std::filesystem::path output;         // --benchmark=FILE             : Run a benchmark and write the results to FILE.
+  uint64_t frame_count = 1000;          // --benchmark-frames=N         : The number of frames to measure.
+  uint64_t warmup_frames = 100;         // --benchmark-warmup=N         : The number of frames to render before starting to measure.
+  uint32_t seed = s_default_seed;       // --benchmark-seed=N           : The seed returned by Application::random_seed while benchmarking.
+  bool cold_pipeline_cache = false;     // --benchmark-pipeline-cache=cold|warm : Ignore (cold) or load (warm, the default) the pipeline cache files on disk.
+
+  // Returns true if a benchmark must be run.
+  bool enabled() const { return !output.empty(); }
+
+  // If argument is one of the options above, apply it and return true. Otherwise return false.
+  // Throws AIAlert::Error if a value is invalid.
+  bool parse_argument(std::string_view argument);
+
+#ifdef CWDEBUG
+  void print_on(std::ostream& os) const;
+#endif
+};
+
+} // namespace vulkan
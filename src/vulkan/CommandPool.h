@@ -49,6 +49,14 @@ class CommandPool
   handle::CommandBuffer allocate_buffer(
       CWDEBUG_ONLY(Ambifix const& ambifix));
 
+  // Allocate a secondary command buffer (see SecondaryCommandBuffers).
+  handle::CommandBuffer allocate_secondary_buffer(
+      CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Reset all command buffers that were allocated from this pool.
+  // The caller must guarantee that none of them is still in use by the device.
+  void reset() const { m_logical_device->reset_command_pool(*m_command_pool); }
+
   void free_buffer(handle::CommandBuffer command_buffer);
 
   void free_buffers(uint32_t count, handle::CommandBuffer const* command_buffers);
@@ -88,6 +96,16 @@ handle::CommandBuffer CommandPool<pool_type>::allocate_buffer(
   return command_buffer;
 }
 
+template<vk::CommandPoolCreateFlags::MaskType pool_type>
+handle::CommandBuffer CommandPool<pool_type>::allocate_secondary_buffer(
+    CWDEBUG_ONLY(Ambifix const& debug_name))
+{
+  handle::CommandBuffer command_buffer;
+  m_logical_device->allocate_command_buffers(*m_command_pool, vk::CommandBufferLevel::eSecondary, 1, &command_buffer
+      COMMA_CWDEBUG_ONLY(debug_name, false));
+  return command_buffer;
+}
+
 template<vk::CommandPoolCreateFlags::MaskType pool_type>
 void CommandPool<pool_type>::allocate_buffers(uint32_t count, handle::CommandBuffer* command_buffers
     COMMA_CWDEBUG_ONLY(Ambifix const& debug_name))
@@ -48,6 +48,11 @@ int Application::thread_pool_reserved_threads(QueuePriority UNUSED_ARG(priority)
   return default_reserved_threads;
 }
 
+int Application::texture_decode_pool_max_decoders() const
+{
+  return default_texture_decoders;
+}
+
 } // namespace vulkan
 
 #ifdef CWDEBUG
@@ -2,6 +2,7 @@
 
 #include "Attachment.h"
 #include "CommandPool.h"
+#include "SecondaryCommandBuffers.h"
 #include "utils/Vector.h"
 #include <memory>
 
@@ -19,6 +20,9 @@ struct FrameResourcesData
   // Command buffers (currently only one).
   handle::CommandBuffer   m_command_buffer;                     // Freed when the command pool is destructed.
 
+  // Secondary command buffers, for recording on multiple threads; executed from m_command_buffer.
+  SecondaryCommandBuffers m_secondary_command_buffers;
+
   // Fence that signals when all (aka, the last) command buffers have finished.
   vk::UniqueFence         m_command_buffers_completed;          // This fence should be signaled when the last command buffer used for this frame completed.
 
@@ -32,7 +36,8 @@ struct FrameResourcesData
       QueueFamilyPropertiesIndex queue_family
       COMMA_CWDEBUG_ONLY(AmbifixOwner const& command_pool_debug_name)) :
     m_attachments(number_of_attachments),
-    m_command_pool(logical_device, queue_family COMMA_CWDEBUG_ONLY(command_pool_debug_name)) { }
+    m_command_pool(logical_device, queue_family COMMA_CWDEBUG_ONLY(command_pool_debug_name)),
+    m_secondary_command_buffers(logical_device, queue_family) { }
 
   ~FrameResourcesData()
   {
@@ -0,0 +1,241 @@
+#include "sys.h"
+#include "FrameTimeBenchmark.h"
+#include "LogicalDevice.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan {
+
+namespace {
+
+constexpr std::array<char const*, FrameTimeBenchmark::number_of_phases> s_phase_names = {
+  "start_frame", "acquire_image", "record", "wait_command_buffer", "submit", "post_submit", "finish_frame"
+};
+
+template<typename Rep, typename Period>
+double to_ms(std::chrono::duration<Rep, Period> duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Write the UTF-8 string str as a JSON string.
+void write_json_string(std::ostream& os, std::u8string const& str)
+{
+  os << '"';
+  for (char8_t c8 : str)
+  {
+    char const c = static_cast<char>(c8);
+    if (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (c8 < 0x20)
+      os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+    else
+      os << c;
+  }
+  os << '"';
+}
+
+// Write the statistics of samples as a JSON object (or null if there are no samples).
+void write_json_series(std::ostream& os, std::vector<double> samples)
+{
+  if (samples.empty())
+  {
+    os << "null";
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  size_t const n = samples.size();
+  // Nearest-rank percentile.
+  auto percentile = [&](size_t p){ return samples[std::max<size_t>((p * n + 99) / 100, 1) - 1]; };
+  double const min = samples.front();
+  double const max = samples.back();
+  double const mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+
+  std::array<size_t, FrameTimeBenchmark::s_histogram_bins> counts{};
+  double const bin_width = (max - min) / counts.size();
+  for (double sample : samples)
+  {
+    size_t const bin = bin_width > 0.0 ? static_cast<size_t>((sample - min) / bin_width) : 0;
+    ++counts[std::min(bin, counts.size() - 1)];
+  }
+
+  os << "{ \"mean\": " << mean << ", \"min\": " << min << ", \"p50\": " << percentile(50) << ", \"p95\": " << percentile(95) <<
+    ", \"p99\": " << percentile(99) << ", \"max\": " << max << ", \"histogram\": { \"min\": " << min << ", \"bin_width\": " << bin_width <<
+    ", \"counts\": [";
+  char const* separator = "";
+  for (size_t count : counts)
+  {
+    os << separator << count;
+    separator = ", ";
+  }
+  os << "] } }";
+}
+
+} // namespace
+
+FrameTimeBenchmark::FrameTimeBenchmark(BenchmarkSettings const& settings, LogicalDevice const* logical_device,
+    QueueFamilyPropertiesIndex queue_family, FrameResourceIndex number_of_frame_resources
+    COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix)) :
+  m_settings(settings),
+  m_logical_device(logical_device),
+  m_timestamp_period_ms(logical_device->timestamp_period() * 1e-6),
+  m_command_pool(logical_device, queue_family COMMA_CWDEBUG_ONLY(".m_command_pool" + ambifix))
+{
+  DoutEntering(dc::vulkan, "FrameTimeBenchmark::FrameTimeBenchmark(" << settings << ", " << logical_device << ", " << queue_family <<
+      ", " << number_of_frame_resources << ")");
+
+  for (std::vector<double>& samples : m_phase_samples)
+    samples.reserve(m_settings.frame_count);
+  m_frame_samples.reserve(m_settings.frame_count);
+
+  uint32_t const timestamp_valid_bits = logical_device->timestamp_valid_bits(queue_family);
+  if (timestamp_valid_bits == 0)
+  {
+    Dout(dc::warning, "The graphics queue does not support timestamps; GPU frame times will not be measured.");
+    return;
+  }
+  m_timestamp_mask = timestamp_valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << timestamp_valid_bits) - 1;
+  m_gpu_samples.reserve(m_settings.frame_count);
+
+  m_query_pool = logical_device->create_query_pool(vk::QueryType::eTimestamp, 2 * static_cast<uint32_t>(number_of_frame_resources.get_value())
+      COMMA_CWDEBUG_ONLY(".m_query_pool" + ambifix));
+  m_timestamp_command_buffers.resize(number_of_frame_resources.get_value());
+  for (FrameResourceIndex i = m_timestamp_command_buffers.ibegin(); i != m_timestamp_command_buffers.iend(); ++i)
+  {
+    TimestampCommandBuffers& command_buffers = m_timestamp_command_buffers[i];
+    uint32_t const first_query = 2 * static_cast<uint32_t>(i.get_value());
+
+    command_buffers.m_begin = m_command_pool.allocate_buffer(
+        CWDEBUG_ONLY(".m_timestamp_command_buffers[" + to_string(i) + "].m_begin" + ambifix));
+    command_buffers.m_begin.begin({});
+    command_buffers.m_begin.resetQueryPool(*m_query_pool, first_query, 2);
+    command_buffers.m_begin.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *m_query_pool, first_query);
+    command_buffers.m_begin.end();
+
+    command_buffers.m_end = m_command_pool.allocate_buffer(
+        CWDEBUG_ONLY(".m_timestamp_command_buffers[" + to_string(i) + "].m_end" + ambifix));
+    command_buffers.m_end.begin({});
+    command_buffers.m_end.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *m_query_pool, first_query + 1);
+    command_buffers.m_end.end();
+  }
+}
+
+bool FrameTimeBenchmark::end_frame()
+{
+  end_phase(finish_frame);
+  if (measuring())
+  {
+    for (int phase = 0; phase < number_of_phases; ++phase)
+      m_phase_samples[phase].push_back(to_ms(m_phase_durations[phase]));
+    m_frame_samples.push_back(to_ms(m_phase_begin - m_frame_begin));
+    ++m_measured_frames;
+  }
+  return m_frame_number >= m_settings.warmup_frames && m_measured_frames == m_settings.frame_count;
+}
+
+vk::CommandBuffer const* FrameTimeBenchmark::wrap_command_buffer(FrameResourceIndex index, vk::CommandBuffer command_buffer, uint32_t& count_out)
+{
+  // The timestamps of the previous frame that used index are available now, and must be read before the queries are reset.
+  collect(index);
+
+  if (!m_query_pool || !measuring())
+  {
+    m_submitted_command_buffers[0] = command_buffer;
+    count_out = 1;
+    return m_submitted_command_buffers.data();
+  }
+
+  TimestampCommandBuffers& command_buffers = m_timestamp_command_buffers[index];
+  command_buffers.m_frame_number = m_frame_number;
+  m_submitted_command_buffers = { command_buffers.m_begin, command_buffer, command_buffers.m_end };
+  count_out = m_submitted_command_buffers.size();
+  return m_submitted_command_buffers.data();
+}
+
+void FrameTimeBenchmark::collect(FrameResourceIndex index)
+{
+  if (!m_query_pool)
+    return;
+
+  TimestampCommandBuffers& command_buffers = m_timestamp_command_buffers[index];
+  if (command_buffers.m_frame_number == 0)
+    return;
+
+  std::array<uint64_t, 2> timestamps;
+  // The fence of the submit was already waited for, so eWait won't block; it just guarantees that the results are valid.
+  vk::Result res = m_logical_device->get_query_pool_results(*m_query_pool, 2 * static_cast<uint32_t>(index.get_value()), 2,
+      sizeof(timestamps), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+  if (res != vk::Result::eSuccess)
+    Dout(dc::warning, "Could not read the timestamps of frame " << command_buffers.m_frame_number << ": " << res);
+  else
+    m_gpu_samples.push_back(((timestamps[1] - timestamps[0]) & m_timestamp_mask) * m_timestamp_period_ms);
+  command_buffers.m_frame_number = 0;
+}
+
+void FrameTimeBenchmark::collect_all()
+{
+  for (FrameResourceIndex i = m_timestamp_command_buffers.ibegin(); i != m_timestamp_command_buffers.iend(); ++i)
+    collect(i);
+}
+
+void FrameTimeBenchmark::write_json(std::ostream& os, std::u8string const& title) const
+{
+  os << std::fixed << std::setprecision(4);
+  os << "{\n  \"window\": ";
+  write_json_string(os, title);
+  os << ",\n  \"seed\": " << m_settings.seed <<
+    ",\n  \"warmup_frames\": " << m_settings.warmup_frames <<
+    ",\n  \"frames\": " << m_measured_frames <<
+    ",\n  \"unit\": \"ms\"" <<
+    ",\n  \"cpu\": {\n    \"frame\": ";
+  write_json_series(os, m_frame_samples);
+  for (int phase = 0; phase < number_of_phases; ++phase)
+  {
+    os << ",\n    \"" << s_phase_names[phase] << "\": ";
+    write_json_series(os, m_phase_samples[phase]);
+  }
+  os << "\n  },\n  \"gpu\": ";
+  if (!m_query_pool)
+    os << "null";
+  else
+  {
+    os << "{\n    \"frame\": ";
+    write_json_series(os, m_gpu_samples);
+    os << "\n  }";
+  }
+  // Compare runs with --benchmark-pipeline-cache=cold and =warm to see what the pipeline cache on disk saves.
+  pipeline::PipelineCache const& pipeline_cache = m_logical_device->pipeline_cache();
+  size_t const pipelines = pipeline_cache.pipelines_created();
+  double const creation_time_ms = std::chrono::duration<double, std::milli>(pipeline_cache.creation_time()).count();
+  os << ",\n  \"pipeline_cache\": { \"warm\": " << (pipeline_cache.is_warm() ? "true" : "false") <<
+    ", \"loaded_bytes\": " << pipeline_cache.loaded_size() <<
+    ", \"pipelines\": " << pipelines <<
+    ", \"creation_time\": " << creation_time_ms <<
+    ", \"mean_creation_time\": " << (pipelines == 0 ? 0.0 : creation_time_ms / pipelines) << " }";
+  os << "\n}\n";
+}
+
+void FrameTimeBenchmark::write_results(std::u8string const& title) const
+{
+  DoutEntering(dc::vulkan, "FrameTimeBenchmark::write_results(" << title << ")");
+  std::ofstream file(m_settings.output, std::ios::trunc);
+  if (file)
+  {
+    write_json(file, title);
+    file.close();                       // Also catch errors while flushing.
+  }
+  if (!file)
+    // Not (only) a debug warning: without CWDEBUG the benchmark run would otherwise look successful.
+    std::cerr << "Failed to write benchmark results to " << m_settings.output << "." << std::endl;
+  else
+    Dout(dc::notice, "Wrote the results of benchmarking \"" << title << "\" to " << m_settings.output << ".");
+}
+
+} // namespace vulkan
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "BenchmarkSettings.h"
+#include "CommandPool.h"
+#include "FrameResourceIndex.h"
+#include "utils/Vector.h"
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace vulkan {
+
+#ifdef CWDEBUG
+class AmbifixOwner;
+#endif
+
+// Measures the frame times of a SynchronousWindow (see BenchmarkSettings).
+//
+// The CPU time of a frame is split into consecutive phases, each of which ends where the next
+// one begins; SynchronousWindow marks the phase boundaries from start_frame, acquire_image,
+// wait_command_buffer_completed, submit and finish_frame. The GPU time of a frame is measured
+// with timestamp queries written by two pre-recorded command buffers per frame resource that are
+// submitted before and after the command buffer of the frame. The timestamps of a frame resource
+// are read back right before it is submitted again, when its m_command_buffers_completed fence
+// is known to be signaled; so reading them never stalls the render loop.
+//
+// After the last frame, write_results writes the mean, min, max, p50, p95 and p99 and a histogram
+// of each series to BenchmarkSettings::output as JSON.
+class FrameTimeBenchmark
+{
+ public:
+  enum Phase
+  {
+    start_frame,                        // SynchronousWindow::start_frame (including drawing the ImGui windows).
+    acquire_image,                      // SynchronousWindow::acquire_image.
+    record,                             // Everything between acquire_image and submit, except for wait_command_buffer.
+    wait_command_buffer,                // SynchronousWindow::wait_command_buffer_completed.
+    submit,                             // SynchronousWindow::submit.
+    post_submit,                        // Everything between submit and finish_frame.
+    finish_frame,                       // SynchronousWindow::finish_frame (presenting).
+    number_of_phases
+  };
+
+  static constexpr int s_histogram_bins = 32;
+
+ private:
+  using clock_type = std::chrono::steady_clock;
+  using command_pool_type = CommandPool<0>;     // The timestamp command buffers are recorded once and never reset.
+
+  struct TimestampCommandBuffers
+  {
+    handle::CommandBuffer m_begin;              // Resets the two queries of this frame resource and writes the first timestamp.
+    handle::CommandBuffer m_end;                // Writes the second timestamp.
+    uint64_t m_frame_number = 0;                // The frame that was last submitted with these command buffers, or zero if none.
+  };
+
+  BenchmarkSettings m_settings;
+  LogicalDevice const* m_logical_device;
+
+  // CPU timing.
+  uint64_t m_frame_number = 0;                                  // The number of frames started (including the warm-up frames).
+  uint64_t m_measured_frames = 0;                               // The number of frames that were completely measured.
+  clock_type::time_point m_frame_begin;                         // The time at which the current frame started.
+  clock_type::time_point m_phase_begin;                         // The time at which the current phase started.
+  std::array<clock_type::duration, number_of_phases> m_phase_durations;         // The phase durations of the current frame.
+  std::array<std::vector<double>, number_of_phases> m_phase_samples;            // The measured phase durations in milliseconds.
+  std::vector<double> m_frame_samples;                          // The measured total CPU frame times in milliseconds.
+
+  // GPU timing.
+  double m_timestamp_period_ms;                                 // The duration of one timestamp tick in milliseconds.
+  uint64_t m_timestamp_mask = 0;                                // The valid bits of a timestamp.
+  vk::UniqueQueryPool m_query_pool;                             // Two timestamps per frame resource. Null if timestamps are not supported.
+  command_pool_type m_command_pool;
+  utils::Vector<TimestampCommandBuffers, FrameResourceIndex> m_timestamp_command_buffers;
+  std::array<vk::CommandBuffer, 3> m_submitted_command_buffers; // Returned by wrap_command_buffer.
+  std::vector<double> m_gpu_samples;                            // The measured GPU frame times in milliseconds.
+
+ public:
+  FrameTimeBenchmark(BenchmarkSettings const& settings, LogicalDevice const* logical_device,
+      QueueFamilyPropertiesIndex queue_family, FrameResourceIndex number_of_frame_resources
+      COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix));
+
+  // Called at the start of SynchronousWindow::start_frame.
+  void begin_frame()
+  {
+    ++m_frame_number;
+    m_phase_durations.fill({});
+    m_frame_begin = m_phase_begin = clock_type::now();
+  }
+
+  // Add the time since the previous call (or begin_frame) to phase.
+  void end_phase(Phase phase)
+  {
+    clock_type::time_point const now = clock_type::now();
+    m_phase_durations[phase] += now - m_phase_begin;
+    m_phase_begin = now;
+  }
+
+  // Called at the end of SynchronousWindow::finish_frame. Ends the finish_frame phase and stores
+  // the timings of the frame, unless it is a warm-up frame. Returns true when all frames were measured.
+  bool end_frame();
+
+  // Return the command buffers that must be submitted in place of command_buffer, which is going to be
+  // submitted using frame resource index, and store their number in count_out.
+  // Must be called from submit, after the m_command_buffers_completed fence of index was waited for.
+  vk::CommandBuffer const* wrap_command_buffer(FrameResourceIndex index, vk::CommandBuffer command_buffer, uint32_t& count_out);
+
+  // Read back all outstanding timestamps. Call after waiting for all m_command_buffers_completed fences.
+  void collect_all();
+
+  // Write the results as JSON to the output file of the benchmark settings.
+  void write_results(std::u8string const& title) const;
+
+  // Write the results as JSON to os.
+  void write_json(std::ostream& os, std::u8string const& title) const;
+
+  // Return true if the current frame must be measured: it is not a warm-up frame and not all frames were measured yet.
+  bool measuring() const { return m_frame_number > m_settings.warmup_frames && m_measured_frames < m_settings.frame_count; }
+
+ private:
+  // Read back the timestamps of frame resource index, if any.
+  void collect(FrameResourceIndex index);
+};
+
+} // namespace vulkan
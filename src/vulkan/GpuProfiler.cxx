@@ -0,0 +1,105 @@
+#include "sys.h"
+#include "GpuProfiler.h"
+#include "LogicalDevice.h"
+#include "RenderPass.h"
+#include <algorithm>
+#include <array>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan {
+
+GpuProfiler::Scope::Scope(GpuProfiler& profiler, vk::CommandBuffer command_buffer, RenderPass const& render_pass) :
+  Scope(profiler, command_buffer, render_pass.name())
+{
+}
+
+void GpuProfiler::initialize(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family, FrameResourceIndex number_of_frame_resources
+    COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix))
+{
+  DoutEntering(dc::vulkan, "GpuProfiler::initialize(" << logical_device << ", " << queue_family << ", " << number_of_frame_resources << ")");
+
+  m_logical_device = logical_device;
+  uint32_t const timestamp_valid_bits = logical_device->timestamp_valid_bits(queue_family);
+  if (timestamp_valid_bits == 0)
+  {
+    Dout(dc::vulkan, "The graphics queue does not support timestamps; the GPU profiler is not available.");
+    return;
+  }
+  m_timestamp_period_ms = logical_device->timestamp_period() * 1e-6;
+  m_timestamp_mask = timestamp_valid_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << timestamp_valid_bits) - 1;
+
+  m_frame_queries.resize(number_of_frame_resources.get_value());
+  for (FrameResourceIndex i = m_frame_queries.ibegin(); i != m_frame_queries.iend(); ++i)
+  {
+    m_frame_queries[i].m_query_pool = logical_device->create_query_pool(vk::QueryType::eTimestamp, 2 * s_max_scopes
+        COMMA_CWDEBUG_ONLY(".m_frame_queries[" + to_string(i) + "].m_query_pool" + ambifix));
+    m_frame_queries[i].m_scopes.reserve(s_max_scopes);
+  }
+  m_timings.reserve(s_max_scopes);
+  m_resolved_timings.reserve(s_max_scopes);
+}
+
+void GpuProfiler::begin_frame_impl(FrameResourceIndex index)
+{
+  FrameQueries& frame_queries = m_frame_queries[index];
+  if (!frame_queries.m_scopes.empty())
+    resolve(frame_queries);
+  m_current_frame_queries = m_enabled ? &frame_queries : nullptr;
+  m_depth = 0;
+}
+
+int GpuProfiler::begin_scope_impl(vk::CommandBuffer command_buffer, std::string_view name)
+{
+  std::vector<ScopeRecord>& scopes = m_current_frame_queries->m_scopes;
+  if (scopes.size() == s_max_scopes)
+  {
+    Dout(dc::warning, "GpuProfiler: more than " << s_max_scopes << " scopes in one frame; not profiling \"" << name << "\".");
+    return -1;
+  }
+  vk::QueryPool vh_query_pool = *m_current_frame_queries->m_query_pool;
+  // The queries can't be reset from the host without the hostQueryReset feature; reset them before the first scope of the frame.
+  if (scopes.empty())
+    command_buffer.resetQueryPool(vh_query_pool, 0, 2 * s_max_scopes);
+  int const scope = scopes.size();
+  command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, vh_query_pool, 2 * scope);
+  scopes.push_back({ name, m_depth++ });
+  return scope;
+}
+
+void GpuProfiler::end_scope_impl(vk::CommandBuffer command_buffer, int scope)
+{
+  command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *m_current_frame_queries->m_query_pool, 2 * scope + 1);
+  --m_depth;
+}
+
+void GpuProfiler::resolve(FrameQueries& frame_queries)
+{
+  std::vector<ScopeRecord>& scopes = frame_queries.m_scopes;
+  uint32_t const query_count = 2 * scopes.size();
+  std::array<uint64_t, 2 * s_max_scopes> timestamps;
+  // Don't wait: the fence of the frame was already waited for, so the results are available unless a scope was never ended.
+  vk::Result res = m_logical_device->get_query_pool_results(*frame_queries.m_query_pool, 0, query_count,
+      query_count * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+  if (res != vk::Result::eSuccess)
+    Dout(dc::warning, "GpuProfiler: could not read timestamps: " << res);
+  else
+  {
+    m_resolved_timings.clear();
+    for (size_t scope = 0; scope < scopes.size(); ++scope)
+    {
+      ScopeRecord const& record = scopes[scope];
+      double const ms = ((timestamps[2 * scope + 1] - timestamps[2 * scope]) & m_timestamp_mask) * m_timestamp_period_ms;
+      auto previous = std::find_if(m_timings.begin(), m_timings.end(),
+          [&](ScopeTiming const& timing){ return timing.m_name == record.m_name && timing.m_depth == record.m_depth; });
+      double const average_ms = previous == m_timings.end() ? ms : previous->m_average_ms + s_average_weight * (ms - previous->m_average_ms);
+      m_resolved_timings.push_back({ record.m_name, record.m_depth, ms, average_ms });
+    }
+    m_timings.swap(m_resolved_timings);
+  }
+  scopes.clear();
+}
+
+} // namespace vulkan
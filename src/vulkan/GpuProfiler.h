@@ -0,0 +1,141 @@
+#pragma once
+
+#include "FrameResourceIndex.h"
+#include "queues/QueueFamilyProperties.h"
+#include "utils/Vector.h"
+#include "utils/macros.h"
+#include <vulkan/vulkan.hpp>
+#include <string_view>
+#include <vector>
+
+namespace vulkan {
+
+class LogicalDevice;
+class RenderPass;
+
+#ifdef CWDEBUG
+class AmbifixOwner;
+#endif
+
+// A GPU profiler based on timestamp queries; it does not depend on Tracy.
+//
+// Every frame resource has its own query pool with room for s_max_scopes scopes. A scope writes
+// a timestamp before and after the commands that it encloses (usually a render pass, see Scope).
+// The timestamps of a frame resource are resolved when SynchronousWindow::wait_command_buffer_completed
+// waited for its m_command_buffers_completed fence, right before the frame resource is recorded
+// again; so resolving never stalls the render loop and the reported timings are those of the
+// last completed frame.
+//
+// The profiler is disabled by default. While disabled, begin_frame and begin_scope only test a flag.
+// Enabling or disabling takes effect from the next frame.
+class GpuProfiler
+{
+ public:
+  static constexpr uint32_t s_max_scopes = 32;          // The maximum number of scopes per frame.
+  static constexpr double s_average_weight = 0.05;      // The weight of a new value in the moving averages.
+
+  // The timing of one scope of the last completed frame.
+  struct ScopeTiming
+  {
+    std::string_view m_name;
+    int m_depth;                        // The number of enclosing scopes.
+    double m_ms;                        // The GPU time spent in this scope, in milliseconds.
+    double m_average_ms;                // The moving average of m_ms.
+  };
+
+  // Convenience class to time the commands recorded during its lifetime.
+  //
+  // For example,
+  //
+  //   {
+  //     vulkan::GpuProfiler::Scope scope(gpu_profiler(), command_buffer, main_pass);
+  //     command_buffer.beginRenderPass(main_pass.begin_info(), vk::SubpassContents::eInline);
+  //     ...
+  //     command_buffer.endRenderPass();
+  //   }
+  //
+  class Scope
+  {
+    GpuProfiler& m_profiler;
+    vk::CommandBuffer m_command_buffer;
+    int m_scope;
+
+   public:
+    // The storage of name must outlive the profiler.
+    Scope(GpuProfiler& profiler, vk::CommandBuffer command_buffer, std::string_view name) :
+      m_profiler(profiler), m_command_buffer(command_buffer), m_scope(profiler.begin_scope(command_buffer, name)) { }
+    // Use the name of render_pass.
+    Scope(GpuProfiler& profiler, vk::CommandBuffer command_buffer, RenderPass const& render_pass);
+    ~Scope() { m_profiler.end_scope(m_command_buffer, m_scope); }
+
+    Scope(Scope const&) = delete;
+    Scope& operator=(Scope const&) = delete;
+  };
+
+ private:
+  struct ScopeRecord
+  {
+    std::string_view m_name;
+    int m_depth;
+  };
+
+  struct FrameQueries
+  {
+    vk::UniqueQueryPool m_query_pool;                   // Two timestamps per scope.
+    std::vector<ScopeRecord> m_scopes;                  // The scopes recorded by the last frame that used this frame resource.
+  };
+
+  LogicalDevice const* m_logical_device = nullptr;
+  bool m_enabled = false;
+  double m_timestamp_period_ms = 0.0;                   // The duration of one timestamp tick in milliseconds.
+  uint64_t m_timestamp_mask = 0;                        // The valid bits of a timestamp.
+  utils::Vector<FrameQueries, FrameResourceIndex> m_frame_queries;      // Empty if timestamps are not supported.
+  FrameQueries* m_current_frame_queries = nullptr;      // The queries of the frame that is being recorded, or null if that frame isn't profiled.
+  int m_depth = 0;                                      // The number of currently open scopes.
+  std::vector<ScopeTiming> m_timings;                   // The timings of the last completed frame.
+  std::vector<ScopeTiming> m_resolved_timings;          // Scratch space for resolve.
+
+ public:
+  // Called by SynchronousWindow::create_frame_resources.
+  void initialize(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family, FrameResourceIndex number_of_frame_resources
+      COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix));
+
+  // Return true if the queue family passed to initialize supports timestamps.
+  bool is_supported() const { return !m_frame_queries.empty(); }
+  bool is_enabled() const { return m_enabled; }
+  void set_enabled(bool enabled) { m_enabled = enabled && is_supported(); }
+
+  // Called by SynchronousWindow::wait_command_buffer_completed, after waiting for the fence of frame resource index.
+  void begin_frame(FrameResourceIndex index)
+  {
+    if (AI_UNLIKELY(m_enabled || m_current_frame_queries))
+      begin_frame_impl(index);
+  }
+
+  // Write a timestamp at the start of a scope. Returns the scope index that must be passed to end_scope.
+  // The first scope of a frame must be recorded outside of a render pass (it resets the queries).
+  int begin_scope(vk::CommandBuffer command_buffer, std::string_view name)
+  {
+    if (AI_LIKELY(!m_current_frame_queries))
+      return -1;
+    return begin_scope_impl(command_buffer, name);
+  }
+
+  // Write a timestamp at the end of scope.
+  void end_scope(vk::CommandBuffer command_buffer, int scope)
+  {
+    if (AI_UNLIKELY(scope >= 0))
+      end_scope_impl(command_buffer, scope);
+  }
+
+  // Return the timings of the last completed frame, in the order in which the scopes were begun.
+  std::vector<ScopeTiming> const& timings() const { return m_timings; }
+
+ private:
+  void begin_frame_impl(FrameResourceIndex index);
+  int begin_scope_impl(vk::CommandBuffer command_buffer, std::string_view name);
+  void end_scope_impl(vk::CommandBuffer command_buffer, int scope);
+  void resolve(FrameQueries& frame_queries);
+};
+
+} // namespace vulkan
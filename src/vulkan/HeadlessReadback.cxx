@@ -0,0 +1,139 @@
+#include "sys.h"
+#include "HeadlessReadback.h"
+#include "Swapchain.h"
+#include "vk_utils/format.h"
+#include "utils/AIAlert.h"
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan {
+
+namespace {
+
+// 64-bit FNV-1a.
+uint64_t checksum(unsigned char const* data, size_t size)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+} // namespace
+
+HeadlessReadback::HeadlessReadback(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family, Swapchain const& swapchain
+    COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix)) :
+  m_logical_device(logical_device),
+  m_command_pool(logical_device, queue_family COMMA_CWDEBUG_ONLY(".m_command_pool" + ambifix)),
+  m_extent(swapchain.extent()),
+  m_image_size(static_cast<vk::DeviceSize>(m_extent.width) * m_extent.height * vk_utils::format_block_size(swapchain.image_kind()->format))
+{
+  DoutEntering(dc::vulkan, "HeadlessReadback::HeadlessReadback(" << logical_device << ", " << queue_family << ", " << m_extent << ")");
+
+  // The images must be created with usage eTransferSrc; see SynchronousWindow::prepare_swapchain.
+  ASSERT((swapchain.image_kind()->usage & vk::ImageUsageFlagBits::eTransferSrc));
+
+  m_readbacks.resize(swapchain.image_count().get_value());
+  for (SwapchainIndex i = m_readbacks.ibegin(); i != m_readbacks.iend(); ++i)
+  {
+    ImageReadback& readback = m_readbacks[i];
+    readback.m_command_buffer = m_command_pool.allocate_buffer(
+        CWDEBUG_ONLY(".m_readbacks[" + to_string(i) + "].m_command_buffer" + ambifix));
+    readback.m_copied = logical_device->create_fence(true
+        COMMA_CWDEBUG_ONLY(true, ".m_readbacks[" + to_string(i) + "].m_copied" + ambifix));
+    readback.m_buffer = memory::StagingBuffer(logical_device, m_image_size
+        COMMA_CWDEBUG_ONLY(".m_readbacks[" + to_string(i) + "].m_buffer" + ambifix),
+        { .usage = vk::BufferUsageFlagBits::eTransferDst,
+          .vma_allocation_create_flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT });
+  }
+}
+
+bool HeadlessReadback::collect(SwapchainIndex index, uint64_t& frame_number_out, uint64_t& checksum_out)
+{
+  ImageReadback& readback = m_readbacks[index];
+  if (readback.m_frame_number == 0)
+    return false;
+
+  if (m_logical_device->wait_for_fences({ *readback.m_copied }, VK_TRUE, 1000000000) != vk::Result::eSuccess)
+    THROW_ALERT("Waiting for the read back of frame [FRAME] took too long!", AIArgs("[FRAME]", readback.m_frame_number));
+
+  // The memory might not be host coherent.
+  m_logical_device->invalidate_mapped_allocation(readback.m_buffer.m_vh_allocation, 0, m_image_size);
+
+  frame_number_out = readback.m_frame_number;
+  checksum_out = checksum(static_cast<unsigned char const*>(readback.m_buffer.m_pointer), m_image_size);
+  readback.m_frame_number = 0;
+  return true;
+}
+
+void HeadlessReadback::copy(vk::Queue vh_queue, SwapchainIndex index, vk::Image vh_image, uint64_t frame_number)
+{
+  DoutEntering(dc::vkframe, "HeadlessReadback::copy(" << vh_queue << ", " << index << ", " << vh_image << ", " << frame_number << ")");
+
+  ImageReadback& readback = m_readbacks[index];
+  // Call collect first.
+  ASSERT(readback.m_frame_number == 0);
+
+  vk::ImageMemoryBarrier const to_transfer_src{
+    .srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite,
+    .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+    .oldLayout = vk::ImageLayout::ePresentSrcKHR,
+    .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .image = vh_image,
+    .subresourceRange = Swapchain::s_default_subresource_range
+  };
+  vk::ImageMemoryBarrier const to_present_src{
+    .srcAccessMask = vk::AccessFlagBits::eTransferRead,
+    .dstAccessMask = {},
+    .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+    .newLayout = vk::ImageLayout::ePresentSrcKHR,
+    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .image = vh_image,
+    .subresourceRange = Swapchain::s_default_subresource_range
+  };
+  vk::BufferMemoryBarrier const to_host{
+    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+    .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .buffer = readback.m_buffer.m_vh_buffer,
+    .offset = 0,
+    .size = VK_WHOLE_SIZE
+  };
+  vk::BufferImageCopy const region{
+    .bufferOffset = 0,
+    .bufferRowLength = 0,               // Tightly packed.
+    .bufferImageHeight = 0,
+    .imageSubresource = { .aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+    .imageOffset = { 0, 0, 0 },
+    .imageExtent = { m_extent.width, m_extent.height, 1 }
+  };
+
+  // The command buffer that rendered the frame was submitted to the same queue before this one;
+  // the first barrier makes the copy wait for its color attachment writes.
+  handle::CommandBuffer command_buffer = readback.m_command_buffer;
+  command_buffer.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, { to_transfer_src });
+  command_buffer.copyImageToBuffer(vh_image, vk::ImageLayout::eTransferSrcOptimal, readback.m_buffer.m_vh_buffer, { region });
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eBottomOfPipe,
+      {}, {}, { to_host }, { to_present_src });
+  command_buffer.end();
+
+  m_logical_device->reset_fences({ *readback.m_copied });
+  vk::SubmitInfo const submit_info{
+    .commandBufferCount = 1,
+    .pCommandBuffers = &command_buffer
+  };
+  vh_queue.submit({ submit_info }, *readback.m_copied);
+  readback.m_frame_number = frame_number;
+}
+
+} // namespace vulkan
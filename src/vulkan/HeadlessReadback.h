@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CommandPool.h"
+#include "SwapchainIndex.h"
+#include "memory/StagingBuffer.h"
+#include "utils/Vector.h"
+#include <vulkan/vulkan.hpp>
+
+namespace vulkan {
+
+class Swapchain;
+
+#ifdef CWDEBUG
+class AmbifixOwner;
+#endif
+
+// Copies the rendered images of a headless window (see HeadlessSettings::read_back) back to host memory.
+//
+// Each image of the (offscreen) swapchain has its own command buffer, fence and host visible buffer,
+// so that copying a frame doesn't stall the render loop: the copy from an image is only waited for
+// right before that image is rendered to again (or when the window closes), which is also when its
+// checksum becomes available.
+class HeadlessReadback
+{
+ public:
+  using command_pool_type = CommandPool<VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT>;
+
+ private:
+  struct ImageReadback
+  {
+    handle::CommandBuffer m_command_buffer;             // Freed when m_command_pool is destructed.
+    vk::UniqueFence m_copied;                           // Signaled when the copy to m_buffer finished.
+    memory::StagingBuffer m_buffer;                     // The host visible copy of the image.
+    uint64_t m_frame_number = 0;                        // The frame that is being copied to m_buffer, or zero if none.
+  };
+
+  LogicalDevice const* m_logical_device;
+  command_pool_type m_command_pool;
+  vk::Extent2D m_extent;                                // The extent of the images.
+  vk::DeviceSize m_image_size;                          // The size of one (tightly packed) image in bytes.
+  utils::Vector<ImageReadback, SwapchainIndex> m_readbacks;
+
+ public:
+  HeadlessReadback(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family, Swapchain const& swapchain
+      COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix));
+
+  // Wait until the copy from image index finished. Returns false if nothing was copied since the last call.
+  // Otherwise return the number of the frame that was copied and a checksum of its pixels.
+  // Must be called before rendering to that image again.
+  bool collect(SwapchainIndex index, uint64_t& frame_number_out, uint64_t& checksum_out);
+
+  // Record and submit a copy of the image vh_image, which must be at index in the swapchain, to the host.
+  // The image must be in the layout ePresentSrcKHR and is returned to that layout.
+  // Call collect for the same index first.
+  void copy(vk::Queue vh_queue, SwapchainIndex index, vk::Image vh_image, uint64_t frame_number);
+};
+
+} // namespace vulkan
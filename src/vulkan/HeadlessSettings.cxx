@@ -0,0 +1,52 @@
+#include "sys.h"
+#include "HeadlessSettings.h"
+#include "utils/AIAlert.h"
+#include <charconv>
+#include <string>
+#ifdef CWDEBUG
+#include <iostream>
+#endif
+#include "debug.h"
+
+namespace vulkan {
+
+bool HeadlessSettings::parse_argument(std::string_view argument)
+{
+  static constexpr std::string_view frames_prefix = "--headless-frames=";
+
+  if (argument == "--headless")
+    enabled = true;
+  else if (argument == "--headless-unthrottled")
+    enabled = unthrottled = true;
+  else if (argument == "--headless-read-back")
+    enabled = read_back = true;
+  else if (argument == "--headless-bake-pipelines")
+    enabled = bake_pipelines = true;
+  else if (argument.starts_with(frames_prefix))
+  {
+    std::string_view const value = argument.substr(frames_prefix.size());
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), frame_count);
+    if (ec != std::errc{} || ptr != value.data() + value.size())
+      THROW_ALERT("Invalid value for --headless-frames: \"[VALUE]\"", AIArgs("[VALUE]", std::string(value)));
+    enabled = true;
+  }
+  else
+    return false;
+
+  return true;
+}
+
+#ifdef CWDEBUG
+void HeadlessSettings::print_on(std::ostream& os) const
+{
+  os << '{';
+  os << "enabled:" << std::boolalpha << enabled <<
+      ", frame_count:" << frame_count <<
+      ", unthrottled:" << unthrottled <<
+      ", read_back:" << read_back <<
+      ", bake_pipelines:" << bake_pipelines;
+  os << '}';
+}
+#endif
+
+} // namespace vulkan
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#ifdef CWDEBUG
+#include <iosfwd>
+#endif
+
+namespace vulkan {
+
+// Settings for running windows without an X server (see Application::parse_builtin_parameters).
+//
+// A headless window has no xcb window, no presentation surface and no swapchain: the render graph
+// renders into a ring of offscreen images (see Swapchain::prepare_headless) that are never presented.
+struct HeadlessSettings
+{
+  bool enabled = false;                 // --headless                   : Do not connect to an X server; render offscreen.
+  uint64_t frame_count = 0;             // --headless-frames=N          : Close the window after rendering N frames (0 means never).
+  bool unthrottled = false;             // --headless-unthrottled       : Render as fast as possible instead of once per frame_rate_interval().
+  bool read_back = false;               // --headless-read-back         : Copy every rendered frame to the host and pass its checksum
+                                        //                                to SynchronousWindow::on_frame_read_back.
+  bool bake_pipelines = false;          // --headless-bake-pipelines    : Close the window as soon as all its pipeline factories are done,
+                                        //                                after writing the pipeline cache to disk (see pipeline::PipelineCache).
+
+  // If argument is one of the options above, apply it and return true. Otherwise return false.
+  // Any of the options implies --headless. Throws AIAlert::Error if the value of --headless-frames is invalid.
+  bool parse_argument(std::string_view argument);
+
+#ifdef CWDEBUG
+  void print_on(std::ostream& os) const;
+#endif
+};
+
+} // namespace vulkan
@@ -93,16 +93,13 @@ struct TexPixelsRGBA32Feeder final : public DataFeeder
 // Just this compilation unit.
 using namespace imgui_ns;
 
-void ImGui::create_frame_resources(FrameResourceIndex number_of_frame_resources
+void ImGui::create_frame_resources(LogicalDevice const* logical_device, FrameResourceIndex number_of_frame_resources
     COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
 {
-  m_frame_resources_list.resize(number_of_frame_resources.get_value());
-  for (FrameResourceIndex i = m_frame_resources_list.ibegin(); i != m_frame_resources_list.iend(); ++i)
-  {
-#ifdef CWDEBUG
-    Ambifix const list_ambifix = ".m_frame_resources_list[" + to_string(i) + "]" + ambifix;
-#endif
-  }
+  // Called before init, so m_owning_window can not be used yet.
+  m_streaming_buffer.create(logical_device, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+      number_of_frame_resources, s_min_streaming_region_size
+      COMMA_CWDEBUG_ONLY(".m_streaming_buffer" + ambifix));
 }
 
 void ImGui::create_descriptor_set(CWDEBUG_ONLY(Ambifix const& ambifix))
@@ -128,7 +125,7 @@ void ImGui::create_descriptor_set(CWDEBUG_ONLY(Ambifix const& ambifix))
       COMMA_CWDEBUG_ONLY(".m_descriptor_set_layout" + ambifix));
   // Note: no frame resource support is required for a descriptor set if just one texture in it.
   auto descriptor_sets = logical_device()->allocate_descriptor_sets(FrameResourceIndex{1},
-      { *m_descriptor_set_layout }, {}, { std::make_pair(descriptor::SetIndex{}, false) }, logical_device()->get_descriptor_pool()
+      { *m_descriptor_set_layout }, {}, { std::make_pair(descriptor::SetIndex{}, false) }
       COMMA_CWDEBUG_ONLY(".m_vh_descriptor_set" + ambifix));
   m_vh_descriptor_set = descriptor_sets[0];     // We only have one descriptor set --^
 }
@@ -902,7 +899,8 @@ void ImGui::start_frame(float delta_s)
   NewFrame();
 }
 
-void ImGui::setup_render_state(handle::CommandBuffer command_buffer, void* draw_data_void_ptr, ImGui_FrameResourcesData& frame_resources, vk::Viewport const& viewport)
+void ImGui::setup_render_state(handle::CommandBuffer command_buffer, void* draw_data_void_ptr,
+    memory::StreamingBuffer::Region const& region, vk::DeviceSize index_offset, vk::Viewport const& viewport)
 {
   // I did not want to forward declare ImDrawData in a header in global namespace.
   ImDrawData* draw_data = reinterpret_cast<ImDrawData*>(draw_data_void_ptr);
@@ -910,8 +908,8 @@ void ImGui::setup_render_state(handle::CommandBuffer command_buffer, void* draw_
   // Bind the pipeline.
   command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_graphics_pipeline);
   // Bind vertex and index buffer.
-  command_buffer.vk::CommandBuffer::bindVertexBuffers(0, { frame_resources.m_vertex_buffer.m_vh_buffer }, { 0 });
-  command_buffer.bindIndexBuffer(frame_resources.m_index_buffer.m_vh_buffer, 0, sizeof(ImDrawIdx) == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
+  command_buffer.vk::CommandBuffer::bindVertexBuffers(0, { region.m_vh_buffer }, { region.m_offset });
+  command_buffer.bindIndexBuffer(region.m_vh_buffer, region.m_offset + index_offset, sizeof(ImDrawIdx) == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
 
   // Set viewport again (is this really needed?).
   command_buffer.setViewport(0, { viewport });
@@ -929,59 +927,23 @@ void ImGui::render_frame(handle::CommandBuffer command_buffer, FrameResourceInde
   EndFrame();
   Render();
   ImDrawData* draw_data = GetDrawData();
-  ImGui_FrameResourcesData& frame_resources = m_frame_resources_list[index];
-  LogicalDevice const* device = logical_device();
 
-  size_t vertex_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
-  size_t index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+  size_t const vertex_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
+  size_t const index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+  // The indices are stored directly after the vertices, in the same region of the streaming buffer.
+  vk::DeviceSize const index_offset = memory::StreamingBuffer::align(vertex_size, sizeof(ImDrawIdx));
 
-  bool initial_buffer_creation = !frame_resources.m_vertex_buffer.m_vh_buffer;
-
-  if (AI_UNLIKELY(initial_buffer_creation) && draw_data->TotalVtxCount == 0)
-    vertex_size = index_size = 1;       // We're not allowed to create buffers with zero size.
-
-  if (AI_LIKELY(draw_data->TotalVtxCount > 0) || initial_buffer_creation)
-  {
-    VmaAllocationInfo allocation_info;
-    // Create or resize the vertex buffer.
-    if (vertex_size > frame_resources.m_vertex_buffer.m_size)
-    {
-      frame_resources.m_vertex_buffer = memory::Buffer(
-          device,
-          vertex_size,
-          { .usage = vk::BufferUsageFlagBits::eVertexBuffer,
-            .properties = vk::MemoryPropertyFlagBits::eHostVisible,
-            .vma_allocation_create_flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
-            .vma_memory_usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
-            .allocation_info_out = &allocation_info }
-          COMMA_CWDEBUG_ONLY(".m_frame_resources_list[" + std::to_string(index.get_value()) + "].m_vertex_buffer" + ambifix));
-      frame_resources.m_mapped_vertex_buffer = static_cast<imgui::ImDrawVert*>(allocation_info.pMappedData);
-    }
-
-    // Create or resize the index buffer.
-    if (index_size > frame_resources.m_index_buffer.m_size)
-    {
-      frame_resources.m_index_buffer = memory::Buffer(
-          device,
-          index_size,
-          { .usage = vk::BufferUsageFlagBits::eIndexBuffer,
-            .properties = vk::MemoryPropertyFlagBits::eHostVisible,
-            .vma_allocation_create_flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
-            .vma_memory_usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
-            .allocation_info_out = &allocation_info }
-          COMMA_CWDEBUG_ONLY(".m_frame_resources_list[" + std::to_string(index.get_value()) + "].m_index_buffer" + ambifix));
-      frame_resources.m_mapped_index_buffer = static_cast<ImDrawIdx*>(allocation_info.pMappedData);
-    }
-  }
+  // This only (re)allocates when the UI outgrew the current region size (or used much less for a long time).
+  memory::StreamingBuffer::Region const region = m_streaming_buffer.begin_frame(index, index_offset + index_size);
 
   if (draw_data->TotalVtxCount > 0)
   {
     // Do not write the debug output to dc::vulkan (it is still written to dc::vkframe).
     Debug(dc::vulkan.off());
 
-    // Upload vertex and index data each into a single contiguous GPU buffer.
-    ImDrawVert* vtx_dst = reinterpret_cast<ImDrawVert*>(frame_resources.m_mapped_vertex_buffer);
-    ImDrawIdx* idx_dst = frame_resources.m_mapped_index_buffer;
+    // Upload vertex and index data each into a single contiguous range of the region.
+    ImDrawVert* vtx_dst = reinterpret_cast<ImDrawVert*>(region.m_pointer);
+    ImDrawIdx* idx_dst = reinterpret_cast<ImDrawIdx*>(region.m_pointer + index_offset);
     for (int n = 0; n < draw_data->CmdListsCount; ++n)
     {
       ImDrawList const* cmd_list = draw_data->CmdLists[n];
@@ -991,18 +953,8 @@ void ImGui::render_frame(handle::CommandBuffer command_buffer, FrameResourceInde
       idx_dst += cmd_list->IdxBuffer.Size;
     }
 
-    std::array<VmaAllocation, 2> vh_allocations = {
-      frame_resources.m_vertex_buffer.m_vh_allocation,
-      frame_resources.m_index_buffer.m_vh_allocation
-    };
-    static std::array<vk::DeviceSize, 2> const offsets = {
-      0,
-      0
-    };
-    static std::array<vk::DeviceSize, 2> const sizes = {
-      VK_WHOLE_SIZE,
-      VK_WHOLE_SIZE
-    };
+    // Flush the vertices and indices at once.
+    m_streaming_buffer.flush(region, index_offset + index_size);
 
     Debug(dc::vulkan.on());
   }
@@ -1016,7 +968,7 @@ void ImGui::render_frame(handle::CommandBuffer command_buffer, FrameResourceInde
     .minDepth = 0.0f,
     .maxDepth = 1.0f
   };
-  setup_render_state(command_buffer, draw_data, frame_resources, viewport);
+  setup_render_state(command_buffer, draw_data, region, index_offset, viewport);
 
   // Will project scissor/clipping rectangles into framebuffer space
   ImVec2 clip_off = draw_data->DisplayPos;         // (0,0) unless using multi-viewports
@@ -1040,7 +992,7 @@ void ImGui::render_frame(handle::CommandBuffer command_buffer, FrameResourceInde
 
         // ImDrawCallback_ResetRenderState is a special callback value used by the user to request the renderer to reset render state.
         if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
-          setup_render_state(command_buffer, draw_data, frame_resources, viewport);
+          setup_render_state(command_buffer, draw_data, region, index_offset, viewport);
         else
           pcmd->UserCallback(cmd_list, pcmd);
       }
@@ -1128,4 +1080,40 @@ void StatsWindow::draw(ImGuiIO& io, vk_utils::TimerData const& timer)
   ImGui::End();
 }
 
+void GpuProfilerWindow::draw(vulkan::GpuProfiler& gpu_profiler)
+{
+  ImGui::Begin("GPU", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+  if (!gpu_profiler.is_supported())
+  {
+    ImGui::TextUnformatted("Timestamps are not supported.");
+    ImGui::End();
+    return;
+  }
+
+  bool enabled = gpu_profiler.is_enabled();
+  if (ImGui::Checkbox("Profile", &enabled))
+    gpu_profiler.set_enabled(enabled);
+
+  if (enabled)
+  {
+    ImGui::SameLine();
+    if (ImGui::RadioButton("average", m_show_average))
+    {
+      m_show_average = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::RadioButton("last", !m_show_average))
+    {
+      m_show_average = false;
+    }
+
+    for (vulkan::GpuProfiler::ScopeTiming const& timing : gpu_profiler.timings())
+      ImGui::Text("%*s%-*.*s %8.3f ms", 2 * timing.m_depth, "", 24 - 2 * timing.m_depth,
+          static_cast<int>(timing.m_name.size()), timing.m_name.data(), m_show_average ? timing.m_average_ms : timing.m_ms);
+  }
+
+  ImGui::End();
+}
+
 } // namespace imgui
@@ -3,7 +3,7 @@
 #include "FrameResourcesData.h" // vulkan::FrameResourcesData::command_pool_type::data_type::create_flags
 #include "lvimconfig.h"         // lvImGuiTLS
 #include "CurrentFrameData.h"
-#include "memory/Buffer.h"
+#include "memory/StreamingBuffer.h"
 #include "shader_builder/ShaderIndex.h"
 #include "shader_builder/VertexAttribute.h"
 #include "shader_builder/VertexShaderInputSet.h"
@@ -74,25 +74,19 @@ namespace task {
 class SynchronousWindow;
 } // namespace task
 
-// Frame resources.
-struct ImGui_FrameResourcesData
-{
-  memory::Buffer m_vertex_buffer;
-  memory::Buffer m_index_buffer;
-  imgui::ImDrawVert* m_mapped_vertex_buffer;
-  imgui::ImDrawIdx* m_mapped_index_buffer;
-};
+class GpuProfiler;
 
 class ImGui
 {
  private:
   static constexpr auto pool_type = static_cast<vk::CommandPoolCreateFlags::MaskType>(vulkan::FrameResourcesData::command_pool_type::create_flags);
+  static constexpr vk::DeviceSize s_min_streaming_region_size = 64 * 1024;     // The initial size of the vertex and index data of one frame.
 
   task::SynchronousWindow const* m_owning_window;
   Texture m_font_texture;
-  utils::Vector<ImGui_FrameResourcesData, FrameResourceIndex> m_frame_resources_list;
+  memory::StreamingBuffer m_streaming_buffer;           // The vertex and index data of all frame resources.
   vk::UniqueDescriptorSetLayout m_descriptor_set_layout;
-  vk::DescriptorSet m_vh_descriptor_set;                // Lifetime is determined by the pool (LogicalDevice::m_descriptor_pool).
+  vk::DescriptorSet m_vh_descriptor_set;                // Lifetime is determined by the pools of LogicalDevice::m_descriptor_allocator.
   vk::UniquePipelineLayout m_pipeline_layout;
   vk::UniquePipeline m_graphics_pipeline;
   std::filesystem::path m_ini_filename;                 // Cache that io.IniFilename points to.
@@ -110,7 +104,8 @@ class ImGui
  private:
   inline LogicalDevice const* logical_device() const;
 
-  void setup_render_state(handle::CommandBuffer command_buffer, void* draw_data_void_ptr, ImGui_FrameResourcesData& frame_resources, vk::Viewport const& viewport);
+  void setup_render_state(handle::CommandBuffer command_buffer, void* draw_data_void_ptr,
+      memory::StreamingBuffer::Region const& region, vk::DeviceSize index_offset, vk::Viewport const& viewport);
   void register_shader_templates();
   void create_descriptor_set(
       CWDEBUG_ONLY(Ambifix const& ambifix));
@@ -118,7 +113,7 @@ class ImGui
       COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
 
  public:
-  void create_frame_resources(FrameResourceIndex number_of_frame_resources
+  void create_frame_resources(LogicalDevice const* logical_device, FrameResourceIndex number_of_frame_resources
     COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
 
   // Signals owning_window with imgui_font_texture_ready when uploading the font texture was finished.
@@ -160,4 +155,13 @@ class StatsWindow
   void draw(ImGuiIO& io, vk_utils::TimerData const& timer);
 };
 
+// Shows the timings of a vulkan::GpuProfiler, and allows to turn it on and off.
+class GpuProfilerWindow
+{
+  bool m_show_average = true;   // To show the moving average or the last frame.
+
+ public:
+  void draw(vulkan::GpuProfiler& gpu_profiler);
+};
+
 } // namespace imgui
@@ -1,11 +1,10 @@
 #pragma once
 
-#include "utils/threading/FIFOBuffer.h"
-#include "threadsafe/threadsafe.h"
 #include <iosfwd>
 #include <cstdint>
-#include <atomic>
 #include <limits>
+#include <string>
+#include <type_traits>
 #include "debug.h"
 
 namespace vulkan {
@@ -52,7 +51,7 @@ struct ModifierMask
 #endif
 };
 
-static_assert(std::is_trivially_copyable_v<ModifierMask>, "ModifierMask must be trivially copyable because we're going to use it in FIFOBuffer.");
+static_assert(std::is_trivially_copyable_v<ModifierMask>, "ModifierMask must be trivially copyable because we're going to use it in InputEventQueue.");
 
 std::ostream& operator<<(std::ostream& os, ModifierMask mask);
 
@@ -115,7 +114,7 @@ struct MouseButtons
 #endif
 };
 
-static_assert(std::is_trivially_copyable_v<MouseButtons>, "MouseButtons must be trivially copyable because we're going to use it in FIFOBuffer.");
+static_assert(std::is_trivially_copyable_v<MouseButtons>, "MouseButtons must be trivially copyable because we're going to use it in InputEventQueue.");
 
 std::ostream& operator<<(std::ostream& os, MouseButtons mask);
 
@@ -136,7 +135,7 @@ class MousePosition
   int16_t y() const { return m_y; }
 };
 
-static_assert(std::is_trivially_copyable_v<MousePosition>, "MousePosition must be trivially copyable because we're going to use it in FIFOBuffer.");
+static_assert(std::is_trivially_copyable_v<MousePosition>, "MousePosition must be trivially copyable because we're going to use it in InputEventQueue.");
 
 enum class EventType : uint16_t         // Uses 3 bits, see ButtonsEventType.
 {
@@ -158,6 +157,7 @@ struct ButtonsEventType
   EventType m_event_type:3;
 
  public:
+  ButtonsEventType() = default;
   ButtonsEventType(MouseButtons mouse_buttons, EventType event_type) : m_mouse_buttons(mouse_buttons.get_value()), m_event_type(event_type) { }
 
   MouseButtons buttons() const { return static_cast<MouseButtons>(m_mouse_buttons); }
@@ -175,38 +175,10 @@ struct InputEvent
   };
 };
 
-static_assert(std::is_trivially_copyable_v<InputEvent>, "InputEvent must be trivially copyable because we're going to use it in FIFOBuffer.");
+static_assert(std::is_trivially_copyable_v<InputEvent>, "InputEvent must be trivially copyable because we're going to use it in InputEventQueue.");
 
 #ifdef CWDEBUG
 std::ostream& operator<<(std::ostream& os, InputEvent const& input_event);
 #endif
 
-using InputEventBuffer = utils::threading::FIFOBuffer<1, InputEvent>;
-
-struct UnlockedWheelOffset
-{
-  float x;
-  float y;
-
-  void accumulate_x(float x_inc)
-  {
-    x += x_inc;
-  }
-
-  void accumulate_y(float y_inc)
-  {
-    y += y_inc;
-  }
-
-  void consume(float& delta_x_out, float& delta_y_out)
-  {
-    delta_x_out = x;
-    delta_y_out = y;
-    x = y = 0.f;
-  }
-};
-
-using WheelOffset = threadsafe::Unlocked<UnlockedWheelOffset, threadsafe::policy::Primitive<std::mutex>>;
-using MovedMousePosition = threadsafe::Unlocked<MousePosition, threadsafe::policy::Primitive<std::mutex>>;
-
 } // namespace vulkan
@@ -0,0 +1,63 @@
+#include "sys.h"
+#include "InputEventQueue.h"
+#include <bit>
+
+namespace vulkan {
+
+void InputEventQueue::initialize(uint32_t capacity)
+{
+  // The capacity must be a power of two.
+  ASSERT(std::has_single_bit(capacity));
+  m_slots = std::make_unique<Slot[]>(capacity);
+  for (uint32_t position = 0; position < capacity; ++position)
+    m_slots[position].m_sequence.store(position, std::memory_order_relaxed);
+  m_mask = capacity - 1;
+  m_tail.store(0, std::memory_order_relaxed);
+  m_head = 0;
+}
+
+bool InputEventQueue::push(InputEvent const& event)
+{
+  uint32_t position = m_tail.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    Slot& slot = m_slots[position & m_mask];
+    uint32_t const sequence = slot.m_sequence.load(std::memory_order_acquire);
+    int32_t const diff = static_cast<int32_t>(sequence - position);
+    if (diff == 0)
+    {
+      // The slot is free; try to claim it.
+      if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        slot.m_event = event;
+        slot.m_sequence.store(position + 1, std::memory_order_release);
+        return true;
+      }
+      // Another producer claimed it first; position was updated by compare_exchange_weak.
+    }
+    else if (diff < 0)
+    {
+      // The slot still contains an event that wasn't popped yet: the queue is full.
+      m_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    else
+      // Another producer claimed the slot, but m_tail was loaded before that; try again.
+      position = m_tail.load(std::memory_order_relaxed);
+  }
+}
+
+bool InputEventQueue::pop(InputEvent& event_out)
+{
+  Slot& slot = m_slots[m_head & m_mask];
+  uint32_t const sequence = slot.m_sequence.load(std::memory_order_acquire);
+  if (static_cast<int32_t>(sequence - (m_head + 1)) < 0)
+    return false;
+  event_out = slot.m_event;
+  // Make the slot available to the producers again, one lap later.
+  slot.m_sequence.store(m_head + m_mask + 1, std::memory_order_release);
+  ++m_head;
+  return true;
+}
+
+} // namespace vulkan
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "InputEvent.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "debug.h"
+
+namespace vulkan {
+
+// A bounded, lock-free, multi-producer single-consumer queue that transfers input events
+// from the event sources (normally the EventThread) to a SynchronousWindow task.
+//
+// Discrete events (key and button transitions, enter/leave and focus changes) are queued in
+// order and are never merged or reordered. Mouse motion and wheel events on the other hand are
+// coalesced: producers merely overwrite an atomic mouse position, or add to atomic wheel offsets,
+// which the consumer reads once per frame after popping the queued events. That way high-rate
+// pointer motion can never fill up the queue. Every discrete event carries the mouse position
+// at which it happened.
+//
+// When the queue is full, push fails and the event is counted as dropped (see consume_dropped).
+//
+// Every slot has a sequence number (D. Vyukov's bounded queue): a producer claims a slot by
+// incrementing m_tail with a CAS and publishes the event by updating the sequence number of the
+// slot, after which the consumer may read it. Neither side ever blocks.
+class InputEventQueue
+{
+ public:
+  static constexpr float s_wheel_unit = 0.5f;           // The wheel offsets are accumulated in units of half a step.
+
+ private:
+  struct Slot
+  {
+    std::atomic<uint32_t> m_sequence;                   // Equal to the position when free, position + 1 once the event at position was written.
+    InputEvent m_event;
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  uint32_t m_mask = 0;                                  // The capacity minus one.
+  alignas(config::cacheline_size_c) std::atomic<uint32_t> m_tail{0};   // The next position to push to.
+  alignas(config::cacheline_size_c) uint32_t m_head{0};                // The next position to pop from (only accessed by the consumer).
+  alignas(config::cacheline_size_c) std::atomic<uint32_t> m_mouse_position{pack(MousePosition{})};
+  std::atomic<int32_t> m_wheel_x{0};                    // The accumulated horizontal wheel offset, in s_wheel_unit.
+  std::atomic<int32_t> m_wheel_y{0};                    // The accumulated vertical wheel offset, in s_wheel_unit.
+  std::atomic<uint32_t> m_dropped{0};                   // The number of events that were dropped since the last call to consume_dropped.
+
+  static uint32_t pack(MousePosition mouse_position)
+  {
+    return static_cast<uint16_t>(mouse_position.x()) | static_cast<uint32_t>(static_cast<uint16_t>(mouse_position.y())) << 16;
+  }
+
+ public:
+  // Allocate room for capacity events; capacity must be a power of two.
+  // Not thread-safe: must be called before the queue is passed to any producer.
+  void initialize(uint32_t capacity);
+
+  //---------------------------------------------------------------------------
+  // Producers (thread-safe).
+
+  // Queue a discrete event. Returns false, and counts a dropped event, if the queue is full.
+  bool push(InputEvent const& event);
+
+  // Coalesced events.
+  void move_mouse(int16_t x, int16_t y) { m_mouse_position.store(pack({x, y}), std::memory_order_relaxed); }
+  void scroll(int32_t units_x, int32_t units_y)
+  {
+    if (units_x)
+      m_wheel_x.fetch_add(units_x, std::memory_order_relaxed);
+    if (units_y)
+      m_wheel_y.fetch_add(units_y, std::memory_order_relaxed);
+  }
+
+  //---------------------------------------------------------------------------
+  // Consumer (only one thread at a time).
+
+  // Pop the oldest discrete event into event_out. Returns false if the queue is empty.
+  bool pop(InputEvent& event_out);
+
+  // Return the last mouse position passed to move_mouse.
+  MousePosition mouse_position() const
+  {
+    uint32_t const packed = m_mouse_position.load(std::memory_order_relaxed);
+    return { static_cast<int16_t>(packed & 0xffff), static_cast<int16_t>(packed >> 16) };
+  }
+
+  // Return the wheel offsets accumulated since the previous call.
+  void consume_wheel_offset(float& delta_x_out, float& delta_y_out)
+  {
+    delta_x_out = m_wheel_x.exchange(0, std::memory_order_relaxed) * s_wheel_unit;
+    delta_y_out = m_wheel_y.exchange(0, std::memory_order_relaxed) * s_wheel_unit;
+  }
+
+  // Return the number of events dropped since the previous call.
+  uint32_t consume_dropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+};
+
+} // namespace vulkan
@@ -6,6 +6,7 @@
 #include "PresentationSurface.h"
 #include "SynchronousWindow.h"
 #include "pipeline/partitions/PartitionTask.h"
+#include "memory/StagingRing.h"
 #include "queues/QueueFamilyProperties.h"
 #include "queues/QueueReply.h"
 #include "infos/DeviceCreateInfo.h"
@@ -14,6 +15,7 @@
 #include "utils/is_power_of_two.h"
 #include "utils/MultiLoop.h"
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 #ifdef CWDEBUG
 #include "debug/vulkan_print_on.h"
 #include "debug/DebugSetName.h"
@@ -324,7 +326,9 @@ QueueFamilies::QueueFamilies(vk::PhysicalDevice vh_physical_device, vk::SurfaceK
   QueueFamilyPropertiesIndex queue_family(0);
   for (auto const& queueFamily : queueFamilies)
   {
-    bool const presentation_support = vh_physical_device.getSurfaceSupportKHR(queue_family.get_value(), vh_surface);
+    // Without a surface (headless windows) every queue family that supports graphics is considered to support presentation.
+    bool const presentation_support = vh_surface ? vh_physical_device.getSurfaceSupportKHR(queue_family.get_value(), vh_surface) :
+        static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
     m_queue_families.emplace_back(queueFamily, presentation_support);
     if ((queueFamily.queueFlags & vk::QueueFlagBits::eTransfer))
       m_has_explicit_transfer_support = true;
@@ -358,7 +362,7 @@ void LogicalDevice::prepare(
   vk::PhysicalDeviceFeatures2 features2 = {
     .features =
       // 1.0 features.
-      { }
+      { .shaderSampledImageArrayDynamicIndexing = true }      // Optional feature (bindless textures).
   };
   vk::StructureChain<DeviceCreateInfo,
     vk::PhysicalDeviceVulkan11Features,
@@ -385,8 +389,8 @@ void LogicalDevice::prepare(
         .descriptorBindingStorageBufferUpdateAfterBind      = false,
         .descriptorBindingUniformTexelBufferUpdateAfterBind = false,
         .descriptorBindingStorageTexelBufferUpdateAfterBind = false,
-        .descriptorBindingUpdateUnusedWhilePending          = false,
-        .descriptorBindingPartiallyBound                    = false,
+        .descriptorBindingUpdateUnusedWhilePending          = true,     // Optional feature (bindless textures).
+        .descriptorBindingPartiallyBound                    = true,     // Optional feature (bindless textures).
         .descriptorBindingVariableDescriptorCount           = false,
         .runtimeDescriptorArray                             = false,
 
@@ -439,6 +443,7 @@ void LogicalDevice::prepare(
   // (if more than one request specifies eTransfer then the first one is used).
 //  ASSERT(m_transfer_request_cookie);
 
+  // Also add the extension for headless windows: their images use the layout ePresentSrcKHR too.
   if (device_create_info.has_queue_flag(QueueFlagBits::ePresentation))
     device_create_info.addDeviceExtentions({ VK_KHR_SWAPCHAIN_EXTENSION_NAME });
 
@@ -457,7 +462,7 @@ void LogicalDevice::prepare(
   auto vhv_physical_devices = vh_instance.enumeratePhysicalDevices();
   for (auto const& vh_physical_device : vhv_physical_devices)
   {
-    QueueFamilies queue_families(vh_physical_device, window_task_ptr->vh_surface());
+    QueueFamilies queue_families(vh_physical_device, window_task_ptr->is_headless() ? vk::SurfaceKHR{} : window_task_ptr->vh_surface());
     if (queue_families.is_compatible_with(device_create_info, m_queue_replies))
     {
       auto extension_properties = vh_physical_device.enumerateDeviceExtensionProperties();
@@ -491,8 +496,9 @@ void LogicalDevice::prepare(
 #ifdef CWDEBUG
     NAMESPACE_DEBUG::Mark mark;
 #endif
-    vk::StructureChain<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceInlineUniformBlockProperties> properties_chain;
+    vk::StructureChain<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceInlineUniformBlockProperties, vk::PhysicalDeviceDescriptorIndexingProperties> properties_chain;
     auto& properties2                     = properties_chain.get<vk::PhysicalDeviceProperties2>();
+    auto& descriptor_indexing_properties  = properties_chain.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
     m_vh_physical_device.getProperties2(&properties2);
     vk::PhysicalDeviceProperties& properties = properties2.properties;
     // Exposition only currently (not yet used).
@@ -503,6 +509,7 @@ void LogicalDevice::prepare(
     m_max_sampler_anisotropy    = properties.limits.maxSamplerAnisotropy;
     m_max_bound_descriptor_sets = properties.limits.maxBoundDescriptorSets;
     m_max_push_constants_size   = properties.limits.maxPushConstantsSize;
+    m_timestamp_period          = properties.limits.timestampPeriod;
     m_set_limits = {
       .maxPerStageDescriptorSamplers = properties.limits.maxPerStageDescriptorSamplers,
       .maxPerStageDescriptorUniformBuffers = properties.limits.maxPerStageDescriptorUniformBuffers,
@@ -520,12 +527,22 @@ void LogicalDevice::prepare(
       .maxDescriptorSetStorageImages = properties.limits.maxDescriptorSetStorageImages,
       .maxDescriptorSetInputAttachments = properties.limits.maxDescriptorSetInputAttachments
     };
+    // A combined image sampler counts as both a sampler and a sampled image.
+    m_max_bindless_textures = std::min({
+      descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+      descriptor_indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+      descriptor_indexing_properties.maxPerStageUpdateAfterBindResources,
+      descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSamplers,
+      descriptor_indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages
+    });
 
     Dout(dc::vulkan, "m_non_coherent_atom_size = " << m_non_coherent_atom_size);
     Dout(dc::vulkan, "m_max_sampler_anisotropy = " << m_max_sampler_anisotropy);
     Dout(dc::vulkan, "m_max_bound_descriptor_sets = " << m_max_bound_descriptor_sets);
     Dout(dc::vulkan, "m_max_push_constants_size = " << m_max_push_constants_size);
+    Dout(dc::vulkan, "m_timestamp_period = " << m_timestamp_period);
     Dout(dc::vulkan, "m_set_limits = " << m_set_limits);
+    Dout(dc::vulkan, "m_max_bindless_textures = " << m_max_bindless_textures);
   }
   Dout(dc::vulkan, "Physical Device Memory Properties:");
   {
@@ -546,7 +563,11 @@ void LogicalDevice::prepare(
     m_supports_sampler_anisotropy = features10.samplerAnisotropy;
     m_supports_separate_depth_stencil_layouts = features12.separateDepthStencilLayouts;
     m_supports_sampled_image_update_after_bind = features12.descriptorBindingSampledImageUpdateAfterBind;
+    m_supports_texture_compression_bc = features10.textureCompressionBC;
     m_supports_cache_control = features13.pipelineCreationCacheControl;
+    m_supports_bindless_textures = features12.descriptorBindingSampledImageUpdateAfterBind &&
+      features12.descriptorBindingPartiallyBound && features12.descriptorBindingUpdateUnusedWhilePending &&
+      features10.shaderSampledImageArrayDynamicIndexing && m_max_bindless_textures > 0;
     Dout(dc::vulkan, features2);
   }
 #ifdef CWDEBUG
@@ -621,65 +642,52 @@ void LogicalDevice::prepare(
   };
   m_vh_allocator.create(vma_allocator_create_info);
 
-  {
-    std::vector<vk::DescriptorPoolSize> pool_sizes = {
-      {
-        .type = vk::DescriptorType::eSampler,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eCombinedImageSampler,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eSampledImage,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eStorageImage,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eUniformTexelBuffer,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eStorageTexelBuffer,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eUniformBuffer,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eStorageBuffer,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eUniformBufferDynamic,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eStorageBufferDynamic,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eInputAttachment,
-        .descriptorCount = 100
-      },
-      {
-        .type = vk::DescriptorType::eInlineUniformBlock,
-        .descriptorCount = 100
-      }
-    };
+  // Create the staging ring, used for all uploads that fit.
+  m_staging_ring = std::make_unique<memory::StagingRing>(this, staging_ring_size() COMMA_CWDEBUG_ONLY(debug_name_prefix("m_staging_ring")));
+  m_batch_immediate_submits = use_immediate_submit_batching();
 
-    descriptor_pool_t::wat descriptor_pool_w(m_descriptor_pool);
-    *descriptor_pool_w = create_descriptor_pool(pool_sizes, 2200
-        COMMA_DEBUG_ONLY(debug_name_prefix("m_descriptor_pool")));
-  }
+  // Blitting (used to generate mipmaps) requires a queue with graphics support.
+  m_transfer_queues_support_graphics = m_transfer_request_cookie != 0;
+  for (QueueReply const& reply : m_queue_replies)
+    if ((reply.requested_queue_flags() & QueueFlagBits::eTransfer) && reply.can_be_used_with(m_transfer_request_cookie) &&
+        !(m_queue_families[reply.get_queue_family()].get_queue_flags() & QueueFlagBits::eGraphics))
+      m_transfer_queues_support_graphics = false;
+  Dout(dc::vulkan, "m_transfer_queues_support_graphics = " << std::boolalpha << m_transfer_queues_support_graphics);
+
+  m_descriptor_allocator.initialize(this, *m_device, number_of_descriptor_pool_shards()
+      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_descriptor_allocator")));
 
   // Create an empty vk::DescriptorSetLayout.
   m_empty_descriptor_set_layout = create_descriptor_set_layout({}, debug_name_prefix("m_empty_descriptor_set_layout"));
+
+  // Create the bindless texture table, if supported and wanted.
+  uint32_t const bindless_textures = std::min(bindless_texture_table_size(), m_max_bindless_textures);
+  if (m_supports_bindless_textures && bindless_textures > 0)
+    m_bindless_texture_table.create(this, *m_device, bindless_textures
+        COMMA_CWDEBUG_ONLY(debug_name_prefix("m_bindless_texture_table")));
+  else
+    Dout(dc::vulkan, "Not creating a bindless texture table (supported: " << std::boolalpha << m_supports_bindless_textures << ").");
+
+  // Load the pipeline cache of this device, shared by all pipeline factories (see pipeline::PipelineCache).
+  Application const& application = Application::instance();
+  m_pipeline_cache.initialize(this, application.path_of(Directory::cache), application.benchmark_settings().cold_pipeline_cache
+      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_pipeline_cache")));
+}
+
+bool LogicalDevice::supports_sampled_format(vk::Format format) const
+{
+  vk::FormatProperties const format_properties = m_vh_physical_device.getFormatProperties(format);
+  return static_cast<bool>(format_properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+}
+
+bool LogicalDevice::supports_blit_mipmap_generation(vk::Format format) const
+{
+  if (!m_transfer_queues_support_graphics)
+    return false;
+  vk::FormatFeatureFlags const required_features =
+    vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+  vk::FormatProperties const format_properties = m_vh_physical_device.getFormatProperties(format);
+  return (format_properties.optimalTilingFeatures & required_features) == required_features;
 }
 
 Queue LogicalDevice::acquire_queue(QueueRequestKey queue_request_key) const
@@ -963,6 +971,7 @@ vk::UniqueDescriptorSetLayout LogicalDevice::create_descriptor_set_layout(
     set_layout = m_device->createDescriptorSetLayoutUnique(descriptor_set_layout_create_info.get<vk::DescriptorSetLayoutCreateInfo>());
   }
   DebugSetName(set_layout, debug_name, this);
+  m_descriptor_allocator.register_layout(*set_layout, sorted_descriptor_set_layout_bindings_and_flags);
   return set_layout;
 }
 
@@ -970,12 +979,11 @@ std::vector<descriptor::FrameResourceCapableDescriptorSet> LogicalDevice::alloca
     FrameResourceIndex number_of_frame_resources,
     std::vector<vk::DescriptorSetLayout> const& vhv_descriptor_set_layouts,
     std::vector<uint32_t> const& unbounded_descriptor_array_sizes,
-    std::vector<std::pair<descriptor::SetIndex, bool>> const& set_index_has_frame_resource_pairs,
-    descriptor_pool_t& descriptor_pool
+    std::vector<std::pair<descriptor::SetIndex, bool>> const& set_index_has_frame_resource_pairs
     COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const
 {
   DoutEntering(dc::shaderresource|dc::vulkan, "LogicalDevice::allocate_descriptor_sets(" << number_of_frame_resources << ", " << vhv_descriptor_set_layouts << ", " << unbounded_descriptor_array_sizes <<
-      ", " << set_index_has_frame_resource_pairs << ", @" << (void*)&descriptor_pool << ", object_name:\"" << debug_name.object_name() << "\").");
+      ", " << set_index_has_frame_resource_pairs << ", object_name:\"" << debug_name.object_name() << "\").");
   // These vectors contain data that matches on a per index basis.
   bool const unbounded_descriptor_array_sizes_empty = unbounded_descriptor_array_sizes.empty();
   ASSERT(unbounded_descriptor_array_sizes_empty || vhv_descriptor_set_layouts.size() == unbounded_descriptor_array_sizes.size());
@@ -999,28 +1007,11 @@ std::vector<descriptor::FrameResourceCapableDescriptorSet> LogicalDevice::alloca
     }
     ++n;
   }
-  // This is only used when !unbounded_descriptor_array_sizes_empty.
-  vk::DescriptorSetVariableDescriptorCountAllocateInfo descriptor_set_variable_descriptor_count_allocate_info{
-    .descriptorSetCount = static_cast<uint32_t>(tmp_unbounded_descriptor_array_sizes.size()),
-    .pDescriptorCounts = tmp_unbounded_descriptor_array_sizes.data()
-  };
-  vk::DescriptorSetVariableDescriptorCountAllocateInfo* descriptor_set_variable_descriptor_count_allocate_info_ptr = nullptr;
-  if (!unbounded_descriptor_array_sizes_empty)
-  {
-    ASSERT(tmp_unbounded_descriptor_array_sizes.size() <= std::numeric_limits<uint32_t>::max());
-    descriptor_set_variable_descriptor_count_allocate_info_ptr = &descriptor_set_variable_descriptor_count_allocate_info;
-  }
-  std::vector<vk::DescriptorSet> raw_descriptor_sets;
-  {
-    descriptor_pool_t::wat descriptor_pool_w(descriptor_pool);
-    vk::DescriptorSetAllocateInfo descriptor_set_allocate_info{
-      .pNext = descriptor_set_variable_descriptor_count_allocate_info_ptr,
-      .descriptorPool = descriptor_pool_w->get(),
-      .descriptorSetCount = static_cast<uint32_t>(tmp_vh_descriptor_set_layouts.size()),
-      .pSetLayouts = tmp_vh_descriptor_set_layouts.data()
-    };
-    raw_descriptor_sets = m_device->allocateDescriptorSets(descriptor_set_allocate_info);
-  }
+  // The variable descriptor counts are only passed when !unbounded_descriptor_array_sizes_empty.
+  if (unbounded_descriptor_array_sizes_empty)
+    tmp_unbounded_descriptor_array_sizes.clear();
+  ASSERT(tmp_unbounded_descriptor_array_sizes.size() <= std::numeric_limits<uint32_t>::max());
+  std::vector<vk::DescriptorSet> raw_descriptor_sets = m_descriptor_allocator.allocate(tmp_vh_descriptor_set_layouts, tmp_unbounded_descriptor_array_sizes);
 
   std::vector<descriptor::FrameResourceCapableDescriptorSet> descriptor_sets;
   auto raw_descriptor_set = raw_descriptor_sets.begin();
@@ -1070,20 +1061,6 @@ std::vector<descriptor::FrameResourceCapableDescriptorSet> LogicalDevice::alloca
   return descriptor_sets;
 }
 
-void LogicalDevice::free_descriptor_sets(descriptor_pool_t& descriptor_pool, std::vector<vk::DescriptorSet> const& descriptors) const
-{
-  DoutEntering(dc::shaderresource|dc::vulkan, "LogicalDevice::LogicalDevice::free_descriptor_sets(@" << (void*)&descriptor_pool << ")");
-  descriptor_pool_t::wat descriptor_pool_w(descriptor_pool);
-  m_device->freeDescriptorSets(descriptor_pool_w->get(), descriptors);
-}
-
-void LogicalDevice::reset_descriptor_pool(descriptor_pool_t& descriptor_pool) const
-{
-  DoutEntering(dc::shaderresource|dc::vulkan, "LogicalDevice::reset_descriptor_pool(@" << (void*)&descriptor_pool << ")");
-  descriptor_pool_t::wat descriptor_pool_w(descriptor_pool);
-  m_device->resetDescriptorPool(descriptor_pool_w->get(), {});
-}
-
 void LogicalDevice::allocate_command_buffers(
     vk::CommandPool vh_pool,
     vk::CommandBufferLevel level,
@@ -1126,6 +1103,18 @@ void LogicalDevice::free_command_buffers(vk::CommandPool vh_pool, uint32_t count
   m_device->freeCommandBuffers(vh_pool, count, command_buffers);
 }
 
+void LogicalDevice::reset_command_pool(vk::CommandPool vh_pool) const
+{
+  // Recycles the memory of all command buffers allocated from vh_pool and puts them back in the initial state.
+  m_device->resetCommandPool(vh_pool, {});
+}
+
+void LogicalDevice::update_descriptor_sets(std::vector<vk::WriteDescriptorSet> const& descriptor_writes) const
+{
+  Dout(dc::vulkan, "Calling vk::Device::updateDescriptorSets(" << descriptor_writes.size() << ", " << descriptor_writes << ", 0, nullptr)");
+  m_device->updateDescriptorSets(descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
+}
+
 vk::UniquePipelineLayout LogicalDevice::create_pipeline_layout(
     utils::Vector<vk::DescriptorSetLayout, descriptor::SetIndexHint> const& vhv_sorted_descriptor_set_layouts,
     std::vector<vk::PushConstantRange> const& push_constant_ranges
@@ -1236,16 +1225,19 @@ size_t LogicalDevice::get_pipeline_cache_size(vk::PipelineCache vh_pipeline_cach
   return result;
 }
 
-void LogicalDevice::get_pipeline_cache_data(vk::PipelineCache vh_pipeline_cache, size_t& len, void* buffer) const
+bool LogicalDevice::get_pipeline_cache_data(vk::PipelineCache vh_pipeline_cache, size_t& len, void* buffer) const
 {
   size_t orig_len = len;
   vk::Result result = m_device->getPipelineCacheData(vh_pipeline_cache, &len, buffer);
+  if (result == vk::Result::eIncomplete)
+    return false;
   if (AI_UNLIKELY(result != vk::Result::eSuccess))
 #ifdef CWDEBUG
     THROW_ALERTC(result, "[DEVICE]->getPipelineCacheData([LEN])", AIArgs("[DEVICE]", this->debug_name())("[LEN]", orig_len));
 #else
     THROW_ALERTC(result, "LogicalDevice::get_pipeline_cache_data([LEN])", AIArgs("[LEN]", orig_len));
 #endif
+  return true;
 }
 
 void LogicalDevice::merge_pipeline_caches(vk::PipelineCache vh_pipeline_cache, std::vector<vk::PipelineCache> const& vhv_pipeline_caches) const
@@ -1444,11 +1436,22 @@ vk::PipelineLayout LogicalDevice::realize_pipeline_layout(
     sorted_descriptor_set_layouts_t::wat const& realized_descriptor_set_layouts_w,
     descriptor::SetIndexHint largest_set_index_hint,
     descriptor::SetIndexHintMap& set_index_hint_map1_out,
-    std::vector<vk::PushConstantRange> const& sorted_push_constant_ranges) /*threadsafe-*/const
+    std::vector<vk::PushConstantRange> const& sorted_push_constant_ranges,
+    bool with_bindless_texture_table) /*threadsafe-*/const
 {
   DoutEntering(dc::shaderresource|dc::vulkan|dc::setindexhint, "LogicalDevice::realize_pipeline_layout(" <<
       *realized_descriptor_set_layouts_w << ", " << largest_set_index_hint << ", set_index_hint_map1_out, " <<
-      sorted_push_constant_ranges << ")");
+      sorted_push_constant_ranges << ", " << std::boolalpha << with_bindless_texture_table << ")");
+  if (with_bindless_texture_table)
+  {
+    // Only call PipelineFactory::use_bindless_texture_table when supports_bindless_textures() returns true.
+    ASSERT(m_bindless_texture_table.is_created());
+    if (!largest_set_index_hint.undefined() && largest_set_index_hint.get_value() >= descriptor::BindlessTextureTable::s_set_index)
+      THROW_ALERT("A pipeline that uses the bindless texture table can not use more than [MAX] other descriptor sets.",
+          AIArgs("[MAX]", descriptor::BindlessTextureTable::s_set_index));
+  }
+  // Pipeline layouts with and without the bindless texture table are kept in different caches, so that they have the same key type.
+  pipeline_layouts_t& pipeline_layouts = with_bindless_texture_table ? m_bindless_pipeline_layouts : m_pipeline_layouts;
 #ifdef CWDEBUG
   descriptor::SetLayout const* prev_set_layout = nullptr;
   descriptor::SetLayoutCompare set_layout_compare;
@@ -1467,7 +1470,7 @@ vk::PipelineLayout LogicalDevice::realize_pipeline_layout(
     try
     {
       using pipeline_layouts_t = LogicalDevice::pipeline_layouts_t;
-      pipeline_layouts_t::rat pipeline_layouts_r(m_pipeline_layouts);
+      pipeline_layouts_t::rat pipeline_layouts_r(pipeline_layouts);
       auto key = std::make_pair(*realized_descriptor_set_layouts_w, sorted_push_constant_ranges);
       auto iter = pipeline_layouts_r->find(key);
       if (iter == pipeline_layouts_r->end())
@@ -1489,6 +1492,12 @@ vk::PipelineLayout LogicalDevice::realize_pipeline_layout(
           // Create an identity set index hint map.
           set_index_hint_map1_out.add_from_to(layout.set_index_hint(), layout.set_index_hint());
         }
+        if (with_bindless_texture_table)
+        {
+          // Fill the set indexes in between with empty layouts too.
+          vhv_realized_descriptor_set_layouts.resize(descriptor::BindlessTextureTable::s_set_index + 1, *m_empty_descriptor_set_layout);
+          vhv_realized_descriptor_set_layouts.back() = m_bindless_texture_table.vh_descriptor_set_layout();
+        }
         vk::UniquePipelineLayout layout = create_pipeline_layout(vhv_realized_descriptor_set_layouts, sorted_push_constant_ranges
             COMMA_CWDEBUG_ONLY(debug_name_prefix("m_pipeline_layouts[" + std::to_string(pipeline_layouts_r->size()) + "]")));
         pipeline_layouts_t::wat pipeline_layouts_w(pipeline_layouts_r);
@@ -1533,7 +1542,7 @@ vk::PipelineLayout LogicalDevice::realize_pipeline_layout(
     catch (std::exception const&)
     {
       Dout(dc::shaderresource, "Another thread is also trying to convert read to write lock: dropping creation and trying again...");
-      m_pipeline_layouts.rd2wryield();
+      pipeline_layouts.rd2wryield();
       set_index_hint_map1_out.clear();
     }
   }
@@ -1547,30 +1556,17 @@ LogicalDevice::LogicalDevice() : m_semaphore_watcher(statefultask::create<task::
 
 LogicalDevice::~LogicalDevice()
 {
+  if (m_staging_ring)
+    Dout(dc::vulkan, "Staging ring statistics: " << *m_staging_ring);
+  Dout(dc::vulkan, "Descriptor allocator: " << m_descriptor_allocator);
+  if (m_bindless_texture_table.is_created())
+    Dout(dc::vulkan, "Bindless texture table: " << m_bindless_texture_table);
 }
 
 void LogicalDevice::initialize_number_of_partitions() /*threadsafe-*/const
 {
   DoutEntering(dc::vulkan, "LogicalDevice::initialize_number_of_partitions()");
-  using namespace pipeline::partitions;
-  // Cache of the number of partitions existing of 'sets' sets when starting with 'top_sets' and adding 'depth' new elements.
-  std::unique_ptr<table3d_t> table3d = std::make_unique<table3d_t>();
-  uint32_t max_number_of_sets = max_bound_descriptor_sets();
-  for (int top_sets = 1; top_sets <= max_number_of_sets; ++top_sets)
-  {
-    for (int depth = 0; depth < max_number_of_elements - top_sets; ++depth)
-    {
-      partition_count_t sum = 0;
-      for (int8_t sets = top_sets; sets <= max_number_of_sets; ++sets)
-      {
-        partition_count_t term = PartitionTask::table(top_sets, depth, sets, table3d.get());
-        if (term == 0)
-          break;
-        sum += term;
-      }
-      m_number_of_partitions[top_sets][depth] = sum;
-    }
-  }
+  pipeline::partitions::PartitionTask::initialize_number_of_partitions(m_number_of_partitions, max_bound_descriptor_sets());
 }
 
 #ifdef TRACY_ENABLE
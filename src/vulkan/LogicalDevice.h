@@ -20,10 +20,12 @@
 #include "descriptor/SetIndexHintMap.h"
 #include "descriptor/FrameResourceCapableDescriptorSet.h"
 #include "descriptor/SetLayoutBindingsAndFlags.h"
+#include "descriptor/DescriptorAllocator.h"
+#include "descriptor/BindlessTextureTable.h"
 #include "pipeline/PushConstantRangeCompare.h"
+#include "pipeline/PipelineCache.h"
 #include "pipeline/partitions/Defs.h"
 #include "vk_utils/print_list.h"
-#include "vk_utils/WriteLockOnly.h"
 #include "statefultask/AIStatefulTask.h"
 #include "statefultask/TaskEvent.h"
 #include "threadsafe/AIReadWriteMutex.h"
@@ -70,6 +72,7 @@ class RenderPass;
 namespace memory {
 class Buffer;
 class Image;
+class StagingRing;
 } // namespace memory
 
 // The collection of queue family properties for a given physical device.
@@ -117,7 +120,9 @@ class LogicalDevice
   float m_max_sampler_anisotropy;                       // GraphicsSettingsPOD::maxAnisotropy must be less than or equal this value.
   uint32_t m_max_bound_descriptor_sets;                 // Each pipeline object can use up to m_max_bound_descriptor_sets descriptor sets.
   uint32_t m_max_push_constants_size;                   // The maximum size, in bytes, of the pool of push constant memory.
+  float m_timestamp_period;                             // The number of nanoseconds it takes for a timestamp value to be incremented by one.
   descriptor::SetLimits m_set_limits;
+  uint32_t m_max_bindless_textures = {};                // The maximum number of elements of an update-after-bind combined image sampler array.
 
   uint32_t m_memory_type_count;                         // The number of memory types of this GPU.
   uint32_t m_memory_heap_count;                         // The number of heaps of this GPU.
@@ -125,14 +130,20 @@ class LogicalDevice
   bool m_supports_sampler_anisotropy = {};
   bool m_supports_cache_control = {};
   bool m_supports_sampled_image_update_after_bind = {}; // Set if the physical device supports vk::DescriptorBindingFlagBits::eUpdateAfterBind for samplers / sampled images.
+  bool m_supports_texture_compression_bc = {};          // Set if the physical device supports the BC1-BC7 formats.
+  bool m_supports_bindless_textures = {};               // Set if the physical device supports the descriptor indexing features needed by BindlessTextureTable.
+  bool m_transfer_queues_support_graphics = {};         // Set if all queues used by ImmediateSubmitQueue support graphics (and therefore vkCmdBlitImage).
   memory::Allocator m_vh_allocator;                     // Handle to VMA allocator object.
   QueueRequestKey::request_cookie_type m_transfer_request_cookie = {};  // The cookie that was used to request eTransfer queues (set in LogicalDevice::prepare).
   boost::intrusive_ptr<task::AsyncSemaphoreWatcher> m_semaphore_watcher;// Asynchronous task that polls timeline semaphores.
+  std::unique_ptr<memory::StagingRing> m_staging_ring;  // Persistently mapped staging memory used by CopyDataToGPU (created in prepare).
+  bool m_batch_immediate_submits = {};                  // Set if ImmediateSubmitQueue tasks should batch requests (set in LogicalDevice::prepare).
 
-  using descriptor_pool_t = vk_utils::WriteLockOnly<vk::UniqueDescriptorPool>;
   // Using "threadsafe-"const for member functions that access this. Since the 'const' then only
-  // means that it is thread-safe, we need to add a mutable here, so that it is possible to obtain a write-lock.
-  mutable descriptor_pool_t m_descriptor_pool;
+  // means that it is thread-safe, we need to add a mutable here, so that it is possible to allocate.
+  mutable descriptor::DescriptorAllocator m_descriptor_allocator;
+  descriptor::BindlessTextureTable m_bindless_texture_table;    // Only created if m_supports_bindless_textures (see prepare).
+  mutable pipeline::PipelineCache m_pipeline_cache;             // Mutable because it is thread-safe (initialized in prepare).
 
   using descriptor_set_layouts_container_t = std::map<std::vector<vk::DescriptorSetLayoutBinding>, vk::UniqueDescriptorSetLayout, utils::VectorCompare<descriptor::LayoutBindingCompare>>;
   using descriptor_set_layouts_t = threadsafe::Unlocked<descriptor_set_layouts_container_t, threadsafe::policy::ReadWrite<AIReadWriteMutex>>;
@@ -148,8 +159,9 @@ class LogicalDevice
         utils::PairCompare<descriptor::SetLayoutCompare, pipeline::PushConstantRangeCompare>>;
   using pipeline_layouts_t = threadsafe::Unlocked<pipeline_layouts_container_t, threadsafe::policy::ReadWrite<AIReadWriteMutex>>;
   mutable pipeline_layouts_t m_pipeline_layouts;
+  mutable pipeline_layouts_t m_bindless_pipeline_layouts;     // Same, but for pipeline layouts that include the bindless texture table.
 
-  using number_of_partitions_t = std::array<std::array<pipeline::partitions::partition_count_t, pipeline::partitions::max_number_of_elements>, pipeline::partitions::max_number_of_elements>;
+  using number_of_partitions_t = pipeline::partitions::number_of_partitions_table_t;
   mutable std::once_flag m_number_of_partitions_initialization; // Used for initialization for m_number_of_partitions.
   mutable number_of_partitions_t m_number_of_partitions;        // One-time initialized by initialize_number_of_partitions.
 
@@ -173,12 +185,26 @@ class LogicalDevice
   bool supports_sampler_anisotropy() const { return m_supports_sampler_anisotropy; }
   bool supports_cache_control() const { return m_supports_cache_control; }
   bool supports_sampled_image_update_after_bind() const { return m_supports_sampled_image_update_after_bind; }
+  bool supports_texture_compression_bc() const { return m_supports_texture_compression_bc; }
+  // Return true if bindless_texture_table() may be used.
+  bool supports_bindless_textures() const { return m_bindless_texture_table.is_created(); }
+  // Return true if images with this format and optimal tiling can be sampled.
+  bool supports_sampled_format(vk::Format format) const;
+  // Return true if CopyDataToImage::set_generate_mipmaps may be used for images with this format.
+  bool supports_blit_mipmap_generation(vk::Format format) const;
   vk::DeviceSize non_coherent_atom_size() const { return m_non_coherent_atom_size; }
   float max_sampler_anisotropy() const { return m_max_sampler_anisotropy; }
   uint32_t max_bound_descriptor_sets() const { return m_max_bound_descriptor_sets; }
   uint32_t max_push_constants_size() const { return m_max_push_constants_size; }
+  float timestamp_period() const { return m_timestamp_period; }
+  // Return the number of valid bits of timestamps written by queues of queue_family (zero if timestamps are not supported).
+  uint32_t timestamp_valid_bits(QueueFamilyPropertiesIndex queue_family) const { return m_queue_families[queue_family].timestampValidBits; }
   bool has_explicit_transfer_support() const { return m_queue_families.has_explicit_transfer_support(); }
   QueueRequestKey::request_cookie_type transfer_request_cookie() const { return m_transfer_request_cookie; }
+  memory::StagingRing& staging_ring() /*threadsafe-*/const { return *m_staging_ring; }
+  bool batch_immediate_submits() const { return m_batch_immediate_submits; }
+  descriptor::BindlessTextureTable const& bindless_texture_table() /*threadsafe-*/const { return m_bindless_texture_table; }
+  pipeline::PipelineCache& pipeline_cache() /*threadsafe-*/const { return m_pipeline_cache; }
 
   void print_on(std::ostream& os) const { char const* prefix = ""; os << '{'; print_members(os, prefix); os << '}'; }
   void print_members(std::ostream& os, char const* prefix) const;
@@ -205,11 +231,14 @@ class LogicalDevice
 
   // This function realizes a pipeline layout, using realized_descriptor_set_layouts and sorted_push_constant_ranges,
   // and returns an updated set_index_hint_map_out (see explanation in LogicalDevice.cxx).
+  // If with_bindless_texture_table is true then the layout of the bindless texture table is added at set index
+  // descriptor::BindlessTextureTable::s_set_index.
   vk::PipelineLayout realize_pipeline_layout(
       sorted_descriptor_set_layouts_t::wat const& realized_descriptor_set_layouts_w,    // wat because the binding numbers might be adjusted.
       descriptor::SetIndexHint largest_set_index_hint,
       descriptor::SetIndexHintMap& set_index_hint_map_out,
-      std::vector<vk::PushConstantRange> const& sorted_push_constant_ranges
+      std::vector<vk::PushConstantRange> const& sorted_push_constant_ranges,
+      bool with_bindless_texture_table = false
       ) /*threadsafe-*/const;
 
   pipeline::partitions::partition_count_t number_of_partitions(int top_sets, int depth) /*threadsafe-*/const
@@ -265,6 +294,15 @@ class LogicalDevice
   inline vk::UniqueCommandPool create_command_pool(uint32_t queue_family_index, vk::CommandPoolCreateFlags flags
       COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const;
   inline void destroy_command_pool(vk::CommandPool vh_command_pool) const;
+  inline vk::UniqueQueryPool create_query_pool(vk::QueryType query_type, uint32_t query_count
+      COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const;
+  vk::Result get_query_pool_results(vk::QueryPool vh_query_pool, uint32_t first_query, uint32_t query_count,
+      size_t data_size, void* data, vk::DeviceSize stride, vk::QueryResultFlags flags) const
+  {
+    DoutEntering(dc::vkframe, "LogicalDevice::get_query_pool_results(" << vh_query_pool << ", " << first_query << ", " << query_count <<
+        ", " << data_size << ", " << data << ", " << stride << ", " << flags << ")");
+    return m_device->getQueryPoolResults(vh_query_pool, first_query, query_count, data_size, data, stride, flags);
+  }
   vk::Result acquire_next_image(vk::SwapchainKHR vh_swapchain, uint64_t timeout, vk::Semaphore vh_semaphore, vk::Fence vh_fence, SwapchainIndex& image_index_out) const
   {
     DoutEntering(dc::vkframe, "LogicalDevice::acquire_next_image(" << vh_swapchain << ", " << timeout << ", " << vh_semaphore << ", " << vh_fence << ", ...)");
@@ -298,17 +336,18 @@ class LogicalDevice
   std::vector<descriptor::FrameResourceCapableDescriptorSet> allocate_descriptor_sets(FrameResourceIndex number_of_frame_resources,
       std::vector<vk::DescriptorSetLayout> const& vhv_descriptor_set_layouts,
       std::vector<uint32_t> const& unbounded_descriptor_array_sizes,
-      std::vector<std::pair<descriptor::SetIndex, bool>> const& set_index_has_frame_resource_pairs, descriptor_pool_t& descriptor_pool
+      std::vector<std::pair<descriptor::SetIndex, bool>> const& set_index_has_frame_resource_pairs
       COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const;
-  void free_descriptor_sets(descriptor_pool_t& descriptor_pool, std::vector<vk::DescriptorSet> const& descriptors) const;
-  void reset_descriptor_pool(descriptor_pool_t& descriptor_pool) const;
   void allocate_command_buffers(vk::CommandPool vh_pool, vk::CommandBufferLevel level, uint32_t count, vk::CommandBuffer* command_buffers_out
       COMMA_CWDEBUG_ONLY(Ambifix const& debug_name, bool is_array = true)) const;
   void free_command_buffers(vk::CommandPool vh_pool, uint32_t count, vk::CommandBuffer const* command_buffers) const;
+  void reset_command_pool(vk::CommandPool vh_pool) const;
   template<ConceptWriteDescriptorSetUpdateInfo T>
   void update_descriptor_sets(descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, vk::DescriptorType descriptor_type,
       uint32_t binding, uint32_t array_element, T const& write_descriptor_set_update_infos,
       uint32_t array_element_count, FrameResourceIndex number_of_frame_resources) const;
+  // Perform all descriptor_writes with a single vkUpdateDescriptorSets call (see descriptor::DescriptorWriteBatch).
+  void update_descriptor_sets(std::vector<vk::WriteDescriptorSet> const& descriptor_writes) const;
   vk::UniquePipelineLayout create_pipeline_layout(utils::Vector<vk::DescriptorSetLayout, descriptor::SetIndexHint> const& vhv_descriptor_set_layouts, std::vector<vk::PushConstantRange> const& push_constant_ranges
       COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const;
   vk::UniqueSwapchainKHR create_swapchain(vk::Extent2D extent, uint32_t min_image_count, PresentationSurface const& presentation_surface,
@@ -360,6 +399,12 @@ class LogicalDevice
     m_vh_allocator.flush_allocations(allocation_count, vh_allocations, offsets, sizes);
   }
 
+  void invalidate_mapped_allocation(VmaAllocation vh_allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+  {
+    DoutEntering(dc::vulkan|dc::vkframe, "invalidate_mapped_allocation(" << vh_allocation << ", " << offset << ", " << size << ")");
+    m_vh_allocator.invalidate_allocation(vh_allocation, offset, size);
+  }
+
   void unmap_memory(VmaAllocation vh_allocation) const
   {
     DoutEntering(dc::vulkan|dc::vkframe, "unmap_memory(" << vh_allocation << ")");
@@ -418,7 +463,8 @@ class LogicalDevice
   vk::UniquePipelineCache create_pipeline_cache(vk::PipelineCacheCreateInfo const& pipeline_cache_create_info
       COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const;
   size_t get_pipeline_cache_size(vk::PipelineCache vh_pipeline_cache) const;
-  void get_pipeline_cache_data(vk::PipelineCache vh_pipeline_cache, size_t& len, void* buffer) const;
+  // Returns false if len was too small to hold all data (len is then set to the number of bytes written).
+  bool get_pipeline_cache_data(vk::PipelineCache vh_pipeline_cache, size_t& len, void* buffer) const;
   void merge_pipeline_caches(vk::PipelineCache vh_pipeline_cache, std::vector<vk::PipelineCache> const& vhv_pipeline_caches) const;
   vk::MemoryRequirements get_buffer_memory_requirements(vk::Buffer vh_buffer) const
   {
@@ -430,10 +476,6 @@ class LogicalDevice
     DoutEntering(dc::vulkan, "LogicalDevice::get_image_memory_requirements(" << vh_image << ")");
     return m_device->getImageMemoryRequirements(vh_image);
   }
-  descriptor_pool_t& get_descriptor_pool() /*threadsafe-*/ const
-  {
-    return m_descriptor_pool;
-  }
 #ifdef CWDEBUG
   vk_utils::MemoryTypeBitsPrinter memory_type_bits_printer() const { return { m_memory_type_count }; }
   vk_utils::MemoryRequirementsPrinter memory_requirements_printer() const { return { m_memory_type_count, m_memory_heap_count }; }
@@ -452,6 +494,22 @@ class LogicalDevice
   // Override this function to add QueueRequest objects manually.
   // The default will create one graphics, presentation and transfer queue.
   virtual void prepare_logical_device(DeviceCreateInfo& device_create_info) const;
+
+  // Override this function to change the size of the staging ring (in bytes).
+  // Uploads larger than a quarter of this size use a dedicated staging buffer.
+  virtual vk::DeviceSize staging_ring_size() const { return 64 * 1024 * 1024; }
+
+  // Override this function to return true in order to record the transfers of immediate submit requests that
+  // arrive close together into a single command buffer. The default gives every request its own command buffer.
+  virtual bool use_immediate_submit_batching() const { return false; }
+
+  // Override this function to change the number of descriptor pool shards (see DescriptorAllocator).
+  // Returning 1 makes all threads allocate their descriptor sets from the same pools, under a single lock.
+  virtual int number_of_descriptor_pool_shards() const { return 8; }
+
+  // Override this function to change the number of textures of the bindless texture table (see BindlessTextureTable).
+  // The table is clamped to the update-after-bind limits of the physical device. Returning 0 disables the table.
+  virtual uint32_t bindless_texture_table_size() const { return 4096; }
 };
 
 namespace task {
@@ -576,6 +634,13 @@ void LogicalDevice::destroy_command_pool(vk::CommandPool vh_command_pool) const
   m_device->destroyCommandPool(vh_command_pool);
 }
 
+vk::UniqueQueryPool LogicalDevice::create_query_pool(vk::QueryType query_type, uint32_t query_count COMMA_CWDEBUG_ONLY(Ambifix const& debug_name)) const
+{
+  vk::UniqueQueryPool query_pool = m_device->createQueryPoolUnique({ .queryType = query_type, .queryCount = query_count });
+  DebugSetName(query_pool, debug_name, this);
+  return query_pool;
+}
+
 template<ConceptWriteDescriptorSetUpdateInfo T>
 void LogicalDevice::update_descriptor_sets(descriptor::FrameResourceCapableDescriptorSet const& descriptor_set,
     vk::DescriptorType descriptor_type, uint32_t binding, uint32_t array_element, T const& write_descriptor_set_update_infos,
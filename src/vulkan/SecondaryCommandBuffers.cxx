@@ -0,0 +1,263 @@
+#include "sys.h"
+#include "SecondaryCommandBuffers.h"
+#include "AsyncTask.h"
+#include "Application.h"
+#include "statefultask/AIStatefulTask.h"
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include "debug.h"
+
+namespace vulkan {
+
+namespace detail {
+
+// The jobs of a single call to SecondaryCommandBuffers::record.
+//
+// Shared between the render thread and the helper tasks; a helper task that only gets
+// to see these jobs after all of them were already taken returns without touching anything else.
+struct SecondaryCommandBuffersJobs
+{
+  vk::CommandBufferInheritanceInfo const m_inheritance_info;
+  SecondaryCommandBuffers::record_function_type const m_record_function;
+  std::function<void(int)> m_job;                      // Records job 'job_index'.
+  int const m_number_of_jobs;
+  std::atomic<int> m_next_job{0};                       // The next job that wasn't taken yet.
+  std::atomic<int> m_finished_jobs{0};                  // The number of jobs that were recorded.
+  std::mutex m_exception_mutex;                         // Protects m_exception.
+  std::exception_ptr m_exception;                       // The first exception thrown by m_job, if any.
+
+  SecondaryCommandBuffersJobs(vk::CommandBufferInheritanceInfo const& inheritance_info,
+      SecondaryCommandBuffers::record_function_type&& record_function, int number_of_jobs) :
+    m_inheritance_info(inheritance_info), m_record_function(std::move(record_function)), m_number_of_jobs(number_of_jobs) { }
+
+  // Run one job, if any is left. Returns false if there was no job left.
+  bool work_one()
+  {
+    int job_index = m_next_job.fetch_add(1, std::memory_order::relaxed);
+    if (job_index >= m_number_of_jobs)
+      return false;
+    try
+    {
+      m_job(job_index);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(m_exception_mutex);
+      if (!m_exception)
+        m_exception = std::current_exception();
+    }
+    m_finished_jobs.fetch_add(1, std::memory_order::release);
+    return true;
+  }
+
+  // Run jobs until there are no jobs left.
+  void work()
+  {
+    while (work_one())
+      ;
+  }
+
+  bool finished() const
+  {
+    return m_finished_jobs.load(std::memory_order::acquire) == m_number_of_jobs;
+  }
+};
+
+} // namespace detail
+
+namespace task {
+
+// A long lived task that helps recording secondary command buffers from the thread pool.
+class RecordSecondaryCommandBuffers final : public AsyncTask
+{
+ public:
+  static constexpr condition_type have_jobs = 1;
+
+ private:
+  std::mutex m_jobs_mutex;                                      // Protects m_jobs.
+  std::shared_ptr<detail::SecondaryCommandBuffersJobs> m_jobs;  // Jobs handed to this task that it didn't pick up yet.
+  std::atomic<bool> m_terminate{false};
+
+ protected:
+  using direct_base_type = AsyncTask;
+
+  enum RecordSecondaryCommandBuffers_state_type {
+    RecordSecondaryCommandBuffers_wait = direct_base_type::state_end
+  };
+
+ public:
+  static constexpr state_type state_end = RecordSecondaryCommandBuffers_wait + 1;
+
+  RecordSecondaryCommandBuffers() : AsyncTask(CWDEBUG_ONLY(false)) { }
+
+  // Help recording jobs.
+  void help(std::shared_ptr<detail::SecondaryCommandBuffersJobs> const& jobs)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_jobs_mutex);
+      m_jobs = jobs;
+    }
+    signal(have_jobs);
+  }
+
+  void terminate()
+  {
+    m_terminate = true;
+    signal(have_jobs);
+  }
+
+ protected:
+  char const* condition_str_impl(condition_type condition) const override
+  {
+    switch (condition)
+    {
+      AI_CASE_RETURN(have_jobs);
+    }
+    return direct_base_type::condition_str_impl(condition);
+  }
+
+  char const* state_str_impl(state_type run_state) const override
+  {
+    switch (run_state)
+    {
+      AI_CASE_RETURN(RecordSecondaryCommandBuffers_wait);
+    }
+    AI_NEVER_REACHED
+  }
+
+  char const* task_name_impl() const override
+  {
+    return "RecordSecondaryCommandBuffers";
+  }
+
+  void initialize_impl() override
+  {
+    set_state(RecordSecondaryCommandBuffers_wait);
+  }
+
+  void multiplex_impl(state_type run_state) override
+  {
+    switch (run_state)
+    {
+      case RecordSecondaryCommandBuffers_wait:
+      {
+        std::shared_ptr<detail::SecondaryCommandBuffersJobs> jobs;
+        {
+          std::lock_guard<std::mutex> lock(m_jobs_mutex);
+          jobs = std::move(m_jobs);
+        }
+        if (jobs)
+          jobs->work();
+        if (m_terminate)
+        {
+          finish();
+          break;
+        }
+        wait(have_jobs);
+        break;
+      }
+    }
+  }
+};
+
+} // namespace task
+
+SecondaryCommandBuffers::SecondaryCommandBuffers(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family) :
+  m_logical_device(logical_device), m_queue_family(queue_family)
+{
+}
+
+SecondaryCommandBuffers::~SecondaryCommandBuffers()
+{
+  // The jobs refer to m_slots; finish them before destroying anything.
+  if (m_jobs)
+    while (!poll())
+      ;
+  for (auto& helper : m_helpers)
+    helper->terminate();
+}
+
+SecondaryCommandBuffers::Slot::Slot(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix)) :
+  m_command_pool(logical_device, queue_family COMMA_CWDEBUG_ONLY(".m_command_pool" + ambifix)),
+  m_command_buffer(m_command_pool.allocate_secondary_buffer(CWDEBUG_ONLY(".m_command_buffer" + ambifix)))
+{
+}
+
+void SecondaryCommandBuffers::record(int number_of_jobs, vk::RenderPassBeginInfo const& begin_info, uint32_t subpass,
+    record_function_type record_function COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix))
+{
+  DoutEntering(dc::vkframe, "SecondaryCommandBuffers::record(" << number_of_jobs << ", ...) [" << this << "]");
+  ASSERT(number_of_jobs > 0);
+  // Call poll() until it returns true (and execute()) before recording the next frame.
+  ASSERT(!m_jobs);
+
+  // Create the missing command pools (on this thread; after this m_slots isn't changed until all jobs are finished).
+  while (m_slots.size() < static_cast<size_t>(number_of_jobs))
+    m_slots.push_back(std::make_unique<Slot>(m_logical_device, m_queue_family
+        COMMA_CWDEBUG_ONLY("->m_slots[" + std::to_string(m_slots.size()) + "]" + ambifix)));
+
+  // The caller already waited for the fence of this frame resource, so none of the command buffers is still in use.
+  for (int job_index = 0; job_index < number_of_jobs; ++job_index)
+    m_slots[job_index]->m_command_pool.reset();
+
+  m_recorded.clear();
+  m_jobs = std::make_shared<detail::SecondaryCommandBuffersJobs>(vk::CommandBufferInheritanceInfo{
+      .renderPass = begin_info.renderPass,
+      .subpass = subpass,
+      .framebuffer = begin_info.framebuffer
+    }, std::move(record_function), number_of_jobs);
+
+  // m_job only refers to *m_jobs and m_slots, both of which outlive it.
+  m_jobs->m_job = [this, jobs = m_jobs.get()](int job_index){
+    handle::CommandBuffer command_buffer = m_slots[job_index]->m_command_buffer;
+    command_buffer.begin({
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+      .pInheritanceInfo = &jobs->m_inheritance_info
+    });
+    jobs->m_record_function(job_index, command_buffer);
+    command_buffer.end();
+  };
+
+  // Wake up the helpers, creating the ones that are missing; the render thread does jobs too (from poll).
+  while (m_helpers.size() < static_cast<size_t>(number_of_jobs - 1))
+  {
+    m_helpers.push_back(statefultask::create<task::RecordSecondaryCommandBuffers>());
+    m_helpers.back()->run(Application::instance().high_priority_queue());
+  }
+  for (int helper = 0; helper < number_of_jobs - 1; ++helper)
+    m_helpers[helper]->help(m_jobs);
+}
+
+bool SecondaryCommandBuffers::poll()
+{
+  // Call record first.
+  ASSERT(m_jobs);
+  m_jobs->work_one();
+  if (!m_jobs->finished())
+    return false;
+  if (m_recorded.empty() && !m_jobs->m_exception)
+  {
+    m_recorded.resize(m_jobs->m_number_of_jobs);
+    for (int job_index = 0; job_index < m_jobs->m_number_of_jobs; ++job_index)
+      m_recorded[job_index] = m_slots[job_index]->m_command_buffer;
+  }
+  return true;
+}
+
+void SecondaryCommandBuffers::execute(handle::CommandBuffer primary_command_buffer)
+{
+  // Call poll() until it returns true first.
+  ASSERT(m_jobs && m_jobs->finished());
+  std::exception_ptr exception = std::move(m_jobs->m_exception);
+  m_jobs.reset();
+  if (exception)
+  {
+    m_recorded.clear();
+    std::rethrow_exception(exception);
+  }
+  primary_command_buffer.executeCommands(m_recorded);
+}
+
+} // namespace vulkan
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CommandPool.h"
+#include <boost/intrusive_ptr.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vulkan {
+
+class AmbifixOwner;
+
+namespace task {
+class RecordSecondaryCommandBuffers;
+} // namespace task
+
+namespace detail {
+struct SecondaryCommandBuffersJobs;
+} // namespace detail
+
+// Per frame resource storage for recording a (sub)pass on multiple threads.
+//
+// Each job gets its own transient command pool and secondary command buffer, so
+// jobs can be recorded concurrently without any locking. record() hands the jobs
+// to helper tasks on the high priority thread pool queue and returns immediately;
+// the render thread then calls poll() until it returns true, recording remaining
+// jobs itself in the meantime. The helper tasks are created once and reused for
+// every frame. The resulting command buffers are executed in job order, regardless
+// of which thread recorded them.
+//
+// Usage (from the render loop, after waiting for m_command_buffers_completed):
+//
+//   command_buffer.beginRenderPass(main_pass.begin_info(), vk::SubpassContents::eSecondaryCommandBuffers);
+//   frame_resources->m_secondary_command_buffers.record(number_of_jobs, main_pass.begin_info(), 0,
+//       [&](int job_index, vulkan::handle::CommandBuffer secondary_command_buffer){
+//         // Set the viewport, scissor, pipeline etc. (none of that is inherited) and draw part job_index of the scene.
+//       }
+//       COMMA_CWDEBUG_ONLY(debug_name_prefix("m_secondary_command_buffers")));
+//   while (!frame_resources->m_secondary_command_buffers.poll())
+//     ;
+//   frame_resources->m_secondary_command_buffers.execute(command_buffer);
+//   command_buffer.endRenderPass();
+//
+class SecondaryCommandBuffers
+{
+ public:
+  using record_function_type = std::function<void(int job_index, handle::CommandBuffer command_buffer)>;
+
+  static constexpr vk::CommandPoolCreateFlags::MaskType pool_type = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  using command_pool_type = CommandPool<pool_type>;
+
+ private:
+  struct Slot
+  {
+    command_pool_type m_command_pool;                   // Reset at the start of every call to record.
+    handle::CommandBuffer m_command_buffer;             // Freed when the command pool is destructed.
+
+    Slot(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family
+        COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+  };
+
+  LogicalDevice const* m_logical_device;
+  QueueFamilyPropertiesIndex m_queue_family;
+  std::vector<std::unique_ptr<Slot>> m_slots;           // One command pool and secondary command buffer per job; grows as needed.
+  std::vector<boost::intrusive_ptr<task::RecordSecondaryCommandBuffers>> m_helpers;     // Long lived helper tasks; grows as needed.
+  std::shared_ptr<detail::SecondaryCommandBuffersJobs> m_jobs;                          // The jobs of the last call to record.
+  std::vector<vk::CommandBuffer> m_recorded;            // The command buffers recorded by the last call to record, in job order.
+
+ public:
+  SecondaryCommandBuffers(LogicalDevice const* logical_device, QueueFamilyPropertiesIndex queue_family);
+  ~SecondaryCommandBuffers();
+
+  // Start recording number_of_jobs secondary command buffers, for subpass subpass of the render pass
+  // that is begun with begin_info, by calling record_function(job_index, command_buffer) for
+  // every job_index in the range [0, number_of_jobs); each call possibly on a different thread.
+  //
+  // This function does not block: call poll() until it returns true before calling execute().
+  // record_function is copied, but anything that it refers to must stay valid until then.
+  // The command buffers passed to record_function are already begun and will be ended by this class.
+  void record(int number_of_jobs, vk::RenderPassBeginInfo const& begin_info, uint32_t subpass, record_function_type record_function
+      COMMA_CWDEBUG_ONLY(AmbifixOwner const& ambifix));
+
+  // Record one job that wasn't taken by a helper task yet, if any, on the calling thread.
+  // Returns true once all jobs of the last call to record are recorded. This never blocks,
+  // but it can return false while helper tasks are still recording their last job.
+  bool poll();
+
+  // Execute the command buffers recorded by the last call to record, in job order.
+  // If any call to record_function threw, then the first exception is rethrown instead.
+  void execute(handle::CommandBuffer primary_command_buffer);
+
+  // The number of jobs that were recorded by the last call to record.
+  int number_of_recorded_jobs() const { return m_recorded.size(); }
+};
+
+} // namespace vulkan
@@ -5,6 +5,7 @@
 #include "LogicalDevice.h"
 #include "FrameResourcesData.h"
 #include "SynchronousWindow.h"
+#include "memory/Image.h"
 #include "vk_utils/print_flags.h"
 #include "utils/AIAlert.h"
 #ifdef CWDEBUG
@@ -26,16 +27,17 @@ vk::Extent2D choose_extent(vk::SurfaceCapabilitiesKHR const& surface_capabilitie
   return surface_capabilities.currentExtent;
 }
 
+// In order of preference. The first one is also used for headless windows.
+constexpr std::array<vk::SurfaceFormatKHR, 3> desired_formats = {{
+  { vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear },
+  { vk::Format::eR8G8B8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear },
+  { vk::Format::eA8B8G8R8SrgbPack32, vk::ColorSpaceKHR::eSrgbNonlinear }
+}};
+
 vk::SurfaceFormatKHR choose_surface_format(std::vector<vk::SurfaceFormatKHR> const& available_formats)
 {
   DoutEntering(dc::vulkan, "choose_surface_format(" << available_formats << ")");
 
-  static std::array<vk::SurfaceFormatKHR, 3> desired_formats = {{
-    { vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear },
-    { vk::Format::eR8G8B8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear },
-    { vk::Format::eA8B8G8R8SrgbPack32, vk::ColorSpaceKHR::eSrgbNonlinear }
-  }};
-
   // If the list contains only one entry with undefined format it means that there are no preferred surface formats and any can be chosen.
   if (available_formats.size() == 1 && available_formats[0].format == vk::Format::eUndefined)
     return desired_formats[0];
@@ -125,6 +127,16 @@ vk::SurfaceTransformFlagBitsKHR get_transform(vk::SurfaceCapabilitiesKHR const&
 
 namespace vulkan {
 
+Swapchain::Swapchain()
+{
+  DoutEntering(dc::vulkan, "Swapchain::Swapchain() [" << this << "]");
+}
+
+Swapchain::~Swapchain()
+{
+  DoutEntering(dc::vulkan, "Swapchain::~Swapchain() [" << this << "]");
+}
+
 void Swapchain::prepare(task::SynchronousWindow* owning_window, vk::ImageUsageFlags const selected_usage, vk::PresentModeKHR const selected_present_mode
     COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix))
 {
@@ -195,11 +207,56 @@ void Swapchain::prepare(task::SynchronousWindow* owning_window, vk::ImageUsageFl
   owning_window->no_swapchain({});
 }
 
+void Swapchain::prepare_headless(task::SynchronousWindow* owning_window, vk::ImageUsageFlags const selected_usage, uint32_t image_count
+    COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix))
+{
+  DoutEntering(dc::vulkan, "Swapchain::prepare_headless(" << owning_window << ", " << selected_usage << ", " << image_count << ")");
+
+  m_headless = true;
+
+  // There is no surface to query, so just use our preferred format.
+  vk::SurfaceFormatKHR const desired_image_format = desired_formats[0];
+
+  // Note: set() must be called before set_image_kind() because of flags propagation.
+  m_kind.set({},
+    {
+      .image_color_space = desired_image_format.colorSpace,
+      .pre_transform = vk::SurfaceTransformFlagBitsKHR::eIdentity,
+      .present_mode = vk::PresentModeKHR::eImmediate
+    }
+  ).set_image_kind({}, {
+      .format = desired_image_format.format,
+      .usage = selected_usage,
+      .sharing_mode = vk::SharingMode::eExclusive
+  });
+
+  // Perform the delayed initialization of m_presentation_attachment.
+  m_presentation_attachment.emplace(utils::Badge<Swapchain>{}, owning_window, "swapchain", image_view_kind());
+
+  m_min_image_count = image_count;
+
+  m_acquire_semaphore = owning_window->logical_device()->create_semaphore(
+        CWDEBUG_ONLY(".m_acquire_semaphore" + ambifix));
+
+  // In case of re-use, cant_render_bit might be reset.
+  owning_window->no_swapchain({});
+}
+
 
 bool Swapchain::change_image_count(utils::Badge<task::SynchronousWindow>, task::SynchronousWindow const* owning_window, uint32_t image_count)
 {
   DoutEntering(dc::vulkan, "Swapchain::change_image_count(" << image_count << ")");
 
+  if (m_headless)
+  {
+    // Without acquire semaphores we need one more image than there are frame resources, see SynchronousWindow::prepare_swapchain.
+    image_count = std::max(image_count, static_cast<uint32_t>(owning_window->number_of_frame_resources().get_value() + 1));
+    if (m_min_image_count == image_count)
+      return false;
+    m_min_image_count = image_count;
+    return true;
+  }
+
   vk::PhysicalDevice vh_physical_device = owning_window->logical_device()->vh_physical_device();
   PresentationSurface const& presentation_surface = owning_window->presentation_surface();
   vk::SurfaceCapabilitiesKHR surface_capabilities = vh_physical_device.getSurfaceCapabilitiesKHR(presentation_surface.vh_surface());
@@ -229,8 +286,12 @@ void Swapchain::recreate(task::SynchronousWindow* owning_window, vk::Extent2D wi
     return;
   }
 
-  recreate_swapchain_images(owning_window, window_extent
-      COMMA_CWDEBUG_ONLY(ambifix));
+  if (m_headless)
+    recreate_headless_images(owning_window, window_extent
+        COMMA_CWDEBUG_ONLY(ambifix));
+  else
+    recreate_swapchain_images(owning_window, window_extent
+        COMMA_CWDEBUG_ONLY(ambifix));
 
   owning_window->have_swapchain({});
 }
@@ -261,6 +322,57 @@ void Swapchain::recreate_swapchain_images(task::SynchronousWindow* owning_window
       COMMA_CWDEBUG_ONLY(".m_vhv_images" + ambifix));
   Dout(dc::vulkan, "Actual number of swap chain images: " << m_vhv_images.size());
 
+  create_resources(logical_device
+      COMMA_CWDEBUG_ONLY(ambifix));
+}
+
+void Swapchain::recreate_headless_images(task::SynchronousWindow* owning_window, vk::Extent2D window_extent
+    COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix))
+{
+  DoutEntering(dc::vulkan, "Swapchain::recreate_headless_images(" << owning_window << ", " << window_extent << ")");
+
+  LogicalDevice const* logical_device = owning_window->logical_device();
+
+  // Headless windows never wait for or signal the semaphores of m_resources, so they can be destroyed immediately.
+  m_vhv_images.clear();
+  m_resources.clear();
+  m_headless_images.clear();
+
+  m_extent = window_extent;
+
+  // The images start in the layout that the render graph expects of a swapchain image that was just acquired
+  // (the final layout of the presentation attachment).
+  ResourceState const new_image_resource_state;
+  ResourceState const initial_present_resource_state = {
+    .pipeline_stage_mask        = vk::PipelineStageFlagBits::eBottomOfPipe,
+    .access_mask                = vk::AccessFlagBits::eMemoryRead,
+    .layout                     = vk::ImageLayout::ePresentSrcKHR
+  };
+
+  for (uint32_t image = 0; image < m_min_image_count; ++image)
+  {
+    m_headless_images.emplace_back(logical_device, window_extent, image_view_kind(),
+        memory::Image::MemoryCreateInfo{ .properties = vk::MemoryPropertyFlagBits::eDeviceLocal }
+        COMMA_CWDEBUG_ONLY(".m_headless_images[" + std::to_string(image) + "]" + ambifix));
+    m_vhv_images.push_back(m_headless_images.back().m_vh_image);
+    owning_window->set_image_memory_barrier(
+      new_image_resource_state,
+      initial_present_resource_state,
+      m_vhv_images.back(),
+      s_default_subresource_range);
+  }
+  Dout(dc::vulkan, "Number of headless images: " << m_vhv_images.size());
+
+  create_resources(logical_device
+      COMMA_CWDEBUG_ONLY(ambifix));
+
+  // The first call to SynchronousWindow::acquire_image will advance this to the next image.
+  m_current_index = m_vhv_images.ibegin();
+}
+
+void Swapchain::create_resources(LogicalDevice const* logical_device
+    COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix))
+{
   // Create the corresponding resources: image view and semaphores.
   for (SwapchainIndex i = m_vhv_images.ibegin(); i != m_vhv_images.iend(); ++i)
   {
@@ -8,6 +8,7 @@
 #include <vulkan/vulkan.hpp>
 #include <thread>
 #include <deque>
+#include <vector>
 #include <optional>
 
 namespace vulkan {
@@ -17,6 +18,11 @@ class SynchronousWindow;
 } // namespace task
 
 class RenderPass;
+class LogicalDevice;
+
+namespace memory {
+struct Image;
+} // namespace memory
 
 #ifdef CWDEBUG
 class AmbifixOwner;
@@ -92,24 +98,39 @@ class Swapchain
   SwapchainIndex            m_current_index;            // The index of the current image and resources.
   vk::UniqueSemaphore       m_acquire_semaphore;        // Semaphore used to acquire the next image.
   vk::PresentModeKHR        m_present_mode;
+  bool                      m_headless = false;         // Set by prepare_headless: m_vhv_images are the images of m_headless_images and m_swapchain is null.
+  std::vector<memory::Image> m_headless_images;        // The offscreen images that are rendered to in headless mode.
   // prepare:
   std::optional<rendergraph::Attachment> m_presentation_attachment;     // The presentation attachment ("optional" because it is initialized during prepare).
   // RenderGraph::generate:
   RenderPass*               m_render_pass_output_sink = nullptr;        // The render pass that stores to presentation attachment as a sink.
 
+ private:
+  // Called by recreate_swapchain_images and recreate_headless_images after filling m_vhv_images.
+  void create_resources(LogicalDevice const* logical_device
+      COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
+
  public:
-  Swapchain() { DoutEntering(dc::vulkan, "Swapchain::Swapchain() [" << this << "]"); }
-  ~Swapchain() { DoutEntering(dc::vulkan, "Swapchain::~Swapchain() [" << this << "]"); }
+  // Not inline because memory::Image is incomplete here.
+  Swapchain();
+  ~Swapchain();
 
   void prepare(task::SynchronousWindow* owning_window, vk::ImageUsageFlags const selected_usage, vk::PresentModeKHR const selected_present_mode
     COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
 
+  // Same as prepare, but for a window without presentation surface: recreate will create
+  // a ring of image_count offscreen images that are never presented.
+  void prepare_headless(task::SynchronousWindow* owning_window, vk::ImageUsageFlags const selected_usage, uint32_t image_count
+    COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
+
   // Set and get the rendergraph node that writes to the presentation attachment.
   void set_render_pass_output_sink(RenderPass* sink) { m_render_pass_output_sink = sink; }
   RenderPass* render_pass_output_sink() const { ASSERT(m_render_pass_output_sink); return m_render_pass_output_sink; }
 
   void recreate_swapchain_images(task::SynchronousWindow* owning_window, vk::Extent2D window_extent
       COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
+  void recreate_headless_images(task::SynchronousWindow* owning_window, vk::Extent2D window_extent
+      COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
   void recreate(task::SynchronousWindow* owning_window, vk::Extent2D window_extent
       COMMA_CWDEBUG_ONLY(vulkan::AmbifixOwner const& ambifix));
 
@@ -161,6 +182,21 @@ class Swapchain
     return m_resources[m_current_index].vhp_rendering_finished_semaphore();
   }
 
+  bool is_headless() const
+  {
+    return m_headless;
+  }
+
+  vk::Image vh_current_image() const
+  {
+    return m_vhv_images[m_current_index];
+  }
+
+  SwapchainIndex image_count() const
+  {
+    return m_vhv_images.iend();
+  }
+
 #ifdef CWDEBUG
   images_type const& images() const
   {
@@ -186,6 +222,14 @@ class Swapchain
     return m_current_index;
   }
 
+  // The index of the image that SynchronousWindow::acquire_image uses next in headless mode.
+  SwapchainIndex next_headless_index() const
+  {
+    // Only call this in headless mode.
+    ASSERT(m_headless);
+    return (m_current_index + 1) % m_vhv_images.iend();
+  }
+
   void update_current_index(SwapchainIndex new_swapchain_index)
   {
     m_resources[new_swapchain_index].swap_image_available_semaphore_with(m_acquire_semaphore);
@@ -4,10 +4,11 @@
 #include "LogicalDevice.h"
 #include "Application.h"
 #include "FrameResourcesData.h"
+#include "HeadlessReadback.h"
+#include "FrameTimeBenchmark.h"
 #include "Exceptions.h"
 #include "SynchronousTask.h"
 #include "pipeline/Handle.h"
-#include "pipeline/PipelineCache.h"
 #include "queues/CopyDataToImage.h"
 #include "vk_utils/print_flags.h"
 #include "vk_utils/UniformColorDataFeeder.h"
@@ -194,6 +195,12 @@ void SynchronousWindow::multiplex_impl(state_type run_state)
   switch (run_state)
   {
     case SynchronousWindow_xcb_connection:
+      if (is_headless())
+      {
+        // Headless windows don't need a connection with an X server.
+        set_state(!m_parent_window_task ? SynchronousWindow_create : SynchronousWindow_create_child);
+        break;
+      }
       // Get the- or create a task::XcbConnection object that is associated with m_broker_key (ie DISPLAY).
       m_xcb_connection_task = m_broker->run(*m_broker_key, [this](bool success){ Dout(dc::notice, "xcb_connection finished!"); signal(connection_set_up); });
       // Wait until the connection with the X server is established, then continue with SynchronousWindow_create or SynchronousWindow_create_child.
@@ -207,15 +214,18 @@ void SynchronousWindow::multiplex_impl(state_type run_state)
       wait(parent_window_created);
       break;
     case SynchronousWindow_create:
-      // Allocate the ring buffer for input events.
-      m_input_event_buffer.reallocate_buffer(s_input_event_buffer_size);
+      // Allocate the queue for input events.
+      m_input_event_queue.initialize(s_input_event_queue_capacity);
       // Register ourselves for input events.
-      m_window_events->register_input_event_buffer(&m_input_event_buffer);
-      // Create a new xcb window using the established connection.
-      m_window_events->set_xcb_connection(m_xcb_connection_task->connection());
-      // We can't set a debug name for the surface yet, because there might not be a logical device yet.
-      m_presentation_surface = m_window_events->create(m_application->vh_instance(), m_title, { m_offset, get_extent() },
-          m_parent_window_task ? m_parent_window_task->window_events() : nullptr);
+      m_window_events->register_input_event_queue(&m_input_event_queue);
+      if (!is_headless())
+      {
+        // Create a new xcb window using the established connection.
+        m_window_events->set_xcb_connection(m_xcb_connection_task->connection());
+        // We can't set a debug name for the surface yet, because there might not be a logical device yet.
+        m_presentation_surface = m_window_events->create(m_application->vh_instance(), m_title, { m_offset, get_extent() },
+            m_parent_window_task ? m_parent_window_task->window_events() : nullptr);
+      }
       // Trigger the "window created" event.
       m_window_created_event.trigger();
       // If a logical device was passed then we need to copy its index as soon as that becomes available.
@@ -265,10 +275,11 @@ void SynchronousWindow::multiplex_impl(state_type run_state)
       m_logical_device = get_logical_device();
       // From this moment on we can use the accessor logical_device().
       // Delayed from SynchronousWindow_create; set the debug name of the surface.
-      DebugSetName(m_presentation_surface.vh_surface(), debug_name_prefix("m_presentation_surface.m_surface"));
+      if (!is_headless())
+        DebugSetName(m_presentation_surface.vh_surface(), debug_name_prefix("m_presentation_surface.m_surface"));
       // Next get on with the real work.
       acquire_queues();
-      if (m_logical_device_task)
+      if (m_logical_device_task && !is_headless())
       {
         // We just linked m_logical_device_task and this window by passing it to Application::create_root_window, without ever
         // really verifying that presentation to this window is supported.
@@ -344,19 +355,22 @@ void SynchronousWindow::multiplex_impl(state_type run_state)
           {
             ZoneScopedNC("SynchronousWindow_render_loop / no special circumstances", 0xf5d193) // Tracy
             // Render the next frame.
-            m_frame_rate_limiter.start(m_frame_rate_interval);
+            bool const throttled = !m_headless_settings.unthrottled;    // Unthrottled headless windows render the next frame as soon as possible.
+            if (AI_LIKELY(throttled))
+              m_frame_rate_limiter.start(m_frame_rate_interval);
             m_imgui_timer.update();   // Keep track of FPS and stuff.
             consume_input_events();
             render_frame();
             m_delay_by_completed_draw_frames.step({});
             yield(m_application->m_medium_priority_queue);
-            wait(frame_timer);
+            if (AI_LIKELY(throttled))
+              wait(frame_timer);
             return;
           }
           catch (vulkan::OutOfDateKHR_Exception const& error)
           {
             Dout(dc::warning, "Rendering aborted due to: " << error.what());
-            if (!m_frame_rate_limiter.stop())
+            if (!m_headless_settings.unthrottled && !m_frame_rate_limiter.stop())
             {
               // We could not stop the timer from firing. Perhaps because it already
               // fired, or because it is already calling expire(). Wait until it
@@ -432,6 +446,10 @@ void SynchronousWindow::multiplex_impl(state_type run_state)
       // Turn on debug output again.
       Debug(mSMDebug = mVWDebug);
       wait_for_all_fences();
+      if (m_headless_readback)
+        collect_headless_read_backs();
+      if (m_frame_time_benchmark)
+        finish_frame_time_benchmark();
       finish();
       break;
   }
@@ -464,6 +482,17 @@ void SynchronousWindow::acquire_queues()
 void SynchronousWindow::prepare_swapchain()
 {
   DoutEntering(dc::vulkan, "SynchronousWindow::prepare_swapchain()");
+  if (is_headless())
+  {
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment;
+    if (m_headless_settings.read_back)
+      usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    // Without acquire semaphores, an image may only be rendered to again when the previous frame that
+    // rendered to it is known to be finished: use one more image than there are frame resources.
+    m_swapchain.prepare_headless(this, usage, number_of_frame_resources().get_value() + 1
+        COMMA_CWDEBUG_ONLY(debug_name_prefix("m_swapchain")));
+    return;
+  }
   m_swapchain.prepare(this, vk::ImageUsageFlagBits::eColorAttachment, vk::PresentModeKHR::eFifo
       COMMA_CWDEBUG_ONLY(debug_name_prefix("m_swapchain")));
 }
@@ -472,6 +501,66 @@ void SynchronousWindow::create_swapchain_images()
 {
   m_swapchain.recreate(this, get_extent()
       COMMA_CWDEBUG_ONLY(debug_name_prefix("m_swapchain")));
+  if (m_headless_settings.read_back)
+    create_headless_readback();
+}
+
+void SynchronousWindow::create_headless_readback()
+{
+  DoutEntering(dc::vulkan, "SynchronousWindow::create_headless_readback()");
+  m_headless_readback.reset();
+  // The swapchain is recreated with a zero extent when the window is minimized; that never happens to a headless window.
+  if (m_swapchain.extent().width == 0)
+    return;
+  m_headless_readback = std::make_unique<vulkan::HeadlessReadback>(m_logical_device, m_presentation_surface.graphics_queue().queue_family(), m_swapchain
+      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_headless_readback")));
+}
+
+vulkan::SwapchainIndex SynchronousWindow::acquire_headless_image()
+{
+  vulkan::SwapchainIndex const new_swapchain_index = m_swapchain.next_headless_index();
+  // Wait for the copy from the image that we are about to render to, if any.
+  uint64_t frame_number;
+  uint64_t checksum;
+  if (m_headless_readback && m_headless_readback->collect(new_swapchain_index, frame_number, checksum))
+    on_frame_read_back(frame_number, checksum);
+  return new_swapchain_index;
+}
+
+void SynchronousWindow::finish_headless_frame()
+{
+  ++m_headless_frame_number;
+  // There is nothing to present. The command buffer that rendered the frame was submitted to the graphics queue,
+  // so submitting the copy to the same queue is enough to make it wait for the rendering to finish.
+  if (m_headless_readback)
+    m_headless_readback->copy(m_presentation_surface.vh_graphics_queue(), m_swapchain.current_index(), m_swapchain.vh_current_image(), m_headless_frame_number);
+  if (m_headless_frame_number == m_headless_settings.frame_count)
+    close();
+}
+
+void SynchronousWindow::collect_headless_read_backs()
+{
+  DoutEntering(dc::vulkan, "SynchronousWindow::collect_headless_read_backs()");
+  // Run over the images starting with the oldest one, in order to report the frames in the order they were rendered.
+  vulkan::SwapchainIndex index = m_swapchain.current_index();
+  do
+  {
+    index = (index + 1) % m_swapchain.image_count();
+    uint64_t frame_number;
+    uint64_t checksum;
+    if (m_headless_readback->collect(index, frame_number, checksum))
+      on_frame_read_back(frame_number, checksum);
+  }
+  while (index != m_swapchain.current_index());
+}
+
+void SynchronousWindow::finish_frame_time_benchmark()
+{
+  DoutEntering(dc::vulkan, "SynchronousWindow::finish_frame_time_benchmark()");
+  // All fences were waited for, so all timestamps are available.
+  m_frame_time_benchmark->collect_all();
+  m_frame_time_benchmark->write_results(m_title);
+  m_frame_time_benchmark.reset();
 }
 
 void SynchronousWindow::change_number_of_swapchain_images(uint32_t image_count)
@@ -532,23 +621,24 @@ void SynchronousWindow::consume_input_events()
 {
   DoutEntering(dc::vkframe, "SynchronousWindow::consume_input_events() [" << this << "]");
   // We are the consumer thread.
-  Dout(dc::vkframe|continued_cf, "Calling m_input_event_buffer.pop() = ");
-  while (vulkan::InputEvent const* input_event = m_input_event_buffer.pop())
+  Dout(dc::vkframe|continued_cf, "Calling m_input_event_queue.pop() = ");
+  vulkan::InputEvent input_event;
+  while (m_input_event_queue.pop(input_event))
   {
-    Dout(dc::finish, '{' << *input_event << '}');
-    int16_t x = input_event->mouse_position.x();
-    int16_t y = input_event->mouse_position.y();
-    bool active = static_cast<uint16_t>(input_event->flags.event_type()) & 1;
+    Dout(dc::finish, '{' << input_event << '}');
+    int16_t x = input_event.mouse_position.x();
+    int16_t y = input_event.mouse_position.y();
+    bool active = static_cast<uint16_t>(input_event.flags.event_type()) & 1;
     using vulkan::EventType;
-    switch (input_event->flags.event_type())
+    switch (input_event.flags.event_type())
     {
       case EventType::key_release:
       case EventType::key_press:
         if (m_use_imgui)
         {
           m_imgui.on_mouse_move(x, y);
-          m_imgui.update_modifiers(input_event->modifier_mask.imgui());
-          m_imgui.on_key_event(input_event->keysym, active);
+          m_imgui.update_modifiers(input_event.modifier_mask.imgui());
+          m_imgui.on_key_event(input_event.keysym, active);
           if (m_imgui.want_capture_keyboard())  // Inaccurate; this value corresponds to *previous* frame.
             break;                              // So it is possible that events are lost or duplicated. FIXME
         }
@@ -559,10 +649,10 @@ void SynchronousWindow::consume_input_events()
         if (m_use_imgui)
         {
           m_imgui.on_mouse_move(x, y);
-          if (input_event->button <= 2)
+          if (input_event.button <= 2)
           {
-            m_imgui.update_modifiers(input_event->modifier_mask.imgui());
-            m_imgui.on_mouse_click(input_event->button, active);
+            m_imgui.update_modifiers(input_event.modifier_mask.imgui());
+            m_imgui.on_mouse_click(input_event.button, active);
           }
           if (m_imgui.want_capture_mouse())     // Inaccurate; this value corresponds to the mouse position during the *previous* frame.
             break;                              // So it is possible that events are lost or duplicated. FIXME
@@ -587,27 +677,21 @@ void SynchronousWindow::consume_input_events()
         //FIXME: pass focus/unfocus event to application here.
         break;
     }
-    Dout(dc::vkframe|continued_cf, "Calling m_input_event_buffer.pop() = ");
+    Dout(dc::vkframe|continued_cf, "Calling m_input_event_queue.pop() = ");
   }
-  Dout(dc::finish, "nullptr");
+  Dout(dc::finish, "false");
+  if (uint32_t dropped = m_input_event_queue.consume_dropped())
+    Dout(dc::warning, "Dropped " << dropped << " input event(s) because the input event queue was full!");
   // Consume mouse wheel offset.
   float delta_x, delta_y;
-  {
-    vulkan::WheelOffset::wat wheel_offset_w(m_window_events->m_accumulated_wheel_offset);
-    wheel_offset_w->consume(delta_x, delta_y);
-  }
+  m_input_event_queue.consume_wheel_offset(delta_x, delta_y);
   if (!m_in_focus)
     return;
   if (m_use_imgui)
   {
     // Pass most recent mouse position to imgui (for hovering effects).
-    int x, y;
-    {
-      vulkan::MovedMousePosition::wat moved_mouse_position_w(m_window_events->m_mouse_position);
-      x = moved_mouse_position_w->x();
-      y = moved_mouse_position_w->y();
-    }
-    m_imgui.on_mouse_move(x, y);
+    vulkan::MousePosition const mouse_position = m_input_event_queue.mouse_position();
+    m_imgui.on_mouse_move(mouse_position.x(), mouse_position.y());
     if (delta_x != 0.f || delta_y != 0.f)
       m_imgui.on_mouse_wheel_event(delta_x, delta_y);
     if (m_imgui.want_capture_mouse())
@@ -657,10 +741,15 @@ void SynchronousWindow::handle_window_size_changed()
   on_window_size_changed_pre();
   // We must wait here until all fences are signaled.
   wait_for_all_fences();
+  // Also report the frames that are still being read back; those buffers are about to be destroyed.
+  if (m_headless_readback)
+    collect_headless_read_backs();
   // Now it is safe to recreate the swapchain.
   vk::Extent2D extent = get_extent();
   m_swapchain.recreate(this, extent
       COMMA_CWDEBUG_ONLY(debug_name_prefix("m_swapchain")));
+  if (m_headless_settings.read_back)
+    create_headless_readback();
   uint32_t const layers = m_swapchain.image_kind()->array_layers;
   recreate_framebuffers(extent, layers);
   if (m_use_imgui)
@@ -786,6 +875,9 @@ void SynchronousWindow::start_frame()
   ZoneNamed(start_frame_scoped_zone, true);
   DoutEntering(dc::vkframe, "SynchronousWindow::start_frame()");
 
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->begin_frame();
+
   m_current_frame.m_resource_index = (m_current_frame.m_resource_index + 1) % m_current_frame.m_resource_count;
   m_current_frame.m_frame_resources = m_frame_resources_list[m_current_frame.m_resource_index].get();
 
@@ -794,11 +886,16 @@ void SynchronousWindow::start_frame()
     m_imgui.start_frame(m_imgui_timer.get_delta_ms() * 0.001f);
     draw_imgui();
   }
+
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::start_frame);
 }
 
 void SynchronousWindow::wait_command_buffer_completed()
 {
   CwZoneScopedN("m_command_buffers_completed", number_of_frame_resources(), m_current_frame.m_resource_index);
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::record);
 #if defined(CWDEBUG) && defined(NON_FATAL_LONG_FENCE_DELAY)
   // You might want to use this if a time out happens while debugging (for example stepping through code with a debugger).
   while (m_logical_device->wait_for_fences({ *m_current_frame.m_frame_resources->m_command_buffers_completed }, VK_FALSE, 1000000000) != vk::Result::eSuccess)
@@ -808,27 +905,39 @@ void SynchronousWindow::wait_command_buffer_completed()
   if (m_logical_device->wait_for_fences({ *m_current_frame.m_frame_resources->m_command_buffers_completed }, VK_FALSE, 1000000000) != vk::Result::eSuccess)
     throw std::runtime_error("Waiting for a fence takes too long!");
 #endif
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::wait_command_buffer);
+  // The timestamps of the previous frame that used these frame resources are available now.
+  m_gpu_profiler.begin_frame(m_current_frame.m_resource_index);
 }
 
 void SynchronousWindow::finish_frame()
 {
   DoutEntering(dc::vkframe, "SynchronousWindow::finish_frame(...)");
 
-  // Present frame
-
-  vk::Result result = vk::Result::eSuccess;
-  vk::SwapchainKHR vh_swapchain = *m_swapchain;
-  uint32_t const swapchain_image_index = m_swapchain.current_index().get_value();
-  vk::PresentInfoKHR present_info{
-    .waitSemaphoreCount = 1,
-    .pWaitSemaphores = m_swapchain.vhp_current_rendering_finished_semaphore(),
-    .swapchainCount = 1,
-    .pSwapchains = &vh_swapchain,
-    .pImageIndices = &swapchain_image_index
-  };
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::post_submit);
 
   vk::Result res;
+  if (AI_UNLIKELY(is_headless()))
   {
+    finish_headless_frame();
+    res = vk::Result::eSuccess;
+  }
+  else
+  {
+    // Present frame
+
+    vk::SwapchainKHR vh_swapchain = *m_swapchain;
+    uint32_t const swapchain_image_index = m_swapchain.current_index().get_value();
+    vk::PresentInfoKHR present_info{
+      .waitSemaphoreCount = 1,
+      .pWaitSemaphores = m_swapchain.vhp_current_rendering_finished_semaphore(),
+      .swapchainCount = 1,
+      .pSwapchains = &vh_swapchain,
+      .pImageIndices = &swapchain_image_index
+    };
+
     Dout(dc::vkframe, "Calling presentKHR with .pWaitSemaphores = " << present_info.pWaitSemaphores[0]);
     CwZoneScopedN("presentKHR", number_of_swapchain_images(), m_swapchain.current_index());
     res = m_presentation_surface.vh_presentation_queue().presentKHR(&present_info);
@@ -865,6 +974,10 @@ void SynchronousWindow::finish_frame()
     default:
       THROW_ALERTC(res, "Could not acquire swapchain image!");
   }
+
+  // Close the window once the last frame of the benchmark was measured.
+  if (m_frame_time_benchmark && m_frame_time_benchmark->end_frame())
+    close();
 }
 
 void SynchronousWindow::acquire_image()
@@ -875,30 +988,38 @@ void SynchronousWindow::acquire_image()
 
     // Acquire swapchain image.
     vulkan::SwapchainIndex new_swapchain_index;
-    vk::Result res = m_logical_device->acquire_next_image(
-        *m_swapchain,
-        1000000000,
-        m_swapchain.vh_acquire_semaphore(),
-        vk::Fence(),
-        new_swapchain_index);
-    switch (res)
+    if (AI_UNLIKELY(is_headless()))
+      new_swapchain_index = acquire_headless_image();
+    else
     {
-      case vk::Result::eSuccess:
-        break;
-      case vk::Result::eSuboptimalKHR:
-        Dout(dc::warning, "acquire_next_image() returned eSuboptimalKHR!");
-        break;
-      case vk::Result::eErrorOutOfDateKHR:
-        // Force regeneration of the swapchain.
-        set_extent_changed();
-        throw vulkan::OutOfDateKHR_Exception();
-      default:
-        THROW_ALERTC(res, "Could not acquire swapchain image!");
+      vk::Result res = m_logical_device->acquire_next_image(
+          *m_swapchain,
+          1000000000,
+          m_swapchain.vh_acquire_semaphore(),
+          vk::Fence(),
+          new_swapchain_index);
+      switch (res)
+      {
+        case vk::Result::eSuccess:
+          break;
+        case vk::Result::eSuboptimalKHR:
+          Dout(dc::warning, "acquire_next_image() returned eSuboptimalKHR!");
+          break;
+        case vk::Result::eErrorOutOfDateKHR:
+          // Force regeneration of the swapchain.
+          set_extent_changed();
+          throw vulkan::OutOfDateKHR_Exception();
+        default:
+          THROW_ALERTC(res, "Could not acquire swapchain image!");
+      }
     }
 
     m_swapchain.update_current_index(new_swapchain_index);
   }
 
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::acquire_image);
+
 #ifdef TRACY_ENABLE
   vulkan::SwapchainIndex swapchain_index = m_swapchain.current_index();
   ASSERT(!tracy_acquired_image_busy[swapchain_index]);
@@ -939,8 +1060,7 @@ void SynchronousWindow::finish_impl()
     handle_synchronous_tasks(CWDEBUG_ONLY(mSMDebug));
 
   // Wait for (certain) tasks to be finished, while giving CPU to possibly still running synchronous tasks.
-  // Currently this waits for CopyDataToGPU and PipelineCache tasks; the most common reason for the latter
-  // not finishing is because not all PipelineFactory tasks finished.
+  // Currently this waits for CopyDataToGPU tasks.
   while (!m_task_counter_gate.wait_for(100))
     while (mainloop().is_true())
       ;
@@ -958,6 +1078,12 @@ threadpool::Timer::Interval SynchronousWindow::frame_rate_interval() const
   return threadpool::Interval<10, std::chrono::milliseconds>{};
 }
 
+//virtual
+void SynchronousWindow::on_frame_read_back(uint64_t frame_number, uint64_t checksum)
+{
+  Dout(dc::notice, "Frame " << frame_number << " of \"" << m_title << "\" has checksum 0x" << std::hex << checksum << std::dec << ".");
+}
+
 void SynchronousWindow::on_window_size_changed_pre()
 {
   DoutEntering(dc::vulkan, "SynchronousWindow::on_window_size_changed_pre()");
@@ -1025,16 +1151,6 @@ vulkan::SwapchainIndex SynchronousWindow::number_of_swapchain_images() const
   return s_default_number_of_swapchain_images;
 }
 
-//virtual
-// Override this function to change this value.
-std::u8string SynchronousWindow::pipeline_cache_name() const
-{
-  // set_title must already be called here (and may not be empty).
-  ASSERT(!m_title.empty());
-  // The default filename is the title of the window.
-  return m_title;
-}
-
 //virtual
 // Override this function to change these values.
 void SynchronousWindow::set_default_clear_values(vulkan::rendergraph::ClearValue& color, vulkan::rendergraph::ClearValue& depth_stencil)
@@ -1084,7 +1200,7 @@ void SynchronousWindow::create_frame_resources()
   }
 
   if (m_use_imgui)
-    m_imgui.create_frame_resources(number_of_frame_resources
+    m_imgui.create_frame_resources(m_logical_device, number_of_frame_resources
         COMMA_CWDEBUG_ONLY(debug_name_prefix("m_imgui")));
 
   // Initialize m_current_frame to point to frame resources index 0.
@@ -1094,6 +1210,15 @@ void SynchronousWindow::create_frame_resources()
     .m_resource_index = static_cast<vulkan::FrameResourceIndex>(0)
   };
 
+  m_gpu_profiler.initialize(m_logical_device, m_presentation_surface.graphics_queue().queue_family(), number_of_frame_resources
+      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_gpu_profiler")));
+
+  // Only benchmark the root window: child windows (if any) have the same settings and would write to the same output file.
+  if (m_benchmark_settings.enabled() && !m_parent_window_task)
+    m_frame_time_benchmark = std::make_unique<vulkan::FrameTimeBenchmark>(m_benchmark_settings, m_logical_device,
+        m_presentation_surface.graphics_queue().queue_family(), number_of_frame_resources
+        COMMA_CWDEBUG_ONLY(debug_name_prefix("m_frame_time_benchmark")));
+
   // Initialize all attachments (images, image views, memory).
   on_window_size_changed_post();
 }
@@ -1111,19 +1236,32 @@ void SynchronousWindow::submit(vulkan::handle::CommandBuffer command_buffer)
   CwZoneNamedN(__submit2, "submit", true, number_of_swapchain_images(), m_swapchain.current_index());
 #endif
 
+  // When benchmarking, command_buffer is surrounded by command buffers that write timestamps.
+  uint32_t command_buffer_count = 1;
+  vk::CommandBuffer const* command_buffers = &command_buffer;
+  if (m_frame_time_benchmark)
+  {
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::record);
+    command_buffers = m_frame_time_benchmark->wrap_command_buffer(m_current_frame.m_resource_index, command_buffer, command_buffer_count);
+  }
+
+  // In headless mode nobody signals the image available semaphore or waits for the rendering finished semaphore.
+  uint32_t const semaphore_count = is_headless() ? 0 : 1;
   vk::PipelineStageFlags wait_dst_stage_mask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
   vk::SubmitInfo submit_info{
-    .waitSemaphoreCount = 1,
+    .waitSemaphoreCount = semaphore_count,
     .pWaitSemaphores = swapchain().vhp_current_image_available_semaphore(),
     .pWaitDstStageMask = &wait_dst_stage_mask,
-    .commandBufferCount = 1,
-    .pCommandBuffers = &command_buffer,
-    .signalSemaphoreCount = 1,
+    .commandBufferCount = command_buffer_count,
+    .pCommandBuffers = command_buffers,
+    .signalSemaphoreCount = semaphore_count,
     .pSignalSemaphores = swapchain().vhp_current_rendering_finished_semaphore()
   };
 
   Dout(dc::vkframe, "Submitting command buffer: submit({" << submit_info << "}, " << *m_current_frame.m_frame_resources->m_command_buffers_completed << ")");
   presentation_surface().vh_graphics_queue().submit({ submit_info }, *m_current_frame.m_frame_resources->m_command_buffers_completed);
+  if (m_frame_time_benchmark)
+    m_frame_time_benchmark->end_phase(vulkan::FrameTimeBenchmark::submit);
 
 #ifdef TRACY_ENABLE
   std::string message("Submitted CB ");
@@ -1138,43 +1276,6 @@ void SynchronousWindow::copy_graphics_settings()
   m_application->copy_graphics_settings_to(&m_graphics_settings, m_logical_device);
 }
 
-#if 0
-void SynchronousWindow::load_pipeline_cache()
-{
-  DoutEntering(dc::vulkan, "SynchronousWindow::load_pipeline_cache()");
-  // If this is a root window - then we might be the first to have access to the logical device.
-  // Try to register it with the pipeline cache.
-  if (!m_parent_window_task)
-  {
-    vulkan::PipelineCache* pipeline_cache = m_application->pipeline_cache_broker(m_logical_device);
-    if (pipeline_cache)
-    {
-      // The first thread that locks Application::m_pipeline_cache_list for a given m_logical_device
-      // will have pipeline_cache != nullptr here. It might not be the first thread to return
-      // from pipeline_cache_broker - but other threads will wait in the while loop below until this
-      // thread stored the pipeline_cache pointer.
-      //
-      // Any thread that reaches that while loop, while this thread didn't finish writing to the
-      // LogicalDevice::m_pipeline_cache atomic yet, must belong to a different root window with its
-      // own SynchronousWindow task. But waiting until m_logical_device->pipeline_cache() returns
-      // a non-null value is enough to assure that that task will see the correct pointer in
-      // subsequent runs because this function is called in the critical area of that task.
-      //
-      // For all the gory details,
-      // see https://stackoverflow.com/questions/71340714/lock-free-write-once-read-often-value-in-conjunction-with-thread-pools
-      m_logical_device->store_pipeline_cache(pipeline_cache);
-    }
-    else
-    {
-      // Wait until the thread that called pipeline_cache_broker with success finished storing
-      // the returned pointer.
-      while (m_logical_device->pipeline_cache() == nullptr)
-        cpu_relax();
-    }
-  }
-}
-#endif
-
 void SynchronousWindow::add_synchronous_task(std::function<void(SynchronousWindow*)> lambda)
 {
   DoutEntering(dc::vulkan, "SynchronousWindow::add_synchronous_task(...)");
@@ -1212,9 +1313,17 @@ vk::Pipeline SynchronousWindow::vh_graphics_pipeline(vulkan::pipeline::Handle pi
 void SynchronousWindow::pipeline_factory_done(utils::Badge<synchronous::MoveNewPipelines>, PipelineFactoryIndex index)
 {
   DoutEntering(dc::notice, "SynchronousWindow::pipeline_factory_done(" << index << ")");
-  boost::intrusive_ptr<PipelineCache> pipeline_cache(m_pipeline_factories[index]->detach_pipeline_cache_task());
   m_pipeline_factories[index].reset();          // Delete the pipeline factory task.
-  m_application->pipeline_factory_done(this, std::move(pipeline_cache));
+
+  // When baking pipelines, close the window once the last factory is done.
+  if (m_headless_settings.bake_pipelines &&
+      std::all_of(m_pipeline_factories.begin(), m_pipeline_factories.end(), [](auto const& factory){ return !factory; }))
+  {
+    vulkan::pipeline::PipelineCache& pipeline_cache = m_logical_device->pipeline_cache();
+    pipeline_cache.save();
+    Dout(dc::notice, "Baked all pipelines of window \"" << m_title << "\"; pipeline cache: " << pipeline_cache);
+    close();
+  }
 }
 
 #ifdef CWDEBUG
@@ -12,8 +12,11 @@
 #include "ImageKind.h"
 #include "SamplerKind.h"
 #include "RenderPass.h"
-#include "InputEvent.h"
+#include "InputEventQueue.h"
 #include "GraphicsSettings.h"
+#include "HeadlessSettings.h"
+#include "BenchmarkSettings.h"
+#include "GpuProfiler.h"
 #include "Pipeline.h"
 #include "ImGui.h"
 #include "descriptor/ArrayElementRange.h"
@@ -67,6 +70,8 @@ class Ambifix;
 class AmbifixOwner;
 class Swapchain;
 class WindowEvents;
+class HeadlessReadback;
+class FrameTimeBenchmark;
 
 namespace shader_builder {
 namespace shader_resource { }
@@ -147,6 +152,10 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   // set_logical_device_task
   LogicalDevice const* m_logical_device_task = nullptr;                 // Cache valued of the task::LogicalDevice const* that was passed to
                                                                         // Application::create_window, if any. That can be nullptr so don't use it.
+  // set_headless_settings
+  HeadlessSettings m_headless_settings;                                 // If m_headless_settings.enabled then this window has no xcb window and no surface.
+  // set_benchmark_settings
+  BenchmarkSettings m_benchmark_settings;                               // If m_benchmark_settings.enabled() then the frame times of this window are measured.
 
   // This must come *before* m_window_events in order to get the corect order of destruction (destroy window events first).
   boost::intrusive_ptr<SynchronousWindow const> m_parent_window_task;   // A pointer to the parent window, or nullptr when this is a root window.
@@ -166,6 +175,10 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   PresentationSurface m_presentation_surface;                           // The presentation surface information (surface-, graphics- and presentation queue handles).
   Swapchain m_swapchain;                                                // The swap chain used for this surface.
 
+  std::unique_ptr<HeadlessReadback> m_headless_readback;               // Only used when m_headless_settings.read_back is set.
+  uint64_t m_headless_frame_number = 0;                                 // The number of frames rendered so far, in headless mode.
+  std::unique_ptr<FrameTimeBenchmark> m_frame_time_benchmark;           // Only used when m_benchmark_settings.enabled(), by root windows.
+
   threadpool::Timer::Interval m_frame_rate_interval;                    // The minimum time between two frames.
   threadpool::Timer m_frame_rate_limiter;
 
@@ -174,9 +187,10 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   bool m_use_imgui = false;
 
  private:
-  static constexpr int s_input_event_buffer_size = 32;                  // If the application is lagging more than 32 events behind then
+  static constexpr uint32_t s_input_event_queue_capacity = 32;          // If the application is lagging more than 32 events behind then
                                                                         // the user is having other problems then losing key strokes.
-  InputEventBuffer m_input_event_buffer;                                // Thread-safe ringbuffer to transfer input events from EventThread to this task.
+                                                                        // Mouse motion and wheel events are coalesced and don't count.
+  InputEventQueue m_input_event_queue;                                  // Lock-free queue to transfer input events from EventThread to this task.
   bool m_in_focus;                                                      // Cache value of decoded input events.
 #ifdef TRACY_ENABLE
  protected:
@@ -255,6 +269,9 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   vk_utils::TimerData m_imgui_timer;
   ImGui m_imgui;                // ImGui framework.
 
+  // Initialized by create_frame_resources.
+  GpuProfiler m_gpu_profiler;   // Timestamp query based GPU profiler (disabled by default).
+
  protected:
   /// The base class of this task.
   using direct_base_type = AIStatefulTask;
@@ -291,6 +308,8 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   void set_offset(vk::Offset2D offset) { m_offset = offset; }
   void set_request_cookie(request_cookie_type request_cookie) { m_request_cookie = request_cookie; }
   void set_logical_device_task(LogicalDevice const* logical_device_task) { m_logical_device_task = logical_device_task; }
+  void set_headless_settings(HeadlessSettings const& headless_settings) { m_headless_settings = headless_settings; }
+  void set_benchmark_settings(BenchmarkSettings const& benchmark_settings) { m_benchmark_settings = benchmark_settings; }
   void set_xcb_connection_broker_and_key(boost::intrusive_ptr<xcb_connection_broker_type> broker, xcb::ConnectionBrokerKey const* broker_key)
     // The broker_key object must have a life-time longer than the time it takes to finish task::XcbConnection.
     { m_broker = std::move(broker); m_broker_key = broker_key; }
@@ -371,6 +390,11 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
      return m_title;
   }
 
+  bool is_headless() const
+  {
+    return m_headless_settings.enabled;
+  }
+
   vk::SurfaceKHR vh_surface() const
   {
     return m_presentation_surface.vh_surface();
@@ -412,6 +436,9 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
 
   Swapchain& swapchain() { return m_swapchain; }
   Swapchain const& swapchain() const { return m_swapchain; }
+
+  GpuProfiler& gpu_profiler() { return m_gpu_profiler; }
+  GpuProfiler const& gpu_profiler() const { return m_gpu_profiler; }
   void no_swapchain(utils::Badge<Swapchain>) const { SynchronousEngine::no_swapchain(); }
   void have_swapchain(utils::Badge<Swapchain>) const { SynchronousEngine::have_swapchain(); }
 
@@ -437,9 +464,10 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   void detect_if_imgui_is_used();
 
   void update_descriptor_set_with_loading_texture(
-      descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements) const
+      descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements,
+      descriptor::DescriptorWriteBatch& batch) const
   {
-    m_loading_texture.update_descriptor_array(this, descriptor_set, binding, array_elements);
+    m_loading_texture.update_descriptor_array(this, descriptor_set, binding, array_elements, batch);
   }
 
  public:
@@ -492,8 +520,18 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
 
   // Called by create_imageless_framebuffers and handle_window_size_changed.
   void recreate_framebuffers(vk::Extent2D extent, uint32_t layers);
+  // Called by create_swapchain_images and handle_window_size_changed, in headless mode.
+  void create_headless_readback();
+  // Called by acquire_image in headless mode.
+  SwapchainIndex acquire_headless_image();
+  // Called by finish_frame in headless mode.
+  void finish_headless_frame();
+  // Report all pending read backs (by calling on_frame_read_back). Called before closing the window or destroying m_headless_readback.
+  void collect_headless_read_backs();
   // Called by create_imageless_framebuffers.
   void prepare_begin_info_chains();
+  // Called when closing the window, if m_frame_time_benchmark exists.
+  void finish_frame_time_benchmark();
 
   // Optionally overridden by derived class.
 
@@ -503,6 +541,9 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   virtual void on_window_size_changed_pre();
   // Called by create_frame_resources() and handle_window_size_changed():
   virtual void on_window_size_changed_post();
+  // Called in headless mode with --headless-read-back, once for every rendered frame (in order),
+  // with a checksum of the pixels of the image that it was rendered to.
+  virtual void on_frame_read_back(uint64_t frame_number, uint64_t checksum);
 
  public:
   // Called by create_frame_resources() (and PresentationSurface::set_queues when TRACY_ENABLE).
@@ -511,10 +552,6 @@ class SynchronousWindow : public AIStatefulTask, protected SynchronousEngine
   // Called by ... when TRACY_ENABLE.
   virtual SwapchainIndex number_of_swapchain_images() const;
 
-  // Override this function to give a Window its own (or shared) pipeline cache ID.
-  // Windows with the same pipeline_cache_name will share the same cache file.
-  virtual std::u8string pipeline_cache_name() const;
-
  protected:
   void start_frame();
   void wait_command_buffer_completed();
@@ -2,39 +2,87 @@
 #include "Texture.h"
 #include "SynchronousWindow.h"
 #include "queues/CopyDataToImage.h"
+#include "descriptor/DescriptorWriteBatch.h"
+#include "vk_utils/MipmapDataFeeder.h"
+#include "vk_utils/format.h"
 
 namespace vulkan {
 
 //static
 ImageViewKind const Texture::s_default_image_view_kind{default_image_kind, {}};
 
-void Texture::upload(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
+boost::intrusive_ptr<task::CopyDataToImage> Texture::create_upload_task(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
     task::SynchronousWindow const* resource_owner,      // The window that determines the life-time of this texture.
-    std::unique_ptr<vulkan::DataFeeder> texture_data_feeder,
-    AIStatefulTask* parent, AIStatefulTask::condition_type texture_ready)
+    std::unique_ptr<vulkan::DataFeeder> texture_data_feeder)
 {
-  DoutEntering(dc::vulkan, "Texture::upload(" << extent << ", " << image_view_kind << ", " << resource_owner << ", " << texture_data_feeder << ", " << parent << ", " << texture_ready << ")");
-
   // Use the same image_view_kind that was used to create the Texture.
   ASSERT(image_view_kind == *debug_image_view_kind);
 
-  size_t const data_size = extent.width * extent.height * vk_utils::format_component_count(image_view_kind.image_kind()->format);
+  ImageKind const& image_kind = image_view_kind.image_kind();
+  vk::Format const format = image_kind->format;
+  uint32_t const level_count = image_kind->mip_levels;
+
+  // The data feeder either provides all mip levels, or only the first one.
+  size_t const data_size = vk_utils::image_data_size(format, extent, level_count);
+  size_t const level0_size = vk_utils::mip_level_size(format, extent, 0);
+  size_t const feeder_size = static_cast<size_t>(texture_data_feeder->chunk_size()) * texture_data_feeder->chunk_count();
+  // If the feeder only provides the first mip level, then generate the others; on the GPU if possible.
+  bool const generate_mipmaps = level_count > 1 && feeder_size == level0_size;
+  bool const generate_mipmaps_on_gpu = generate_mipmaps && (image_kind->usage & vk::ImageUsageFlagBits::eTransferSrc) &&
+    m_logical_device->supports_blit_mipmap_generation(format);
+  if (generate_mipmaps && !generate_mipmaps_on_gpu)
+    texture_data_feeder = std::make_unique<vk_utils::MipmapDataFeeder>(std::move(texture_data_feeder), format, extent, level_count);
+  // Otherwise the feeder must provide exactly all mip levels.
+  ASSERT(generate_mipmaps || feeder_size == data_size);
 
-  auto copy_data_to_image = statefultask::create<task::CopyDataToImage>(m_logical_device, data_size,
-            m_vh_image, extent, vk_defaults::ImageSubresourceRange{},
+  auto copy_data_to_image = statefultask::create<task::CopyDataToImage>(m_logical_device, generate_mipmaps_on_gpu ? level0_size : data_size,
+            m_vh_image, extent, format, vk_defaults::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, level_count},
             vk::ImageLayout::eUndefined, vk::AccessFlags(0), vk::PipelineStageFlagBits::eTopOfPipe,
             vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eShaderRead, vk::PipelineStageFlagBits::eFragmentShader
             COMMA_CWDEBUG_ONLY(Application::instance().debug_CopyDataToImage()));
 
+  if (generate_mipmaps_on_gpu)
+    copy_data_to_image->set_generate_mipmaps();
   copy_data_to_image->set_resource_owner(resource_owner);       // Wait for this task to finish before destroying the owning window, because the window owns this texture.
   copy_data_to_image->set_data_feeder(std::move(texture_data_feeder));
+  return copy_data_to_image;
+}
+
+void Texture::upload(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
+    task::SynchronousWindow const* resource_owner,
+    std::unique_ptr<vulkan::DataFeeder> texture_data_feeder,
+    AIStatefulTask* parent, AIStatefulTask::condition_type texture_ready)
+{
+  DoutEntering(dc::vulkan, "Texture::upload(" << extent << ", " << image_view_kind << ", " << resource_owner << ", " << texture_data_feeder << ", " << parent << ", " << texture_ready << ")");
+
+  auto copy_data_to_image = create_upload_task(extent, image_view_kind, resource_owner, std::move(texture_data_feeder));
   copy_data_to_image->run(vulkan::Application::instance().low_priority_queue(), parent, texture_ready, AIStatefulTask::signal_parent);
 }
 
+void Texture::upload(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
+    task::SynchronousWindow const* resource_owner,
+    std::unique_ptr<vulkan::DataFeeder> texture_data_feeder,
+    std::function<void(bool success)> texture_ready)
+{
+  DoutEntering(dc::vulkan, "Texture::upload(" << extent << ", " << image_view_kind << ", " << resource_owner << ", " << texture_data_feeder << ", texture_ready)");
+
+  auto copy_data_to_image = create_upload_task(extent, image_view_kind, resource_owner, std::move(texture_data_feeder));
+  copy_data_to_image->run(vulkan::Application::instance().low_priority_queue(), std::move(texture_ready));
+}
+
 void Texture::update_descriptor_array(task::SynchronousWindow const* owning_window, descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements) const
 {
   DoutEntering(dc::shaderresource, "Texture::update_descriptor_array(" << owning_window << ", " << descriptor_set << ", " << binding << ", " << array_elements << ")");
   // Update vh_descriptor_set binding `binding` with this texture.
+  descriptor::DescriptorWriteBatch batch;
+  update_descriptor_array(owning_window, descriptor_set, binding, array_elements, batch);
+  batch.flush(owning_window->logical_device());
+}
+
+void Texture::update_descriptor_array(task::SynchronousWindow const* owning_window, descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements,
+    descriptor::DescriptorWriteBatch& batch) const
+{
+  DoutEntering(dc::shaderresource, "Texture::update_descriptor_array(" << owning_window << ", " << descriptor_set << ", " << binding << ", " << array_elements << ", batch)");
   std::vector<vk::DescriptorImageInfo> image_infos(
     array_elements.size(),
     {
@@ -43,7 +91,22 @@ void Texture::update_descriptor_array(task::SynchronousWindow const* owning_wind
       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
     }
   );
-  owning_window->logical_device()->update_descriptor_sets(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_elements.ibegin(), image_infos, array_elements.size(), owning_window->number_of_frame_resources());
+  batch.add(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_elements.ibegin(), image_infos, array_elements.size(), owning_window->number_of_frame_resources());
+}
+
+descriptor::BindlessTextureTable::index_type Texture::register_bindless()
+{
+  if (m_bindless_index == descriptor::BindlessTextureTable::s_invalid_index)
+    m_bindless_index = logical_device()->bindless_texture_table().register_texture(*this);
+  return m_bindless_index;
+}
+
+void Texture::release_bindless()
+{
+  if (m_bindless_index == descriptor::BindlessTextureTable::s_invalid_index)
+    return;
+  m_logical_device->bindless_texture_table().release(m_bindless_index);
+  m_bindless_index = descriptor::BindlessTextureTable::s_invalid_index;
 }
 
 #ifdef CWDEBUG
@@ -52,7 +115,8 @@ void Texture::print_on(std::ostream& os) const
   os << '{';
   memory::Image::print_on(os);
   os << "m_image_view:" << m_image_view <<
-      ", m_sampler:" << m_sampler;
+      ", m_sampler:" << m_sampler <<
+      ", m_bindless_index:" << m_bindless_index;
   os << '}';
 }
 #endif
@@ -4,9 +4,21 @@
 #include "memory/DataFeeder.h"
 #include "descriptor/SetKeyContext.h"
 #include "descriptor/ArrayElementRange.h"
+#include "descriptor/BindlessTextureTable.h"
+#include <boost/intrusive_ptr.hpp>
+#include <functional>
+#include <utility>
 
 namespace vulkan {
 
+namespace task {
+class CopyDataToImage;
+} // namespace task
+
+namespace descriptor {
+class DescriptorWriteBatch;
+} // namespace descriptor
+
 class Texture : public memory::Image
 {
  public:
@@ -20,6 +32,7 @@ class Texture : public memory::Image
  private:
   vk::UniqueImageView   m_image_view;
   vk::UniqueSampler     m_sampler;
+  descriptor::BindlessTextureTable::index_type m_bindless_index{descriptor::BindlessTextureTable::s_invalid_index};     // Set by register_bindless.
 #if CW_DEBUG
   vulkan::ImageViewKind const* debug_image_view_kind;
 #endif
@@ -27,7 +40,11 @@ class Texture : public memory::Image
  public:
   // Used to move-assign later.
   Texture() { }
-  ~Texture() { DoutEntering(dc::vulkan, "Texture::~Texture() [" << this << "]"); }
+  ~Texture()
+  {
+    DoutEntering(dc::vulkan, "Texture::~Texture() [" << this << "]");
+    release_bindless();
+  }
 
   // Use sampler as-is.
   Texture(
@@ -126,12 +143,16 @@ class Texture : public memory::Image
   // Class is move-only.
   // Note: do NOT move the Ambifix!
   // That is only initialized in-place with the constructor that takes just the Ambifix.
-  Texture(Texture&& rhs) : Image(std::move(rhs)), m_image_view(std::move(rhs.m_image_view)), m_sampler(std::move(rhs.m_sampler)), debug_image_view_kind(rhs.debug_image_view_kind) { }
+  Texture(Texture&& rhs) : Image(std::move(rhs)), m_image_view(std::move(rhs.m_image_view)), m_sampler(std::move(rhs.m_sampler)),
+    m_bindless_index(std::exchange(rhs.m_bindless_index, descriptor::BindlessTextureTable::s_invalid_index)), debug_image_view_kind(rhs.debug_image_view_kind) { }
   Texture& operator=(Texture&& rhs)
   {
+    // Release the index while m_logical_device is still valid.
+    release_bindless();
     this->memory::Image::operator=(std::move(rhs));
     m_image_view = std::move(rhs.m_image_view);
     m_sampler = std::move(rhs.m_sampler);
+    m_bindless_index = std::exchange(rhs.m_bindless_index, descriptor::BindlessTextureTable::s_invalid_index);
 #if CW_DEBUG
     debug_image_view_kind = rhs.debug_image_view_kind;
 #endif
@@ -139,7 +160,21 @@ class Texture : public memory::Image
   }
 
   void update_descriptor_array(task::SynchronousWindow const* owning_window, descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements) const;
+  // Same, but add the writes to batch instead of writing them immediately.
+  void update_descriptor_array(task::SynchronousWindow const* owning_window, descriptor::FrameResourceCapableDescriptorSet const& descriptor_set, uint32_t binding, descriptor::ArrayElementRange array_elements,
+      descriptor::DescriptorWriteBatch& batch) const;
+
+ private:
+  boost::intrusive_ptr<task::CopyDataToImage> create_upload_task(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
+      task::SynchronousWindow const* resource_owner, std::unique_ptr<DataFeeder> texture_data_feeder);
 
+ public:
+  // Upload the data of texture_data_feeder to this texture.
+  //
+  // The data feeder must provide either all mip levels of the image (see vk_utils::image_data_size),
+  // or only the first one. In the latter case the other mip levels are generated: with vkCmdBlitImage
+  // if the image has usage eTransferSrc and the format and transfer queue support it, or on the CPU
+  // (see vk_utils::MipmapDataFeeder) otherwise.
   void upload(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
       task::SynchronousWindow const* resource_owner,
       std::unique_ptr<DataFeeder> texture_data_feeder,
@@ -154,8 +189,34 @@ class Texture : public memory::Image
     upload(extent, s_default_image_view_kind, resource_owner, std::move(texture_data_feeder), parent, texture_ready);
   }
 
+  // Same, but call texture_ready from the thread pool when the upload finished (for example, to start using the texture
+  // in place of the "loading texture" from a task that is not running when the upload finishes).
+  void upload(vk::Extent2D extent, vulkan::ImageViewKind const& image_view_kind,
+      task::SynchronousWindow const* resource_owner,
+      std::unique_ptr<DataFeeder> texture_data_feeder,
+      std::function<void(bool success)> texture_ready);
+
+  // Same, but use s_default_image_view_kind.
+  void upload(vk::Extent2D extent,
+      task::SynchronousWindow const* resource_owner,
+      std::unique_ptr<DataFeeder> texture_data_feeder,
+      std::function<void(bool success)> texture_ready)
+  {
+    upload(extent, s_default_image_view_kind, resource_owner, std::move(texture_data_feeder), std::move(texture_ready));
+  }
+
+  // Register this texture with the bindless texture table of its logical device (see descriptor::BindlessTextureTable)
+  // and return the index that shaders use to access it. Calling this again returns the same index. The index is released
+  // when the texture is destroyed (or its GPU resources are released), so the GPU must not be using it anymore by then.
+  // Only call this when LogicalDevice::supports_bindless_textures() returns true.
+  descriptor::BindlessTextureTable::index_type register_bindless();
+
+  // Put the index returned by register_bindless, if any, back on the free-list of the bindless texture table.
+  void release_bindless();
+
   void release_GPU_resources()
   {
+    release_bindless();
     m_sampler.reset();
     m_image_view.reset();
     destroy();
@@ -169,6 +230,8 @@ class Texture : public memory::Image
   }
   vk::ImageView image_view() const { return *m_image_view; }
   vk::Sampler sampler() const { return *m_sampler; }
+  // Returns descriptor::BindlessTextureTable::s_invalid_index if register_bindless wasn't called.
+  descriptor::BindlessTextureTable::index_type bindless_index() const { return m_bindless_index; }
 
 #ifdef CWDEBUG
   void print_on(std::ostream& os) const;
@@ -0,0 +1,302 @@
+#include "sys.h"
+#include "TextureDecodePool.h"
+#include "AsyncTask.h"
+#include "vk_utils/ImageData.h"
+#include "vk_utils/PNGImageDataFeeder.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <iostream>
+#include "debug.h"
+
+namespace vulkan {
+
+namespace {
+
+// Return a DataFeeder for the image at path and store its extent in extent_out.
+// Sets pixels_decoded_out to false if only the header was read (the pixels are decoded by the returned feeder).
+std::unique_ptr<DataFeeder> create_image_data_feeder(std::filesystem::path const& path, int requested_components, vk::Extent2D& extent_out, bool& pixels_decoded_out)
+{
+  if (path.extension() == ".png")
+  {
+    auto png_data_feeder = std::make_unique<vk_utils::libpng::ImageDataFeeder>(path, requested_components);
+    extent_out = png_data_feeder->extent();
+    pixels_decoded_out = false;
+    return png_data_feeder;
+  }
+  vk_utils::stbi::ImageData image_data(path, requested_components);
+  extent_out = image_data.extent();
+  pixels_decoded_out = true;
+  return std::make_unique<vk_utils::stbi::ImageDataFeeder>(std::move(image_data));
+}
+
+} // namespace
+
+namespace task {
+
+// A task that decodes the requests of a TextureDecodePool, most important first, until there are none left.
+class TextureDecoder final : public AsyncTask
+{
+ private:
+  TextureDecodePool* m_pool;
+
+ protected:
+  using direct_base_type = AsyncTask;
+
+  enum TextureDecoder_state_type {
+    TextureDecoder_decode = direct_base_type::state_end
+  };
+
+ public:
+  static constexpr state_type state_end = TextureDecoder_decode + 1;
+
+  TextureDecoder(TextureDecodePool* pool) : AsyncTask(CWDEBUG_ONLY(false)), m_pool(pool) { }
+
+ protected:
+  char const* state_str_impl(state_type run_state) const override
+  {
+    switch (run_state)
+    {
+      AI_CASE_RETURN(TextureDecoder_decode);
+    }
+    AI_NEVER_REACHED
+  }
+
+  char const* task_name_impl() const override
+  {
+    return "TextureDecoder";
+  }
+
+  void initialize_impl() override
+  {
+    set_state(TextureDecoder_decode);
+  }
+
+  void multiplex_impl(state_type run_state) override
+  {
+    switch (run_state)
+    {
+      case TextureDecoder_decode:
+      {
+        TextureDecodePool::request_handle_type request = m_pool->next_request();
+        if (!request)
+        {
+          finish();
+          break;
+        }
+        vk::Extent2D extent{};
+        std::unique_ptr<DataFeeder> texture_data_feeder;
+        bool pixels_decoded = false;
+        try
+        {
+          texture_data_feeder = create_image_data_feeder(request->m_path, request->m_requested_components, extent, pixels_decoded);
+        }
+        catch (AIAlert::Error const& error)
+        {
+          Dout(dc::warning, "Failed to decode " << request->m_path << ": " << error);
+          extent = vk::Extent2D{};
+        }
+        TextureDecodePool::clock_type::time_point const decode_finished = TextureDecodePool::clock_type::now();
+        bool const succeeded = texture_data_feeder != nullptr;
+        // Only count the bytes that were actually decoded here.
+        size_t const bytes = succeeded && pixels_decoded ? static_cast<size_t>(texture_data_feeder->chunk_size()) * texture_data_feeder->chunk_count() : 0;
+        TextureDecodePool::s_in_callback = true;
+        try
+        {
+          request->m_callback(extent, std::move(texture_data_feeder));
+        }
+        catch (...)
+        {
+          TextureDecodePool::s_in_callback = false;
+          m_pool->decoded(request, decode_finished, succeeded, bytes);
+          throw;
+        }
+        TextureDecodePool::s_in_callback = false;
+        m_pool->decoded(request, decode_finished, succeeded, bytes);
+        // Give tasks in other queues a chance to run before decoding the next image.
+        yield();
+        break;
+      }
+    }
+  }
+};
+
+} // namespace task
+
+//static
+thread_local bool TextureDecodePool::s_in_callback = false;
+
+void TextureDecodePool::initialize(AIQueueHandle queue, int max_decoders)
+{
+  DoutEntering(dc::vulkan, "TextureDecodePool::initialize(" << queue << ", " << max_decoders << ")");
+  m_queue = queue;
+  m_max_decoders = max_decoders;
+}
+
+TextureDecodePool::request_handle_type TextureDecodePool::decode(std::filesystem::path const& path, int requested_components, float importance, callback_type callback)
+{
+  DoutEntering(dc::vulkan, "TextureDecodePool::decode(" << path << ", " << requested_components << ", " << importance << ", callback)");
+
+  auto request = std::make_shared<Request>(path, requested_components, importance, std::move(callback));
+  bool start_decoder = false;
+  {
+    pool_t::wat pool_w(m_pool);
+    if (pool_w->m_terminating)
+    {
+      request->m_state = Request::cancelled;
+      return request;
+    }
+    pool_w->m_pending.push_back(request);
+    Statistics& statistics = pool_w->m_statistics;
+    statistics.m_queue_depth = pool_w->m_pending.size();
+    statistics.m_peak_queue_depth = std::max(statistics.m_peak_queue_depth, statistics.m_queue_depth);
+    if (pool_w->m_running_decoders < m_max_decoders)
+    {
+      if (pool_w->m_running_decoders++ == 0)
+        pool_w->m_busy_since = clock_type::now();
+      start_decoder = true;
+    }
+  }
+  if (start_decoder)
+    statefultask::create<task::TextureDecoder>(this)->run(m_queue);
+  return request;
+}
+
+void TextureDecodePool::set_importance(request_handle_type const& request, float importance)
+{
+  pool_t::wat pool_w(m_pool);
+  request->m_importance = importance;
+}
+
+bool TextureDecodePool::cancel(request_handle_type const& request)
+{
+  DoutEntering(dc::vulkan, "TextureDecodePool::cancel(" << request->m_path << ")");
+  {
+    pool_t::wat pool_w(m_pool);
+    if (request->m_state == Request::pending)
+    {
+      std::erase(pool_w->m_pending, request);
+      request->m_state = Request::cancelled;
+      ++pool_w->m_statistics.m_cancelled;
+      pool_w->m_statistics.m_queue_depth = pool_w->m_pending.size();
+      return true;
+    }
+    if (request->m_state != Request::decoding)
+      return false;
+  }
+  // Waiting from inside a callback could wait for itself, or for a callback that is waiting for this one.
+  if (s_in_callback)
+    return false;
+  // The callback is running right now; wait until it returned.
+  std::unique_lock<std::mutex> lock(m_state_changed_mutex);
+  m_state_changed.wait(lock, [&](){ pool_t::crat pool_r(m_pool); return request->m_state != Request::decoding; });
+  return false;
+}
+
+void TextureDecodePool::terminate()
+{
+  DoutEntering(dc::vulkan, "TextureDecodePool::terminate()");
+  {
+    pool_t::wat pool_w(m_pool);
+    pool_w->m_terminating = true;
+    for (request_handle_type const& request : pool_w->m_pending)
+      request->m_state = Request::cancelled;
+    pool_w->m_statistics.m_cancelled += pool_w->m_pending.size();
+    pool_w->m_pending.clear();
+    pool_w->m_statistics.m_queue_depth = 0;
+  }
+  std::unique_lock<std::mutex> lock(m_state_changed_mutex);
+  m_state_changed.wait(lock, [this](){ return pool_t::crat(m_pool)->m_running_decoders == 0; });
+}
+
+TextureDecodePool::request_handle_type TextureDecodePool::next_request()
+{
+  request_handle_type request;
+  {
+    pool_t::wat pool_w(m_pool);
+    if (pool_w->m_pending.empty())
+    {
+      // The decoder will finish; do this while holding the lock, so that decode starts a new decoder if necessary.
+      if (--pool_w->m_running_decoders == 0)
+        pool_w->m_busy_time += clock_type::now() - pool_w->m_busy_since;
+    }
+    else
+    {
+      // The queue is short and importances change while requests are pending, so just search for the most important one.
+      auto most_important = std::max_element(pool_w->m_pending.begin(), pool_w->m_pending.end(),
+          [](request_handle_type const& r1, request_handle_type const& r2){ return r1->m_importance < r2->m_importance; });
+      request = std::move(*most_important);
+      pool_w->m_pending.erase(most_important);
+      request->m_state = Request::decoding;
+      pool_w->m_statistics.m_queue_depth = pool_w->m_pending.size();
+      return request;
+    }
+  }
+  // Wake up terminate.
+  { std::lock_guard<std::mutex> lock(m_state_changed_mutex); }
+  m_state_changed.notify_all();
+  return request;
+}
+
+void TextureDecodePool::decoded(request_handle_type const& request, clock_type::time_point decode_finished, bool succeeded, size_t bytes)
+{
+  {
+    pool_t::wat pool_w(m_pool);
+    request->m_state = Request::finished;
+    Statistics& statistics = pool_w->m_statistics;
+    if (!succeeded)
+      ++statistics.m_failed;
+    else if (bytes == 0)
+      ++statistics.m_header_only;
+    else
+    {
+      ++statistics.m_decoded;
+      statistics.m_bytes += bytes;
+    }
+    pool_w->m_latencies[pool_w->m_latency_count++ % s_latency_samples] =
+      std::chrono::duration<double, std::milli>(decode_finished - request->m_queued).count();
+  }
+  // Wake up cancel.
+  { std::lock_guard<std::mutex> lock(m_state_changed_mutex); }
+  m_state_changed.notify_all();
+}
+
+TextureDecodePool::Statistics TextureDecodePool::statistics() const
+{
+  std::vector<double> latencies;
+  Statistics statistics;
+  {
+    pool_t::crat pool_r(m_pool);
+    statistics = pool_r->m_statistics;
+    latencies.assign(pool_r->m_latencies.begin(), pool_r->m_latencies.begin() + std::min(pool_r->m_latency_count, s_latency_samples));
+    clock_type::duration busy_time = pool_r->m_busy_time;
+    if (pool_r->m_running_decoders > 0)
+      busy_time += clock_type::now() - pool_r->m_busy_since;
+    double const seconds = std::chrono::duration<double>(busy_time).count();
+    statistics.m_bytes_per_second = seconds > 0.0 ? statistics.m_bytes / seconds : 0.0;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  std::array<double, 3> constexpr percentiles = { 0.5, 0.9, 0.99 };
+  for (size_t i = 0; i < percentiles.size(); ++i)
+    statistics.m_latency_ms[i] = latencies.empty() ? 0.0 : latencies[static_cast<size_t>(percentiles[i] * (latencies.size() - 1))];
+  return statistics;
+}
+
+void TextureDecodePool::print_on(std::ostream& os) const
+{
+  os << statistics();
+}
+
+void TextureDecodePool::Statistics::print_on(std::ostream& os) const
+{
+  os << "{queue_depth:" << m_queue_depth <<
+      ", peak_queue_depth:" << m_peak_queue_depth <<
+      ", decoded:" << m_decoded <<
+      ", header_only:" << m_header_only <<
+      ", failed:" << m_failed <<
+      ", cancelled:" << m_cancelled <<
+      ", bytes:" << m_bytes <<
+      ", MB/s:" << (m_bytes_per_second / 1000000.0) <<
+      ", latency_ms(p50/p90/p99):" << m_latency_ms[0] << '/' << m_latency_ms[1] << '/' << m_latency_ms[2] << '}';
+}
+
+} // namespace vulkan
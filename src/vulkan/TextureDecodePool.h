@@ -0,0 +1,145 @@
+#pragma once
+
+#include "memory/DataFeeder.h"
+#include "threadpool/AIQueueHandle.h"
+#include "threadsafe/threadsafe.h"
+#include "utils/has_print_on.h"
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "debug.h"
+
+namespace vulkan {
+using utils::has_print_on::operator<<;
+
+namespace task {
+class TextureDecoder;
+} // namespace task
+
+// Decodes texture images on a dedicated thread pool queue, most important request first.
+//
+// There is one TextureDecodePool per Application (see Application::texture_decode_pool).
+// Call decode with the path of the image and an importance (for example, the projected
+// screen size of the object that uses the texture; larger is more important). The callback
+// is called from the decode thread with the extent and a DataFeeder that can be passed to
+// Texture::upload. Until that upload finished, the descriptor keeps pointing to
+// SynchronousWindow::m_loading_texture, so that is what is shown in the meantime.
+//
+// The importance of a request that is still pending can be changed with set_importance,
+// and a request that is no longer needed can be cancelled.
+//
+// PNG images are decoded while being uploaded (see libpng::ImageDataFeeder), so for those
+// the decode job only reads the header; other formats are fully decoded by the decode job.
+// The statistics count the former separately (m_header_only), and m_bytes only contains the
+// pixels that were actually decoded by the decode jobs.
+//
+// All member functions are thread-safe.
+class TextureDecodePool
+{
+ public:
+  using callback_type = std::function<void(vk::Extent2D extent, std::unique_ptr<DataFeeder> texture_data_feeder)>;
+  using clock_type = std::chrono::steady_clock;
+
+  class Request
+  {
+   private:
+    friend class TextureDecodePool;
+    friend class task::TextureDecoder;
+    enum State { pending, decoding, finished, cancelled };
+
+    std::filesystem::path const m_path;
+    int const m_requested_components;
+    callback_type m_callback;
+    clock_type::time_point const m_queued;              // The time at which decode was called.
+    float m_importance;                                 // Protected by TextureDecodePool::m_pool.
+    State m_state{pending};                             // Protected by TextureDecodePool::m_pool.
+
+   public:
+    Request(std::filesystem::path const& path, int requested_components, float importance, callback_type&& callback) :
+      m_path(path), m_requested_components(requested_components), m_callback(std::move(callback)), m_queued(clock_type::now()), m_importance(importance) { }
+  };
+  using request_handle_type = std::shared_ptr<Request>;
+
+  // A snapshot of the statistics.
+  struct Statistics
+  {
+    size_t m_queue_depth;                               // The number of requests that are waiting to be decoded.
+    size_t m_peak_queue_depth;                          // The largest value that m_queue_depth ever had.
+    size_t m_decoded;                                   // The number of images that were fully decoded by the pool.
+    size_t m_header_only;                               // The number of PNG images of which the pool only read the header.
+    size_t m_failed;                                    // The number of images that could not be decoded.
+    size_t m_cancelled;                                 // The number of requests that were cancelled before they were decoded.
+    size_t m_bytes;                                     // The total size of the images counted in m_decoded, in bytes.
+    double m_bytes_per_second;                          // m_bytes divided by the time that at least one decoder was running.
+    std::array<double, 3> m_latency_ms;                 // The 50th, 90th and 99th percentile of the time between decode and the callback.
+
+    void print_on(std::ostream& os) const;
+  };
+
+  static constexpr size_t s_latency_samples = 256;      // The number of most recent latencies that m_latency_ms is calculated from.
+
+ private:
+  friend class task::TextureDecoder;
+
+  struct UnlockedPool
+  {
+    std::vector<request_handle_type> m_pending;         // Requests that weren't started yet, unordered.
+    int m_running_decoders{0};                          // The number of running task::TextureDecoder's.
+    bool m_terminating{false};                          // Set by terminate; no new requests are accepted.
+    Statistics m_statistics{};
+    std::array<double, s_latency_samples> m_latencies;  // Ring buffer with the most recent latencies in milliseconds.
+    size_t m_latency_count{0};                          // The total number of latencies added to m_latencies.
+    clock_type::duration m_busy_time{};                 // The total time that at least one decoder was running.
+    clock_type::time_point m_busy_since;                // Valid while m_running_decoders > 0.
+  };
+  using pool_t = threadsafe::Unlocked<UnlockedPool, threadsafe::policy::Primitive<std::mutex>>;
+
+  AIQueueHandle m_queue;                                // The thread pool queue that the decoders run in.
+  int m_max_decoders{1};                                // The maximum number of images that are decoded concurrently.
+  pool_t m_pool;
+  std::mutex m_state_changed_mutex;
+  std::condition_variable m_state_changed;              // Notified when a request finished decoding or a decoder finished.
+  static thread_local bool s_in_callback;               // Set while the current thread is calling a callback.
+
+ public:
+  // Must be called once, before the first call to decode.
+  void initialize(AIQueueHandle queue, int max_decoders);
+
+  // Queue the image at path for decoding, with the given importance. Returns a handle that can
+  // be passed to set_importance and cancel. The callback is called exactly once, unless the
+  // request is cancelled first. If the image can't be decoded, the callback is called with a
+  // zero extent and a null texture_data_feeder.
+  request_handle_type decode(std::filesystem::path const& path, int requested_components, float importance, callback_type callback);
+
+  // Change the importance of a pending request. Does nothing if the request was already started.
+  void set_importance(request_handle_type const& request, float importance);
+
+  // Cancel request. If it is being decoded right now, then this blocks until its callback returned.
+  // Returns true if the callback will not be called (anymore) as a result of this call.
+  //
+  // Calling cancel from inside a callback is allowed, but then it never blocks: cancelling a request
+  // whose callback is running (including the request of the calling callback itself) just returns false.
+  bool cancel(request_handle_type const& request);
+
+  // Cancel all pending requests and wait until all decoders finished.
+  void terminate();
+
+  Statistics statistics() const;
+
+  void print_on(std::ostream& os) const;
+
+ private:
+  // Called by task::TextureDecoder.
+  request_handle_type next_request();
+  // Pass succeeded = false if the image could not be decoded, and bytes = 0 if only its header was read.
+  void decoded(request_handle_type const& request, clock_type::time_point decode_finished, bool succeeded, size_t bytes);
+};
+
+} // namespace vulkan
@@ -3,7 +3,7 @@
 
 #include "OperatingSystem.h"
 #include "SpecialCircumstances.h"
-#include "InputEvent.h"
+#include "InputEventQueue.h"
 #include "ImGui.h"
 #include "utils/Badge.h"
 
@@ -46,17 +46,12 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
 {
  private:
   MouseButtons m_mouse_buttons;                         // Cache of current mouse button state.
-  InputEventBuffer* m_input_event_buffer = {};
+  InputEventQueue* m_input_event_queue = {};
 
  public:
-  // Thread-safe.
-  MovedMousePosition m_mouse_position;                  // Last mouse position, also updated by mouse movement.
-  WheelOffset m_accumulated_wheel_offset;               // Accumulated mouse wheel events.
-
- public:
-  void register_input_event_buffer(InputEventBuffer* input_event_buffer)
+  void register_input_event_queue(InputEventQueue* input_event_queue)
   {
-    m_input_event_buffer = input_event_buffer;
+    m_input_event_queue = input_event_queue;
   }
 
  private:
@@ -66,7 +61,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     DoutEntering(dc::notice, "WindowEvents::On_WM_DELETE_WINDOW(" << timestamp << ") [" << this << "]");
     // Lets not pass more events to a window that is going to destruct itself.
     // That is, any XCB events received after this WM_DELETE_WINDOW message will be ignored.
-    m_input_event_buffer = nullptr;
+    m_input_event_queue = nullptr;
     // Set the must_close_bit.
     set_must_close();
     // We should have one boost::intrusive_ptr's left: the one in Application::m_window_list.
@@ -89,7 +84,9 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
   void on_mouse_move(int16_t x, int16_t y, uint16_t CWDEBUG_ONLY(converted_modifiers)) override final
   {
     DoutEntering(dc::xcbmotion, "vulkan::WindowEvents::on_mouse_move(" << x << ", " << y << ", " << vulkan::ModifierMask{converted_modifiers} << ")");
-    MovedMousePosition::wat(m_mouse_position)->set(x, y);
+    // Mouse motion is coalesced: only the last position is kept.
+    if (m_input_event_queue)
+      m_input_event_queue->move_mouse(x, y);
   }
 
   void on_key_event(int16_t x, int16_t y, uint16_t converted_modifiers, bool pressed, uint32_t keysym) override final
@@ -97,7 +94,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     vulkan::ModifierMask modifiers{converted_modifiers};
     DoutEntering(dc::xcb, "vulkan::WindowEvents::on_key_event(" << x << ", " << y << ", " << modifiers << ", " << std::boolalpha << pressed << ", " << std::hex << keysym << ")");
 
-    if (m_input_event_buffer)
+    if (m_input_event_queue)
     {
       // Queue event.
       InputEvent event{
@@ -106,8 +103,8 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
         .flags = { m_mouse_buttons, pressed ? EventType::key_press : EventType::key_release },
         .keysym = keysym
       };
-      if (!m_input_event_buffer->push(&event))
-        Dout(dc::warning, "Dumping input event because queue is full!");
+      // A full queue is reported by the consumer (see InputEventQueue::consume_dropped).
+      m_input_event_queue->push(event);
     }
   }
 
@@ -122,22 +119,24 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     {
       // The mouse wheel buttons are not handled as separate events (with an order and mouse coordinates),
       // but merely accumulated. This means that the bits for them in m_mouse_buttons are always unset!
-      WheelOffset::wat wheel_offset_w(m_accumulated_wheel_offset);
+      if (!m_input_event_queue)
+        return;
       switch (button)
       {
         // The reasoning for the direction is that I see Left as going to the left on the screen (obviously) which is the negative x direction.
         // Therefore I chose Up as going up on the screen (which is debatable) and that means going in the negative y direction.
+        // The offsets are in units of InputEventQueue::s_wheel_unit (half a step).
         case MouseButtons::WheelUp:
-          wheel_offset_w->accumulate_y(-0.5f);
+          m_input_event_queue->scroll(0, -1);
           break;
         case MouseButtons::WheelDown:
-          wheel_offset_w->accumulate_y(0.5f);
+          m_input_event_queue->scroll(0, 1);
           break;
         case MouseButtons::WheelLeft:
-          wheel_offset_w->accumulate_x(-1.f);
+          m_input_event_queue->scroll(-2, 0);
           break;
         case MouseButtons::WheelRight:
-          wheel_offset_w->accumulate_x(1.f);
+          m_input_event_queue->scroll(2, 0);
           break;
       }
       return;
@@ -147,7 +146,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     m_mouse_buttons.update_button(button, pressed);
 
     // Queue event.
-    if (m_input_event_buffer)
+    if (m_input_event_queue)
     {
       // Queue event.
       InputEvent event{
@@ -156,8 +155,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
         .flags = { m_mouse_buttons, pressed ? EventType::button_press : EventType::button_release },
         .button = button
       };
-      if (!m_input_event_buffer->push(&event))
-        Dout(dc::warning, "Dumping input event because queue is full!");
+      m_input_event_queue->push(event);
     }
   }
 
@@ -168,7 +166,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     DoutEntering(dc::xcbmotion, "vulkan::WindowEvents::on_mouse_enter(" << x << ", " << y << ", " << modifiers << ", " << std::boolalpha << entered << ")");
 
     // Queue event.
-    if (m_input_event_buffer)
+    if (m_input_event_queue)
     {
       // Queue event.
       InputEvent event{
@@ -176,8 +174,7 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
         .modifier_mask = modifiers,
         .flags = { m_mouse_buttons, entered ? EventType::window_enter : EventType::window_leave },
       };
-      if (!m_input_event_buffer->push(&event))
-        Dout(dc::warning, "Dumping input event because queue is full!");
+      m_input_event_queue->push(event);
     }
   }
 
@@ -186,14 +183,13 @@ class WindowEvents : public linuxviewer::OS::Window, public AsyncAccessSpecialCi
     DoutEntering(dc::notice, "vulkan::WindowEvents::on_focus_changed(" << std::boolalpha << in_focus << ")");
 
     // Queue event.
-    if (m_input_event_buffer)
+    if (m_input_event_queue)
     {
       // Queue event.
       InputEvent event{
         .flags = { m_mouse_buttons, in_focus ? EventType::window_in_focus : EventType::window_out_focus },
       };
-      if (!m_input_event_buffer->push(&event))
-        Dout(dc::warning, "Dumping input event because queue is full!");
+      m_input_event_queue->push(event);
     }
   }
 
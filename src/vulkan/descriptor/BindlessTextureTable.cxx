@@ -0,0 +1,158 @@
+#include "sys.h"
+#include "BindlessTextureTable.h"
+#include "SetLayoutBindingsAndFlags.h"
+#include "LogicalDevice.h"
+#include "Texture.h"
+#include "CommandBuffer.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <iostream>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan::descriptor {
+
+BindlessTextureTable::index_type BindlessTextureTable::SlotAllocator::allocate()
+{
+  index_type index;
+  if (!m_free.empty())
+  {
+    index = m_free.back();
+    m_free.pop_back();
+  }
+  else if (m_next_unused < m_capacity)
+  {
+    index = m_next_unused++;
+    m_in_use_flags.push_back(false);
+  }
+  else
+    return s_invalid_index;
+  m_in_use_flags[index] = true;
+  m_peak = std::max(m_peak, ++m_in_use);
+  return index;
+}
+
+void BindlessTextureTable::SlotAllocator::release(index_type index)
+{
+  // index must have been returned by allocate and not be released already.
+  ASSERT(is_in_use(index));
+  m_in_use_flags[index] = false;
+  m_free.push_back(index);
+  --m_in_use;
+}
+
+void BindlessTextureTable::create(LogicalDevice const* logical_device, vk::Device vh_device, index_type capacity
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
+{
+  DoutEntering(dc::vulkan, "BindlessTextureTable::create(" << logical_device << ", " << vh_device << ", " << capacity << ")");
+  // Need room for at least one texture.
+  ASSERT(capacity > 0);
+  m_logical_device = logical_device;
+  m_vh_device = vh_device;
+
+  // Partially bound: elements that are never written are never accessed either.
+  // Update after bind and update unused while pending: register_texture doesn't have to wait for command buffers that use the set.
+  vk::DescriptorBindingFlags const binding_flags =
+    vk::DescriptorBindingFlagBits::ePartiallyBound |
+    vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+    vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+  SetLayoutBindingsAndFlags bindings_and_flags;
+  bindings_and_flags.insert({
+      .binding = s_binding,
+      .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+      .descriptorCount = capacity,
+      .stageFlags = vk::ShaderStageFlagBits::eAll
+    }, binding_flags, capacity);
+  // The eUpdateAfterBind binding flag causes the layout to be created with eUpdateAfterBindPool.
+  m_descriptor_set_layout = logical_device->create_descriptor_set_layout(bindings_and_flags
+      COMMA_CWDEBUG_ONLY(".m_descriptor_set_layout" + ambifix));
+
+  // The table has its own pool, so that its (large) size doesn't affect the pools of the DescriptorAllocator.
+  m_descriptor_pool = logical_device->create_descriptor_pool(
+      { { .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = capacity } }, 1
+      COMMA_CWDEBUG_ONLY(".m_descriptor_pool" + ambifix));
+
+  vk::DescriptorSetAllocateInfo descriptor_set_allocate_info{
+    .descriptorPool = *m_descriptor_pool,
+    .descriptorSetCount = 1,
+    .pSetLayouts = &*m_descriptor_set_layout
+  };
+  vk::Result res = vh_device.allocateDescriptorSets(&descriptor_set_allocate_info, &m_vh_descriptor_set);
+  if (res != vk::Result::eSuccess)
+    THROW_ALERTC(res, "vk::Device::allocateDescriptorSets");
+  DebugSetName(m_vh_descriptor_set, ambifix.object_name(".m_vh_descriptor_set"), logical_device);
+
+  // Set this last, so that is_created() returns false if anything above threw.
+  *slots_t::wat(m_slots) = SlotAllocator(capacity);
+  m_capacity = capacity;
+}
+
+void BindlessTextureTable::write(index_type index, Texture const& texture) const
+{
+  vk::DescriptorImageInfo const image_info{
+    .sampler = texture.sampler(),
+    .imageView = texture.image_view(),
+    .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+  };
+  vk::WriteDescriptorSet const write_descriptor_set{
+    .dstSet = m_vh_descriptor_set,
+    .dstBinding = s_binding,
+    .dstArrayElement = index,
+    .descriptorCount = 1,
+    .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+    .pImageInfo = &image_info
+  };
+  m_vh_device.updateDescriptorSets(1, &write_descriptor_set, 0, nullptr);
+}
+
+BindlessTextureTable::index_type BindlessTextureTable::register_texture(Texture const& texture) /*threadsafe-*/const
+{
+  DoutEntering(dc::vulkan, "BindlessTextureTable::register_texture(" << texture << ")");
+  // Call LogicalDevice::bindless_texture_table() only when LogicalDevice::supports_bindless_textures() returns true.
+  ASSERT(is_created());
+
+  slots_t::wat slots_w(m_slots);
+  index_type const index = slots_w->allocate();
+  if (index == s_invalid_index)
+    THROW_ALERT("The bindless texture table is full ([CAPACITY] textures).", AIArgs("[CAPACITY]", m_capacity));
+  // Host access to the descriptor set must be externally synchronized; the lock on m_slots takes care of that.
+  write(index, texture);
+  Dout(dc::vulkan, "Registered texture at index " << index << ".");
+  return index;
+}
+
+void BindlessTextureTable::update_texture(index_type index, Texture const& texture) /*threadsafe-*/const
+{
+  DoutEntering(dc::vulkan, "BindlessTextureTable::update_texture(" << index << ", " << texture << ")");
+  slots_t::wat slots_w(m_slots);
+  // index must have been returned by register_texture and not be released.
+  ASSERT(slots_w->is_in_use(index));
+  write(index, texture);
+}
+
+void BindlessTextureTable::release(index_type index) /*threadsafe-*/const
+{
+  DoutEntering(dc::vulkan, "BindlessTextureTable::release(" << index << ")");
+  slots_t::wat slots_w(m_slots);
+  slots_w->release(index);
+}
+
+void BindlessTextureTable::bind(handle::CommandBuffer command_buffer, vk::PipelineBindPoint pipeline_bind_point, vk::PipelineLayout vh_pipeline_layout) const
+{
+  // Call LogicalDevice::bindless_texture_table() only when LogicalDevice::supports_bindless_textures() returns true.
+  ASSERT(is_created());
+  command_buffer.bindDescriptorSets(pipeline_bind_point, vh_pipeline_layout, s_set_index, m_vh_descriptor_set, {});
+}
+
+void BindlessTextureTable::print_on(std::ostream& os) const
+{
+  slots_t::rat slots_r(m_slots);
+  os << "{capacity:" << m_capacity <<
+      ", in_use:" << slots_r->in_use() <<
+      ", peak:" << slots_r->peak() <<
+      ", free:" << slots_r->free_size() << '}';
+}
+
+} // namespace vulkan::descriptor
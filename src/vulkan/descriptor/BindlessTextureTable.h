@@ -0,0 +1,133 @@
+#pragma once
+
+#include "threadsafe/threadsafe.h"
+#include "utils/has_print_on.h"
+#include <vulkan/vulkan.hpp>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+#ifdef CWDEBUG
+#include "debug/DebugSetName.h"
+#endif
+#include "debug.h"
+
+namespace vulkan {
+class LogicalDevice;
+class Texture;
+namespace handle {
+class CommandBuffer;
+} // namespace handle
+
+namespace descriptor {
+using utils::has_print_on::operator<<;
+
+// A global table of textures of a LogicalDevice, for bindless texturing.
+//
+// The table is a single descriptor set with one binding: an array of m_capacity combined image
+// samplers, with the binding flags ePartiallyBound, eUpdateAfterBind and eUpdateUnusedWhilePending.
+// A texture is registered once (see Texture::register_bindless), which writes its descriptor into
+// a free element of the array, and is then addressed by that index; for example by passing it as
+// push constant:
+//
+//   layout(set = 3, binding = 0) uniform sampler2D textures[];        // set = BindlessTextureTable::s_set_index.
+//   layout(push_constant) uniform PushConstant { uint texture_index; } pc;
+//   ...
+//   color = texture(textures[pc.texture_index], uv);
+//
+// Pipelines that use the table must be generated by a PipelineFactory on which use_bindless_texture_table()
+// was called: that adds the layout of the table at set index s_set_index to the pipeline layout.
+// Because the descriptor set never changes, such pipelines only need to bind it (see bind) once per
+// command buffer, no matter how many different textures are drawn.
+//
+// Released indices are put on a free-list and reused by the next register_texture. Since the
+// binding is eUpdateUnusedWhilePending, (re)writing an element does not require waiting for
+// command buffers that use the set, as long as those don't use that element: the caller must
+// not release an index before the GPU stopped using it (which is the case anyway when the
+// texture itself is destroyed at that point).
+//
+// The table is only created if the physical device supports the needed descriptor indexing
+// features (see LogicalDevice::supports_bindless_textures).
+class BindlessTextureTable
+{
+ public:
+  using index_type = uint32_t;
+  static constexpr index_type s_binding = 0;                    // The binding of the texture array.
+  static constexpr index_type s_invalid_index = ~index_type{0}; // Never returned by register_texture.
+  // The set index of the table in pipeline layouts. Every device supports at least four bound descriptor sets
+  // (maxBoundDescriptorSets), so this is the largest set index that is always valid. Pipelines that use the
+  // table can therefore only use set indices 0, 1 and 2 for their other shader resources.
+  static constexpr uint32_t s_set_index = 3;
+
+  // The bookkeeping of which indices are in use (separate from the descriptor set, so that it can be tested without a device).
+  class SlotAllocator
+  {
+   private:
+    index_type m_capacity;
+    std::vector<index_type> m_free;                     // Released indices.
+    std::vector<bool> m_in_use_flags;                   // Whether or not an index is in use, for each index below m_next_unused.
+    index_type m_next_unused{0};                        // All indices from here till m_capacity were never used.
+    index_type m_in_use{0};                             // The number of indices that are in use.
+    index_type m_peak{0};                               // The maximum of m_in_use.
+
+   public:
+    SlotAllocator(index_type capacity = 0) : m_capacity(capacity) { }
+
+    // Return an index that is not in use, preferring released indices, or s_invalid_index if all indices are in use.
+    index_type allocate();
+
+    // Put index (previously returned by allocate) back on the free-list. Releasing an index twice is not allowed.
+    void release(index_type index);
+
+    // Accessors.
+    index_type capacity() const { return m_capacity; }
+    index_type in_use() const { return m_in_use; }
+    index_type peak() const { return m_peak; }
+    size_t free_size() const { return m_free.size(); }
+    bool is_in_use(index_type index) const { return index < m_next_unused && m_in_use_flags[index]; }
+  };
+
+ private:
+  using slots_t = threadsafe::Unlocked<SlotAllocator, threadsafe::policy::Primitive<std::mutex>>;
+
+  LogicalDevice const* m_logical_device{};
+  vk::Device m_vh_device;
+  index_type m_capacity{0};
+  vk::UniqueDescriptorSetLayout m_descriptor_set_layout;
+  vk::UniqueDescriptorPool m_descriptor_pool;
+  vk::DescriptorSet m_vh_descriptor_set;                // Allocated from m_descriptor_pool.
+  mutable slots_t m_slots;                              // Also serializes the writes to m_vh_descriptor_set.
+
+ public:
+  // Called from LogicalDevice::prepare.
+  void create(LogicalDevice const* logical_device, vk::Device vh_device, index_type capacity
+      COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Return true if create was called.
+  bool is_created() const { return m_capacity > 0; }
+
+  // Write the descriptor of texture into a free element of the table and return its index.
+  // Throws if the table is full.
+  index_type register_texture(Texture const& texture) /*threadsafe-*/const;
+
+  // Overwrite the descriptor at index (previously returned by register_texture) with texture.
+  void update_texture(index_type index, Texture const& texture) /*threadsafe-*/const;
+
+  // Put index (previously returned by register_texture) back on the free-list.
+  void release(index_type index) /*threadsafe-*/const;
+
+  // Bind the table to set s_set_index, for a pipeline that was generated with PipelineFactory::use_bindless_texture_table.
+  void bind(handle::CommandBuffer command_buffer, vk::PipelineBindPoint pipeline_bind_point, vk::PipelineLayout vh_pipeline_layout) const;
+
+  // Accessors.
+  index_type capacity() const { return m_capacity; }
+  vk::DescriptorSetLayout vh_descriptor_set_layout() const { return *m_descriptor_set_layout; }
+  vk::DescriptorSet vh_descriptor_set() const { return m_vh_descriptor_set; }
+
+  void print_on(std::ostream& os) const;
+
+ private:
+  void write(index_type index, Texture const& texture) const;
+};
+
+} // namespace descriptor
+} // namespace vulkan
@@ -19,6 +19,7 @@ void CombinedImageSamplerUpdater::prepare_shader_resource_declaration(descriptor
 CombinedImageSamplerUpdater::~CombinedImageSamplerUpdater()
 {
   DoutEntering(dc::statefultask(mSMDebug), "~CombinedImageSamplerUpdater() [" << this << "]");
+  Dout(dc::shaderresource(mSMDebug), "Descriptor write batch: " << m_descriptor_write_batch);
 }
 
 char const* CombinedImageSamplerUpdater::state_str_impl(state_type run_state) const
@@ -212,11 +213,13 @@ void CombinedImageSamplerUpdater::multiplex_impl(state_type run_state)
                   .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
                 };
               }
-              m_owning_window->logical_device()->update_descriptor_sets(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_element_range.ibegin(), image_infos, array_element_range.size(), m_owning_window->number_of_frame_resources());
+              m_descriptor_write_batch.add(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_element_range.ibegin(), image_infos, array_element_range.size(), m_owning_window->number_of_frame_resources());
             }
             else
-              m_owning_window->update_descriptor_set_with_loading_texture(descriptor_set, binding, { 0, descriptor_update_info->descriptor_array_size() });
+              m_owning_window->update_descriptor_set_with_loading_texture(descriptor_set, binding, { 0, descriptor_update_info->descriptor_array_size() }, m_descriptor_write_batch);
             // The PipelineFactory is informed that this update has been executed from the destructor of the descriptor::DescriptorUpdateInfo.
+            // Keep it alive until the batch was flushed, so that doesn't happen before the descriptors are actually written.
+            m_descriptor_write_batch.keep_alive(std::move(update));
           }
           else
           {
@@ -362,11 +365,14 @@ void CombinedImageSamplerUpdater::multiplex_impl(state_type run_state)
                     .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
                   };
                 }
-                m_owning_window->logical_device()->update_descriptor_sets(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_element_range.ibegin(), image_infos, array_element_range.size(), number_of_frame_resources);
+                m_descriptor_write_batch.add(descriptor_set, vk::DescriptorType::eCombinedImageSampler, binding, array_element_range.ibegin(), image_infos, array_element_range.size(), number_of_frame_resources);
               }
             }
           }
         });
+      // Write all descriptors of the updates received above with a single vkUpdateDescriptorSets call.
+      if (!m_descriptor_write_batch.empty())
+        m_descriptor_write_batch.flush(m_owning_window->logical_device());
       if (producer_not_finished())
         break;
       set_state(CombinedImageSamplerUpdater_done);
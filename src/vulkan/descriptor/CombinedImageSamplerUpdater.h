@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Update.h"
+#include "DescriptorWriteBatch.h"
 #include "SetKeyContext.h"
 #include "../TextureArrayRange.h"
 #include "../shader_builder/ShaderResourceBase.h"
@@ -80,6 +81,7 @@ class CombinedImageSamplerUpdater : public vk_utils::TaskToTaskDeque<AIStatefulT
   factory_characteristic_key_to_descriptor_t m_factory_characteristic_key_to_descriptor;        // The descriptor set / bindings associated with this CombinedImageSamplerUpdater.
   using factory_characteristic_key_to_texture_array_range_t = std::vector<std::pair<pipeline::FactoryCharacteristicKey, TextureArrayRange>>;
   factory_characteristic_key_to_texture_array_range_t m_factory_characteristic_key_to_texture_array_range;
+  descriptor::DescriptorWriteBatch m_descriptor_write_batch;                    // The descriptor writes of one run of CombinedImageSamplerUpdater_need_action.
 
  private:
   std::pair<factory_characteristic_key_to_descriptor_t::const_iterator, factory_characteristic_key_to_descriptor_t::const_iterator> find_descriptors(pipeline::FactoryCharacteristicKey const& key) const;
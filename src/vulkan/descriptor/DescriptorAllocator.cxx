@@ -0,0 +1,202 @@
+#include "sys.h"
+#include "DescriptorAllocator.h"
+#include "SetLayoutBindingsAndFlags.h"
+#include "LogicalDevice.h"
+#include "utils/AIAlert.h"
+#include "utils/macros.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan::descriptor {
+
+namespace {
+
+// Add count descriptors of type to pool_sizes.
+void add_descriptors(std::vector<vk::DescriptorPoolSize>& pool_sizes, vk::DescriptorType type, uint32_t count)
+{
+  if (count == 0)
+    return;
+  auto pool_size = std::find_if(pool_sizes.begin(), pool_sizes.end(), [type](vk::DescriptorPoolSize const& pool_size){ return pool_size.type == type; });
+  if (pool_size == pool_sizes.end())
+    pool_sizes.push_back({ .type = type, .descriptorCount = count });
+  else
+    pool_size->descriptorCount += count;
+}
+
+} // namespace
+
+void DescriptorAllocator::initialize(LogicalDevice const* logical_device, vk::Device vh_device, int number_of_shards
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
+{
+  DoutEntering(dc::vulkan, "DescriptorAllocator::initialize(" << logical_device << ", " << vh_device << ", " << number_of_shards << ")");
+  // Need at least one shard.
+  ASSERT(number_of_shards > 0);
+  m_logical_device = logical_device;
+  m_vh_device = vh_device;
+  m_number_of_shards = number_of_shards;
+  m_shards = std::make_unique<Shard[]>(number_of_shards);
+  CWDEBUG_ONLY(m_ambifix = ambifix);
+}
+
+void DescriptorAllocator::register_layout(vk::DescriptorSetLayout vh_descriptor_set_layout, SetLayoutBindingsAndFlags const& sorted_descriptor_set_layout_bindings_and_flags)
+{
+  std::vector<vk::DescriptorSetLayoutBinding> const& bindings = sorted_descriptor_set_layout_bindings_and_flags.sorted_bindings();
+  std::vector<vk::DescriptorBindingFlags> const& binding_flags = sorted_descriptor_set_layout_bindings_and_flags.binding_flags();
+  LayoutUsage layout_usage;
+  for (size_t i = 0; i < bindings.size(); ++i)
+  {
+    if (!binding_flags.empty() && (binding_flags[i] & vk::DescriptorBindingFlagBits::eVariableDescriptorCount))
+    {
+      // The actual number of descriptors of this binding is passed to allocate.
+      layout_usage.m_variable_count_type = bindings[i].descriptorType;
+      layout_usage.m_has_variable_count_binding = true;
+    }
+    else
+      add_descriptors(layout_usage.m_pool_sizes, bindings[i].descriptorType, bindings[i].descriptorCount);
+  }
+  layout_usages_t::wat(m_layout_usages)->insert_or_assign(vh_descriptor_set_layout, std::move(layout_usage));
+}
+
+DescriptorAllocator::Shard& DescriptorAllocator::this_threads_shard() const
+{
+  static std::atomic<unsigned int> s_next_thread{0};
+  thread_local unsigned int const thread = s_next_thread++;
+  return m_shards[thread % m_number_of_shards];
+}
+
+std::vector<vk::DescriptorSet> DescriptorAllocator::allocate(std::vector<vk::DescriptorSetLayout> const& vhv_descriptor_set_layouts,
+    std::vector<uint32_t> const& variable_descriptor_counts)
+{
+  // The number of descriptors per type needed by this request.
+  std::vector<vk::DescriptorPoolSize> request;
+  {
+    layout_usages_t::rat layout_usages_r(m_layout_usages);
+    for (size_t i = 0; i < vhv_descriptor_set_layouts.size(); ++i)
+    {
+      auto layout_usage = layout_usages_r->find(vhv_descriptor_set_layouts[i]);
+      // Descriptor set layouts must be created with LogicalDevice::create_descriptor_set_layout.
+      ASSERT(layout_usage != layout_usages_r->end());
+      for (vk::DescriptorPoolSize const& pool_size : layout_usage->second.m_pool_sizes)
+        add_descriptors(request, pool_size.type, pool_size.descriptorCount);
+      if (layout_usage->second.m_has_variable_count_binding && !variable_descriptor_counts.empty())
+        add_descriptors(request, layout_usage->second.m_variable_count_type, variable_descriptor_counts[i]);
+    }
+  }
+
+  // This is only used when !variable_descriptor_counts.empty().
+  vk::DescriptorSetVariableDescriptorCountAllocateInfo descriptor_set_variable_descriptor_count_allocate_info{
+    .descriptorSetCount = static_cast<uint32_t>(variable_descriptor_counts.size()),
+    .pDescriptorCounts = variable_descriptor_counts.data()
+  };
+  vk::DescriptorSetAllocateInfo descriptor_set_allocate_info{
+    .pNext = variable_descriptor_counts.empty() ? nullptr : &descriptor_set_variable_descriptor_count_allocate_info,
+    .descriptorSetCount = static_cast<uint32_t>(vhv_descriptor_set_layouts.size()),
+    .pSetLayouts = vhv_descriptor_set_layouts.data()
+  };
+  std::vector<vk::DescriptorSet> descriptor_sets(vhv_descriptor_set_layouts.size());
+
+  Shard& shard = this_threads_shard();
+  std::unique_lock<std::mutex> lock(shard.m_mutex, std::try_to_lock);
+  if (!lock.owns_lock())
+  {
+    lock.lock();
+    ++shard.m_statistics.m_contended;
+  }
+  ++shard.m_statistics.m_allocations;
+  shard.m_statistics.m_sets += descriptor_sets.size();
+  for (vk::DescriptorPoolSize const& pool_size : request)
+    add_descriptors(shard.m_observed, pool_size.type, pool_size.descriptorCount);
+  shard.m_observed_sets += descriptor_sets.size();
+
+  if (AI_UNLIKELY(shard.m_pools.empty()))
+    add_pool(shard, request, descriptor_sets.size());
+
+  descriptor_set_allocate_info.descriptorPool = *shard.m_pools.back();
+  vk::Result res = m_vh_device.allocateDescriptorSets(&descriptor_set_allocate_info, descriptor_sets.data());
+  if (AI_UNLIKELY(res == vk::Result::eErrorOutOfPoolMemory || res == vk::Result::eErrorFragmentedPool))
+  {
+    Dout(dc::vulkan, "Descriptor pool " << *shard.m_pools.back() << " is full (" << res << "); adding a new pool.");
+    ++shard.m_statistics.m_out_of_pool_memory;
+    add_pool(shard, request, descriptor_sets.size());
+    descriptor_set_allocate_info.descriptorPool = *shard.m_pools.back();
+    res = m_vh_device.allocateDescriptorSets(&descriptor_set_allocate_info, descriptor_sets.data());
+  }
+  if (res != vk::Result::eSuccess)
+    THROW_ALERTC(res, "vk::Device::allocateDescriptorSets");
+
+  return descriptor_sets;
+}
+
+void DescriptorAllocator::add_pool(Shard& shard, std::vector<vk::DescriptorPoolSize> const& request, uint32_t number_of_sets)
+{
+  uint32_t const max_sets = std::max(number_of_sets, shard.m_max_sets == 0 ? s_initial_max_sets : std::min(2 * shard.m_max_sets, s_max_sets_limit));
+  // Size the pool for max_sets sets with the average number of descriptors per set observed so far,
+  // but with room for at least the current request.
+  std::vector<vk::DescriptorPoolSize> pool_sizes;
+  for (vk::DescriptorPoolSize const& observed : shard.m_observed)
+  {
+    uint64_t const expected = (static_cast<uint64_t>(observed.descriptorCount) * max_sets + shard.m_observed_sets - 1) / shard.m_observed_sets;
+    pool_sizes.push_back({ .type = observed.type, .descriptorCount = static_cast<uint32_t>(std::max<uint64_t>(expected, s_min_descriptor_count)) });
+  }
+  for (vk::DescriptorPoolSize const& needed : request)
+  {
+    auto pool_size = std::find_if(pool_sizes.begin(), pool_sizes.end(), [&](vk::DescriptorPoolSize const& pool_size){ return pool_size.type == needed.type; });
+    // request was already added to m_observed.
+    ASSERT(pool_size != pool_sizes.end());
+    pool_size->descriptorCount = std::max(pool_size->descriptorCount, needed.descriptorCount);
+  }
+  if (pool_sizes.empty())
+    // Only empty descriptor set layouts were allocated so far; a pool must have at least one pool size.
+    pool_sizes.push_back({ .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = s_min_descriptor_count });
+
+  Dout(dc::vulkan, "Creating a descriptor pool for " << max_sets << " sets with pool sizes " << pool_sizes << ".");
+#ifdef CWDEBUG
+  size_t const shard_index = &shard - m_shards.get();
+#endif
+  shard.m_pools.push_back(m_logical_device->create_descriptor_pool(pool_sizes, max_sets
+      COMMA_CWDEBUG_ONLY(".m_shards[" + std::to_string(shard_index) + "].m_pools[" + std::to_string(shard.m_pools.size()) + "]" + m_ambifix)));
+  shard.m_max_sets = max_sets;
+  ++shard.m_statistics.m_pools;
+}
+
+DescriptorAllocator::Statistics& DescriptorAllocator::Statistics::operator+=(Statistics const& statistics)
+{
+  m_allocations += statistics.m_allocations;
+  m_sets += statistics.m_sets;
+  m_contended += statistics.m_contended;
+  m_pools += statistics.m_pools;
+  m_out_of_pool_memory += statistics.m_out_of_pool_memory;
+  return *this;
+}
+
+DescriptorAllocator::Statistics DescriptorAllocator::statistics() const
+{
+  Statistics statistics{};
+  for (int shard = 0; shard < m_number_of_shards; ++shard)
+  {
+    std::lock_guard<std::mutex> lock(m_shards[shard].m_mutex);
+    statistics += m_shards[shard].m_statistics;
+  }
+  return statistics;
+}
+
+void DescriptorAllocator::print_on(std::ostream& os) const
+{
+  os << "{shards:" << m_number_of_shards << ", statistics:" << statistics() << '}';
+}
+
+void DescriptorAllocator::Statistics::print_on(std::ostream& os) const
+{
+  os << "{allocations:" << m_allocations <<
+      ", sets:" << m_sets <<
+      ", contended:" << m_contended <<
+      ", pools:" << m_pools <<
+      ", out_of_pool_memory:" << m_out_of_pool_memory << '}';
+}
+
+} // namespace vulkan::descriptor
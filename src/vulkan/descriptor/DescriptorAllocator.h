@@ -0,0 +1,116 @@
+#pragma once
+
+#include "threadsafe/threadsafe.h"
+#include "threadsafe/AIReadWriteMutex.h"
+#include "utils/has_print_on.h"
+#include <vulkan/vulkan.hpp>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#ifdef CWDEBUG
+#include "debug/DebugSetName.h"
+#endif
+#include "debug.h"
+
+namespace vulkan {
+class LogicalDevice;
+
+namespace descriptor {
+using utils::has_print_on::operator<<;
+
+class SetLayoutBindingsAndFlags;
+
+// Allocates the descriptor sets of a LogicalDevice.
+//
+// Instead of a single, fixed size, descriptor pool behind one lock, every thread allocates from
+// the pools of its own shard (threads are assigned to shards round-robin the first time they
+// allocate). Each shard has its own mutex, so that pipeline factories that run on different
+// threads do not serialize on their descriptor set allocations.
+//
+// A shard creates a new pool when the current one returns eErrorOutOfPoolMemory or eErrorFragmentedPool.
+// Every new pool can contain twice as many sets as the previous one (up to s_max_sets_limit), and
+// its vk::DescriptorPoolSize's are based on the number of descriptors of each type that were
+// observed per set in that shard so far. The number of descriptors per type of every descriptor
+// set layout is registered by LogicalDevice::create_descriptor_set_layout.
+//
+// Descriptor sets are never freed individually: they live as long as the LogicalDevice.
+class DescriptorAllocator
+{
+ public:
+  static constexpr uint32_t s_initial_max_sets = 64;    // The maximum number of sets of the first pool of a shard.
+  static constexpr uint32_t s_max_sets_limit = 4096;    // Pools never grow beyond this number of sets.
+  static constexpr uint32_t s_min_descriptor_count = 16;        // The minimum descriptorCount of an observed descriptor type in a new pool.
+
+  struct Statistics
+  {
+    size_t m_allocations;                               // The number of calls to allocate.
+    size_t m_sets;                                      // The total number of allocated descriptor sets.
+    size_t m_contended;                                 // The number of calls to allocate that had to wait for the lock of their shard.
+    size_t m_pools;                                     // The number of pools created.
+    size_t m_out_of_pool_memory;                        // The number of times that a pool ran out of memory (or was fragmented).
+
+    Statistics& operator+=(Statistics const& statistics);
+    void print_on(std::ostream& os) const;
+  };
+
+ private:
+  // The number of descriptors of each type of one descriptor set layout.
+  struct LayoutUsage
+  {
+    std::vector<vk::DescriptorPoolSize> m_pool_sizes;   // The descriptors of all bindings, except a variable count binding.
+    vk::DescriptorType m_variable_count_type{};         // The type of the variable count binding, if any.
+    bool m_has_variable_count_binding{false};
+  };
+  using layout_usages_container_t = std::map<vk::DescriptorSetLayout, LayoutUsage>;
+  using layout_usages_t = threadsafe::Unlocked<layout_usages_container_t, threadsafe::policy::ReadWrite<AIReadWriteMutex>>;
+
+  struct Shard
+  {
+    std::mutex m_mutex;                                 // Protects all other members.
+    std::vector<vk::UniqueDescriptorPool> m_pools;      // All pools of this shard; the last one is the one that is allocated from.
+    uint32_t m_max_sets{0};                             // The maximum number of sets of the last pool.
+    std::vector<vk::DescriptorPoolSize> m_observed;     // The total number of descriptors per type allocated from this shard.
+    uint64_t m_observed_sets{0};                        // The total number of sets allocated from this shard.
+    Statistics m_statistics{};
+  };
+
+  LogicalDevice const* m_logical_device{};
+  vk::Device m_vh_device;
+  int m_number_of_shards{};
+  std::unique_ptr<Shard[]> m_shards;
+  layout_usages_t m_layout_usages;
+#ifdef CWDEBUG
+  Ambifix m_ambifix;
+#endif
+
+ public:
+  // Called from LogicalDevice::prepare.
+  void initialize(LogicalDevice const* logical_device, vk::Device vh_device, int number_of_shards
+      COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Register the number of descriptors of each type of a newly created descriptor set layout.
+  void register_layout(vk::DescriptorSetLayout vh_descriptor_set_layout, SetLayoutBindingsAndFlags const& sorted_descriptor_set_layout_bindings_and_flags);
+
+  // Allocate one descriptor set per layout in vhv_descriptor_set_layouts.
+  // If variable_descriptor_counts is not empty then it must have the same size as vhv_descriptor_set_layouts
+  // and contains the descriptor count of the variable count binding of the corresponding layout.
+  std::vector<vk::DescriptorSet> allocate(std::vector<vk::DescriptorSetLayout> const& vhv_descriptor_set_layouts,
+      std::vector<uint32_t> const& variable_descriptor_counts);
+
+  // Return the sum of the statistics of all shards.
+  Statistics statistics() const;
+
+  void print_on(std::ostream& os) const;
+
+ private:
+  // Return the shard of the calling thread.
+  Shard& this_threads_shard() const;
+
+  // Add one new pool to shard, sized for at least request.
+  void add_pool(Shard& shard, std::vector<vk::DescriptorPoolSize> const& request, uint32_t number_of_sets);
+};
+
+} // namespace descriptor
+} // namespace vulkan
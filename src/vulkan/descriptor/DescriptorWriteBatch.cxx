@@ -0,0 +1,82 @@
+#include "sys.h"
+#include "DescriptorWriteBatch.h"
+#include "LogicalDevice.h"
+#include <iostream>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan::descriptor {
+
+uint32_t DescriptorWriteBatch::append(vk::DescriptorImageInfo const* infos, size_t count, InfoKind& info_kind_out)
+{
+  info_kind_out = image_info;
+  uint32_t const offset = m_image_infos.size();
+  m_image_infos.insert(m_image_infos.end(), infos, infos + count);
+  return offset;
+}
+
+uint32_t DescriptorWriteBatch::append(vk::DescriptorBufferInfo const* infos, size_t count, InfoKind& info_kind_out)
+{
+  info_kind_out = buffer_info;
+  uint32_t const offset = m_buffer_infos.size();
+  m_buffer_infos.insert(m_buffer_infos.end(), infos, infos + count);
+  return offset;
+}
+
+uint32_t DescriptorWriteBatch::append(vk::BufferView const* infos, size_t count, InfoKind& info_kind_out)
+{
+  info_kind_out = texel_buffer_view;
+  uint32_t const offset = m_texel_buffer_views.size();
+  m_texel_buffer_views.insert(m_texel_buffer_views.end(), infos, infos + count);
+  return offset;
+}
+
+void DescriptorWriteBatch::flush(LogicalDevice const* logical_device)
+{
+  DoutEntering(dc::shaderresource|dc::vulkan, "DescriptorWriteBatch::flush(" << logical_device << ") with " << m_pending_writes.size() << " writes.");
+
+  if (!m_pending_writes.empty())
+  {
+    // Only now that no more infos will be added to the arena are the pointers into it stable.
+    m_descriptor_writes.clear();
+    m_descriptor_writes.reserve(m_pending_writes.size());
+    for (PendingWrite const& pending_write : m_pending_writes)
+    {
+      vk::WriteDescriptorSet& descriptor_write = m_descriptor_writes.emplace_back(pending_write.m_write);
+      switch (pending_write.m_info_kind)
+      {
+        case image_info:
+          descriptor_write.pImageInfo = m_image_infos.data() + pending_write.m_info_offset;
+          break;
+        case buffer_info:
+          descriptor_write.pBufferInfo = m_buffer_infos.data() + pending_write.m_info_offset;
+          break;
+        case texel_buffer_view:
+          descriptor_write.pTexelBufferView = m_texel_buffer_views.data() + pending_write.m_info_offset;
+          break;
+      }
+    }
+    logical_device->update_descriptor_sets(m_descriptor_writes);
+    ++m_flushes;
+    m_flushed_writes += m_descriptor_writes.size();
+
+    m_pending_writes.clear();
+    m_image_infos.clear();
+    m_buffer_infos.clear();
+    m_texel_buffer_views.clear();
+  }
+
+  // The descriptors are written; it is now safe to tell others about it.
+  m_keep_alive.clear();
+}
+
+void DescriptorWriteBatch::print_on(std::ostream& os) const
+{
+  os << "{flushes:" << m_flushes <<
+      ", writes:" << m_flushed_writes <<
+      ", pending:" << m_pending_writes.size() << '}';
+}
+
+} // namespace vulkan::descriptor
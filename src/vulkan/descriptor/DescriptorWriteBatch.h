@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Update.h"
+#include "FrameResourceCapableDescriptorSet.h"
+#include "FrameResourceIndex.h"
+#include "Concepts.h"
+#include "utils/has_print_on.h"
+#include <vulkan/vulkan.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <array>
+#include <iosfwd>
+#include <vector>
+#include "debug.h"
+
+namespace vulkan {
+class LogicalDevice;
+
+namespace descriptor {
+using utils::has_print_on::operator<<;
+
+// Collects descriptor writes and passes them to the device in a single vkUpdateDescriptorSets call.
+//
+// add takes the same arguments as LogicalDevice::update_descriptor_sets, but only copies the
+// vk::WriteDescriptorSet's and their image/buffer infos into the arena of the batch; flush then
+// writes all of them at once. The vectors of the arena are cleared, but not freed, by flush;
+// so after a while adding writes no longer allocates memory.
+//
+// vkUpdateDescriptorSets performs the writes in the order in which they are passed, so when
+// two writes overlap (the same array elements of the same binding of the same descriptor set)
+// the one that was added last wins, exactly as if each add had been a separate update.
+//
+// Something that may only happen after the descriptors were written (like the destructor of a
+// DescriptorUpdateInfo, which tells the PipelineFactory that the descriptor set was updated)
+// can be postponed until the flush by passing a reference to keep_alive.
+class DescriptorWriteBatch
+{
+ private:
+  enum InfoKind : uint8_t { image_info, buffer_info, texel_buffer_view };
+
+  struct PendingWrite
+  {
+    vk::WriteDescriptorSet m_write;             // All pointers are null; they are set from m_info_offset in flush.
+    InfoKind m_info_kind;                       // Which arena m_info_offset refers to.
+    uint32_t m_info_offset;                     // The index of the first info of this write in the arena.
+  };
+
+  std::vector<PendingWrite> m_pending_writes;
+  std::vector<vk::DescriptorImageInfo> m_image_infos;
+  std::vector<vk::DescriptorBufferInfo> m_buffer_infos;
+  std::vector<vk::BufferView> m_texel_buffer_views;
+  std::vector<vk::WriteDescriptorSet> m_descriptor_writes;     // The writes passed to vkUpdateDescriptorSets by flush.
+  std::vector<boost::intrusive_ptr<Update>> m_keep_alive;       // Released after the next flush.
+  size_t m_flushes{0};                                          // The number of calls to vkUpdateDescriptorSets.
+  size_t m_flushed_writes{0};                                   // The total number of vk::WriteDescriptorSet's passed to them.
+
+ public:
+  // Add the write(s) that LogicalDevice::update_descriptor_sets would do for these arguments.
+  template<ConceptWriteDescriptorSetUpdateInfo T>
+  void add(FrameResourceCapableDescriptorSet const& descriptor_set, vk::DescriptorType descriptor_type,
+      uint32_t binding, uint32_t array_element, T const& write_descriptor_set_update_infos,
+      uint32_t array_element_count, FrameResourceIndex number_of_frame_resources);
+
+  // Keep update alive until after the next flush.
+  void keep_alive(boost::intrusive_ptr<Update>&& update) { m_keep_alive.push_back(std::move(update)); }
+
+  // Return true if there is nothing to flush.
+  bool empty() const { return m_pending_writes.empty() && m_keep_alive.empty(); }
+
+  // Write all added descriptors with a single call to vkUpdateDescriptorSets,
+  // then release the updates passed to keep_alive.
+  void flush(LogicalDevice const* logical_device);
+
+  void print_on(std::ostream& os) const;
+
+ private:
+  // Copy count infos to the end of the corresponding arena and return the index of the first one.
+  uint32_t append(vk::DescriptorImageInfo const* infos, size_t count, InfoKind& info_kind_out);
+  uint32_t append(vk::DescriptorBufferInfo const* infos, size_t count, InfoKind& info_kind_out);
+  uint32_t append(vk::BufferView const* infos, size_t count, InfoKind& info_kind_out);
+};
+
+template<ConceptWriteDescriptorSetUpdateInfo T>
+void DescriptorWriteBatch::add(FrameResourceCapableDescriptorSet const& descriptor_set, vk::DescriptorType descriptor_type,
+    uint32_t binding, uint32_t array_element, T const& write_descriptor_set_update_infos,
+    uint32_t array_element_count, FrameResourceIndex number_of_frame_resources)
+{
+  // See LogicalDevice::update_descriptor_sets.
+  ASSERT(write_descriptor_set_update_infos.size() % array_element_count == 0);
+  uint32_t const frame_resources = write_descriptor_set_update_infos.size() / array_element_count;
+  ASSERT(frame_resources == 1 || (frame_resources == number_of_frame_resources.get_value() && descriptor_set.is_frame_resource()));
+
+  InfoKind info_kind;
+  uint32_t const info_offset = append(write_descriptor_set_update_infos.data(), write_descriptor_set_update_infos.size(), info_kind);
+  PendingWrite pending_write{
+    .m_write = {
+      .dstBinding = binding,
+      .dstArrayElement = array_element,
+      .descriptorCount = array_element_count,
+      .descriptorType = descriptor_type
+    },
+    .m_info_kind = info_kind,
+    .m_info_offset = info_offset
+  };
+  if (!descriptor_set.is_frame_resource())
+  {
+    pending_write.m_write.dstSet = static_cast<vk::DescriptorSet>(descriptor_set);
+    m_pending_writes.push_back(pending_write);
+    return;
+  }
+  for (FrameResourceIndex frame_index{0}; frame_index < number_of_frame_resources; ++frame_index)
+  {
+    pending_write.m_write.dstSet = descriptor_set[frame_index];
+    m_pending_writes.push_back(pending_write);
+    // If frame resource data was passed then every descriptor set gets its own infos.
+    if (frame_resources > 1)
+      pending_write.m_info_offset += array_element_count;
+  }
+}
+
+} // namespace descriptor
+} // namespace vulkan
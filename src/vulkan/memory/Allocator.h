@@ -83,6 +83,11 @@ class Allocator
     vmaFlushAllocations(m_handle, allocation_count, vh_allocations, offsets, sizes);
   }
 
+  void invalidate_allocation(VmaAllocation vh_allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+  {
+    vmaInvalidateAllocation(m_handle, vh_allocation, offset, size);
+  }
+
   void unmap_memory(VmaAllocation vh_allocation) const
   {
     vmaUnmapMemory(m_handle, vh_allocation);
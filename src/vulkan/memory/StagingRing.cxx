@@ -0,0 +1,151 @@
+#include "sys.h"
+#include "StagingRing.h"
+#include "LogicalDevice.h"
+#include <algorithm>
+#include <iostream>
+
+namespace vulkan::memory {
+
+StagingRing::StagingRing(LogicalDevice const* logical_device, vk::DeviceSize capacity COMMA_CWDEBUG_ONLY(Ambifix const& ambifix)) :
+  m_logical_device(logical_device),
+  m_staging_buffer(logical_device, capacity COMMA_CWDEBUG_ONLY(".m_staging_buffer" + ambifix)),
+  // Regions must be suitable as bufferOffset of vkCmdCopyBufferToImage for every format (a multiple of four and of the texel block size)
+  // and flushing a region should not touch more than one non-coherent atom of the neighboring regions.
+  m_alignment(std::max(vk::DeviceSize{16}, logical_device->non_coherent_atom_size()))
+{
+  DoutEntering(dc::vulkan, "StagingRing::StagingRing(" << logical_device << ", " << capacity << ") [" << this << "]");
+  // The StagingBuffer must be persistently mapped.
+  ASSERT(m_staging_buffer.m_pointer);
+  ring_t::wat(m_ring)->m_statistics.m_capacity = m_staging_buffer.m_size;
+}
+
+bool StagingRing::allocate(vk::DeviceSize size, Region& region_out, AIStatefulTask* task, AIStatefulTask::condition_type condition)
+{
+  DoutEntering(dc::vulkan, "StagingRing::allocate(" << size << ", ...) [" << this << "]");
+  // Use a dedicated staging buffer for uploads of this size.
+  ASSERT(0 < size && size <= max_allocation_size());
+
+  vk::DeviceSize const capacity = m_staging_buffer.m_size;
+  vk::DeviceSize const aligned_size = (size + m_alignment - 1) / m_alignment * m_alignment;
+
+  ring_t::wat ring_w(m_ring);
+  vk::DeviceSize offset = ring_w->m_head;
+  vk::DeviceSize padding = 0;
+  if (!ring_w->m_blocks.empty())
+  {
+    vk::DeviceSize const tail = ring_w->m_blocks.front().m_begin;
+    // The allocated blocks occupy [tail, head) if head > tail, or [tail, capacity) + [0, head) otherwise.
+    bool const wrapped = ring_w->m_head <= tail;
+    bool fits;
+    if (wrapped)
+      fits = tail - offset >= aligned_size;
+    else if (capacity - offset >= aligned_size)
+      fits = true;
+    else
+    {
+      // Skip the remainder at the end of the ring and start again at the beginning.
+      padding = capacity - offset;
+      offset = 0;
+      fits = tail >= aligned_size;
+    }
+    if (!fits)
+    {
+      ++ring_w->m_statistics.m_stalls;
+      ring_w->m_waiters.push_back({task, condition});
+      Dout(dc::vulkan, "Staging ring full (" << ring_w->m_statistics.m_in_use << " bytes in use); waiting.");
+      return false;
+    }
+    if (padding > 0)
+      ring_w->m_blocks.back().m_end = capacity;         // The padding is reclaimed together with the last block.
+  }
+  else
+    offset = 0;
+
+  ring_w->m_blocks.push_back({offset, offset + aligned_size, false});
+  ring_w->m_head = offset + aligned_size;
+  Statistics& statistics = ring_w->m_statistics;
+  statistics.m_in_use += aligned_size + padding;
+  statistics.m_peak_in_use = std::max(statistics.m_peak_in_use, statistics.m_in_use);
+  ++statistics.m_allocations;
+
+  region_out.m_vh_buffer = m_staging_buffer.m_vh_buffer;
+  region_out.m_offset = offset;
+  region_out.m_size = size;
+  region_out.m_pointer = static_cast<unsigned char*>(m_staging_buffer.m_pointer) + offset;
+  return true;
+}
+
+void StagingRing::release(Region const& region)
+{
+  DoutEntering(dc::vulkan, "StagingRing::release(" << region << ") [" << this << "]");
+
+  std::vector<Waiter> waiters;
+  {
+    ring_t::wat ring_w(m_ring);
+    auto block = std::find_if(ring_w->m_blocks.begin(), ring_w->m_blocks.end(), [&](Block const& block){ return block.m_begin == region.m_offset; });
+    // Releasing a region that wasn't allocated from this ring?
+    ASSERT(block != ring_w->m_blocks.end() && !block->m_released);
+    block->m_released = true;
+    if (block != ring_w->m_blocks.begin())
+      return;                                           // Nothing can be reclaimed yet.
+    // Reclaim all released blocks at the tail of the ring.
+    while (!ring_w->m_blocks.empty() && ring_w->m_blocks.front().m_released)
+    {
+      ring_w->m_statistics.m_in_use -= ring_w->m_blocks.front().m_end - ring_w->m_blocks.front().m_begin;
+      ring_w->m_blocks.pop_front();
+    }
+    if (ring_w->m_blocks.empty())
+      ring_w->m_head = 0;
+    waiters.swap(ring_w->m_waiters);
+  }
+  // Wake up the tasks that are waiting for space, after releasing the lock.
+  for (Waiter const& waiter : waiters)
+    waiter.m_task->signal(waiter.m_condition);
+}
+
+void StagingRing::cancel_wait(AIStatefulTask* task)
+{
+  ring_t::wat ring_w(m_ring);
+  std::erase_if(ring_w->m_waiters, [task](Waiter const& waiter){ return waiter.m_task == task; });
+}
+
+void StagingRing::flush(Region const& region) const
+{
+  m_logical_device->flush_mapped_allocation(m_staging_buffer.m_vh_allocation, region.m_offset, region.m_size);
+}
+
+void StagingRing::count_dedicated()
+{
+  ++ring_t::wat(m_ring)->m_statistics.m_dedicated;
+}
+
+StagingRing::Statistics StagingRing::statistics() const
+{
+  return ring_t::crat(m_ring)->m_statistics;
+}
+
+void StagingRing::print_on(std::ostream& os) const
+{
+  os << statistics();
+}
+
+void StagingRing::Statistics::print_on(std::ostream& os) const
+{
+  os << "{capacity:" << m_capacity <<
+      ", in_use:" << m_in_use <<
+      ", peak_in_use:" << m_peak_in_use <<
+      ", allocations:" << m_allocations <<
+      ", stalls:" << m_stalls <<
+      ", dedicated:" << m_dedicated << '}';
+}
+
+#ifdef CWDEBUG
+void StagingRing::Region::print_on(std::ostream& os) const
+{
+  os << "{vh_buffer:" << m_vh_buffer <<
+      ", offset:" << m_offset <<
+      ", size:" << m_size << '}';
+}
+#endif
+
+} // namespace vulkan::memory
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "StagingBuffer.h"
+#include "statefultask/AIStatefulTask.h"
+#include "threadsafe/threadsafe.h"
+#include "utils/has_print_on.h"
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <vector>
+#include "debug.h"
+
+namespace vulkan::memory {
+using utils::has_print_on::operator<<;
+
+// A persistently mapped staging buffer that is sub-allocated as a ring.
+//
+// Every LogicalDevice has one (see LogicalDevice::staging_ring). CopyDataToGPU tasks allocate
+// a Region from it, let their DataFeeder write directly into the mapped memory, and release
+// the Region again once the timeline semaphore of the submit that reads from it was signaled.
+//
+// Regions are handed out in ring order; released regions are only reclaimed once all regions
+// that were allocated before them were released too. If there is not enough contiguous space
+// then allocate fails and the task is woken up with the passed condition as soon as a region
+// was reclaimed (a "stall"). Uploads larger than max_allocation_size() should not use the ring;
+// CopyDataToGPU falls back to a dedicated StagingBuffer for those.
+//
+// All member functions are thread-safe.
+class StagingRing
+{
+ public:
+  // A part of the staging ring (or of a dedicated staging buffer).
+  struct Region
+  {
+    vk::Buffer m_vh_buffer;                             // The buffer that this region is part of.
+    vk::DeviceSize m_offset{};                          // The offset of the region into m_vh_buffer.
+    vk::DeviceSize m_size{};                            // The size of the region in bytes.
+    unsigned char* m_pointer{};                         // The mapped memory of the region.
+
+#ifdef CWDEBUG
+    void print_on(std::ostream& os) const;
+#endif
+  };
+
+  // A snapshot of the ring statistics, for sizing the ring.
+  struct Statistics
+  {
+    vk::DeviceSize m_capacity;                          // The size of the ring in bytes.
+    vk::DeviceSize m_in_use;                            // The number of bytes that are currently allocated (including padding at the end of the ring).
+    vk::DeviceSize m_peak_in_use;                       // The largest value that m_in_use ever had.
+    size_t m_allocations;                               // The total number of successful allocations.
+    size_t m_stalls;                                    // The number of times that allocate failed because the ring was full.
+    size_t m_dedicated;                                 // The number of uploads that were too large for the ring (see count_dedicated).
+
+    void print_on(std::ostream& os) const;
+  };
+
+ private:
+  // An allocated region, in allocation (ring) order.
+  struct Block
+  {
+    vk::DeviceSize m_begin;                             // Offset of the first byte.
+    vk::DeviceSize m_end;                               // Offset one past the last byte; extended to the end of the ring when the next allocation wrapped around.
+    bool m_released;                                    // Set when release was called for this block.
+  };
+
+  // A task that is waiting for space.
+  struct Waiter
+  {
+    AIStatefulTask* m_task;
+    AIStatefulTask::condition_type m_condition;
+  };
+
+  struct UnlockedRing
+  {
+    std::deque<Block> m_blocks;                         // All blocks that weren't reclaimed yet, oldest first.
+    vk::DeviceSize m_head{0};                           // The offset at which the next allocation will be attempted.
+    std::vector<Waiter> m_waiters;                      // Tasks that need to be woken up when space becomes available.
+    Statistics m_statistics{};
+  };
+  using ring_t = threadsafe::Unlocked<UnlockedRing, threadsafe::policy::Primitive<std::mutex>>;
+
+  LogicalDevice const* m_logical_device;
+  StagingBuffer m_staging_buffer;                       // The underlying, persistently mapped, buffer.
+  vk::DeviceSize m_alignment;                           // The alignment of all regions.
+  ring_t m_ring;
+
+ public:
+  StagingRing(LogicalDevice const* logical_device, vk::DeviceSize capacity COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Allocations larger than this must use a dedicated staging buffer.
+  vk::DeviceSize max_allocation_size() const { return m_staging_buffer.m_size / 4; }
+
+  // Try to allocate size bytes. On success returns true and fills region_out.
+  // Otherwise returns false, and task will be signaled with condition once (more) space was reclaimed.
+  bool allocate(vk::DeviceSize size, Region& region_out, AIStatefulTask* task, AIStatefulTask::condition_type condition);
+
+  // Stop waiting for space; must be called by a task that is aborted while waiting.
+  void cancel_wait(AIStatefulTask* task);
+
+  // Make region, previously returned by allocate, available again.
+  // May only be called once the GPU finished reading from it.
+  void release(Region const& region);
+
+  // Flush the (possibly non-coherent) memory of region after writing to it.
+  void flush(Region const& region) const;
+
+  // Register an upload that was too large for the ring (for the statistics only).
+  void count_dedicated();
+
+  Statistics statistics() const;
+
+  void print_on(std::ostream& os) const;
+};
+
+} // namespace vulkan::memory
@@ -0,0 +1,86 @@
+#include "sys.h"
+#include "StreamingBuffer.h"
+#include "LogicalDevice.h"
+#include <algorithm>
+#ifdef CWDEBUG
+#include "debug/vulkan_print_on.h"
+#endif
+#include "debug.h"
+
+namespace vulkan::memory {
+
+void StreamingBuffer::create(LogicalDevice const* logical_device, vk::BufferUsageFlags usage, FrameResourceIndex number_of_frame_resources, vk::DeviceSize min_region_size
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
+{
+  DoutEntering(dc::vulkan, "StreamingBuffer::create(" << logical_device << ", " << usage << ", " << number_of_frame_resources << ", " << min_region_size << ") [" << this << "]");
+
+  m_logical_device = logical_device;
+  m_usage = usage;
+  // Flushing one region should not touch the non-coherent atoms of the neighboring regions.
+  m_alignment = std::max(vk::DeviceSize{16}, logical_device->non_coherent_atom_size());
+  m_min_region_size = align(std::max(min_region_size, vk::DeviceSize{1}), m_alignment);
+  m_number_of_regions = number_of_frame_resources.get_value();
+  CWDEBUG_ONLY(m_ambifix = ambifix);
+  m_retired_buffers.clear();
+  reallocate(m_min_region_size);
+}
+
+StreamingBuffer::Region StreamingBuffer::begin_frame(FrameResourceIndex index, vk::DeviceSize size)
+{
+  // Destroy the buffers that are no longer used by any frame resource.
+  if (AI_UNLIKELY(!m_retired_buffers.empty()))
+    std::erase_if(m_retired_buffers, [](RetiredBuffer& retired_buffer){ return --retired_buffer.m_frames_left <= 0; });
+
+  m_peak_size = std::max(m_peak_size, size);
+  if (AI_UNLIKELY(size > m_region_size))
+  {
+    // Grow geometrically.
+    vk::DeviceSize region_size = m_region_size;
+    while (region_size < size)
+      region_size *= 2;
+    reallocate(region_size);
+  }
+  else if (AI_UNLIKELY(++m_shrink_frame_count == s_shrink_frames))
+  {
+    vk::DeviceSize const region_size = std::max(m_min_region_size, align(2 * m_peak_size, m_alignment));
+    if (4 * m_peak_size < m_region_size && region_size < m_region_size)
+      reallocate(region_size);
+    m_shrink_frame_count = 0;
+    m_peak_size = 0;
+  }
+
+  vk::DeviceSize const offset = index.get_value() * m_region_size;
+  return { m_buffer.m_vh_buffer, offset, m_region_size, m_mapped + offset };
+}
+
+void StreamingBuffer::flush(Region const& region, vk::DeviceSize size) const
+{
+  // This is a no-op for host coherent memory.
+  if (size > 0)
+    m_logical_device->flush_mapped_allocation(m_buffer.m_vh_allocation, region.m_offset, size);
+}
+
+void StreamingBuffer::reallocate(vk::DeviceSize region_size)
+{
+  DoutEntering(dc::vulkan, "StreamingBuffer::reallocate(" << region_size << ") [" << this << "]");
+
+  if (m_buffer.m_vh_buffer)
+    // The other frame resources are possibly still reading from the old buffer, and will be waited upon
+    // for in the next m_number_of_regions - 1 frames. Wait one more frame to be safe.
+    m_retired_buffers.push_back({ std::move(m_buffer), m_number_of_regions });
+
+  VmaAllocationInfo allocation_info;
+  m_buffer = Buffer(m_logical_device, m_number_of_regions * region_size,
+      { .usage = m_usage,
+        .properties = vk::MemoryPropertyFlagBits::eHostVisible,
+        .vma_allocation_create_flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+        .vma_memory_usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        .allocation_info_out = &allocation_info }
+      COMMA_CWDEBUG_ONLY(".m_buffer" + m_ambifix));
+  m_mapped = static_cast<unsigned char*>(allocation_info.pMappedData);
+  m_region_size = region_size;
+  m_shrink_frame_count = 0;
+  m_peak_size = 0;
+}
+
+} // namespace vulkan::memory
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Buffer.h"
+#include "../FrameResourceIndex.h"
+#include <vector>
+
+namespace vulkan::memory {
+
+// A persistently mapped, host visible buffer from which every frame resource streams its per-frame data.
+//
+// The buffer is shared by all frame resources: it is divided into one equally sized region per
+// frame resource. Each frame, the user calls begin_frame with the number of bytes that it needs,
+// sub-allocates linearly from the returned Region and calls flush once at the end with the number
+// of bytes that were written (a single, merged, flush).
+//
+// If a frame needs more than the region size, the whole buffer is replaced by one whose regions
+// are at least twice as large (geometric growth, so that an application whose UI slowly grows
+// only rarely reallocates). If the peak usage of s_shrink_frames consecutive frames stays below
+// a quarter of the region size, the regions are shrunk to twice that peak (hysteresis, so that
+// a usage that hovers around a boundary doesn't cause reallocations every frame).
+//
+// A buffer that was replaced is still being read by frames of other frame resources that are in
+// flight; it is therefore only destroyed after every frame resource was used again.
+//
+// begin_frame may only be called after the fence of the frame resource was waited for.
+class StreamingBuffer
+{
+ public:
+  static constexpr int s_shrink_frames = 256;           // The number of consecutive frames that must use less than a quarter of the region size before shrinking.
+
+  // The part of the buffer that belongs to the current frame resource.
+  struct Region
+  {
+    vk::Buffer m_vh_buffer;                             // The buffer that this region is part of.
+    vk::DeviceSize m_offset{};                          // The offset of the region into m_vh_buffer.
+    vk::DeviceSize m_size{};                            // The size of the region in bytes.
+    unsigned char* m_pointer{};                         // The mapped memory of the region.
+  };
+
+ private:
+  struct RetiredBuffer
+  {
+    Buffer m_buffer;
+    int m_frames_left;                                  // The number of begin_frame calls before m_buffer may be destroyed.
+  };
+
+  LogicalDevice const* m_logical_device{};
+  vk::BufferUsageFlags m_usage;
+  vk::DeviceSize m_alignment{};                         // The alignment of the region size (and thus of the region offsets).
+  vk::DeviceSize m_min_region_size{};                   // Never shrink below this size.
+  int m_number_of_regions{};
+  Buffer m_buffer;                                      // The current buffer, containing m_number_of_regions regions.
+  unsigned char* m_mapped{};                            // The mapped memory of m_buffer.
+  vk::DeviceSize m_region_size{};                       // The size of one region.
+  std::vector<RetiredBuffer> m_retired_buffers;         // Buffers that were replaced but might still be in use by the GPU.
+  vk::DeviceSize m_peak_size{};                         // The largest size passed to begin_frame during the current shrink period.
+  int m_shrink_frame_count{};                           // The number of frames in the current shrink period.
+#ifdef CWDEBUG
+  Ambifix m_ambifix;
+#endif
+
+ public:
+  StreamingBuffer() = default;
+
+  // Create the buffer with number_of_frame_resources regions of (at least) min_region_size bytes.
+  void create(LogicalDevice const* logical_device, vk::BufferUsageFlags usage, FrameResourceIndex number_of_frame_resources, vk::DeviceSize min_region_size
+      COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Return the region of frame resource index, resized if needed to hold at least size bytes.
+  Region begin_frame(FrameResourceIndex index, vk::DeviceSize size);
+
+  // Flush the first size bytes of region, after writing to them.
+  void flush(Region const& region, vk::DeviceSize size) const;
+
+  // Return offset rounded up to a multiple of alignment (which must be a power of two).
+  static vk::DeviceSize align(vk::DeviceSize offset, vk::DeviceSize alignment) { return (offset + alignment - 1) & ~(alignment - 1); }
+
+ private:
+  void reallocate(vk::DeviceSize region_size);
+};
+
+} // namespace vulkan::memory
@@ -4,7 +4,10 @@
 #include "shader_builder/ShaderInfo.h"
 #include "shader_builder/DeclarationsString.h"
 #include "descriptor/CombinedImageSamplerUpdater.h"
+#include "CompileShader.h"
 #include "utils/malloc_size.h"
+#include <algorithm>
+#include <optional>
 #include "debug.h"
 
 namespace vulkan::pipeline {
@@ -99,14 +102,27 @@ vk::ShaderStageFlags AddShaderStage::preprocess_shaders_and_realize_descriptor_s
   return preprocessed_stages;
 }
 
-bool AddShaderStage::realize_shaders(
-    task::CharacteristicRange* characteristic_range, task::PipelineFactory* pipeline_factory, AIStatefulTask::condition_type locked)
+void AddShaderStage::start_realize_shaders()
+{
+  m_sorted_added_shaders = m_added_shaders;
+  std::sort(m_sorted_added_shaders.begin(), m_sorted_added_shaders.end());
+  m_added_shaders_index = 0;
+  m_pending_compilations.clear();
+  // PendingCompilation objects are accessed by CompileShader tasks; they may not move.
+  m_pending_compilations.reserve(m_sorted_added_shaders.size());
+  m_number_of_running_compilations = 0;
+}
+
+AIStatefulTask::condition_type AddShaderStage::realize_shaders(task::CharacteristicRange* characteristic_range,
+    task::PipelineFactory* pipeline_factory, AIStatefulTask::condition_type locked, AIStatefulTask::condition_type compiled)
 {
   DoutEntering(dc::vulkan, "AddShaderStage::realize_shaders(" << pipeline_factory << ") with index = " <<
       m_added_shaders_index << " [" << this << "]");
 
   task::SynchronousWindow const* owning_window = pipeline_factory->owning_window();
-  while (m_added_shaders_index != m_added_shaders.size())
+
+  // Obtain the task mutex of every added shader and start a CompileShader task for each shader that wasn't compiled yet.
+  while (m_added_shaders_index != m_sorted_added_shaders.size())
   {
     // If m_added_shaders_index is negative then that means that we received
     // the locked signal for the current m_added_shaders_index and now we have the lock.
@@ -114,7 +130,7 @@ bool AddShaderStage::realize_shaders(
     if (have_lock)
       m_added_shaders_index = -m_added_shaders_index - 1;
 
-    shader_builder::ShaderIndex shader_index = m_added_shaders[m_added_shaders_index];
+    shader_builder::ShaderIndex shader_index = m_sorted_added_shaders[m_added_shaders_index];
     shader_builder::ShaderInfoCache& shader_info_cache = Application::instance().get_shader_info(shader_index);
 
     if (!have_lock &&
@@ -122,27 +138,70 @@ bool AddShaderStage::realize_shaders(
     {
       // Make the index negative to signal that we're blocking on trying to get the task mutex.
       m_added_shaders_index = -m_added_shaders_index - 1;
-      return false;
+      return locked;
     }
 
+    // Now that we locked shader_info_cache.m_task_mutex we're allowed to access shader_info_cache.
+    // The mutex mainly makes sure that only a single task will compile any given shader and assign
+    // shader_info_cache.m_shader_module.
+    if (shader_info_cache.m_shader_module)
     {
+      // This shader was already compiled by another factory (or for a previous fill index).
       statefultask::AdoptLock lock(shader_info_cache.m_task_mutex);
-
-      // Now that we locked shader_info_cache.m_task_mutex we're allowed to access shader_info_cache.
-      // The mutex mainly makes sure that only a single task will compile any given shader and assign
-      // shader_info_cache.m_shader_module.
-      realize_shader(pipeline_factory, owning_window, shader_index, shader_info_cache, m_compiler, m_set_index_hint_map2
-         COMMA_CWDEBUG_ONLY("AddShaderStage::"));
+      add_shader_stage_create_info(shader_info_cache);
+    }
+    else
+    {
+      // Keep the task mutex locked until the shader module was created (below).
+      PendingCompilation& pending_compilation = m_pending_compilations.emplace_back(shader_index);
+      std::string_view glsl_source_code = preprocess2(shader_info_cache, pending_compilation.m_glsl_source_code_buffer, m_set_index_hint_map2);
+      pending_compilation.m_compile_shader_task = statefultask::create<task::CompileShader>(&shader_info_cache, std::string{glsl_source_code},
+          &pending_compilation.m_spirv_cache, &owning_window->application().spirv_disk_cache()
+          COMMA_CWDEBUG_ONLY(mSMDebug));
+      m_number_of_running_compilations.fetch_add(1, std::memory_order::relaxed);
+      pending_compilation.m_compile_shader_task->run(Application::instance().low_priority_queue(),
+          [this, characteristic_range, compiled](bool CWDEBUG_ONLY(success)){
+            Dout(dc::vulkan(!success), "CompileShader task failed.");
+            if (m_number_of_running_compilations.fetch_sub(1, std::memory_order::acq_rel) == 1)
+              characteristic_range->signal(compiled);
+          });
     }
 
     // Advance to the next shader, if any.
     ++m_added_shaders_index;
   }
 
-  m_compiler.release();
+  // Wait until all CompileShader tasks finished.
+  if (m_number_of_running_compilations.load(std::memory_order::acquire) > 0)
+    return compiled;
+
+  // Create the shader modules and release the task mutexes.
+  std::optional<AIAlert::Error> error;
+  std::string failed_shader_name;
+  for (PendingCompilation& pending_compilation : m_pending_compilations)
+  {
+    shader_builder::ShaderInfoCache& shader_info_cache = Application::instance().get_shader_info(pending_compilation.m_shader_index);
+    statefultask::AdoptLock lock(shader_info_cache.m_task_mutex);
+    if (pending_compilation.m_compile_shader_task->error())
+    {
+      if (!error)
+      {
+        error = pending_compilation.m_compile_shader_task->error();
+        failed_shader_name = shader_info_cache.name();
+      }
+      continue;
+    }
+    create_shader_module(pipeline_factory, owning_window, pending_compilation.m_shader_index, shader_info_cache, pending_compilation.m_spirv_cache
+        COMMA_CWDEBUG_ONLY("AddShaderStage::"));
+    add_shader_stage_create_info(shader_info_cache);
+  }
+  m_pending_compilations.clear();
+
+  if (error)
+    THROW_ALERT("Failed to compile shader \"[NAME]\"", AIArgs("[NAME]", failed_shader_name), *error);
 
-  // Returns true on success.
-  return true;
+  // Returns zero on success.
+  return 0;
 }
 
 void AddShaderStage::preprocess1(shader_builder::ShaderInfo const& shader_info)
@@ -306,31 +365,48 @@ void AddShaderStage::realize_shader(task::PipelineFactory* pipeline_factory,
     glsl_source_code = preprocess2(shader_info, glsl_source_code_buffer, set_index_hint_map2);
 
     // Add a shader module to this pipeline.
-    spirv_cache.compile(glsl_source_code, compiler, shader_info);
+    spirv_cache.compile(glsl_source_code, compiler, shader_info, &owning_window->application().spirv_disk_cache());
 
-    shader_info_cache.m_shader_module = spirv_cache.create_module({}, owning_window->logical_device()
-        COMMA_CWDEBUG_ONLY("m_per_stage_shader_module[" + to_string(shader_info.stage()) + "]" + ambifix));
+    create_shader_module(pipeline_factory, owning_window, shader_index, shader_info_cache, spirv_cache COMMA_CWDEBUG_ONLY(ambifix));
+  }
 
-    if (pipeline_factory)       // This is nullptr for imgui.
-    {
-      // Add data to shader_info_cache that might be needed by other pipeline factories
-      // because they will no longer call preprocess* after the shader module handle is set.
-      update(shader_info_cache);
-      cache_descriptor_set_layouts(shader_info_cache);
-      pipeline_factory->add_compiled_shader_known_by_this_factory({}, shader_index);
-    }
+  add_shader_stage_create_info(shader_info_cache);
+}
+
+void AddShaderStage::create_shader_module(task::PipelineFactory* pipeline_factory,
+    task::SynchronousWindow const* owning_window,
+    shader_builder::ShaderIndex shader_index,
+    shader_builder::ShaderInfoCache& shader_info_cache,
+    shader_builder::SPIRVCache const& spirv_cache
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
+{
+  shader_builder::ShaderInfo const& shader_info = shader_info_cache;
+
+  shader_info_cache.m_shader_module = spirv_cache.create_module({}, owning_window->logical_device()
+      COMMA_CWDEBUG_ONLY("m_per_stage_shader_module[" + to_string(shader_info.stage()) + "]" + ambifix));
 
-    // Set an atomic boolean for the sake of optimizing preprocessing away.
-    // We can't use m_shader_module for that because preprocess1 is called outside of the
-    // critical area of ShaderInfoCache::m_task_mutex. As such there is a race condition,
-    // but that will at most lead to an unnecessary preprocess of the same shader, without
-    // compiling it afterwards.
-    shader_info_cache.set_compiled();
+  if (pipeline_factory)       // This is nullptr for imgui.
+  {
+    // Add data to shader_info_cache that might be needed by other pipeline factories
+    // because they will no longer call preprocess* after the shader module handle is set.
+    update(shader_info_cache);
+    cache_descriptor_set_layouts(shader_info_cache);
+    pipeline_factory->add_compiled_shader_known_by_this_factory({}, shader_index);
   }
 
+  // Set an atomic boolean for the sake of optimizing preprocessing away.
+  // We can't use m_shader_module for that because preprocess1 is called outside of the
+  // critical area of ShaderInfoCache::m_task_mutex. As such there is a race condition,
+  // but that will at most lead to an unnecessary preprocess of the same shader, without
+  // compiling it afterwards.
+  shader_info_cache.set_compiled();
+}
+
+void AddShaderStage::add_shader_stage_create_info(shader_builder::ShaderInfoCache const& shader_info_cache)
+{
   m_shader_stage_create_infos.push_back(vk::PipelineShaderStageCreateInfo{
     .flags = vk::PipelineShaderStageCreateFlags(0),
-    .stage = shader_info.stage(),
+    .stage = shader_info_cache.stage(),
     .module = *shader_info_cache.m_shader_module,
     .pName = "main"
   });
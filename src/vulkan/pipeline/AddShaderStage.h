@@ -11,6 +11,8 @@
 #include "utils/Badge.h"
 #include "utils/Array.h"
 #include "utils/is_power_of_two.h"
+#include <boost/intrusive_ptr.hpp>
+#include <atomic>
 #include <map>
 #include <vector>
 #include <set>
@@ -32,6 +34,7 @@ class SetIndexHintMap;
 } // namespace descriptor
 namespace task {
 class CombinedImageSamplerUpdater;
+class CompileShader;
 } // namespace task
 
 namespace pipeline {
@@ -90,8 +93,23 @@ class AddShaderStage : public virtual CharacteristicRangeBridge, public virtual
   descriptor::SetIndexHintMap const* m_set_index_hint_map2{};
 
   // Variables used by realize_shaders.
-  int m_added_shaders_index;
-  shader_builder::ShaderCompiler m_compiler;
+  std::vector<shader_builder::ShaderIndex> m_sorted_added_shaders;     // m_added_shaders sorted by ShaderIndex (the order in which the
+                                                                        // task mutexes of the shaders are locked; this avoids dead-locks
+                                                                        // between factories that use overlapping sets of shaders).
+  int m_added_shaders_index;                                            // Index into m_sorted_added_shaders.
+
+  // A shader that is being compiled by a CompileShader task, while we hold its ShaderInfoCache::m_task_mutex.
+  struct PendingCompilation
+  {
+    shader_builder::ShaderIndex m_shader_index;
+    std::string m_glsl_source_code_buffer;                              // Buffer passed to preprocess2.
+    shader_builder::SPIRVCache m_spirv_cache;                           // Written to by the CompileShader task.
+    boost::intrusive_ptr<task::CompileShader> m_compile_shader_task;    // The task that compiles this shader.
+
+    PendingCompilation(shader_builder::ShaderIndex shader_index) : m_shader_index(shader_index) { }
+  };
+  std::vector<PendingCompilation> m_pending_compilations;               // Reserved in start_realize_shaders, so that elements never move.
+  std::atomic<int> m_number_of_running_compilations;                    // The number of CompileShader tasks that didn't finish yet.
 
   // Filled by preprocess1, used by preprocess2.
   utils::Array<declaration_contexts_container_t, number_of_shader_stage_indexes, ShaderStageIndex> m_per_stage_declaration_contexts;
@@ -147,9 +165,9 @@ class AddShaderStage : public virtual CharacteristicRangeBridge, public virtual
   vk::ShaderStageFlags preprocess_shaders_and_realize_descriptor_set_layouts(task::PipelineFactory* pipeline_factory) override;
 
   // Called from CharacteristicRange_compile.
-  void start_realize_shaders() override { m_compiler.initialize(); m_added_shaders_index = 0; }
-  bool realize_shaders(task::CharacteristicRange* characteristic_range,
-      task::PipelineFactory* pipeline_factory, AIStatefulTask::condition_type locked) override;
+  void start_realize_shaders() override;
+  AIStatefulTask::condition_type realize_shaders(task::CharacteristicRange* characteristic_range,
+      task::PipelineFactory* pipeline_factory, AIStatefulTask::condition_type locked, AIStatefulTask::condition_type compiled) override;
 
   // Called from the top of the first call to preprocess1.
   void prepare_shader_resource_declarations();
@@ -197,6 +215,18 @@ class AddShaderStage : public virtual CharacteristicRangeBridge, public virtual
       descriptor::SetIndexHintMap const* set_index_hint_map2
       COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
 
+  // Create shader_info_cache.m_shader_module from the SPIR-V code in spirv_cache.
+  // Called by realize_shader and realize_shaders while holding shader_info_cache.m_task_mutex.
+  void create_shader_module(task::PipelineFactory* pipeline_factory,
+      task::SynchronousWindow const* owning_window,
+      shader_builder::ShaderIndex shader_index,
+      shader_builder::ShaderInfoCache& shader_info_cache,
+      shader_builder::SPIRVCache const& spirv_cache
+      COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
+
+  // Add shader_info_cache.m_shader_module to m_shader_stage_create_infos.
+  void add_shader_stage_create_info(shader_builder::ShaderInfoCache const& shader_info_cache);
+
   void realize_shader(task::PipelineFactory* pipeline_factory,
       task::SynchronousWindow const* owning_window,
       shader_builder::ShaderIndex shader_index,
@@ -30,6 +30,7 @@ char const* CharacteristicRange::condition_str_impl(condition_type condition) co
     AI_CASE_RETURN(do_compile);
     AI_CASE_RETURN(do_realize_shaders);
     AI_CASE_RETURN(do_terminate);
+    AI_CASE_RETURN(do_shaders_compiled);
   }
   return direct_base_type::condition_str_impl(condition);
 }
@@ -126,11 +127,13 @@ void CharacteristicRange::multiplex_impl(state_type run_state)
       Dout(dc::statefultask(mSMDebug), "Falling through to CharacteristicRange_realize_shaders [" << this << "]");
       [[fallthrough]];
     case CharacteristicRange_realize_shaders:
-      // If realize_shaders returns false we must reenter it when signal(do_realize_shaders) is received.
-      // Note that it keeps returning false until all shaders are compiled.
-      if (!realize_shaders(this, m_owning_factory, do_realize_shaders))
+      // If realize_shaders returns non-zero we must reenter it when that condition is signaled:
+      // do_realize_shaders when a task mutex of a shader was obtained, or do_shaders_compiled
+      // when all CompileShader tasks that were started finished.
+      // Note that it keeps returning non-zero until all shaders are compiled.
+      if (condition_type wait_for = realize_shaders(this, m_owning_factory, do_realize_shaders, do_shaders_compiled))
       {
-        wait(do_realize_shaders);
+        wait(wait_for);
         break;
       }
       set_state(CharacteristicRange_compiled);
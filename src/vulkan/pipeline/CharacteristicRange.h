@@ -46,6 +46,7 @@ class CharacteristicRange : public AIStatefulTask, public virtual pipeline::Char
   static constexpr condition_type do_compile = 4;
   static constexpr condition_type do_realize_shaders = 8;
   static constexpr condition_type do_terminate = 16;
+  static constexpr condition_type do_shaders_compiled = 32;
 
   condition_type m_needs_signals{do_fill};      // The signals that are required by the derived class.
 
@@ -61,8 +61,10 @@ struct CharacteristicRangeBridge
     ASSERT(false);
     AI_NEVER_REACHED
   }
-  virtual bool realize_shaders(task::CharacteristicRange* UNUSED_ARG(characteristic_range),
-      task::PipelineFactory* UNUSED_ARG(pipeline_factory), AIStatefulTask::condition_type UNUSED_ARG(locked))
+  // Returns the condition to wait for before calling realize_shaders again, or 0 when all shaders are realized.
+  virtual AIStatefulTask::condition_type realize_shaders(task::CharacteristicRange* UNUSED_ARG(characteristic_range),
+      task::PipelineFactory* UNUSED_ARG(pipeline_factory), AIStatefulTask::condition_type UNUSED_ARG(locked),
+      AIStatefulTask::condition_type UNUSED_ARG(compiled))
   {
     ASSERT(false);
     AI_NEVER_REACHED
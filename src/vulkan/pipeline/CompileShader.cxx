@@ -0,0 +1,169 @@
+#include "sys.h"
+#include "CompileShader.h"
+#include "shader_builder/ShaderInfo.h"
+#include "shader_builder/ShaderCompiler.h"
+#include "shader_builder/SPIRVCache.h"
+#include "debug.h"
+
+namespace vulkan::task {
+
+namespace {
+
+// A shaderc compiler instance per thread.
+struct ThreadLocalShaderCompiler : shader_builder::ShaderCompiler
+{
+  ThreadLocalShaderCompiler() { initialize(); }
+};
+
+shader_builder::ShaderCompiler const& thread_local_shader_compiler()
+{
+  thread_local ThreadLocalShaderCompiler compiler;
+  return compiler;
+}
+
+} // namespace
+
+//static
+CompileShader::compiled_shaders_t CompileShader::s_compiled_shaders;
+
+CompileShader::spirv_code_type CompileShader::UnlockedCompiledShaders::find(shader_builder::SPIRVDiskCache::Key const& key)
+{
+  auto compiled = m_compiled.find(key);
+  if (compiled == m_compiled.end())
+    return {};
+  m_lru.splice(m_lru.begin(), m_lru, compiled->second.m_lru_position);
+  return compiled->second.m_spirv_code;
+}
+
+void CompileShader::UnlockedCompiledShaders::insert(shader_builder::SPIRVDiskCache::Key const& key, spirv_code_type spirv_code)
+{
+  if (m_compiled.contains(key))
+    return;
+  m_lru.push_front(key);
+  m_compiled_bytes += spirv_code->size() * sizeof(uint32_t);
+  m_compiled.try_emplace(key, CompiledShader{std::move(spirv_code), m_lru.begin()});
+  // Always keep the code that was just added.
+  while (m_compiled_bytes > s_max_compiled_bytes && m_lru.size() > 1)
+  {
+    auto least_recently_used = m_compiled.find(m_lru.back());
+    m_compiled_bytes -= least_recently_used->second.m_spirv_code->size() * sizeof(uint32_t);
+    m_compiled.erase(least_recently_used);
+    m_lru.pop_back();
+  }
+}
+
+CompileShader::CompileShader(shader_builder::ShaderInfo const* shader_info, std::string&& glsl_source_code,
+    shader_builder::SPIRVCache* spirv_cache_out, shader_builder::SPIRVDiskCache* disk_cache
+    COMMA_CWDEBUG_ONLY(bool debug)) :
+  AsyncTask(CWDEBUG_ONLY(debug)), m_shader_info(shader_info), m_glsl_source_code(std::move(glsl_source_code)),
+  m_spirv_cache_out(spirv_cache_out), m_disk_cache(disk_cache)
+{
+  DoutEntering(dc::statefultask(mSMDebug), "CompileShader(\"" << shader_info->name() << "\", ..., " << spirv_cache_out << ", " << disk_cache << ") [" << this << "]");
+}
+
+CompileShader::~CompileShader()
+{
+  DoutEntering(dc::statefultask(mSMDebug), "~CompileShader() [" << this << "]");
+}
+
+char const* CompileShader::state_str_impl(state_type run_state) const
+{
+  switch (run_state)
+  {
+    AI_CASE_RETURN(CompileShader_start);
+    AI_CASE_RETURN(CompileShader_lookup);
+    AI_CASE_RETURN(CompileShader_compile);
+    AI_CASE_RETURN(CompileShader_done);
+  }
+  AI_NEVER_REACHED
+}
+
+char const* CompileShader::condition_str_impl(condition_type condition) const
+{
+  switch (condition)
+  {
+    AI_CASE_RETURN(compilation_finished);
+  }
+  return direct_base_type::condition_str_impl(condition);
+}
+
+char const* CompileShader::task_name_impl() const
+{
+  return "CompileShader";
+}
+
+void CompileShader::initialize_impl()
+{
+  set_state(CompileShader_start);
+}
+
+void CompileShader::multiplex_impl(state_type run_state)
+{
+  switch (run_state)
+  {
+    case CompileShader_start:
+      m_key = shader_builder::SPIRVDiskCache::make_key(m_glsl_source_code, *m_shader_info);
+      set_state(CompileShader_lookup);
+      [[fallthrough]];
+    case CompileShader_lookup:
+    {
+      compiled_shaders_t::wat compiled_shaders_w(s_compiled_shaders);
+      if (spirv_code_type compiled = compiled_shaders_w->find(m_key))
+      {
+        Dout(dc::vulkan, "Reusing SPIR-V code of identical shader for \"" << m_shader_info->name() << "\".");
+        m_spirv_cache_out->set_spirv_code({}, *compiled);
+        set_state(CompileShader_done);
+        break;
+      }
+      auto in_flight = compiled_shaders_w->m_in_flight.find(m_key);
+      if (in_flight != compiled_shaders_w->m_in_flight.end())
+      {
+        // Another task is already compiling the same source code. Wait till it is finished and then look again.
+        in_flight->second.emplace_back(this);
+        wait(compilation_finished);
+        break;
+      }
+      // We're going to compile this source code. Let other tasks wait for us.
+      compiled_shaders_w->m_in_flight.try_emplace(m_key);
+      set_state(CompileShader_compile);
+      break;
+    }
+    case CompileShader_compile:
+    {
+      try
+      {
+        m_spirv_cache_out->compile(m_glsl_source_code, thread_local_shader_compiler(), *m_shader_info, m_disk_cache);
+      }
+      catch (AIAlert::Error const& error)
+      {
+        m_error = error;
+      }
+      std::vector<boost::intrusive_ptr<CompileShader>> waiters;
+      {
+        compiled_shaders_t::wat compiled_shaders_w(s_compiled_shaders);
+        if (!m_error)
+          compiled_shaders_w->insert(m_key, std::make_shared<std::vector<uint32_t> const>(m_spirv_cache_out->spirv_code()));
+        auto in_flight = compiled_shaders_w->m_in_flight.find(m_key);
+        waiters = std::move(in_flight->second);
+        compiled_shaders_w->m_in_flight.erase(in_flight);
+      }
+      // Wake up the tasks that were waiting for this compilation.
+      // If compilation failed then they will try (and fail) again themselves.
+      for (auto const& waiter : waiters)
+        waiter->signal(compilation_finished);
+      if (m_error)
+      {
+        Dout(dc::warning, "Failed to compile \"" << m_shader_info->name() << "\": " << *m_error);
+        abort();
+        break;
+      }
+      set_state(CompileShader_done);
+      [[fallthrough]];
+    }
+    case CompileShader_done:
+      finish();
+      break;
+  }
+}
+
+} // namespace vulkan::task
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../AsyncTask.h"
+#include "../shader_builder/SPIRVDiskCache.h"
+#include "threadsafe/threadsafe.h"
+#include "utils/AIAlert.h"
+#include <boost/intrusive_ptr.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "debug.h"
+
+namespace vulkan::shader_builder {
+class ShaderInfo;
+class SPIRVCache;
+} // namespace vulkan::shader_builder
+
+namespace vulkan::task {
+
+// A task that compiles a single, already preprocessed, shader into SPIR-V.
+//
+// AddShaderStage::realize_shaders runs one CompileShader task per shader that still
+// needs compiling on the low priority thread pool queue, so that the shaders of a
+// PipelineFactory are compiled concurrently instead of one after another.
+//
+// Each worker thread uses its own shaderc compiler instance.
+//
+// Identical (source code, compiler options) pairs are normally compiled at most once per
+// application run: the most recently used SPIR-V code is remembered (keyed by the same key
+// as used by SPIRVDiskCache, up to s_max_compiled_bytes; older code is still found in the
+// disk cache) and a CompileShader task that is started while another task is already
+// compiling the same source waits for that task to finish and then uses its result.
+class CompileShader final : public AsyncTask
+{
+ public:
+  static constexpr condition_type compilation_finished = 1;
+
+ private:
+  using spirv_code_type = std::shared_ptr<std::vector<uint32_t> const>;
+
+  static constexpr size_t s_max_compiled_bytes = 16 * 1024 * 1024;   // The maximum total size of the SPIR-V code kept in memory.
+
+  struct CompiledShader
+  {
+    spirv_code_type m_spirv_code;
+    std::list<shader_builder::SPIRVDiskCache::Key>::iterator m_lru_position;   // The position of the key in m_lru.
+  };
+
+  // The most recently used compiled SPIR-V code and the compilations that are currently running.
+  struct UnlockedCompiledShaders
+  {
+    std::map<shader_builder::SPIRVDiskCache::Key, CompiledShader> m_compiled;                                          // SPIR-V code, by key.
+    std::list<shader_builder::SPIRVDiskCache::Key> m_lru;                                                              // The keys of m_compiled, most recently used first.
+    size_t m_compiled_bytes{0};                                                                                        // The total size of the code in m_compiled.
+    std::map<shader_builder::SPIRVDiskCache::Key, std::vector<boost::intrusive_ptr<CompileShader>>> m_in_flight;       // Tasks waiting for a running compilation, by key.
+
+    // Return the code of key, or nullptr if it isn't in memory (anymore).
+    spirv_code_type find(shader_builder::SPIRVDiskCache::Key const& key);
+    // Remember the code of key, forgetting the least recently used code if that becomes too much.
+    void insert(shader_builder::SPIRVDiskCache::Key const& key, spirv_code_type spirv_code);
+  };
+  using compiled_shaders_t = threadsafe::Unlocked<UnlockedCompiledShaders, threadsafe::policy::Primitive<std::mutex>>;
+  static compiled_shaders_t s_compiled_shaders;
+
+  // Constructor.
+  shader_builder::ShaderInfo const* m_shader_info;              // The shader that is being compiled.
+  std::string m_glsl_source_code;                               // The preprocessed source code.
+  shader_builder::SPIRVCache* m_spirv_cache_out;                // Where to store the result.
+  shader_builder::SPIRVDiskCache* m_disk_cache;                 // The on-disk cache to use, or nullptr.
+  // State CompileShader_start.
+  shader_builder::SPIRVDiskCache::Key m_key;
+  // State CompileShader_compile.
+  std::optional<AIAlert::Error> m_error;                        // Set when compilation failed.
+
+ protected:
+  using direct_base_type = AsyncTask;
+
+  // The different states of the task.
+  enum CompileShader_state_type {
+    CompileShader_start = direct_base_type::state_end,
+    CompileShader_lookup,
+    CompileShader_compile,
+    CompileShader_done
+  };
+
+ public:
+  static constexpr state_type state_end = CompileShader_done + 1;
+
+  CompileShader(shader_builder::ShaderInfo const* shader_info, std::string&& glsl_source_code,
+      shader_builder::SPIRVCache* spirv_cache_out, shader_builder::SPIRVDiskCache* disk_cache
+      COMMA_CWDEBUG_ONLY(bool debug = false));
+
+  // Accessor. Only call this after the task finished (aborted).
+  std::optional<AIAlert::Error> const& error() const { return m_error; }
+
+ protected:
+  ~CompileShader() override;
+
+  char const* state_str_impl(state_type run_state) const override;
+  char const* condition_str_impl(condition_type condition) const override;
+  char const* task_name_impl() const override;
+  void initialize_impl() override;
+  void multiplex_impl(state_type run_state) override;
+};
+
+} // namespace vulkan::task
@@ -10,4 +10,10 @@ void FactoryHandle::generate(task::SynchronousWindow const* owning_window)
   owning_window->pipeline_factory(m_factory_index)->generate();
 }
 
+void FactoryHandle::set_number_of_priority_pipelines(task::SynchronousWindow const* owning_window, size_t number_of_priority_pipelines)
+{
+  DoutEntering(dc::vulkan, "pipeline::FactoryHandle::set_number_of_priority_pipelines(" << owning_window << ", " << number_of_priority_pipelines << ")");
+  owning_window->pipeline_factory(m_factory_index)->set_number_of_priority_pipelines(number_of_priority_pipelines);
+}
+
 } // namespace vulkan::pipeline
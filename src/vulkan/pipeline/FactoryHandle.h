@@ -29,6 +29,9 @@ class FactoryHandle
 
   void generate(task::SynchronousWindow const* owning_window);
 
+  // See PipelineFactory::set_number_of_priority_pipelines.
+  void set_number_of_priority_pipelines(task::SynchronousWindow const* owning_window, size_t number_of_priority_pipelines);
+
   friend bool operator==(FactoryHandle h1, FactoryHandle h2)
   {
     return h1.m_factory_index == h2.m_factory_index;
@@ -1,20 +1,17 @@
 #include "sys.h"
 #include "PipelineCache.h"
-#include "PipelineFactory.h"
 #include "LogicalDevice.h"
-#include "Application.h"
-#include "SynchronousWindow.h"
-#include "utils/nearest_multiple_of_power_of_two.h"
-#include "utils/u8string_to_filename.h"
-#include "utils/AIAlert.h"
-#include "debug.h"
-#include <boost/serialization/binary_object.hpp>
-#include <fstream>
-
-#ifdef CWDEBUG
 #include <boost/uuid/uuid_io.hpp>
+#include <farmhash.h>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "debug.h"
 
+#ifdef CWDEBUG
 namespace vk {
 
 std::ostream& operator<<(std::ostream& os, vk::PipelineCacheHeaderVersionOne const& header)
@@ -33,221 +30,197 @@ std::ostream& operator<<(std::ostream& os, vk::PipelineCacheHeaderVersionOne con
 } // namespace vk
 #endif
 
-namespace vulkan::task {
+namespace vulkan::pipeline {
 
-PipelineCache::PipelineCache(PipelineFactory* factory COMMA_CWDEBUG_ONLY(bool debug)) : direct_base_type(CWDEBUG_ONLY(debug)), m_owning_factory(factory)
+namespace {
+
+// The header of the cache file, followed by data_size bytes of pipeline cache data.
+struct FileHeader
 {
-  DoutEntering(dc::statefultask(mSMDebug), "PipelineCache(" << factory << ") [" << this << "]");
-  // We depend on the owning window, but should not be aborted at program termination.
-  // Note: increment() can, theoretically, throw -- but that should never happen in
-  // this case: a PipelineCache is created in PipelineFactory_start, but all PipelineFactory
-  // tasks are aborted before the owning window enters m_task_counter_gate.wait().
-  m_owning_factory->owning_window()->m_task_counter_gate.increment();
-}
+  static constexpr uint32_t s_magic = 0x43504b56;       // "VKPC" (little endian).
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t driver_version;                              // vk::PhysicalDeviceProperties::driverVersion of the device that wrote the file.
+  uint32_t padding;
+  uint64_t data_size;
+  uint64_t checksum;                                    // The Fingerprint64 of the data.
+};
 
-PipelineCache::~PipelineCache()
+} // namespace
+
+void PipelineCache::initialize(LogicalDevice const* logical_device, std::filesystem::path const& directory, bool ignore_existing
+    COMMA_CWDEBUG_ONLY(Ambifix const& ambifix))
 {
-  DoutEntering(dc::statefultask(mSMDebug), "~PipelineCache() [" << this << "]");
-  m_owning_factory->owning_window()->m_task_counter_gate.decrement();
+  DoutEntering(dc::vulkan, "PipelineCache::initialize(" << logical_device << ", " << directory << ", " << std::boolalpha << ignore_existing << ")");
+
+  m_logical_device = logical_device;
+  // One file per physical device; the driver version and pipeline cache UUID are checked by load.
+  m_filename = directory / ("pipeline_cache_" + boost::uuids::to_string(logical_device->get_UUID()));
+
+  std::string data;
+  if (!ignore_existing)
+    data = load();
+  else
+    Dout(dc::vulkan, "Ignoring existing pipeline cache file " << m_filename << " (cold start).");
+
+  vk::PipelineCacheCreateInfo const pipeline_cache_create_info = {
+    .initialDataSize = data.size(),
+    .pInitialData = data.data()
+  };
+  m_pipeline_cache = logical_device->create_pipeline_cache(pipeline_cache_create_info
+      COMMA_CWDEBUG_ONLY(".m_pipeline_cache" + ambifix));
+
+  m_loaded_size = data.size();
+  // Don't write the same data back (unless the existing file was ignored, in which case it must be overwritten).
+  m_saved_size = ignore_existing ? 0 : logical_device->get_pipeline_cache_size(*m_pipeline_cache);
+  m_next_flush = (clock_type::now() + s_flush_interval).time_since_epoch().count();
 }
 
-char const* PipelineCache::condition_str_impl(condition_type condition) const
+std::string PipelineCache::load() const
 {
-  switch (condition)
+  DoutEntering(dc::vulkan, "PipelineCache::load()");
+
+  std::ifstream file(m_filename, std::ios::binary);
+  if (!file)
   {
-    AI_CASE_RETURN(condition_flush_to_disk);
-    AI_CASE_RETURN(factory_finished);
+    Dout(dc::vulkan, "No pipeline cache file " << m_filename << " (cold start).");
+    return {};
   }
-  return direct_base_type::condition_str_impl(condition);
-}
 
-char const* PipelineCache::state_str_impl(state_type run_state) const
-{
-  switch (run_state)
+  vk::PhysicalDeviceProperties const properties = m_logical_device->vh_physical_device().getProperties();
+  char const* reason = nullptr;
+  std::string data;
+  FileHeader file_header;
+  if (!file.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+      file_header.magic != FileHeader::s_magic || file_header.version != file_format_version)
+    reason = "not a pipeline cache file of this version";
+  else if (file_header.driver_version != properties.driverVersion)
+    reason = "driver version mismatch";
+  else if (file_header.data_size < sizeof(vk::PipelineCacheHeaderVersionOne))
+    reason = "truncated";
+  else
+  {
+    data.resize(file_header.data_size);
+    if (!file.read(data.data(), data.size()) || file.peek() != std::ifstream::traits_type::eof())
+      reason = "size mismatch";
+    else if (util::Fingerprint64(data.data(), data.size()) != file_header.checksum)
+      reason = "checksum mismatch";
+    else
+    {
+      // The data must have been written by the same physical device (and driver) that we're using now.
+      vk::PipelineCacheHeaderVersionOne header;
+      std::memcpy(&header, data.data(), sizeof(header));
+      Dout(dc::vulkan, "Pipeline cache data header: " << header);
+      if (header.headerSize < sizeof(header) || header.headerSize > data.size() ||
+          header.headerVersion != vk::PipelineCacheHeaderVersion::eOne)
+        reason = "unsupported pipeline cache header";
+      else if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID ||
+          !std::equal(header.pipelineCacheUUID.begin(), header.pipelineCacheUUID.end(), properties.pipelineCacheUUID.begin()))
+        reason = "pipeline cache header mismatch";
+    }
+  }
+  if (reason)
   {
-    // A complete listing of my_task_state_type.
-    AI_CASE_RETURN(PipelineCache_initialize);
-    AI_CASE_RETURN(PipelineCache_load_from_disk);
-    AI_CASE_RETURN(PipelineCache_ready);
-    AI_CASE_RETURN(PipelineCache_factory_finished);
-    AI_CASE_RETURN(PipelineCache_factory_merge);
-    AI_CASE_RETURN(PipelineCache_save_to_disk);
-    AI_CASE_RETURN(PipelineCache_done);
+    Dout(dc::warning, "Ignoring pipeline cache file " << m_filename << ": " << reason << ".");
+    return {};
   }
-  AI_NEVER_REACHED
-}
 
-char const* PipelineCache::task_name_impl() const
-{
-  return "PipelineCache";
+  Dout(dc::vulkan, "Loaded " << data.size() << " bytes of pipeline cache data from " << m_filename << ".");
+  return data;
 }
 
-std::filesystem::path PipelineCache::get_filename() const
+void PipelineCache::pipeline_created(clock_type::duration creation_time)
 {
-  return Application::instance().path_of(Directory::cache) / utils::u8string_to_filename(u8"pipeline_cache of " + m_owning_factory->owning_window()->pipeline_cache_name());
+  m_pipelines_created.fetch_add(1, std::memory_order::relaxed);
+  m_creation_time.fetch_add(creation_time.count(), std::memory_order::relaxed);
+
+  clock_type::rep const now = clock_type::now().time_since_epoch().count();
+  clock_type::rep next_flush = m_next_flush.load(std::memory_order::relaxed);
+  // Only the thread that succeeds to move m_next_flush forward saves the cache.
+  if (now < next_flush ||
+      !m_next_flush.compare_exchange_strong(next_flush, now + clock_type::duration{s_flush_interval}.count(), std::memory_order::relaxed))
+    return;
+  save();
 }
 
-void PipelineCache::multiplex_impl(state_type run_state)
+void PipelineCache::save()
 {
-  switch (run_state)
+  DoutEntering(dc::vulkan, "PipelineCache::save()");
+
+  if (m_filename.empty() || !m_pipeline_cache)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_save_mutex);
+
+  // The driver only ever adds to the cache, so if the size didn't change then neither did the content.
+  size_t size = m_logical_device->get_pipeline_cache_size(*m_pipeline_cache);
+  if (size == m_saved_size)
+    return;
+
+  // Other threads might be creating pipelines while we get the data, so the size that
+  // we obtained above might already be too small. In that case just try again.
+  std::string buffer;
+  for (;;)
   {
-    case PipelineCache_initialize:
-    {
-      if (!std::filesystem::exists(get_filename()))
-      {
-        vulkan::LogicalDevice const* logical_device(m_owning_factory->owning_window()->logical_device());
-        vk::PipelineCacheCreateInfo pipeline_cache_create_info = {
-          .flags = logical_device->supports_cache_control() ? vk::PipelineCacheCreateFlagBits::eExternallySynchronized : vk::PipelineCacheCreateFlagBits{0},
-          .initialDataSize = 0
-        };
-        m_pipeline_cache = logical_device->create_pipeline_cache(pipeline_cache_create_info
-            COMMA_CWDEBUG_ONLY({"PipelineCache_initialize::m_pipeline_cache", as_postfix(this)}));
-        set_state(PipelineCache_ready);
-        break;
-      }
-      set_state(PipelineCache_load_from_disk);
-      Dout(dc::statefultask(mSMDebug), "Falling through to PipelineCache_load_from_disk [" << this << "]");
-      [[fallthrough]];
-    }
-    case PipelineCache_load_from_disk:
+    buffer.resize(sizeof(FileHeader) + size);
+    if (m_logical_device->get_pipeline_cache_data(*m_pipeline_cache, size, buffer.data() + sizeof(FileHeader)))
+      break;
+    size = m_logical_device->get_pipeline_cache_size(*m_pipeline_cache);
+  }
+  buffer.resize(sizeof(FileHeader) + size);
+  char const* const data = buffer.data() + sizeof(FileHeader);
+
+  FileHeader const file_header{
+    .magic = FileHeader::s_magic,
+    .version = file_format_version,
+    .driver_version = m_logical_device->vh_physical_device().getProperties().driverVersion,
+    .padding = 0,
+    .data_size = size,
+    .checksum = util::Fingerprint64(data, size)
+  };
+  std::memcpy(buffer.data(), &file_header, sizeof(file_header));
+
+  // Write to a temporary file first, so that a crash never leaves a partially written cache behind.
+  std::filesystem::path tmp_filename = m_filename;
+  tmp_filename += ".tmp." + std::to_string(getpid());
+  std::error_code ec;
+  {
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (file)
     {
-      std::ifstream file(get_filename());
-      ASSERT(file);
-      try
-      {
-        boost::archive::binary_iarchive ia(file);
-        //Dout(dc::always|flush_cf, "CALLING ia & *this");
-        ia & *this;
-      }
-      catch (boost::archive::archive_exception const& error)
-      {
-        Dout(dc::warning, "Caught boost::archive::archive_exception \"" << error.what() << "\" while trying to load " << get_filename() << ". Removing.");
-        std::error_code ec;
-        int exists = std::filesystem::remove(get_filename(), ec);
-        if (ec)
-          THROW_ALERTC(ec, "Failed to load (invalid?) pipeline cache file [FILENAME] ([ARERR]) and then failed to remove that file! Please remove it yourself",
-              AIArgs("[FILENAME]", get_filename())("[ARERR]", error.what()));
-        // Paranoia check: we should never get in state PipelineCache_load_from_disk when it doesn't exist?!
-        ASSERT(exists);
-        yield();        // Must yield to avoid an assert because PipelineCache_initialize did fallthrough to this state.
-        set_state(PipelineCache_initialize);
-        break;
-      }
-      set_state(PipelineCache_ready);
-      Dout(dc::statefultask(mSMDebug), "Falling through to PipelineCache_ready [" << this << "]");
-      [[fallthrough]];
+      file.write(buffer.data(), buffer.size());
+      file.close();
     }
-    case PipelineCache_ready:
-      // Paranoia check: ready means we have a pipeline cache.
-      ASSERT(m_pipeline_cache);
-      m_owning_factory->signal(PipelineFactory::pipeline_cache_set_up);
-      set_state(PipelineCache_factory_finished);
-      wait(factory_finished);
-      break;
-    case PipelineCache_factory_finished:
-      if (!m_is_merger)
-      {
-        set_state(PipelineCache_done);
-        break;
-      }
-      set_state(PipelineCache_factory_merge);
-      Dout(dc::statefultask(mSMDebug), "Falling through to PipelineCache_merge [" << this << "]");
-      [[fallthrough]];
-    case PipelineCache_factory_merge:
-      {
-        std::vector<vk::UniquePipelineCache> srcs;
-        std::vector<vk::PipelineCache> vhv_srcs;
-        // Copy over all pipeline caches. Also preserve the unique handle to keep the pipeline cache alive
-        // until the end of scope (after which it was merged).
-        flush_new_data([&](vk::UniquePipelineCache&& pipeline_cache){
-          vhv_srcs.push_back(*pipeline_cache);
-          srcs.push_back(std::move(pipeline_cache));
-        });
-        if (!vhv_srcs.empty())
-        {
-          Dout(dc::vulkan, "Merging " << vhv_srcs << " into " << *m_pipeline_cache);
-          vulkan::LogicalDevice const* logical_device(m_owning_factory->owning_window()->logical_device());
-          logical_device->merge_pipeline_caches(*m_pipeline_cache, vhv_srcs);
-        }
-      }
-      if (producer_not_finished())
-        break;
-      set_state(PipelineCache_save_to_disk);
-      Dout(dc::statefultask(mSMDebug), "Falling through to PipelineCache_save_to_disk [" << this << "]");
-      [[fallthrough]];
-    case PipelineCache_save_to_disk:
+    if (!file)
     {
-      if (m_pipeline_cache)     // Should always be true - but see ASSERT in PipelineCache::save.
-      {
-        std::ofstream file(get_filename());
-        boost::archive::binary_oarchive oa(file);
-        oa & *this;
-      }
-      else
-        Dout(dc::warning, "Not saving pipeline cache because m_pipeline_cache is nul?!");
-      set_state(PipelineCache_done);
-      Dout(dc::statefultask(mSMDebug), "Falling through to PipelineCache_done [" << this << "]");
-      [[fallthrough]];
+      Dout(dc::warning, "Failed to write pipeline cache file " << tmp_filename << ".");
+      std::filesystem::remove(tmp_filename, ec);
+      return;
     }
-    case PipelineCache_done:
-      clear_cache();
-      finish();
-      break;
   }
+  std::filesystem::rename(tmp_filename, m_filename, ec);
+  if (ec)
+  {
+    Dout(dc::warning, "Failed to rename " << tmp_filename << " to " << m_filename << ": " << ec.message());
+    std::filesystem::remove(tmp_filename, ec);
+    return;
+  }
+  m_saved_size = size;
+  m_saves.fetch_add(1, std::memory_order::relaxed);
+  Dout(dc::vulkan, "Wrote " << size << " bytes of pipeline cache data to " << m_filename << ".");
 }
 
-void PipelineCache::clear_cache()
-{
-  DoutEntering(dc::vulkan, "PipelineCache::clear_cache() [" << this << "]");
-  m_pipeline_cache.reset();
-}
-
-void PipelineCache::load(boost::archive::binary_iarchive& archive, unsigned int const version)
-{
-  DoutEntering(dc::vulkan, "PipelineCache::load(archive, " << version << ") [" << this << "]");
-  size_t size;
-  archive & size;
-  void* tmp_storage = std::aligned_alloc(
-      alignof(vk::PipelineCacheHeaderVersionOne),
-      utils::nearest_multiple_of_power_of_two(size, alignof(vk::PipelineCacheHeaderVersionOne)));
-  archive & make_nvp("pipeline_cache", boost::serialization::make_binary_object(tmp_storage, size));
-  vk::PipelineCacheHeaderVersionOne const* header = static_cast<vk::PipelineCacheHeaderVersionOne const*>(tmp_storage);
-  Dout(dc::vulkan, "Read " << size << " bytes from pipeline cache, with header: " << *header);
-  vulkan::LogicalDevice const* logical_device(m_owning_factory->owning_window()->logical_device());
-  vk::PipelineCacheCreateInfo pipeline_cache_create_info = {
-    .flags = logical_device->supports_cache_control() ? vk::PipelineCacheCreateFlagBits::eExternallySynchronized : vk::PipelineCacheCreateFlagBits{0},
-    .initialDataSize = size,
-    .pInitialData = tmp_storage
-  };
-  m_pipeline_cache = logical_device->create_pipeline_cache(pipeline_cache_create_info
-      COMMA_CWDEBUG_ONLY({"PipelineCache::m_pipeline_cache", as_postfix(this)}));
-  free(tmp_storage);
-}
-
-void PipelineCache::save(boost::archive::binary_oarchive& archive, unsigned int const version) const
+void PipelineCache::print_on(std::ostream& os) const
 {
-  DoutEntering(dc::vulkan, "PipelineCache::save(archive, " << version << ") [" << this << "]");
-  size_t size;
-  vk::PipelineCache vh_pipeline_cache = *m_pipeline_cache;
-  // Don't call `oa & *this` (state PipelineCache_save_to_disk) when we don't have a handle:
-  // that would truncate the cache file since we can't write to it and worse, make it unloadable.
-  // This assert is put before the throw because it is a program error and should be fixed before a Release.
-  ASSERT(vh_pipeline_cache);
-  // However - a release doesn't have asserts. In this case I want to do something better than just crash
-  // below; if this inadvertently would still happen.
-  if (!vh_pipeline_cache)
-    THROW_FALERT("The pipeline cache handle is nul.");
-  vulkan::LogicalDevice const* logical_device(m_owning_factory->owning_window()->logical_device());
-  size = logical_device->get_pipeline_cache_size(vh_pipeline_cache);
-  void* tmp_storage = std::aligned_alloc(
-      alignof(vk::PipelineCacheHeaderVersionOne),
-      utils::nearest_multiple_of_power_of_two(size, alignof(vk::PipelineCacheHeaderVersionOne)));
-  logical_device->get_pipeline_cache_data(vh_pipeline_cache, size, tmp_storage);
-  archive & size;
-  archive & make_nvp("pipeline_cache", boost::serialization::make_binary_object(tmp_storage, size));
-  vk::PipelineCacheHeaderVersionOne const* header = static_cast<vk::PipelineCacheHeaderVersionOne const*>(tmp_storage);
-  Dout(dc::vulkan, "Wrote " << size << " bytes to pipeline cache, with header: " << *header);
-  free(tmp_storage);
+  size_t const pipelines = pipelines_created();
+  double const creation_time_ms = std::chrono::duration<double, std::milli>(creation_time()).count();
+  os << "{warm:" << std::boolalpha << is_warm() <<
+      ", loaded_bytes:" << m_loaded_size <<
+      ", pipelines:" << pipelines <<
+      ", creation_time_ms:" << creation_time_ms <<
+      ", mean_creation_time_ms:" << (pipelines == 0 ? 0.0 : creation_time_ms / pipelines) <<
+      ", saves:" << m_saves.load(std::memory_order::relaxed) << '}';
 }
 
-} // namespace vulkan::task
+} // namespace vulkan::pipeline
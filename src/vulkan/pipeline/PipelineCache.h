@@ -1,101 +1,95 @@
 #pragma once
 
-#ifndef PIPELINE_PIPELINE_CACHE_H
-#define PIPELINE_PIPELINE_CACHE_H
-
-#include "../vk_utils/TaskToTaskDeque.h"
-#include "statefultask/AIStatefulTask.h"
-#include "threadsafe/threadsafe.h"
-#include "utils/nearest_multiple_of_power_of_two.h"
-#include "utils/ulong_to_base.h"
-#include <boost/serialization/serialization.hpp>
-#include <boost/archive/binary_iarchive.hpp>
-#include <boost/archive/binary_oarchive.hpp>
+#include "utils/has_print_on.h"
 #include <vulkan/vulkan.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
-#include <cstdlib>
+#include <iosfwd>
+#include <mutex>
+#include <string>
 #ifdef CWDEBUG
 #include "../debug/DebugSetName.h"
 #endif
 #include "debug.h"
 
-namespace vulkan::task {
-
-class PipelineFactory;
-
-class PipelineCache : public vk_utils::TaskToTaskDeque<AIStatefulTask, vk::UniquePipelineCache> // Other PipelineCache tasks can pass their pipeline cache for merging.
+namespace vulkan {
+class LogicalDevice;
+
+namespace pipeline {
+using utils::has_print_on::operator<<;
+
+// The pipeline cache of a LogicalDevice, shared by all PipelineFactory tasks that create pipelines for it.
+//
+// The cache is loaded once, by initialize (called from LogicalDevice::prepare), from a file in
+// Directory::cache whose name contains the device UUID of the physical device. The file starts with
+// a FileHeader (see PipelineCache.cxx) that stores, amongst others, the driver version and a checksum
+// of the pipeline cache data that follows it. The data itself starts with a vk::PipelineCacheHeaderVersionOne
+// that is checked against the properties of the physical device before the data is passed to the driver;
+// a file that was written by a different device, driver or version of this code is ignored (and later
+// overwritten).
+//
+// The vk::PipelineCache is created without eExternallySynchronized, so that all factories can use it
+// concurrently. Pipelines created by one factory (or window) therefore immediately benefit those created
+// by another, and there is nothing to merge afterwards.
+//
+// The cache is written back to disk by save: periodically (at most once per s_flush_interval) from
+// pipeline_created, when a PipelineFactory is done and at program termination. Data is first written to
+// a temporary file that is then renamed, so that a crash never leaves a partially written cache behind.
+//
+// All public member functions, except initialize, are thread-safe.
+class PipelineCache
 {
  public:
-  static constexpr condition_type condition_flush_to_disk = 2;
-  static constexpr condition_type factory_finished = 4;
+  using clock_type = std::chrono::steady_clock;
+
+  static constexpr uint32_t file_format_version = 1;
+  static constexpr std::chrono::seconds s_flush_interval{10};
 
  private:
-  // Constructor.
-  boost::intrusive_ptr<PipelineFactory> m_owning_factory; // We have one pipeline cache per factory - or each factory would still be
-                                                                // slowed down as a result of concurrent accesses to the cache.
-                                                                // This is a intrusive_ptr because the PipelineFactory might finish before this task.
-  // State PipelineCache_load_from_disk.
+  LogicalDevice const* m_logical_device{};
+  std::filesystem::path m_filename;                     // The file that the cache is stored in. Empty when persistence is disabled.
   vk::UniquePipelineCache m_pipeline_cache;
+  size_t m_loaded_size{0};                              // The size of the pipeline cache data that was loaded from disk (zero on a cold start).
 
-  bool m_is_merger = false;
+  std::mutex m_save_mutex;                              // Serializes calls to save.
+  size_t m_saved_size{0};                               // The size of the pipeline cache data at the last load/save. Protected by m_save_mutex.
+  std::atomic<clock_type::rep> m_next_flush{0};         // The time_since_epoch of the earliest time at which pipeline_created calls save again.
 
- protected:
-  // The different states of the stateful task.
-  enum PipelineCache_state_type {
-    PipelineCache_initialize = direct_base_type::state_end,
-    PipelineCache_load_from_disk,
-    PipelineCache_ready,
-    PipelineCache_factory_finished,
-    PipelineCache_factory_merge,
-    PipelineCache_save_to_disk,
-    PipelineCache_done,
-  };
+  // Statistics.
+  std::atomic<size_t> m_pipelines_created{0};           // Number of calls to pipeline_created.
+  std::atomic<clock_type::rep> m_creation_time{0};      // The sum of the durations passed to pipeline_created.
+  std::atomic<size_t> m_saves{0};                       // Number of times the cache was written to disk.
 
  public:
-  // One beyond the largest state of this task.
-  static constexpr state_type state_end = PipelineCache_done + 1;
-
-  // Called by Application::pipeline_factory_done.
-  void set_is_merger() { m_is_merger = true; }
+  // Load the pipeline cache of logical_device from directory (unless ignore_existing is set) and create m_pipeline_cache.
+  void initialize(LogicalDevice const* logical_device, std::filesystem::path const& directory, bool ignore_existing
+      COMMA_CWDEBUG_ONLY(Ambifix const& ambifix));
 
- protected:
-  // boost::serialization::access has a destroy function that want to call operator delete on us. Of course, we will never call destroy.
-  friend class boost::serialization::access;
-  ~PipelineCache() override;                    // Call finish(), not delete.
-
-  // Implementation of virtual functions of AIStatefulTask.
-  char const* condition_str_impl(condition_type condition) const override;
-  char const* state_str_impl(state_type run_state) const override;
-  char const* task_name_impl() const override;
-  void multiplex_impl(state_type run_state) override;
-
-#ifdef CWDEBUG
-  void abort_impl() final
-  {
-    // A PipelineCache should not be aborted; it should write to disk at program termination.
-    ASSERT(false);
-  }
-#endif
-
- public:
-  PipelineCache(PipelineFactory* factory COMMA_CWDEBUG_ONLY(bool debug = false));
+  // Accessor for the pipeline cache. Pass this to every vkCreate*Pipelines call.
+  vk::PipelineCache vh_pipeline_cache() const { return *m_pipeline_cache; }
 
-  std::filesystem::path get_filename() const;
+  // Called after a pipeline was created with vh_pipeline_cache(), passing the time that took.
+  // Writes the cache to disk when the last time that happened is longer than s_flush_interval ago.
+  void pipeline_created(clock_type::duration creation_time);
 
-  void clear_cache();
+  // Write the cache to disk if it changed.
+  void save();
 
-  void load(boost::archive::binary_iarchive& archive, unsigned int const version);
-  void save(boost::archive::binary_oarchive& archive, unsigned int const version) const;
+  // Statistics.
+  bool is_warm() const { return m_loaded_size > 0; }
+  size_t loaded_size() const { return m_loaded_size; }
+  size_t pipelines_created() const { return m_pipelines_created.load(std::memory_order::relaxed); }
+  clock_type::duration creation_time() const { return clock_type::duration{m_creation_time.load(std::memory_order::relaxed)}; }
 
-  // Accessor for the create pipeline cache.
-  vk::PipelineCache vh_pipeline_cache() const { return *m_pipeline_cache; }
+  // Print the statistics.
+  void print_on(std::ostream& os) const;
 
-  // Rescue pipeline cache just before deleting this task. Called by Application::pipeline_factory_done.
-  vk::UniquePipelineCache detach_pipeline_cache() { return std::move(m_pipeline_cache); }
-
-  BOOST_SERIALIZATION_SPLIT_MEMBER()
+ private:
+  // Return the pipeline cache data read from m_filename if it is valid for m_logical_device, otherwise return an empty string.
+  std::string load() const;
 };
 
-} // namespace vulkan::task
-
-#endif // PIPELINE_PIPELINE_CACHE_H
+} // namespace pipeline
+} // namespace vulkan
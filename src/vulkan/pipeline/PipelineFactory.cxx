@@ -1,13 +1,13 @@
 #include "sys.h"
 #include "PipelineFactory.h"
-#include "PipelineCache.h"
 #include "Handle.h"
 #include "SynchronousWindow.h"
 #include "SynchronousTask.h"
 #include "AddShaderStage.h"
 #include "partitions/PartitionTask.h"
 #include "partitions/ElementPair.h"
-#include "partitions/PartitionIteratorExplode.h"
+#include "partitions/PartitionOptimizer.h"
+#include "partitions/PartitionCache.h"
 #include "shader_builder/shader_resource/CombinedImageSampler.h"
 #include "shader_builder/shader_resource/UniformBuffer.h"
 #include "vk_utils/TaskToTaskDeque.h"
@@ -251,7 +251,6 @@ char const* PipelineFactory::condition_str_impl(condition_type condition) const
 {
   switch (condition)
   {
-    AI_CASE_RETURN(pipeline_cache_set_up);
     AI_CASE_RETURN(fully_initialized);
     AI_CASE_RETURN(characteristics_initialized);
     AI_CASE_RETURN(characteristics_filled);
@@ -268,7 +267,6 @@ char const* PipelineFactory::state_str_impl(state_type run_state) const
 {
   switch (run_state)
   {
-    AI_CASE_RETURN(PipelineFactory_start);
     AI_CASE_RETURN(PipelineFactory_initialize);
     AI_CASE_RETURN(PipelineFactory_initialized);
     AI_CASE_RETURN(PipelineFactory_characteristics_initialized);
@@ -453,64 +451,33 @@ void PipelineFactory::fill_set_index_hints(added_shader_resource_plus_characteri
 
   partition_task.initialize_set23_to_score();
 
-  Score best_score(negative_inf);
-  Partition best_partition;
-  int best_rp = 0;
-  int best_count = 0;
-  //
-  // 500 : { ... }
-  // 503 : { ... }
-  // 510 : { ... }
-  // 550 : { ... }
-  // 553 : { ... }
-  // 553 : { ... }
-  //
-  //
-  //
-  //
-  //
-  //
-  for (int rp = 0; rp < 1000; ++rp)
+  // Identical sets of shader resources with identical preferences recur often; look up
+  // the result of a previous search (possibly from a previous run) first.
+  PartitionCache& partition_cache = m_owning_window->application().partition_cache();
+  PartitionCache::canonical_order_type canonical_order;
+  PartitionCache::Key const partition_cache_key = PartitionCache::make_key(partition_task, canonical_order);
+  PartitionCache::set_indexes_type set_indexes;
+  if (!partition_cache.lookup(partition_cache_key, canonical_order, set_indexes) || set_indexes.size() != static_cast<size_t>(number_of_elements))
   {
-    Partition partition = partition_task.random();
-    Score score = partition.find_local_maximum(partition_task);
-    int count = 0;
-    for (PartitionIteratorExplode explode = partition.sbegin(partition_task); !explode.is_end(); ++explode)
-    {
-      Partition partition2 = explode.get_partition(partition_task);
-      Score score2 = partition2.find_local_maximum(partition_task);
-      if (score2 > score)
-      {
-        partition = partition2;
-        score = score2;
-      }
-      if (++count == PartitionIteratorExplode::total_loop_count_limit)
-        break;
-    }
-    if (score > best_score)
-    {
-      best_partition = partition;
-      best_score = score;
-      best_rp = rp;
-      best_count = 1;
-    }
-    else if (score.unchanged(best_score))
-      ++best_count;
-    // Stop when the chance to have missed the best score until now would have been less than 1%, but no
-    // sooner than after 20 attempts and only if the last half of all attempts didn't give an improvement.
-    if (rp > std::max(20, 2 * best_rp) && std::exp(rp * std::log(static_cast<double>(rp - best_count) / rp)) < 0.01)
-      break;
+    // Find the best partition: exhaustively if the number of shader resources is small, otherwise
+    // using a fixed number of seeded simulated annealing runs (so that the result is reproducible).
+    PartitionOptimizer partition_optimizer(partition_task);
+    Partition best_partition = partition_optimizer.optimize().m_partition;
+    set_indexes.clear();
+    for (ElementIndex element_index = partition_task.ibegin(); element_index != partition_task.iend(); ++element_index)
+      set_indexes.push_back(best_partition.set_of(element_index).get_value());
+    partition_cache.insert(partition_cache_key, canonical_order, set_indexes);
   }
+  else
+    Dout(dc::setindexhint(mSMDebug), "Using cached partition.");
 
   // Run over all required shader resources.
   set_index_hints_out.reserve(added_shader_resource_plus_characteristic_list_r->size());
   for (pipeline::ShaderResourcePlusCharacteristicIndex shader_resource_plus_characteristic_index = added_shader_resource_plus_characteristic_list_r->ibegin();
       shader_resource_plus_characteristic_index != added_shader_resource_plus_characteristic_list_r->iend(); ++shader_resource_plus_characteristic_index)
   {
-    // partitions::ElementIndex is equivalent to ShaderResourcePlusCharacteristicIndex.
-    ElementIndex element_index{ElementIndexPOD{static_cast<int8_t>(shader_resource_plus_characteristic_index.get_value())}};
-    // partitions::SetIndex is equivalent to SetIndexHint.
-    set_index_hints_out.push_back(descriptor::SetIndexHint{static_cast<size_t>(best_partition.set_of(element_index))});
+    // partitions::SetIndex is equivalent to SetIndexHint; the set_indexes are in the order of ShaderResourcePlusCharacteristicIndex.
+    set_index_hints_out.push_back(descriptor::SetIndexHint{static_cast<size_t>(set_indexes[shader_resource_plus_characteristic_index.get_value()])});
   }
 
   Dout(dc::finish, set_index_hints_out << ") [" << this << "]");
@@ -583,17 +550,6 @@ void PipelineFactory::multiplex_impl(state_type run_state)
   {
     switch (run_state)
     {
-      case PipelineFactory_start:
-      {
-        // Create our task::PipelineCache object.
-        m_pipeline_cache_task = statefultask::create<PipelineCache>(this
-            COMMA_CWDEBUG_ONLY(vulkan::Application::instance().debug_PipelineCache() && mSMDebug));
-        m_pipeline_cache_task->run(vulkan::Application::instance().low_priority_queue(), this, pipeline_cache_set_up);
-        // Wait until the pipeline cache is ready, then continue with PipelineFactory_initialize.
-        set_state(PipelineFactory_initialize);
-        wait(pipeline_cache_set_up);
-        return;
-      }
       case PipelineFactory_initialize:
         // Start a synchronous task that will be run when this task, that runs asynchronously, created a new pipeline and/or is finished.
         DEBUG_ONLY(m_debug_reached_characteristics_initialized = false);
@@ -607,6 +563,9 @@ void PipelineFactory::multiplex_impl(state_type run_state)
       {
         // Do not use an empty factory - it makes no sense.
         ASSERT(!m_characteristics.empty());
+        // A factory without priority pipelines runs in the background from the start.
+        if (m_number_of_priority_pipelines == 0)
+          target(vulkan::Application::instance().low_priority_queue());
         size_t const number_of_characteristic_range_tasks = m_characteristics.size();
         m_range_shift.resize(number_of_characteristic_range_tasks);
         // The number of characteristic tasks that we need to wait for finishing initialization.
@@ -796,7 +755,7 @@ void PipelineFactory::multiplex_impl(state_type run_state)
           // Realize (create or get from cache) the pipeline layout and return a suitable SetIndexHintMap.
           m_vh_pipeline_layout = m_owning_window->logical_device()->realize_pipeline_layout(
               threadsafe::wat_cast(sorted_descriptor_set_layouts_r),
-              m_largest_set_index_hint, m_set_index_hint_map1, sorted_push_constant_ranges);
+              m_largest_set_index_hint, m_set_index_hint_map1, sorted_push_constant_ranges, m_use_bindless_texture_table);
         }
 
         // Now that we have (re)initialized m_set_index_hint_map1, run the code that needs it.
@@ -962,9 +921,15 @@ void PipelineFactory::multiplex_impl(state_type run_state)
 #endif
 
           // Create and then store the graphics pipeline.
-          m_pipeline = m_owning_window->logical_device()->create_graphics_pipeline(
-              m_pipeline_cache_task->vh_pipeline_cache(), pipeline_create_info
-              COMMA_CWDEBUG_ONLY(m_owning_window->debug_name_prefix("PipelineFactory::m_pipeline")));
+          {
+            vulkan::LogicalDevice const* logical_device = m_owning_window->logical_device();
+            vulkan::pipeline::PipelineCache& pipeline_cache = logical_device->pipeline_cache();
+            auto const start = vulkan::pipeline::PipelineCache::clock_type::now();
+            m_pipeline = logical_device->create_graphics_pipeline(
+                pipeline_cache.vh_pipeline_cache(), pipeline_create_info
+                COMMA_CWDEBUG_ONLY(m_owning_window->debug_name_prefix("PipelineFactory::m_pipeline")));
+            pipeline_cache.pipeline_created(vulkan::pipeline::PipelineCache::clock_type::now() - start);
+          }
 
 #if CW_DEBUG
           // Reset these in order to avoid an assert in FlatCreateInfo::get_pipeline_color_blend_attachment_states.
@@ -989,6 +954,9 @@ void PipelineFactory::multiplex_impl(state_type run_state)
                              m_owning_window->number_of_frame_resources()
                              COMMA_CWDEBUG_ONLY(m_owning_window->logical_device())},
             std::move(m_pipeline)});
+        // The first pipelines are needed to render the first frame(s); create the remaining ones in the background.
+        if (++m_number_of_moved_pipelines == m_number_of_priority_pipelines)
+          target(vulkan::Application::instance().low_priority_queue());
 
         //
         // End of MultiLoop inner loop.
@@ -1045,6 +1013,8 @@ multiloop_magic_footer:
         Dout(dc::statefultask(mSMDebug), "Falling through to PipelineFactory_done [" << this << "]");
         [[fallthrough]];
       case PipelineFactory_done:
+        // Write the new pipelines to disk now, rather than waiting for the next periodic flush.
+        m_owning_window->logical_device()->pipeline_cache().save();
         finish();
         return;
     }
@@ -1620,7 +1590,7 @@ void PipelineFactory::allocate_update_add_handles_and_unlocking(
     missing_descriptor_sets = logical_device->allocate_descriptor_sets(
         m_owning_window->number_of_frame_resources(),
         missing_descriptor_set_layouts, missing_descriptor_set_unbounded_descriptor_array_sizes,
-        set_index_has_frame_resource_pairs, logical_device->get_descriptor_pool()
+        set_index_has_frame_resource_pairs
         COMMA_CWDEBUG_ONLY(Ambifix{"PipelineFactory::m_descriptor_set_per_set_index", as_postfix(this)}));
            // Note: the debug name is changed when copying this vector to the Pipeline it will be used with.
   // Idem.
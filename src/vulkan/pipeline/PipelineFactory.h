@@ -25,7 +25,6 @@ class LogicalDevice;
 
 namespace task {
 class CombinedImageSamplerUpdater;
-class PipelineCache;
 class CharacteristicRange;
 } // namespace task
 
@@ -53,7 +52,6 @@ class PipelineFactory : public AIStatefulTask
   // The same as CharacteristicRange::pipeline_index_t.
   using pipeline_index_t = threadsafe::Unlocked<pipeline::Index, threadsafe::policy::Primitive<std::mutex>>;
 
-  static constexpr condition_type pipeline_cache_set_up = 0x1;
   static constexpr condition_type fully_initialized = 0x2;
   static constexpr condition_type characteristics_initialized = 0x4;
   static constexpr condition_type characteristics_filled = 0x8;
@@ -75,8 +73,6 @@ class PipelineFactory : public AIStatefulTask
   // run
   // initialize_impl.
   statefultask::RunningTasksTracker::index_type m_index;
-  // State PipelineFactory_start.
-  boost::intrusive_ptr<PipelineCache> m_pipeline_cache_task;
   // State PipelineFactory_initialize.
   boost::intrusive_ptr<synchronous::MoveNewPipelines> m_move_new_pipelines_synchronously;
   // State PipelineFactory_initialized.
@@ -106,6 +102,11 @@ class PipelineFactory : public AIStatefulTask
   Pipeline& m_pipeline_out;
   // Index into SynchronousWindow::m_pipelines, enumerating the current pipeline being generated inside the MultiLoop.
   pipeline_index_t m_pipeline_index;
+  // The number of pipelines, in the order of the MultiLoop, that are created on the medium priority queue (see set_number_of_priority_pipelines).
+  size_t m_number_of_priority_pipelines{1};
+  bool m_use_bindless_texture_table{false};             // Set if the pipeline layouts must include the bindless texture table (see use_bindless_texture_table).
+  // The number of pipelines that were passed to the SynchronousWindow so far.
+  size_t m_number_of_moved_pipelines{0};
   // Layout of the current pipeline that is being created inside the MultiLoop.
   vk::PipelineLayout m_vh_pipeline_layout;
   // Set to true when calling update_missing_descriptor_sets while already having the set_layout_binding lock for the current pipeline/set_index/first_shader_resource.
@@ -275,8 +276,7 @@ class PipelineFactory : public AIStatefulTask
 
   // The different states of the task.
   enum PipelineFactory_state_type {
-    PipelineFactory_start = direct_base_type::state_end,
-    PipelineFactory_initialize,
+    PipelineFactory_initialize = direct_base_type::state_end,
     PipelineFactory_initialized,
     PipelineFactory_characteristics_initialized,
     PipelineFactory_top_multiloop_for_loop,
@@ -321,6 +321,16 @@ class PipelineFactory : public AIStatefulTask
 
   pipeline::FactoryCharacteristicId add_characteristic(boost::intrusive_ptr<CharacteristicRange> characteristic_range);
   void generate() { signal(fully_initialized); }
+  // The first number_of_priority_pipelines pipelines (default 1) are generated with the same priority as the
+  // render loop of the window, the rest in the background on the low priority queue. The MultiLoop starts with
+  // every characteristic at its ibegin(), so a window should give that index to the variant that it draws first.
+  // Must be called before generate().
+  void set_number_of_priority_pipelines(size_t number_of_priority_pipelines) { m_number_of_priority_pipelines = number_of_priority_pipelines; }
+  // Add the layout of the bindless texture table of the logical device at set index descriptor::BindlessTextureTable::s_set_index
+  // to the layouts of all pipelines of this factory. The shaders can then use the textures registered with Texture::register_bindless,
+  // after binding the table with descriptor::BindlessTextureTable::bind. Only call this when LogicalDevice::supports_bindless_textures()
+  // returns true. Must be called before generate().
+  void use_bindless_texture_table() { m_use_bindless_texture_table = true; }
   void set_index(PipelineFactoryIndex pipeline_factory_index) { m_pipeline_factory_index = pipeline_factory_index; }
   void set_pipeline(Pipeline&& pipeline) { m_pipeline_out = std::move(pipeline); }
   characteristics_container_t const& characteristics() const { return m_characteristics; }
@@ -333,30 +343,8 @@ class PipelineFactory : public AIStatefulTask
   void characteristic_range_compiled();
   void descriptor_set_update_start();
   void descriptor_set_updated();
-
-  // Called by SynchronousWindow::pipeline_factory_done to rescue the cache, immediately before deleting this task.
-  inline boost::intrusive_ptr<PipelineCache> detach_pipeline_cache_task();
 };
 
 } // namespace task
 } // namespace vulkan
 #endif // PIPELINE_PIPELINE_FACTORY_H
-
-#ifndef PIPELINE_PIPELINE_CACHE_H
-#include "PipelineCache.h"
-#endif
-
-// Define inlined functions that use PipelineCache (see https://stackoverflow.com/a/71470522/1487069).
-#ifndef PIPELINE_PIPELINE_FACTORY_H_definitions
-#define PIPELINE_PIPELINE_FACTORY_H_definitions
-
-namespace vulkan::task {
-
-boost::intrusive_ptr<PipelineCache> PipelineFactory::detach_pipeline_cache_task()
-{
-  return std::move(m_pipeline_cache_task);
-}
-
-} // namespace vulkan::task
-
-#endif // PIPELINE_PIPELINE_FACTORY_H_definitions
@@ -0,0 +1,285 @@
+#include "sys.h"
+#include "PartitionCache.h"
+#include "PartitionTask.h"
+#include "ElementPair.h"
+#include <farmhash.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <unistd.h>
+#include "debug.h"
+
+namespace vulkan::pipeline::partitions {
+
+namespace {
+
+// The header of the cache file.
+struct FileHeader
+{
+  static constexpr uint32_t s_magic = 0x43544150;       // "PATC" (little endian).
+
+  uint32_t magic;
+  uint32_t version;
+  uint64_t number_of_entries;
+};
+
+// The header of each entry, followed by number_of_elements set indexes.
+struct EntryHeader
+{
+  uint64_t key_low;
+  uint64_t key_high;
+  uint64_t number_of_elements;
+};
+
+template<typename T>
+void append(std::string& buffer, T const& value)
+{
+  buffer.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+// A totally ordered representation of a pair score. Pair scores are either finite, +inf or -inf.
+using score_token_type = std::tuple<char, double>;
+
+score_token_type score_token(PartitionTask const& partition_task, int e1, int e2)
+{
+  Score const& score = partition_task.score(ElementPair{ElementIndex{ElementIndexPOD{static_cast<int8_t>(e1)}},
+                                                        ElementIndex{ElementIndexPOD{static_cast<int8_t>(e2)}}}.score_index());
+  if (!score.is_infinite())
+    return {'f', score.value()};
+  return {score.is_positive_inf() ? '+' : '-', 0.0};
+}
+
+// Refine the classes of the elements until the number of classes no longer grows: each element gets a signature
+// consisting of its class and the sorted list of (pair score, class of the other element) for all other elements,
+// and the classes are renumbered by sorted signature. Returns the new number of classes.
+int refine_classes(std::vector<score_token_type> const& scores, int n, std::vector<int>& element_class, int number_of_classes)
+{
+  using signature_type = std::tuple<int, std::vector<std::tuple<score_token_type, int>>>;
+  std::vector<signature_type> signatures(n);
+  while (number_of_classes < n)
+  {
+    for (int e1 = 0; e1 < n; ++e1)
+    {
+      auto& [own_class, neighbors] = signatures[e1];
+      own_class = element_class[e1];
+      neighbors.clear();
+      for (int e2 = 0; e2 < n; ++e2)
+        if (e2 != e1)
+          neighbors.emplace_back(scores[e1 * n + e2], element_class[e2]);
+      std::sort(neighbors.begin(), neighbors.end());
+    }
+    std::vector<signature_type> sorted_signatures(signatures);
+    std::sort(sorted_signatures.begin(), sorted_signatures.end());
+    sorted_signatures.erase(std::unique(sorted_signatures.begin(), sorted_signatures.end()), sorted_signatures.end());
+    for (int e = 0; e < n; ++e)
+      element_class[e] = std::lower_bound(sorted_signatures.begin(), sorted_signatures.end(), signatures[e]) - sorted_signatures.begin();
+    if (static_cast<int>(sorted_signatures.size()) == number_of_classes)
+      break;
+    number_of_classes = sorted_signatures.size();
+  }
+  return number_of_classes;
+}
+
+// Return the elements of partition_task in an order that does not depend on the original order of the elements.
+//
+// The elements are divided into classes by color refinement (see refine_classes). As long as there are
+// elements that share a class, the first element of the first such class is given a class of its own and
+// the classes are refined again. Such elements have the same scores towards every class, so in practice
+// they are interchangeable and it doesn't matter which one is picked.
+PartitionCache::canonical_order_type canonical_order(PartitionTask const& partition_task)
+{
+  int const n = partition_task.number_of_elements();
+  std::vector<score_token_type> scores(n * n);
+  for (int e1 = 0; e1 < n; ++e1)
+    for (int e2 = e1 + 1; e2 < n; ++e2)
+      scores[e1 * n + e2] = scores[e2 * n + e1] = score_token(partition_task, e1, e2);
+
+  std::vector<int> element_class(n, 0);
+  int number_of_classes = refine_classes(scores, n, element_class, 1);
+  while (number_of_classes < n)
+  {
+    std::vector<int> class_size(number_of_classes, 0);
+    for (int e = 0; e < n; ++e)
+      ++class_size[element_class[e]];
+    int shared_class = 0;
+    while (class_size[shared_class] == 1)
+      ++shared_class;
+    int chosen = 0;
+    while (element_class[chosen] != shared_class)
+      ++chosen;
+    // Split shared_class into chosen and the rest, keeping the order of all classes.
+    for (int e = 0; e < n; ++e)
+      element_class[e] = 2 * element_class[e] + (element_class[e] == shared_class && e != chosen);
+    number_of_classes = refine_classes(scores, n, element_class, number_of_classes + 1);
+  }
+
+  // All classes are different now, but not necessarily consecutive.
+  PartitionCache::canonical_order_type order(n);
+  for (int e = 0; e < n; ++e)
+    order[e] = e;
+  std::sort(order.begin(), order.end(), [&](int8_t e1, int8_t e2){ return element_class[e1] < element_class[e2]; });
+  return order;
+}
+
+} // namespace
+
+void PartitionCache::initialize(std::filesystem::path const& filename)
+{
+  DoutEntering(dc::vulkan, "PartitionCache::initialize(" << filename << ")");
+
+  m_filename = filename;
+
+  std::ifstream file(m_filename, std::ios::binary);
+  if (!file)
+    return;
+
+  entries_t::wat entries_w(m_entries);
+  FileHeader header;
+  bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+      header.magic == FileHeader::s_magic &&
+      header.version == file_format_version;
+  for (uint64_t n = 0; valid && n < header.number_of_entries; ++n)
+  {
+    EntryHeader entry_header;
+    valid = file.read(reinterpret_cast<char*>(&entry_header), sizeof(entry_header)) &&
+        entry_header.number_of_elements <= static_cast<uint64_t>(max_number_of_elements);
+    if (!valid)
+      break;
+    set_indexes_type set_indexes(entry_header.number_of_elements);
+    valid = static_cast<bool>(file.read(reinterpret_cast<char*>(set_indexes.data()), set_indexes.size()));
+    if (valid)
+      entries_w->m_map.try_emplace(Key{entry_header.key_low, entry_header.key_high}, std::move(set_indexes));
+  }
+  if (!valid)
+  {
+    Dout(dc::warning, "Ignoring corrupt or outdated partition cache file " << m_filename << ".");
+    entries_w->m_map.clear();
+    // Overwrite the file by the next save.
+    entries_w->m_dirty = true;
+    return;
+  }
+  Dout(dc::vulkan, "Loaded " << entries_w->m_map.size() << " partitions from " << m_filename << ".");
+}
+
+//static
+PartitionCache::Key PartitionCache::make_key(PartitionTask const& partition_task, canonical_order_type& order)
+{
+  order = canonical_order(partition_task);
+  int const n = order.size();
+
+  std::string fingerprint_input;
+  append(fingerprint_input, file_format_version);
+  append(fingerprint_input, partition_task.number_of_elements());
+  append(fingerprint_input, partition_task.max_number_of_sets());
+  for (int c1 = 0; c1 < n; ++c1)
+    for (int c2 = c1 + 1; c2 < n; ++c2)
+    {
+      auto const [kind, value] = score_token(partition_task, order[c1], order[c2]);
+      append(fingerprint_input, kind);
+      if (kind == 'f')
+        append(fingerprint_input, value);
+    }
+
+  util::uint128_t fingerprint = util::Fingerprint128(fingerprint_input.data(), fingerprint_input.size());
+  return { util::Uint128Low64(fingerprint), util::Uint128High64(fingerprint) };
+}
+
+bool PartitionCache::lookup(Key const& key, canonical_order_type const& canonical_order, set_indexes_type& set_indexes)
+{
+  {
+    entries_t::rat entries_r(m_entries);
+    auto entry = entries_r->m_map.find(key);
+    if (entry != entries_r->m_map.end() && entry->second.size() == canonical_order.size())
+    {
+      set_indexes.resize(canonical_order.size());
+      for (size_t c = 0; c < canonical_order.size(); ++c)
+        set_indexes[canonical_order[c]] = entry->second[c];
+      m_hits.fetch_add(1, std::memory_order::relaxed);
+      return true;
+    }
+  }
+  m_misses.fetch_add(1, std::memory_order::relaxed);
+  return false;
+}
+
+void PartitionCache::insert(Key const& key, canonical_order_type const& canonical_order, set_indexes_type const& set_indexes)
+{
+  ASSERT(set_indexes.size() == canonical_order.size());
+  set_indexes_type canonical_set_indexes(set_indexes.size());
+  for (size_t c = 0; c < canonical_order.size(); ++c)
+    canonical_set_indexes[c] = set_indexes[canonical_order[c]];
+  {
+    entries_t::wat entries_w(m_entries);
+    if (!entries_w->m_map.insert_or_assign(key, std::move(canonical_set_indexes)).second)
+      return;
+    entries_w->m_dirty = true;
+  }
+  // Write the new entry to disk right away, so that it isn't lost when the application doesn't exit cleanly.
+  save();
+}
+
+void PartitionCache::save()
+{
+  DoutEntering(dc::vulkan, "PartitionCache::save()");
+
+  if (m_filename.empty())
+    return;
+
+  std::lock_guard<std::mutex> save_lock(m_save_mutex);
+  std::string buffer;
+  {
+    entries_t::wat entries_w(m_entries);
+    if (!entries_w->m_dirty)
+      return;
+    FileHeader header{
+      .magic = FileHeader::s_magic,
+      .version = file_format_version,
+      .number_of_entries = entries_w->m_map.size()
+    };
+    append(buffer, header);
+    for (auto const& entry : entries_w->m_map)
+    {
+      EntryHeader entry_header{
+        .key_low = entry.first.m_low,
+        .key_high = entry.first.m_high,
+        .number_of_elements = entry.second.size()
+      };
+      append(buffer, entry_header);
+      buffer.append(reinterpret_cast<char const*>(entry.second.data()), entry.second.size());
+    }
+    entries_w->m_dirty = false;
+  }
+
+  // Write to a temporary file first, so that a crash never leaves a partially written cache behind.
+  std::filesystem::path tmp_filename = m_filename;
+  tmp_filename += ".tmp." + std::to_string(getpid());
+  std::error_code ec;
+  {
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (file)
+    {
+      file.write(buffer.data(), buffer.size());
+      file.close();
+    }
+    if (!file)
+    {
+      Dout(dc::warning, "Failed to write partition cache file " << tmp_filename << ".");
+      std::filesystem::remove(tmp_filename, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_filename, m_filename, ec);
+  if (ec)
+  {
+    Dout(dc::warning, "Failed to rename " << tmp_filename << " to " << m_filename << ": " << ec.message());
+    std::filesystem::remove(tmp_filename, ec);
+  }
+}
+
+void PartitionCache::print_on(std::ostream& os) const
+{
+  os << "{hits:" << hits() << ", misses:" << misses() << '}';
+}
+
+} // namespace vulkan::pipeline::partitions
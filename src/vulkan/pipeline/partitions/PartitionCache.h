@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Defs.h"
+#include "threadsafe/threadsafe.h"
+#include "utils/has_print_on.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace vulkan::pipeline::partitions {
+using utils::has_print_on::operator<<;
+
+class PartitionTask;
+
+// A persistent cache of the results of PartitionOptimizer.
+//
+// The key is a 128-bit fingerprint of the number of elements, the maximum number
+// of sets and all pair scores of a (fully initialized) PartitionTask; the value
+// is the set index of each element of the best partition that was found.
+//
+// The order of the elements of a task is arbitrary (it is the order in which shader
+// resources were added), therefore make_key first puts the elements in a canonical
+// order that only depends on the scores, and the set indexes are stored in that order.
+// The same task with its elements permuted thus has the same key.
+//
+// The cache is loaded by initialize (normally from Directory::cache / "partition_cache",
+// next to the pipeline caches) and written back by insert whenever a new entry was added.
+//
+// All public member functions, except initialize, are thread-safe.
+class PartitionCache
+{
+ public:
+  static constexpr uint32_t file_format_version = 2;
+
+  struct Key
+  {
+    uint64_t m_low;
+    uint64_t m_high;
+
+    auto operator<=>(Key const& key) const = default;
+  };
+
+  using set_indexes_type = std::vector<int8_t>;         // The set index of each element.
+  using canonical_order_type = std::vector<int8_t>;     // The element index at each canonical position.
+
+ private:
+  struct UnlockedEntries
+  {
+    std::map<Key, set_indexes_type> m_map;
+    bool m_dirty{false};                                // Set when an entry was added since the last load/save.
+  };
+  using entries_t = threadsafe::Unlocked<UnlockedEntries, threadsafe::policy::Primitive<std::mutex>>;
+
+  std::filesystem::path m_filename;                     // The file that the cache is stored in. Empty when persistence is disabled.
+  entries_t m_entries;
+  std::atomic<size_t> m_hits{0};                        // Number of successful calls to lookup.
+  std::atomic<size_t> m_misses{0};                      // Number of calls to lookup that returned false.
+  std::mutex m_save_mutex;                              // Only one thread at a time writes the file.
+
+ public:
+  // Load the cache from filename (if it exists) and remember filename for save().
+  void initialize(std::filesystem::path const& filename);
+
+  // Calculate the key of partition_task and the canonical order of its elements that the key is based on.
+  // Must be called after all scores have been set.
+  static Key make_key(PartitionTask const& partition_task, canonical_order_type& canonical_order);
+
+  // Try to find the entry for key. Returns true and fills set_indexes (in element order) on success.
+  bool lookup(Key const& key, canonical_order_type const& canonical_order, set_indexes_type& set_indexes);
+
+  // Add an entry; set_indexes is in element order. Saves the cache if the entry is new.
+  void insert(Key const& key, canonical_order_type const& canonical_order, set_indexes_type const& set_indexes);
+
+  // Write the cache to disk if it changed.
+  void save();
+
+  size_t hits() const { return m_hits.load(std::memory_order::relaxed); }
+  size_t misses() const { return m_misses.load(std::memory_order::relaxed); }
+
+  // Print the statistics.
+  void print_on(std::ostream& os) const;
+};
+
+} // namespace vulkan::pipeline::partitions
@@ -0,0 +1,156 @@
+#include "sys.h"
+#include "PartitionOptimizer.h"
+#include "PartitionTask.h"
+#include "PartitionIteratorBruteForce.h"
+#include "ElementPair.h"
+#include "utils/RandomNumber.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "debug.h"
+
+namespace vulkan::pipeline::partitions {
+
+namespace {
+
+// Returns the sum of the scores of the pairs that element forms with the elements of set (other than element itself).
+Score element_score(PartitionTask const& partition_task, Set set, ElementIndex element)
+{
+  Score sum;
+  for (auto bit_iter = set.begin(); bit_iter != set.end(); ++bit_iter)
+  {
+    ElementIndex other = elements_t::mask2index((*bit_iter)());
+    if (other == element)
+      continue;
+    sum += partition_task.score(ElementPair{element, other}.score_index());
+  }
+  return sum;
+}
+
+// Returns the largest absolute value of the finite pair scores (or 1.0 if there are none).
+double score_scale(PartitionTask const& partition_task)
+{
+  double scale = 0.0;
+  for (ElementIndex i1 = partition_task.ibegin(); i1 != partition_task.iend(); ++i1)
+    for (ElementIndex i2 = i1 + 1; i2 != partition_task.iend(); ++i2)
+    {
+      Score const& score = partition_task.score(ElementPair{i1, i2}.score_index());
+      if (!score.is_infinite())
+        scale = std::max(scale, std::abs(score.value()));
+    }
+  return scale > 0.0 ? scale : 1.0;
+}
+
+} // namespace
+
+PartitionOptimizer::PartitionOptimizer(PartitionTask const& partition_task, int number_of_restarts,
+    partition_count_t exact_enumeration_limit, uint64_t seed) :
+  m_partition_task(partition_task), m_number_of_restarts(std::max(1, number_of_restarts)),
+  m_exact_enumeration_limit(exact_enumeration_limit), m_seed(seed)
+{
+}
+
+bool PartitionOptimizer::will_enumerate() const
+{
+  int const number_of_elements = m_partition_task.number_of_elements();
+  // There is only one (empty) partition of zero elements.
+  if (number_of_elements == 0)
+    return true;
+  // For more than 24 elements the number of partitions no longer fits in a partition_count_t (it certainly exceeds any sane limit).
+  return number_of_elements <= 24 && m_partition_task.number_of_partitions(1, number_of_elements - 1) <= m_exact_enumeration_limit;
+}
+
+PartitionOptimizer::Result PartitionOptimizer::optimize() const
+{
+  if (m_partition_task.number_of_elements() == 0)
+    return { .m_score = Score{}, .m_exact = true, .m_evaluated = 1, .m_restarts = 0 };
+  return will_enumerate() ? enumerate() : anneal();
+}
+
+PartitionOptimizer::Result PartitionOptimizer::enumerate() const
+{
+  Result result{ .m_score = negative_inf, .m_exact = true, .m_evaluated = 0, .m_restarts = 0 };
+  for (PartitionIteratorBruteForce iter(m_partition_task); !iter.is_end(); ++iter)
+  {
+    Partition partition = *iter;
+    Score score = partition.score(m_partition_task);
+    ++result.m_evaluated;
+    if (score > result.m_score)
+    {
+      result.m_partition = partition;
+      result.m_score = score;
+    }
+  }
+  return result;
+}
+
+PartitionOptimizer::Result PartitionOptimizer::anneal() const
+{
+  int const number_of_elements = m_partition_task.number_of_elements();
+  int const max_number_of_sets = m_partition_task.max_number_of_sets();
+  // The initial temperature is such that the worst finite single move is accepted with a probability of about 1/e.
+  double const initial_temperature = score_scale(m_partition_task);
+  double const final_temperature = initial_temperature * 1e-3;
+  int const steps_per_run = 1000 * number_of_elements;
+  double const cooling = std::pow(final_temperature / initial_temperature, 1.0 / steps_per_run);
+
+  Result best{ .m_score = negative_inf, .m_exact = false, .m_evaluated = 0, .m_restarts = m_number_of_restarts };
+
+  for (int restart = 0; restart < m_number_of_restarts; ++restart)
+  {
+    // Every run has its own seed, so that the result doesn't depend on the number of restarts that came before.
+    utils::RandomNumber random_number(m_seed + restart);
+    std::uniform_int_distribution<int> element_distribution{0, number_of_elements - 1};
+    std::uniform_real_distribution<double> acceptance_distribution{0.0, 1.0};
+    Partition partition = m_partition_task.random(random_number);
+    Score current_score = partition.score(m_partition_task);
+    Partition run_best = partition;
+    Score run_best_score = current_score;
+    double temperature = initial_temperature;
+    for (int step = 0; step < steps_per_run; ++step, temperature *= cooling)
+    {
+      // Propose to move a random element to another (possibly new) set.
+      ElementIndex element{ElementIndexPOD{static_cast<int8_t>(random_number.generate(element_distribution))}};
+      SetIndex const from = partition.set_of(Element{element});
+      int const number_of_sets = partition.number_of_sets().get_value();
+      bool const can_create_set = number_of_sets < max_number_of_sets && !partition.set(from).is_single_bit();
+      int const number_of_choices = number_of_sets - 1 + (can_create_set ? 1 : 0);
+      if (number_of_choices == 0)
+        continue;
+      std::uniform_int_distribution<int> target_distribution{0, number_of_choices - 1};
+      int target = random_number.generate(target_distribution);
+      SetIndex to = target < number_of_sets - 1 ? SetIndex{target < from.get_value() ? target : target + 1} : partition.first_empty_set();
+      ++best.m_evaluated;
+
+      Score delta = element_score(m_partition_task, partition.set(to), element) - element_score(m_partition_task, partition.set(from), element);
+      if (delta < Score{})
+      {
+        // Never accept losing a positive infinity or gaining a negative infinity.
+        if (delta.is_infinite() || random_number.generate(acceptance_distribution) >= std::exp(delta.value() / temperature))
+          continue;
+      }
+      partition.remove_from(from, Element{element});
+      partition.add_to(to, Element{element});
+      if (partition.set(from).empty())
+        partition.sort();       // Keep the empty sets at the end.
+      current_score += delta;
+      if (current_score > run_best_score)
+      {
+        run_best = partition;
+        run_best_score = current_score;
+      }
+    }
+    // Polish the result of this run with a deterministic local search.
+    run_best_score = run_best.find_local_maximum(m_partition_task);
+    if (run_best_score > best.m_score)
+    {
+      best.m_partition = run_best;
+      best.m_score = run_best_score;
+    }
+  }
+
+  best.m_partition.sort();
+  return best;
+}
+
+} // namespace vulkan::pipeline::partitions
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Partition.h"
+#include <cstdint>
+
+namespace vulkan::pipeline::partitions {
+
+class PartitionTask;
+
+// Find the Partition with the highest score for a (fully initialized) PartitionTask.
+//
+// If the total number of partitions is small enough (at most exact_enumeration_limit)
+// then all partitions are enumerated and the result is the exact optimum.
+// Otherwise simulated annealing is run number_of_restarts times from a random starting
+// partition (see PartitionTask::random), each run followed by a local search (Partition::find_local_maximum),
+// and the best partition found by any run is returned.
+//
+// The amount of work is bounded and every run uses a random number generator seeded
+// from seed, so that the result only depends on the PartitionTask (and the arguments):
+// the same shader resources always end up in the same descriptor sets.
+// optimize() runs on the calling thread.
+class PartitionOptimizer
+{
+ public:
+  static constexpr partition_count_t default_exact_enumeration_limit = 200000;
+  static constexpr int default_number_of_restarts = 4;
+
+  struct Result
+  {
+    Partition m_partition;              // The best partition found.
+    Score m_score;                      // The score of m_partition.
+    bool m_exact;                       // True if m_partition is guaranteed to be the best partition.
+    uint64_t m_evaluated;               // The number of partitions (exact), or annealing steps (otherwise), that were evaluated.
+    int m_restarts;                     // The number of annealing runs (zero if m_exact is true).
+  };
+
+ private:
+  PartitionTask const& m_partition_task;
+  int m_number_of_restarts;
+  partition_count_t m_exact_enumeration_limit;
+  uint64_t m_seed;
+
+ public:
+  PartitionOptimizer(PartitionTask const& partition_task,
+      int number_of_restarts = default_number_of_restarts,
+      partition_count_t exact_enumeration_limit = default_exact_enumeration_limit,
+      uint64_t seed = 1);
+
+  // Returns true if optimize() will do an exhaustive search.
+  bool will_enumerate() const;
+
+  Result optimize() const;
+
+ private:
+  Result enumerate() const;
+  Result anneal() const;
+};
+
+} // namespace vulkan::pipeline::partitions
@@ -66,6 +66,16 @@ PartitionTask::PartitionTask(int8_t number_of_elements, LogicalDevice const* log
 {
 }
 
+PartitionTask::PartitionTask(int8_t number_of_elements, int8_t max_number_of_sets) :
+  m_logical_device(nullptr),
+  m_number_of_partitions(std::make_unique<number_of_partitions_table_t>()),
+  m_number_of_elements(number_of_elements),
+  m_max_number_of_sets(std::min(number_of_elements, max_number_of_sets)),
+  m_scores(64 * (number_of_elements - 2) + number_of_elements)
+{
+  initialize_number_of_partitions(*m_number_of_partitions, max_number_of_sets);
+}
+
 // Returns a reference into the cache for a given top_sets, depth and sets.
 //static
 partition_count_t& PartitionTask::number_of_partitions_with_sets(int top_sets, int depth, int sets, table3d_t* table3d)
@@ -77,7 +87,7 @@ partition_count_t& PartitionTask::number_of_partitions_with_sets(int top_sets, i
 }
 
 //static
-int PartitionTask::table(int top_sets, int depth, int sets, table3d_t* table3d)
+partition_count_t PartitionTask::table(int top_sets, int depth, int sets, table3d_t* table3d)
 {
   ASSERT(top_sets + depth <= max_number_of_elements);
   if (sets > depth + top_sets || sets < top_sets)
@@ -95,6 +105,47 @@ int PartitionTask::table(int top_sets, int depth, int sets, table3d_t* table3d)
   return te;
 }
 
+//static
+void PartitionTask::initialize_number_of_partitions(number_of_partitions_table_t& number_of_partitions, int max_number_of_sets)
+{
+  max_number_of_sets = std::min(max_number_of_sets, static_cast<int>(max_number_of_elements));
+  for (auto& row : number_of_partitions)
+    row.fill(0);
+  // Cache of the number of partitions existing of 'sets' sets when starting with 'top_sets' and adding 'depth' new elements.
+  // This table doesn't depend on max_number_of_sets, so it is calculated only once and shared by all logical devices.
+  static std::unique_ptr<table3d_t> const s_table3d = [](){
+    std::unique_ptr<table3d_t> table3d = std::make_unique<table3d_t>();
+    for (int top_sets = 1; top_sets <= max_number_of_elements; ++top_sets)
+      for (int depth = 0; depth < max_number_of_elements - top_sets; ++depth)
+        for (int sets = top_sets; sets <= top_sets + depth; ++sets)
+          table(top_sets, depth, sets, table3d.get());
+    return table3d;
+  }();
+  table3d_t* table3d = s_table3d.get();
+  for (int top_sets = 1; top_sets <= max_number_of_sets; ++top_sets)
+  {
+    for (int depth = 0; depth < max_number_of_elements - top_sets; ++depth)
+    {
+      partition_count_t sum = 0;
+      for (int8_t sets = top_sets; sets <= max_number_of_sets; ++sets)
+      {
+        partition_count_t term = table(top_sets, depth, sets, table3d);
+        if (term == 0)
+          break;
+        sum += term;
+      }
+      number_of_partitions[top_sets][depth] = sum;
+    }
+  }
+}
+
+partition_count_t PartitionTask::number_of_partitions(int top_sets, int depth) const
+{
+  if (m_logical_device)
+    return m_logical_device->number_of_partitions(top_sets, depth);
+  return (*m_number_of_partitions)[top_sets][depth];
+}
+
 // Print the table 'top_sets'.
 void PartitionTask::print_table(int top_sets, table3d_t* table3d)
 {
@@ -106,11 +157,11 @@ void PartitionTask::print_table(int top_sets, table3d_t* table3d)
   std::cout << '\n';
   for (int8_t depth = 0; depth <= std::min(5, max_number_of_elements - 1 - top_sets); ++depth)   // Use 5 because for larger depth the numbers get way too big.
   {
-    partitions::partition_count_t nop = m_logical_device->number_of_partitions(top_sets, depth);
+    partitions::partition_count_t nop = number_of_partitions(top_sets, depth);
     std::cout << std::setw(2) << depth;
     for (int8_t sets = 1; sets <= m_max_number_of_sets; ++sets)
     {
-      int v = table(top_sets, depth, sets, table3d);
+      partition_count_t v = table(top_sets, depth, sets, table3d);
       std::cout << std::setw(8) << v;
     }
     std::cout << " = " << nop << '\n';
@@ -153,6 +204,11 @@ void PartitionTask::initialize_set23_to_score()
 }
 
 Partition PartitionTask::random()
+{
+  return random(m_random_number);
+}
+
+Partition PartitionTask::random(utils::RandomNumber& random_number) const
 {
   Partition top(*this, Set(Element('A')));
   int8_t top_sets = 1;     // The current_root has 1 set.
@@ -161,12 +217,12 @@ Partition PartitionTask::random()
   {
     Element const new_element('A' + top_elements);
     int8_t depth = m_number_of_elements - top_elements;
-    partition_count_t existing_set = m_logical_device->number_of_partitions(top_sets, depth - 1);
-    partition_count_t new_set = m_logical_device->number_of_partitions(top_sets + 1, depth - 1);
+    partition_count_t existing_set = number_of_partitions(top_sets, depth - 1);
+    partition_count_t new_set = number_of_partitions(top_sets + 1, depth - 1);
     partition_count_t total = top_sets * existing_set + new_set;
 
     std::uniform_int_distribution<partition_count_t> distr{0, total - 1};
-    partition_count_t n = m_random_number.generate(distr);
+    partition_count_t n = random_number.generate(distr);
     if (n >= top_sets * existing_set)
     {
       // Add new element to new set.
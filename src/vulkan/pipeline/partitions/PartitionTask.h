@@ -3,6 +3,7 @@
 #include "Partition.h"
 #include "utils/RandomNumber.h"
 #include <map>
+#include <memory>
 #include <vector>
 #include <array>
 #ifdef USE_BRUTE_FORCE_ITERATOR         // Normally not defined.
@@ -18,7 +19,8 @@ namespace vulkan::pipeline::partitions {
 class PartitionTask
 {
  private:
-  LogicalDevice const* m_logical_device;        // The device that this is being used for: it determines the max_number_of_sets.
+  LogicalDevice const* m_logical_device;        // The device that this is being used for: it determines the max_number_of_sets. Might be nullptr.
+  std::unique_ptr<number_of_partitions_table_t> m_number_of_partitions; // Only used when m_logical_device is nullptr.
   int8_t m_number_of_elements;                  // The number of elements that we need to partition.
   int8_t m_max_number_of_sets;                  // The maximum number of sets that will be used by this task.
   utils::RandomNumber m_random_number{1};       // Random number generator for generating random partitions.
@@ -28,11 +30,18 @@ class PartitionTask
 
  public:
   PartitionTask(int8_t number_of_elements, LogicalDevice const* logical_device);
+  // Construct a PartitionTask that isn't associated with a logical device (used by benchmarks and tests).
+  PartitionTask(int8_t number_of_elements, int8_t max_number_of_sets);
 
   static partition_count_t& number_of_partitions_with_sets(int top_sets, int depth, int sets, table3d_t* table3d);
-  static int table(int top_sets, int depth, int sets, table3d_t* table3d);
+  static partition_count_t table(int top_sets, int depth, int sets, table3d_t* table3d);
+  static void initialize_number_of_partitions(number_of_partitions_table_t& number_of_partitions, int max_number_of_sets);
   void print_table(int top_sets, table3d_t* table3d);
 
+  // The number of partitions with at most max_number_of_sets() sets that can be reached
+  // by adding depth elements to a partition existing of top_sets sets.
+  partition_count_t number_of_partitions(int top_sets, int depth) const;
+
   Score score(Set set23) const
   {
     auto set23_iter = m_set23_to_score.find(set23);
@@ -42,6 +51,8 @@ class PartitionTask
   }
 
   Partition random();
+  // Thread-safe version of random(), using the given random number generator.
+  Partition random(utils::RandomNumber& random_number) const;
 
   int8_t number_of_elements() const
   {
@@ -3,11 +3,9 @@
 
 namespace vulkan::task {
 
-void CopyDataToBuffer::record_command_buffer(handle::CommandBuffer command_buffer)
+void CopyDataToBuffer::add_to_batch(TransferBatch& transfer_batch)
 {
-  DoutEntering(dc::vulkan(mSMDebug), "CopyDataToBuffer::record_command_buffer(" << command_buffer << ") [" << this << "]");
-
-  command_buffer.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+  DoutEntering(dc::vulkan(mSMDebug), "CopyDataToBuffer::add_to_batch(...) [" << this << "]");
 
   vk::BufferMemoryBarrier pre_transfer_buffer_memory_barrier{
     .srcAccessMask = m_current_buffer_access,
@@ -18,15 +16,15 @@ void CopyDataToBuffer::record_command_buffer(handle::CommandBuffer command_buffe
     .offset = m_buffer_offset,
     .size = m_data_size
   };
-  command_buffer.pipelineBarrier(m_generating_stages, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(0), {}, { pre_transfer_buffer_memory_barrier }, {});
+  transfer_batch.pre_transfer_barrier(m_generating_stages, pre_transfer_buffer_memory_barrier);
 
   vk::BufferCopy buffer_copy_region{
-    .srcOffset = 0,
+    .srcOffset = m_staging_region.m_offset,
     .dstOffset = m_buffer_offset,
     .size = m_data_size
   };
-  Dout(dc::always, "Preparing to transfer from " << m_staging_buffer.m_vh_buffer << " to " << m_vh_target_buffer << ": " << buffer_copy_region);
-  command_buffer.copyBuffer(m_staging_buffer.m_vh_buffer, m_vh_target_buffer, { buffer_copy_region });
+  Dout(dc::always, "Preparing to transfer from " << m_staging_region.m_vh_buffer << " to " << m_vh_target_buffer << ": " << buffer_copy_region);
+  transfer_batch.copy_buffer(m_staging_region.m_vh_buffer, m_vh_target_buffer, buffer_copy_region);
 
   vk::BufferMemoryBarrier post_transfer_buffer_memory_barrier{
     .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
@@ -37,8 +35,7 @@ void CopyDataToBuffer::record_command_buffer(handle::CommandBuffer command_buffe
     .offset = m_buffer_offset,
     .size = m_data_size
   };
-  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, m_consuming_stages, vk::DependencyFlags(0), {}, { post_transfer_buffer_memory_barrier }, {});
-  command_buffer.end();
+  transfer_batch.post_transfer_barrier(m_consuming_stages, post_transfer_buffer_memory_barrier);
 }
 
 } // namespace vulkan::task
@@ -38,7 +38,7 @@ class CopyDataToBuffer final : public CopyDataToGPU
   }
 
  private:
-  void record_command_buffer(handle::CommandBuffer command_buffer) override;
+  void add_to_batch(TransferBatch& transfer_batch) override;
 };
 
 } // namespace vulkan::task
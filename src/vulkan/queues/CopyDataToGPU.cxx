@@ -2,6 +2,8 @@
 #include "CopyDataToGPU.h"
 #include "SynchronousWindow.h"
 #include "memory/StagingBuffer.h"
+#include "memory/StagingRing.h"
+#include "utils/AIAlert.h"
 
 namespace vulkan::task {
 
@@ -10,6 +12,15 @@ CopyDataToGPU::~CopyDataToGPU()
   DoutEntering(dc::statefultask(mSMDebug), "~CopyDataToGPU() [" << this << "]");
 }
 
+char const* CopyDataToGPU::condition_str_impl(condition_type condition) const
+{
+  switch (condition)
+  {
+    AI_CASE_RETURN(staging_ring_space_available);
+  }
+  return direct_base_type::condition_str_impl(condition);
+}
+
 char const* CopyDataToGPU::state_str_impl(state_type run_state) const
 {
   switch(run_state)
@@ -45,6 +56,13 @@ void CopyDataToGPU::initialize_impl()
 void CopyDataToGPU::finish_impl()
 {
   DoutEntering(dc::statefultask(mSMDebug), "CopyDataToGPU::finish_impl() [" << this << "]");
+  memory::StagingRing& staging_ring = m_submit_request.logical_device()->staging_ring();
+  if (!m_staging_region.m_pointer)
+    // We might have been aborted while waiting for space.
+    staging_ring.cancel_wait(this);
+  else if (!m_staging_buffer.m_vh_buffer)
+    // The submit finished (the timeline semaphore reached its signal value), so the GPU is done reading the staging memory.
+    staging_ring.release(m_staging_region);
   if (m_resource_owner)
     // See above.
     const_cast<SynchronousWindow*>(m_resource_owner)->m_task_counter_gate.decrement();
@@ -58,9 +76,30 @@ void CopyDataToGPU::multiplex_impl(state_type run_state)
     {
       ZoneScopedN("CopyDataToGPU_start");
       vulkan::LogicalDevice const* logical_device = m_submit_request.logical_device();
-      // Create staging buffer and map its memory to copy data from the CPU.
-      m_staging_buffer = memory::StagingBuffer(logical_device, m_data_size
-          COMMA_CWDEBUG_ONLY(debug_name_prefix("m_staging_buffer")));
+      memory::StagingRing& staging_ring = logical_device->staging_ring();
+      if (m_data_size <= staging_ring.max_allocation_size())
+      {
+        // Get a region of the staging ring to copy the data from the CPU to.
+        if (!staging_ring.allocate(m_data_size, m_staging_region, this, staging_ring_space_available))
+        {
+          // Try again once some other upload released its region.
+          wait(staging_ring_space_available);
+          break;
+        }
+      }
+      else
+      {
+        // Too large for the staging ring: create a dedicated staging buffer and map its memory.
+        staging_ring.count_dedicated();
+        m_staging_buffer = memory::StagingBuffer(logical_device, m_data_size
+            COMMA_CWDEBUG_ONLY(debug_name_prefix("m_staging_buffer")));
+        m_staging_region = {
+          .m_vh_buffer = m_staging_buffer.m_vh_buffer,
+          .m_offset = 0,
+          .m_size = m_data_size,
+          .m_pointer = static_cast<unsigned char*>(m_staging_buffer.m_pointer)
+        };
+      }
       set_state(CopyDataToGPU_write);
     }
     Dout(dc::statefultask(mSMDebug), "Falling through to CopyDataToGPU_write [" << this << "]");
@@ -69,15 +108,25 @@ void CopyDataToGPU::multiplex_impl(state_type run_state)
     {
       ZoneScopedN("CopyDataToGPU_write");
       // Copy data to the staging buffer.
-      unsigned char* dst = static_cast<unsigned char*>(m_staging_buffer.m_pointer);
+      unsigned char* dst = m_staging_region.m_pointer;
       uint32_t const chunk_size = m_data_feeder->chunk_size();
       int const chunk_count = m_data_feeder->chunk_count();
       int chunks;
-      for (int total_chunks = 0; total_chunks < chunk_count; total_chunks += chunks)
+      try
+      {
+        for (int total_chunks = 0; total_chunks < chunk_count; total_chunks += chunks)
+        {
+          chunks = m_data_feeder->next_batch();
+          m_data_feeder->get_chunks(dst);
+          dst += chunks * chunk_size;
+        }
+      }
+      catch (AIAlert::Error const& error)
       {
-        chunks = m_data_feeder->next_batch();
-        m_data_feeder->get_chunks(dst);
-        dst += chunks * chunk_size;
+        // The data feeder failed to produce the data (for example, a corrupt image file).
+        Dout(dc::warning, error);
+        abort();
+        return;
       }
       set_state(CopyDataToGPU_flush);
     }
@@ -88,12 +137,16 @@ void CopyDataToGPU::multiplex_impl(state_type run_state)
       ZoneScopedN("CopyDataToGPU_flush");
       vulkan::LogicalDevice const* logical_device = m_submit_request.logical_device();
       // Once everything is written to the staging buffer and flush.
-      logical_device->flush_mapped_allocation(m_staging_buffer.m_vh_allocation, 0, VK_WHOLE_SIZE);
-      // Set callback to record command buffer to virtual function `record_command_buffer`,
+      if (m_staging_buffer.m_vh_buffer)
+        logical_device->flush_mapped_allocation(m_staging_buffer.m_vh_allocation, 0, VK_WHOLE_SIZE);
+      else
+        logical_device->staging_ring().flush(m_staging_region);
+      // Set callback to add the commands to a TransferBatch to virtual function `add_to_batch`,
       // the derived class is responsible for appropriate commands to copy the staging buffer to the right destination.
-      m_submit_request.set_record_function([this](handle::CommandBuffer command_buffer){
-        record_command_buffer(command_buffer);
-      });
+      // Using a batch function allows the ImmediateSubmitQueue to record the copies of many requests into a single command buffer.
+      m_submit_request.set_batch_function([this](TransferBatch& transfer_batch){
+        add_to_batch(transfer_batch);
+      }, m_data_size);
       // Finish the rest of this "immediate submit" by passing control to the base class.
       run_state = ImmediateSubmit_start;
       break;
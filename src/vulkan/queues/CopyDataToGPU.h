@@ -2,6 +2,7 @@
 
 #include "ImmediateSubmit.h"
 #include "../memory/StagingBuffer.h"
+#include "../memory/StagingRing.h"
 #include "../memory/DataFeeder.h"
 #include "statefultask/RunningTasksTracker.h"
 #include <vector>
@@ -10,9 +11,13 @@ namespace vulkan::task {
 
 class CopyDataToGPU : public ImmediateSubmit
 {
+ public:
+  static constexpr condition_type staging_ring_space_available = 2;
+
  protected:
   std::unique_ptr<DataFeeder> m_data_feeder;
-  memory::StagingBuffer m_staging_buffer;
+  memory::StagingRing::Region m_staging_region;                 // Where the data is written to; part of the staging ring of the logical device, or of m_staging_buffer.
+  memory::StagingBuffer m_staging_buffer;                       // Only used when m_data_size is too large for the staging ring.
   uint32_t m_data_size;
   SynchronousWindow const* m_resource_owner;                    // If any resources that this task uses are part of a window, then this should be set.
   statefultask::RunningTasksTracker::index_type m_index;        // Our index, if added to m_resource_owner.
@@ -53,13 +58,15 @@ class CopyDataToGPU : public ImmediateSubmit
   }
 
  private:
-  virtual void record_command_buffer(handle::CommandBuffer command_buffer) = 0;
+  // Add the barriers and copy commands that copy m_staging_region to the destination.
+  virtual void add_to_batch(TransferBatch& transfer_batch) = 0;
 
  protected:
   ~CopyDataToGPU() override;
 
   void initialize_impl() override;
   void finish_impl() override;
+  char const* condition_str_impl(condition_type condition) const override;
   char const* state_str_impl(state_type run_state) const override;
   void multiplex_impl(state_type run_state) override;
 };
@@ -1,13 +1,12 @@
 #include "sys.h"
 #include "CopyDataToImage.h"
+#include "../vk_utils/format.h"
 
 namespace vulkan::task {
 
-void CopyDataToImage::record_command_buffer(handle::CommandBuffer command_buffer)
+void CopyDataToImage::add_to_batch(TransferBatch& transfer_batch)
 {
-  DoutEntering(dc::vulkan(mSMDebug), "CopyDataToImage::record_command_buffer(" << command_buffer << ")");
-
-  command_buffer.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+  DoutEntering(dc::vulkan(mSMDebug), "CopyDataToImage::add_to_batch(...) [" << this << "]");
 
   vk::ImageMemoryBarrier pre_transfer_image_memory_barrier{
     .srcAccessMask = m_current_image_access,
@@ -19,44 +18,60 @@ void CopyDataToImage::record_command_buffer(handle::CommandBuffer command_buffer
     .image = m_vh_target_image,
     .subresourceRange = m_image_subresource_range
   };
-  command_buffer.pipelineBarrier(m_generating_stages, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(0), {}, {}, { pre_transfer_image_memory_barrier });
+  transfer_batch.pre_transfer_barrier(m_generating_stages, pre_transfer_image_memory_barrier);
 
+  uint32_t const level_begin = m_image_subresource_range.baseMipLevel;
+  uint32_t const level_end = m_generate_mipmaps ? level_begin + 1 : level_begin + m_image_subresource_range.levelCount;
   std::vector<vk::BufferImageCopy> buffer_image_copy;
-  buffer_image_copy.reserve(m_image_subresource_range.levelCount);
-  for (uint32_t i = m_image_subresource_range.baseMipLevel; i < m_image_subresource_range.baseMipLevel + m_image_subresource_range.levelCount; ++i)
+  buffer_image_copy.reserve(level_end - level_begin);
+  vk::DeviceSize buffer_offset = m_staging_region.m_offset;
+  for (uint32_t level = level_begin; level < level_end; ++level)
   {
+    vk::Extent2D const level_extent = vk_utils::mip_level_extent(m_extent, level);
     buffer_image_copy.emplace_back(vk::BufferImageCopy{
-      .bufferOffset = 0,
+      .bufferOffset = buffer_offset,
       .bufferRowLength = 0,
       .bufferImageHeight = 0,
       .imageSubresource = vk::ImageSubresourceLayers{
         .aspectMask = m_image_subresource_range.aspectMask,
-        .mipLevel = i,
+        .mipLevel = level,
         .baseArrayLayer = m_image_subresource_range.baseArrayLayer,
         .layerCount = m_image_subresource_range.layerCount
       },
       .imageOffset = vk::Offset3D{},
       .imageExtent = vk::Extent3D{
-        .width = m_extent.width,
-        .height = m_extent.height,
+        .width = level_extent.width,
+        .height = level_extent.height,
         .depth = 1
       }
     });
+    buffer_offset += vk_utils::mip_level_size(m_format, m_extent, level) * m_image_subresource_range.layerCount;
+  }
+  // The data must contain exactly the levels that are copied.
+  ASSERT(buffer_offset - m_staging_region.m_offset == m_data_size);
+  transfer_batch.copy_buffer_to_image(m_staging_region.m_vh_buffer, m_vh_target_image, vk::ImageLayout::eTransferDstOptimal, std::move(buffer_image_copy));
+
+  vk::ImageLayout post_transfer_layout = vk::ImageLayout::eTransferDstOptimal;
+  vk::AccessFlags post_transfer_access = vk::AccessFlagBits::eTransferWrite;
+  if (m_generate_mipmaps)
+  {
+    // Afterwards, all levels are in eTransferSrcOptimal.
+    transfer_batch.generate_mipmaps(m_vh_target_image, m_extent, m_image_subresource_range);
+    post_transfer_layout = vk::ImageLayout::eTransferSrcOptimal;
+    post_transfer_access = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
   }
-  command_buffer.copyBufferToImage(m_staging_buffer.m_vh_buffer, m_vh_target_image, vk::ImageLayout::eTransferDstOptimal, buffer_image_copy);
 
   vk::ImageMemoryBarrier post_transfer_image_memory_barrier{
-    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+    .srcAccessMask = post_transfer_access,
     .dstAccessMask = m_new_image_access,
-    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+    .oldLayout = post_transfer_layout,
     .newLayout = m_new_image_layout,
     .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
     .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
     .image = m_vh_target_image,
     .subresourceRange = m_image_subresource_range
   };
-  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, m_consuming_stages, vk::DependencyFlags(0), {}, {}, { post_transfer_image_memory_barrier });
-  command_buffer.end();
+  transfer_batch.post_transfer_barrier(m_consuming_stages, post_transfer_image_memory_barrier);
 }
 
 } // namespace vulkan::task
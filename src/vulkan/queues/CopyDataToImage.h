@@ -9,7 +9,8 @@ class CopyDataToImage final : public CopyDataToGPU
 {
  private:
   vk::Image m_vh_target_image;
-  vk::Extent2D m_extent;
+  vk::Extent2D m_extent;                                // The extent of mip level 0.
+  vk::Format m_format;
   vk_defaults::ImageSubresourceRange const m_image_subresource_range;
   vk::ImageLayout m_current_image_layout;
   vk::AccessFlags m_current_image_access;
@@ -17,21 +18,25 @@ class CopyDataToImage final : public CopyDataToGPU
   vk::ImageLayout m_new_image_layout;
   vk::AccessFlags m_new_image_access;
   vk::PipelineStageFlags m_consuming_stages;
+  bool m_generate_mipmaps{false};                       // Set if the data only contains the first mip level and the others must be generated.
 
  public:
   // Construct a CopyDataToImage object.
+  //
+  // The data must contain all mip levels of image_subresource_range, tightly packed and in order,
+  // unless set_generate_mipmaps is called; in that case it only contains the first mip level.
   CopyDataToImage(vulkan::LogicalDevice const* logical_device,
-      uint32_t data_size, vk::Image vh_target_image, vk::Extent2D extent, vk_defaults::ImageSubresourceRange image_subresource_range,
+      uint32_t data_size, vk::Image vh_target_image, vk::Extent2D extent, vk::Format format, vk_defaults::ImageSubresourceRange image_subresource_range,
       vk::ImageLayout current_image_layout, vk::AccessFlags current_image_access, vk::PipelineStageFlags generating_stages,
       vk::ImageLayout new_image_layout, vk::AccessFlags new_image_access, vk::PipelineStageFlags consuming_stages
       COMMA_CWDEBUG_ONLY(bool debug)) :
     CopyDataToGPU(logical_device, data_size COMMA_CWDEBUG_ONLY(debug)),
-    m_vh_target_image(vh_target_image), m_extent(extent), m_image_subresource_range(image_subresource_range),
+    m_vh_target_image(vh_target_image), m_extent(extent), m_format(format), m_image_subresource_range(image_subresource_range),
     m_current_image_layout(current_image_layout), m_current_image_access(current_image_access), m_generating_stages(generating_stages),
     m_new_image_layout(new_image_layout), m_new_image_access(new_image_access), m_consuming_stages(consuming_stages)
   {
     DoutEntering(dc::statefultask(mSMDebug), "CopyDataToImage(" << logical_device << ", " << data_size << ", " << vh_target_image << ", " <<
-        extent << ", " << image_subresource_range << ", " << current_image_layout << ", " << current_image_access << ", " <<
+        extent << ", " << format << ", " << image_subresource_range << ", " << current_image_layout << ", " << current_image_access << ", " <<
         generating_stages << ", " << new_image_layout << ", " << new_image_access << ", " << consuming_stages << ") [" << this << "]");
   }
 
@@ -40,8 +45,12 @@ class CopyDataToImage final : public CopyDataToGPU
     DoutEntering(dc::statefultask(mSMDebug), "~CopyDataToImage()  [" << this << "]");
   }
 
+  // Only upload the first mip level and generate the other levels with vkCmdBlitImage.
+  // The format must support that (see LogicalDevice::supports_blit_mipmap_generation).
+  void set_generate_mipmaps() { m_generate_mipmaps = true; }
+
  private:
-  void record_command_buffer(handle::CommandBuffer command_buffer) override;
+  void add_to_batch(TransferBatch& transfer_batch) override;
 };
 
 } // namespace vulkan::task
@@ -35,6 +35,7 @@ class ImmediateSubmit : public AsyncTask
 
   void set_queue_request_key(QueueRequestKey queue_request_key) { m_submit_request.set_queue_request_key(queue_request_key); }
   void set_record_function(ImmediateSubmitRequest::record_function_type&& record_function) { m_submit_request.set_record_function(std::move(record_function)); }
+  void set_batch_function(ImmediateSubmitRequest::batch_function_type&& batch_function, vk::DeviceSize bytes) { m_submit_request.set_batch_function(std::move(batch_function), bytes); }
 
  protected:
   ~ImmediateSubmit() override;
@@ -2,6 +2,8 @@
 #include "ImmediateSubmitQueue.h"
 #include "CommandBufferFactory.h"
 #include "utils/AIAlert.h"
+#include <iostream>
+#include <sstream>
 
 namespace vulkan::task {
 
@@ -14,7 +16,8 @@ ImmediateSubmitQueue::ImmediateSubmitQueue(
       COMMA_CWDEBUG_ONLY(debug_name_prefix("m_command_buffer_pool.m_factory"))),
   m_queue(queue),
   m_semaphore(logical_device, 0
-      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_timeline_semaphore")))
+      COMMA_CWDEBUG_ONLY(debug_name_prefix("m_timeline_semaphore"))),
+  m_batching(logical_device->batch_immediate_submits())
 {
   DoutEntering(dc::statefultask(mSMDebug), "ImmediateSubmitQueue(" << logical_device << ", " << queue << ") [" << this << "]");
 }
@@ -22,6 +25,11 @@ ImmediateSubmitQueue::ImmediateSubmitQueue(
 ImmediateSubmitQueue::~ImmediateSubmitQueue()
 {
   DoutEntering(dc::statefultask(mSMDebug), "~ImmediateSubmitQueue() [" << this << "]");
+#ifdef CWDEBUG
+  std::ostringstream statistics;
+  print_statistics_on(statistics);
+  Dout(dc::vulkan, "ImmediateSubmitQueue statistics: " << statistics.str());
+#endif
 }
 
 char const* ImmediateSubmitQueue::state_str_impl(state_type run_state) const
@@ -89,6 +97,7 @@ void ImmediateSubmitQueue::multiplex_impl(state_type run_state)
         container_type::const_iterator pending_request = first_pending_request;
         uint64_t counter_value = m_semaphore.get_counter_value();
         int processed = 0;
+        int released = 0;
         for (;;)
         {
           if (counter_value < pending_request->signal_value())
@@ -98,7 +107,10 @@ void ImmediateSubmitQueue::multiplex_impl(state_type run_state)
               --pending_request;        // Must be equal to the last processed request for the call to pop_front_n below.
             break;
           }
-          command_buffers[processed++] = pending_request->command_buffer();
+          // Requests that were batched together with a previous request do not have a command buffer of their own.
+          if (pending_request->command_buffer())
+            command_buffers[released++] = pending_request->command_buffer();
+          ++processed;
           pending_request->finished();
           // Do not increment pending_request past the last one processed.
           if (processed == m_pending_requests)
@@ -109,46 +121,155 @@ void ImmediateSubmitQueue::multiplex_impl(state_type run_state)
         if (processed > 0)
         {
           // Release the command buffers of the pending requests that were signaled.
-          m_command_buffer_pool.release(command_buffers.data(), processed);
+          m_command_buffer_pool.release(command_buffers.data(), released);
           // Erase the pending requests that were just processed.
           pop_front_n(pending_request);         // If this invalidates m_last_submitted
           m_pending_requests -= processed;      // then this will become zero.
         }
       }
-      if (n > 0)
+      bool submit_now = n > 0;
+      // Only delay submitting while there are other requests (that are not finished yet) anyway.
+      if (submit_now && m_batching && (n > 1 || m_pending_requests > 0))
       {
-        // Acquire n command buffers from the command buffer pool.
-        std::vector<handle::CommandBuffer> command_buffers(n);
-        // Attempt to acquire n buffers - this might fail.
+        // Delay submitting until the batch window expired, unless we already have enough requests to fill a batch.
+        if (!m_batch_window_expired.load(std::memory_order::relaxed) && n < s_max_batch_requests)
+        {
+          vk::DeviceSize bytes = 0;
+          container_type::const_iterator submit_request = first_submit_request;
+          for (int count = 0;;)
+          {
+            bytes += submit_request->batch_bytes();
+            // Do not increment submit_request past the last new request.
+            if (++count == n)
+              break;
+            ++submit_request;
+          }
+          submit_now = bytes >= s_max_batch_bytes;
+        }
+        if (submit_now)
+          stop_batch_timer();
+        else if (!m_batch_timer_running)
+        {
+          // The time that requests are collected before submitting them as a single batch.
+          static threadpool::Timer::Interval const s_batch_window{threadpool::Interval<2, std::chrono::milliseconds>{}};
+          m_batch_timer_running = true;
+          m_batch_timer.start(s_batch_window);
+        }
+      }
+      else if (submit_now)
+        stop_batch_timer();
+      if (submit_now)
+      {
+        // Divide the new requests into groups; each group is recorded into a single command buffer.
+        // Without batching, or for requests that record their own command buffer, every group has just one request.
+        struct Group
+        {
+          int m_number_of_requests;
+          bool m_batched;
+          TransferBatch m_transfer_batch;
+        };
+        std::vector<Group> groups;
+        // One command buffer per group, acquired from the command buffer pool. Acquiring might fail,
+        // in which case only the requests of the groups that we have a command buffer for are submitted.
+        std::vector<handle::CommandBuffer> command_buffers;
+        // The number of command buffers that we still need, but couldn't acquire.
+        int missing_command_buffers = 0;
         Debug(m_command_buffer_pool.factory().set_ambifix({"ImmediateSubmitQueue_need_action::command_buffers", as_postfix(this)}));
-        size_t const acquired = m_command_buffer_pool.acquire(command_buffers);
+        if (!m_batching)
+        {
+          // Every request needs its own command buffer; attempt to acquire n buffers at once.
+          command_buffers.resize(n);
+          size_t const acquired = m_command_buffer_pool.acquire(command_buffers);
+          command_buffers.resize(acquired);
+          groups.resize(acquired, {1, false, {}});
+          missing_command_buffers = n - acquired;
+        }
+        else
+        {
+          // Acquire a command buffer when a new group is started, and stop at the first group that we can't get one for.
+          std::vector<handle::CommandBuffer> new_command_buffer(1);
+          container_type::const_iterator submit_request = first_submit_request;
+          for (int count = 0;;)
+          {
+            bool const batched = submit_request->is_batchable();
+            TransferBatch transfer_batch;
+            if (batched)
+              submit_request->add_to_batch(transfer_batch);
+            // Transfers that write to the same memory need a barrier in between; put those in a different command buffer.
+            if (batched && !groups.empty() && groups.back().m_batched && !groups.back().m_transfer_batch.overlaps(transfer_batch))
+            {
+              groups.back().m_transfer_batch.append(std::move(transfer_batch));
+              ++groups.back().m_number_of_requests;
+            }
+            else if (m_command_buffer_pool.acquire(new_command_buffer) == 1)
+            {
+              command_buffers.push_back(new_command_buffer[0]);
+              groups.push_back({1, batched, std::move(transfer_batch)});
+            }
+            else
+            {
+              missing_command_buffers = 1;
+              break;
+            }
+            // Do not increment submit_request past the last new request.
+            if (++count == n)
+              break;
+            ++submit_request;
+          }
+        }
+        int const acquired = command_buffers.size();
+
         if (AI_LIKELY(acquired > 0))
         {
+          // The number of requests in the groups that we have a command buffer for.
+          int requests_to_submit = 0;
+          for (Group const& group : groups)
+            requests_to_submit += group.m_number_of_requests;
+          // Because this is the only thread/task that uses m_semaphore; it is safe to add 1 to the value
+          // returned by signal_value() and assume that will be the value used by the submit below.
+          uint64_t const signal_value = m_semaphore.signal_value() + 1;
+
           // As this task owns the deque and is essentially single threaded, we can
           // now simply iterate over the elements, starting with first_submit_request
           // without having the deque locked: producer threads can add new elements
           // in the meantime without invalidating submit_request.
           container_type::const_iterator submit_request = first_submit_request;
-          int count = 0;
-          for (;;)
+          int group = 0;
+          int request_in_group = 0;
+          for (int count = 0;;)
           {
             Dout(dc::vulkan, "ImmediateSubmitQueue_need_action: received submit_request: " << *submit_request << " [" << this << "]");
 
-            // Record the command buffer.
-            submit_request->record_commands(command_buffers[count]);
-            // Store pending request data. Because this is the only thread/task that uses m_semaphore; it is safe to
-            // add 1 to the value returned by signal_value() and assume that will be the value used by the submit below.
-            submit_request->set_command_buffer_and_signal_value(command_buffers[count], m_semaphore.signal_value() + 1);
-            // Prevent submit_request from being moved past the last recorded command buffer.
-            if (++count == acquired)
+            // Record the command buffer of this group.
+            if (request_in_group == 0)
+            {
+              if (groups[group].m_batched)
+                groups[group].m_transfer_batch.record(command_buffers[group]);
+              else
+                submit_request->record_commands(command_buffers[group]);
+            }
+            // Store pending request data. Only the first request of a group owns the command buffer.
+            submit_request->set_command_buffer_and_signal_value(request_in_group == 0 ? command_buffers[group] : handle::CommandBuffer{}, signal_value);
+            m_submitted_bytes += submit_request->batch_bytes();
+            if (++request_in_group == groups[group].m_number_of_requests)
+            {
+              ++group;
+              request_in_group = 0;
+            }
+            // Prevent submit_request from being moved past the last recorded request.
+            if (++count == requests_to_submit)
               break;
             ++submit_request;
           }
           m_last_submitted = submit_request;
-          m_pending_requests += acquired;
+          m_pending_requests += requests_to_submit;
 
           // Submit recorded commands.
           m_queue.submit(command_buffers.data(), acquired, m_semaphore);
+          if (m_submits++ == 0)
+            m_first_submit = std::chrono::steady_clock::now();
+          m_submitted_command_buffers += acquired;
+          m_submitted_requests += requests_to_submit;
 
           // Wake me up when you're done.
           m_semaphore.add_poll(this, need_action);
@@ -158,8 +279,8 @@ void ImmediateSubmitQueue::multiplex_impl(state_type run_state)
         // "do something" (action needs to be taken) it will work: this just assures this task will run again once more CAN be done.
         // It will also still run again when more submit requests are added; that then can result in multiple calls to the below 'subscribe'
         // function - so that must be able to deal with that.
-        if (acquired < n)
-          m_command_buffer_pool.subscribe(n - acquired, this, need_action);
+        if (missing_command_buffers > 0)
+          m_command_buffer_pool.subscribe(missing_command_buffers, this, need_action);
       }
       if (producer_not_finished())
         break;
@@ -168,13 +289,30 @@ void ImmediateSubmitQueue::multiplex_impl(state_type run_state)
       [[fallthrough]];
     }
     case ImmediateSubmitQueue_done:
+      stop_batch_timer();
       finish();
       break;
   }
 }
 
+void ImmediateSubmitQueue::stop_batch_timer()
+{
+  if (m_batch_timer_running)
+  {
+    m_batch_timer_running = false;
+    if (!m_batch_timer.stop())
+    {
+      // The timer already fired, or is calling expire() right now. Wait until it returned from expire().
+      // The resulting need_action signal is harmless: it just causes an extra run of ImmediateSubmitQueue_need_action.
+      m_batch_timer.wait_for_possible_expire_to_finish();
+    }
+  }
+  m_batch_window_expired.store(false, std::memory_order::relaxed);
+}
+
 void ImmediateSubmitQueue::abort_impl()
 {
+  stop_batch_timer();
   m_semaphore.remove_poll();
   flush_new_data([](ImmediateSubmitRequest&& submit_request){
     submit_request.abort();
@@ -189,4 +327,18 @@ void ImmediateSubmitQueue::terminate()
   abort();
 }
 
+void ImmediateSubmitQueue::print_statistics_on(std::ostream& os) const
+{
+  double const seconds = m_submits == 0 ? 0.0 : std::chrono::duration<double>(std::chrono::steady_clock::now() - m_first_submit).count();
+  os << "{batching:" << std::boolalpha << m_batching <<
+      ", submits:" << m_submits <<
+      ", command_buffers:" << m_submitted_command_buffers <<
+      ", requests:" << m_submitted_requests <<
+      ", bytes:" << m_submitted_bytes;
+  if (seconds > 0.0)
+    os << ", submits/s:" << (m_submits / seconds) <<
+        ", MB/s:" << (m_submitted_bytes / seconds / (1024 * 1024));
+  os << '}';
+}
+
 } // namespace vulkan::task
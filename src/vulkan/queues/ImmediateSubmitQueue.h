@@ -7,6 +7,9 @@
 #include "../TimelineSemaphore.h"
 #include "../vk_utils/TaskToTaskDeque.h"
 #include "statefultask/DefaultMemoryPagePool.h"
+#include "threadpool/Timer.h"
+#include <atomic>
+#include <chrono>
 
 namespace vulkan::task {
 
@@ -22,6 +25,26 @@ class ImmediateSubmitQueue final : public vk_utils::TaskToTaskDeque<PersistentAs
   container_type::const_iterator m_last_submitted;                      // Pointer to the last ImmediateSubmitRequest associated with the pending requests.
                                                                         // Only valid if m_pending_requests > 0.
 
+  // Batching.
+  //
+  // If m_batching is set then the transfers of all batchable requests (see ImmediateSubmitRequest::set_batch_function)
+  // that are received within a short window (see ImmediateSubmitQueue.cxx) are recorded into a single command buffer,
+  // with merged barriers, unless s_max_batch_requests requests or s_max_batch_bytes bytes are queued before the window expires.
+  // A request that arrives while no other request is queued or being executed is submitted immediately.
+  static constexpr int s_max_batch_requests = 64;
+  static constexpr vk::DeviceSize s_max_batch_bytes = 16 * 1024 * 1024;
+  bool const m_batching;                                                // Copy of LogicalDevice::batch_immediate_submits().
+  std::atomic<bool> m_batch_window_expired{false};                      // Set by m_batch_timer.
+  bool m_batch_timer_running{false};                                    // Set while m_batch_timer was started and not stopped yet.
+  threadpool::Timer m_batch_timer{[this](){ m_batch_window_expired.store(true, std::memory_order::relaxed); signal(need_action); }};
+
+  // Statistics.
+  size_t m_submits{};                                                   // The number of calls to Queue::submit.
+  size_t m_submitted_command_buffers{};                                 // The total number of command buffers submitted.
+  size_t m_submitted_requests{};                                        // The total number of requests submitted.
+  vk::DeviceSize m_submitted_bytes{};                                   // The total number of bytes transferred by batchable requests.
+  std::chrono::steady_clock::time_point m_first_submit;                 // The time of the first submit.
+
   // The different states of the task.
   enum ImmediateSubmitQueue_state_type {
     ImmediateSubmitQueue_need_action = direct_base_type::state_end,
@@ -39,6 +62,9 @@ class ImmediateSubmitQueue final : public vk_utils::TaskToTaskDeque<PersistentAs
   void multiplex_impl(state_type run_state) override;
   void abort_impl() override;
 
+ private:
+  void stop_batch_timer();
+
  public:
   ImmediateSubmitQueue(
     // Arguments for m_command_buffer_pool.
@@ -49,6 +75,9 @@ class ImmediateSubmitQueue final : public vk_utils::TaskToTaskDeque<PersistentAs
   void wait_for(uint64_t signal_value) { m_semaphore.wait_for(signal_value); }
 
   void terminate();
+
+  // Print the number of submits per second and the upload throughput.
+  void print_statistics_on(std::ostream& os) const;
 };
 
 } // namespace vulkan::task
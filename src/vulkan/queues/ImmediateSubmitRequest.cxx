@@ -19,7 +19,9 @@ void ImmediateSubmitRequest::print_on(std::ostream& os) const
 {
   os << "{m_logical_device:" << m_logical_device <<
     ", m_queue_request_key:" << m_queue_request_key <<
-    ", m_record_function:" << (m_record_function ? "<set>" : "nullptr") << '}';
+    ", m_record_function:" << (m_record_function ? "<set>" : "nullptr") <<
+    ", m_batch_function:" << (m_batch_function ? "<set>" : "nullptr") <<
+    ", m_batch_bytes:" << m_batch_bytes << '}';
 }
 #endif
 
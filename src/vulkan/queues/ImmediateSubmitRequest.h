@@ -3,6 +3,7 @@
 #include "../LogicalDevice.h"
 #include "../CommandBuffer.h"
 #include "QueueRequestKey.h"
+#include "TransferBatch.h"
 #include <functional>
 
 namespace vulkan {
@@ -17,6 +18,7 @@ class ImmediateSubmitRequest
  public:
   static constexpr vk::CommandPoolCreateFlags::MaskType pool_type = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
   using record_function_type = std::function<void(handle::CommandBuffer)>;
+  using batch_function_type = std::function<void(TransferBatch&)>;
 
  private:
   // Filled by set_* functions before running the task.
@@ -24,6 +26,8 @@ class ImmediateSubmitRequest
   task::ImmediateSubmit* m_immediate_submit;            // The ImmediateSubmit task that issued this request.
   QueueRequestKey m_queue_request_key;                  // Key that uniquely maps to a queue (request/reply) to use.
   record_function_type m_record_function;               // Callback function that will record the command buffer.
+  batch_function_type m_batch_function;                 // Alternatively, callback function that adds the commands to a TransferBatch.
+  vk::DeviceSize m_batch_bytes{};                       // The number of bytes transferred by the commands added by m_batch_function.
   // Filled in after submitting.
   mutable handle::CommandBuffer m_command_buffer{};     // Acquired command buffer that was recorded into (if any).
   mutable uint64_t m_signal_value;                      // Signal value used with the timeline semaphore when this command buffer was submitted.
@@ -40,6 +44,8 @@ class ImmediateSubmitRequest
     m_logical_device = orig.m_logical_device;
     m_queue_request_key = orig.m_queue_request_key;
     m_record_function = std::move(orig.m_record_function);
+    m_batch_function = std::move(orig.m_batch_function);
+    m_batch_bytes = orig.m_batch_bytes;
     return *this;
   }
 
@@ -47,6 +53,8 @@ class ImmediateSubmitRequest
   void set_logical_device(LogicalDevice const* logical_device) { m_logical_device = logical_device; }
   void set_queue_request_key(QueueRequestKey queue_request_key) { m_queue_request_key = queue_request_key; }
   void set_record_function(record_function_type&& record_function) { m_record_function = std::move(record_function); }
+  // Use this instead of set_record_function to allow the commands to be recorded together with those of other requests.
+  void set_batch_function(batch_function_type&& batch_function, vk::DeviceSize bytes) { m_batch_function = std::move(batch_function); m_batch_bytes = bytes; }
   // Called by ImmediateSubmitQueue_need_action.
   void set_command_buffer_and_signal_value(handle::CommandBuffer command_buffer, uint64_t signal_value) const { m_command_buffer = command_buffer; m_signal_value = signal_value; }
 
@@ -60,9 +68,33 @@ class ImmediateSubmitRequest
     return m_queue_request_key;
   }
 
+  bool is_batchable() const
+  {
+    return static_cast<bool>(m_batch_function);
+  }
+
+  vk::DeviceSize batch_bytes() const
+  {
+    return m_batch_bytes;
+  }
+
+  // Record the commands of this request, as the only request, into command_buffer.
   void record_commands(handle::CommandBuffer command_buffer) const
   {
-    m_record_function(command_buffer);
+    if (m_record_function)
+    {
+      m_record_function(command_buffer);
+      return;
+    }
+    TransferBatch transfer_batch;
+    m_batch_function(transfer_batch);
+    transfer_batch.record(command_buffer);
+  }
+
+  // Add the commands of this request to transfer_batch. Only call this when is_batchable() returns true.
+  void add_to_batch(TransferBatch& transfer_batch) const
+  {
+    m_batch_function(transfer_batch);
   }
 
   handle::CommandBuffer command_buffer() const
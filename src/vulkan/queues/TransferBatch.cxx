@@ -0,0 +1,148 @@
+#include "sys.h"
+#include "TransferBatch.h"
+#include "../vk_utils/format.h"
+#include <algorithm>
+#include <iterator>
+#include "debug.h"
+
+namespace vulkan {
+
+void TransferBatch::pre_transfer_barrier(vk::PipelineStageFlags generating_stages, vk::BufferMemoryBarrier const& buffer_memory_barrier)
+{
+  m_generating_stages |= generating_stages;
+  m_pre_buffer_barriers.push_back(buffer_memory_barrier);
+}
+
+void TransferBatch::pre_transfer_barrier(vk::PipelineStageFlags generating_stages, vk::ImageMemoryBarrier const& image_memory_barrier)
+{
+  m_generating_stages |= generating_stages;
+  m_pre_image_barriers.push_back(image_memory_barrier);
+}
+
+void TransferBatch::copy_buffer(vk::Buffer vh_source, vk::Buffer vh_destination, vk::BufferCopy const& region)
+{
+  m_buffer_copies.push_back({vh_source, vh_destination, region});
+}
+
+void TransferBatch::copy_buffer_to_image(vk::Buffer vh_source, vk::Image vh_destination, vk::ImageLayout destination_layout, std::vector<vk::BufferImageCopy>&& regions)
+{
+  m_buffer_to_image_copies.push_back({vh_source, vh_destination, destination_layout, std::move(regions)});
+}
+
+void TransferBatch::generate_mipmaps(vk::Image vh_image, vk::Extent2D extent, vk::ImageSubresourceRange const& subresource_range)
+{
+  m_generate_mipmaps.push_back({vh_image, extent, subresource_range});
+}
+
+void TransferBatch::post_transfer_barrier(vk::PipelineStageFlags consuming_stages, vk::BufferMemoryBarrier const& buffer_memory_barrier)
+{
+  m_consuming_stages |= consuming_stages;
+  m_post_buffer_barriers.push_back(buffer_memory_barrier);
+}
+
+void TransferBatch::post_transfer_barrier(vk::PipelineStageFlags consuming_stages, vk::ImageMemoryBarrier const& image_memory_barrier)
+{
+  m_consuming_stages |= consuming_stages;
+  m_post_image_barriers.push_back(image_memory_barrier);
+}
+
+bool TransferBatch::overlaps(TransferBatch const& other) const
+{
+  for (CopyBuffer const& copy1 : m_buffer_copies)
+    for (CopyBuffer const& copy2 : other.m_buffer_copies)
+      if (copy1.m_vh_destination == copy2.m_vh_destination &&
+          copy1.m_region.dstOffset < copy2.m_region.dstOffset + copy2.m_region.size &&
+          copy2.m_region.dstOffset < copy1.m_region.dstOffset + copy1.m_region.size)
+        return true;
+  // Images also change layout; never batch two transfers to the same image.
+  for (CopyBufferToImage const& copy1 : m_buffer_to_image_copies)
+    for (CopyBufferToImage const& copy2 : other.m_buffer_to_image_copies)
+      if (copy1.m_vh_destination == copy2.m_vh_destination)
+        return true;
+  return false;
+}
+
+void TransferBatch::append(TransferBatch&& other)
+{
+  auto move_append = [](auto& to, auto& from){
+    to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+  };
+  m_generating_stages |= other.m_generating_stages;
+  move_append(m_pre_buffer_barriers, other.m_pre_buffer_barriers);
+  move_append(m_pre_image_barriers, other.m_pre_image_barriers);
+  move_append(m_buffer_copies, other.m_buffer_copies);
+  move_append(m_buffer_to_image_copies, other.m_buffer_to_image_copies);
+  move_append(m_generate_mipmaps, other.m_generate_mipmaps);
+  m_consuming_stages |= other.m_consuming_stages;
+  move_append(m_post_buffer_barriers, other.m_post_buffer_barriers);
+  move_append(m_post_image_barriers, other.m_post_image_barriers);
+}
+
+//static
+void TransferBatch::record_generate_mipmaps(handle::CommandBuffer command_buffer, GenerateMipmaps const& generate_mipmaps)
+{
+  vk::ImageSubresourceRange const& range = generate_mipmaps.m_subresource_range;
+  vk::ImageMemoryBarrier barrier{
+    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+    .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+    .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+    .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+    .image = generate_mipmaps.m_vh_image,
+    .subresourceRange = {
+      .aspectMask = range.aspectMask,
+      .levelCount = 1,
+      .baseArrayLayer = range.baseArrayLayer,
+      .layerCount = range.layerCount
+    }
+  };
+
+  uint32_t const level_end = range.baseMipLevel + range.levelCount;
+  for (uint32_t level = range.baseMipLevel; level < level_end; ++level)
+  {
+    // Wait until level was written and make it the source of the next blit.
+    barrier.subresourceRange.baseMipLevel = level;
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(0), {}, {}, { barrier });
+    if (level + 1 == level_end)
+      break;
+
+    vk::Extent2D const source_extent = vk_utils::mip_level_extent(generate_mipmaps.m_extent, level);
+    vk::Extent2D const destination_extent = vk_utils::mip_level_extent(generate_mipmaps.m_extent, level + 1);
+    vk::ImageBlit const blit{
+      .srcSubresource = { .aspectMask = range.aspectMask, .mipLevel = level, .baseArrayLayer = range.baseArrayLayer, .layerCount = range.layerCount },
+      .srcOffsets = std::array<vk::Offset3D, 2>{ vk::Offset3D{}, vk::Offset3D{ static_cast<int32_t>(source_extent.width), static_cast<int32_t>(source_extent.height), 1 } },
+      .dstSubresource = { .aspectMask = range.aspectMask, .mipLevel = level + 1, .baseArrayLayer = range.baseArrayLayer, .layerCount = range.layerCount },
+      .dstOffsets = std::array<vk::Offset3D, 2>{ vk::Offset3D{}, vk::Offset3D{ static_cast<int32_t>(destination_extent.width), static_cast<int32_t>(destination_extent.height), 1 } }
+    };
+    command_buffer.blitImage(generate_mipmaps.m_vh_image, vk::ImageLayout::eTransferSrcOptimal,
+        generate_mipmaps.m_vh_image, vk::ImageLayout::eTransferDstOptimal, { blit }, vk::Filter::eLinear);
+  }
+}
+
+void TransferBatch::record(handle::CommandBuffer command_buffer) const
+{
+  DoutEntering(dc::vulkan, "TransferBatch::record(" << command_buffer << ") with " <<
+      (m_buffer_copies.size() + m_buffer_to_image_copies.size()) << " copy commands.");
+
+  command_buffer.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+  if (!m_pre_buffer_barriers.empty() || !m_pre_image_barriers.empty())
+    command_buffer.pipelineBarrier(m_generating_stages, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(0), {},
+        m_pre_buffer_barriers, m_pre_image_barriers);
+
+  for (CopyBuffer const& copy : m_buffer_copies)
+    command_buffer.copyBuffer(copy.m_vh_source, copy.m_vh_destination, { copy.m_region });
+  for (CopyBufferToImage const& copy : m_buffer_to_image_copies)
+    command_buffer.copyBufferToImage(copy.m_vh_source, copy.m_vh_destination, copy.m_destination_layout, copy.m_regions);
+  for (GenerateMipmaps const& generate_mipmaps : m_generate_mipmaps)
+    record_generate_mipmaps(command_buffer, generate_mipmaps);
+
+  if (!m_post_buffer_barriers.empty() || !m_post_image_barriers.empty())
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, m_consuming_stages, vk::DependencyFlags(0), {},
+        m_post_buffer_barriers, m_post_image_barriers);
+
+  command_buffer.end();
+}
+
+} // namespace vulkan
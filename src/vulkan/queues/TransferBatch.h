@@ -0,0 +1,83 @@
+#pragma once
+
+#include "../CommandBuffer.h"
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+namespace vulkan {
+
+// The commands of one or more transfers, to be recorded into a single command buffer.
+//
+// Each transfer adds the barriers that it needs before and after its copy commands;
+// record then records all "pre" barriers with a single vkCmdPipelineBarrier, followed
+// by all copy commands and finally all "post" barriers with a single vkCmdPipelineBarrier.
+//
+// This is only correct when the transfers of a batch do not write to the same memory;
+// use overlaps to test that before calling append.
+class TransferBatch
+{
+ private:
+  struct CopyBuffer
+  {
+    vk::Buffer m_vh_source;
+    vk::Buffer m_vh_destination;
+    vk::BufferCopy m_region;
+  };
+
+  struct CopyBufferToImage
+  {
+    vk::Buffer m_vh_source;
+    vk::Image m_vh_destination;
+    vk::ImageLayout m_destination_layout;
+    std::vector<vk::BufferImageCopy> m_regions;
+  };
+
+  struct GenerateMipmaps
+  {
+    vk::Image m_vh_image;
+    vk::Extent2D m_extent;                              // The extent of the first level.
+    vk::ImageSubresourceRange m_subresource_range;
+  };
+
+  vk::PipelineStageFlags m_generating_stages;                   // The union of the source stages of all pre_transfer barriers.
+  std::vector<vk::BufferMemoryBarrier> m_pre_buffer_barriers;
+  std::vector<vk::ImageMemoryBarrier> m_pre_image_barriers;
+  std::vector<CopyBuffer> m_buffer_copies;
+  std::vector<CopyBufferToImage> m_buffer_to_image_copies;
+  std::vector<GenerateMipmaps> m_generate_mipmaps;
+  vk::PipelineStageFlags m_consuming_stages;                    // The union of the destination stages of all post_transfer barriers.
+  std::vector<vk::BufferMemoryBarrier> m_post_buffer_barriers;
+  std::vector<vk::ImageMemoryBarrier> m_post_image_barriers;
+
+ public:
+  // Add a barrier that must be executed before the copy commands.
+  void pre_transfer_barrier(vk::PipelineStageFlags generating_stages, vk::BufferMemoryBarrier const& buffer_memory_barrier);
+  void pre_transfer_barrier(vk::PipelineStageFlags generating_stages, vk::ImageMemoryBarrier const& image_memory_barrier);
+
+  // Add copy commands.
+  void copy_buffer(vk::Buffer vh_source, vk::Buffer vh_destination, vk::BufferCopy const& region);
+  void copy_buffer_to_image(vk::Buffer vh_source, vk::Image vh_destination, vk::ImageLayout destination_layout, std::vector<vk::BufferImageCopy>&& regions);
+
+  // Fill the mip levels of subresource_range, except the first, by repeatedly blitting the previous level (after all copy commands).
+  // Expects all levels to be in eTransferDstOptimal and leaves all of them in eTransferSrcOptimal.
+  // This requires a queue with graphics support.
+  void generate_mipmaps(vk::Image vh_image, vk::Extent2D extent, vk::ImageSubresourceRange const& subresource_range);
+
+  // Add a barrier that must be executed after the copy commands.
+  void post_transfer_barrier(vk::PipelineStageFlags consuming_stages, vk::BufferMemoryBarrier const& buffer_memory_barrier);
+  void post_transfer_barrier(vk::PipelineStageFlags consuming_stages, vk::ImageMemoryBarrier const& image_memory_barrier);
+
+  // Return true if this batch and other write to the same buffer range or image.
+  bool overlaps(TransferBatch const& other) const;
+
+  // Move all commands of other to this batch.
+  void append(TransferBatch&& other);
+
+  // Begin command_buffer, record all commands of this batch and end it again.
+  void record(handle::CommandBuffer command_buffer) const;
+
+ private:
+  static void record_generate_mipmaps(handle::CommandBuffer command_buffer, GenerateMipmaps const& generate_mipmaps);
+};
+
+} // namespace vulkan
@@ -1,5 +1,6 @@
 #include "sys.h"
 #include "SPIRVCache.h"
+#include "SPIRVDiskCache.h"
 #include "LogicalDevice.h"
 #include "SynchronousWindow.h"
 #include "utils/AIAlert.h"
@@ -7,6 +8,7 @@
 #include <shaderc/shaderc.hpp>
 #include <fstream>
 #include <functional>
+#include <chrono>
 #include "debug.h"
 #ifdef CWDEBUG
 #include <sstream>
@@ -103,13 +105,27 @@ void SPIRVCache::reset()
   m_spirv_code.clear();
 }
 
-void SPIRVCache::compile(std::string_view glsl_source_code, ShaderCompiler const& compiler, ShaderInfo const& shader_info)
+void SPIRVCache::compile(std::string_view glsl_source_code, ShaderCompiler const& compiler, ShaderInfo const& shader_info, SPIRVDiskCache* disk_cache)
 {
-  DoutEntering(dc::vulkan, "SPIRVCache::compile(...)");
+  DoutEntering(dc::vulkan, "SPIRVCache::compile(..., " << disk_cache << ")");
 
   // Call reset() before reusing a SPIRVCache.
   ASSERT(m_spirv_code.empty());
+
+  if (!disk_cache || !disk_cache->enabled())
+  {
+    m_spirv_code = compiler.compile({}, shader_info, glsl_source_code);
+    return;
+  }
+
+  SPIRVDiskCache::Key const key = SPIRVDiskCache::make_key(glsl_source_code, shader_info);
+  if (disk_cache->load(key, m_spirv_code))
+    return;
+
+  auto start = std::chrono::steady_clock::now();
   m_spirv_code = compiler.compile({}, shader_info, glsl_source_code);
+  disk_cache->add_compile_time(std::chrono::steady_clock::now() - start);
+  disk_cache->store(key, m_spirv_code);
 }
 
 vk::UniqueShaderModule SPIRVCache::create_module(utils::Badge<vulkan::pipeline::AddShaderStage>, vulkan::LogicalDevice const* logical_device
@@ -14,6 +14,7 @@ namespace vulkan {
 
 namespace task {
 class SynchronousWindow;
+class CompileShader;
 } // namespace task
 
 #ifdef CWDEBUG
@@ -27,6 +28,7 @@ class AddShaderStage;
 namespace shader_builder {
 
 class ShaderCompiler;
+class SPIRVDiskCache;
 
 // Objects of this type should be used to keep a cache of compiled SPIR-V code
 // when for whatever reason you need to recreate a ShaderModule but don't want
@@ -38,7 +40,19 @@ class SPIRVCache
 
  public:
   // Compile the code in glsl_source_code (as returned from preprocess) and cache it in m_spirv_code.
-  void compile(std::string_view glsl_source_code, ShaderCompiler const& compiler, ShaderInfo const& shader_info);
+  // If disk_cache is non-null and enabled then the SPIR-V code is first looked up in (and after compilation stored to) that cache.
+  void compile(std::string_view glsl_source_code, ShaderCompiler const& compiler, ShaderInfo const& shader_info, SPIRVDiskCache* disk_cache = nullptr);
+
+  // Set m_spirv_code to a copy of previously compiled SPIR-V code.
+  void set_spirv_code(utils::Badge<task::CompileShader>, std::vector<uint32_t> const& spirv_code)
+  {
+    // Call reset() before reusing a SPIRVCache.
+    ASSERT(m_spirv_code.empty());
+    m_spirv_code = spirv_code;
+  }
+
+  // Accessor.
+  std::vector<uint32_t> const& spirv_code() const { return m_spirv_code; }
 
   // Create handle from cached SPIR-V code.
   vk::UniqueShaderModule create_module(
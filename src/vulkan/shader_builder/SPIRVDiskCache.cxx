@@ -0,0 +1,262 @@
+#include "sys.h"
+#include "SPIRVDiskCache.h"
+#include "ShaderInfo.h"
+#include <shaderc/shaderc.h>
+#include <farmhash.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+#include "debug.h"
+
+// Defined by CMake (the version of shaderc that we link with, as reported by pkg-config).
+#ifndef LV_SHADERC_VERSION
+#error "LV_SHADERC_VERSION must be defined"
+#endif
+
+namespace vulkan::shader_builder {
+
+namespace {
+
+// The header of each cache file.
+struct FileHeader
+{
+  static constexpr uint32_t s_magic = 0x43535650;       // "PVSC" (little endian).
+
+  uint32_t magic;
+  uint32_t version;
+  uint64_t key_low;
+  uint64_t key_high;
+  uint64_t number_of_words;
+};
+
+// The first word of every SPIR-V module.
+constexpr uint32_t spirv_magic_number = 0x07230203;
+
+} // namespace
+
+std::string SPIRVDiskCache::Key::filename() const
+{
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0') << std::setw(16) << m_high << std::setw(16) << m_low << ".spv";
+  return oss.str();
+}
+
+void SPIRVDiskCache::initialize(std::filesystem::path const& directory, std::uintmax_t max_size)
+{
+  DoutEntering(dc::vulkan, "SPIRVDiskCache::initialize(" << directory << ", " << max_size << ")");
+
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  if (ec)
+  {
+    Dout(dc::warning, "Could not create SPIR-V cache directory " << directory << ": " << ec.message() << ". SPIR-V disk cache disabled.");
+    return;
+  }
+
+  m_directory = directory;
+  m_max_size = max_size;
+
+  // Determine the current total size of the cache and clean up stale temporary files.
+  std::uintmax_t total_size = 0;
+  for (auto const& entry : std::filesystem::directory_iterator(m_directory, ec))
+  {
+    if (!entry.is_regular_file(ec))
+      continue;
+    if (entry.path().extension() != ".spv")
+    {
+      // Left behind by a crash while writing a new entry.
+      std::filesystem::remove(entry.path(), ec);
+      continue;
+    }
+    total_size += entry.file_size(ec);
+  }
+  m_total_size = total_size;
+  Dout(dc::vulkan, "Total size of SPIR-V disk cache: " << total_size << " bytes.");
+
+  if (total_size > m_max_size)
+    evict();
+}
+
+//static
+SPIRVDiskCache::Key SPIRVDiskCache::make_key(std::string_view glsl_source_code, ShaderInfo const& shader_info)
+{
+  unsigned int spirv_version;
+  unsigned int spirv_revision;
+  shaderc_get_spv_version(&spirv_version, &spirv_revision);
+
+  // Every part is followed by a separator, so that no two different sets of inputs give the same fingerprint input.
+  std::ostringstream oss;
+  oss << file_format_version << ':' << LV_SHADERC_VERSION << ':' << spirv_version << '.' << spirv_revision << ':' <<
+    static_cast<int>(shader_info.get_shader_kind()) << ':' << shader_info.compiler_options().serialized() << ':';
+  std::string fingerprint_input = oss.str();
+  fingerprint_input.append(glsl_source_code);
+
+  util::uint128_t fingerprint = util::Fingerprint128(fingerprint_input.data(), fingerprint_input.size());
+  return { util::Uint128Low64(fingerprint), util::Uint128High64(fingerprint) };
+}
+
+bool SPIRVDiskCache::load(Key const& key, std::vector<uint32_t>& spirv_code)
+{
+  if (!enabled())
+    return false;
+
+  auto start = std::chrono::steady_clock::now();
+  std::filesystem::path filename = m_directory / key.filename();
+  std::ifstream file(filename, std::ios::binary);
+  if (!file)
+  {
+    m_misses.fetch_add(1, std::memory_order::relaxed);
+    return false;
+  }
+
+  FileHeader header;
+  bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+      header.magic == FileHeader::s_magic &&
+      header.version == file_format_version &&
+      header.key_low == key.m_low && header.key_high == key.m_high &&
+      header.number_of_words > 0;
+  if (valid)
+  {
+    spirv_code.resize(header.number_of_words);
+    valid = file.read(reinterpret_cast<char*>(spirv_code.data()), header.number_of_words * sizeof(uint32_t)) &&
+        file.peek() == std::char_traits<char>::eof() &&
+        spirv_code[0] == spirv_magic_number;
+  }
+  file.close();
+
+  if (!valid)
+  {
+    Dout(dc::warning, "Removing corrupt SPIR-V cache file " << filename << ".");
+    spirv_code.clear();
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(filename, ec);
+    if (!ec && std::filesystem::remove(filename, ec))
+      m_total_size.fetch_sub(std::min(size, m_total_size.load(std::memory_order::relaxed)), std::memory_order::relaxed);
+    m_misses.fetch_add(1, std::memory_order::relaxed);
+    return false;
+  }
+
+  // Mark this entry as recently used.
+  std::error_code ec;
+  std::filesystem::last_write_time(filename, std::filesystem::file_time_type::clock::now(), ec);
+
+  m_hits.fetch_add(1, std::memory_order::relaxed);
+  m_load_time_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order::relaxed);
+  Dout(dc::vulkan, "Loaded " << (spirv_code.size() * sizeof(uint32_t)) << " bytes of SPIR-V code from " << filename << ".");
+  return true;
+}
+
+void SPIRVDiskCache::store(Key const& key, std::vector<uint32_t> const& spirv_code)
+{
+  if (!enabled() || spirv_code.empty())
+    return;
+
+  std::filesystem::path filename = m_directory / key.filename();
+  // Write to a unique temporary file first, so that readers never see a partially written file.
+  std::filesystem::path tmp_filename = filename;
+  tmp_filename += ".tmp." + std::to_string(getpid()) + "." + std::to_string(m_tmp_file_counter.fetch_add(1, std::memory_order::relaxed));
+
+  FileHeader header{
+    .magic = FileHeader::s_magic,
+    .version = file_format_version,
+    .key_low = key.m_low,
+    .key_high = key.m_high,
+    .number_of_words = spirv_code.size()
+  };
+
+  std::error_code ec;
+  {
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (file)
+    {
+      file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+      file.write(reinterpret_cast<char const*>(spirv_code.data()), spirv_code.size() * sizeof(uint32_t));
+      file.close();
+    }
+    if (!file)
+    {
+      Dout(dc::warning, "Failed to write SPIR-V cache file " << tmp_filename << ".");
+      std::filesystem::remove(tmp_filename, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_filename, filename, ec);
+  if (ec)
+  {
+    Dout(dc::warning, "Failed to rename " << tmp_filename << " to " << filename << ": " << ec.message());
+    std::filesystem::remove(tmp_filename, ec);
+    return;
+  }
+
+  m_stores.fetch_add(1, std::memory_order::relaxed);
+  std::uintmax_t const file_size = sizeof(header) + spirv_code.size() * sizeof(uint32_t);
+  if (m_total_size.fetch_add(file_size, std::memory_order::relaxed) + file_size > m_max_size)
+    evict();
+}
+
+void SPIRVDiskCache::evict()
+{
+  DoutEntering(dc::vulkan, "SPIRVDiskCache::evict()");
+
+  // If another thread is already evicting, then leave it to that thread.
+  std::unique_lock<std::mutex> lock(m_eviction_mutex, std::try_to_lock);
+  if (!lock.owns_lock())
+    return;
+
+  struct Entry
+  {
+    std::filesystem::path path;
+    std::filesystem::file_time_type last_write_time;
+    std::uintmax_t size;
+  };
+
+  std::vector<Entry> entries;
+  std::uintmax_t total_size = 0;
+  std::error_code ec;
+  for (auto const& entry : std::filesystem::directory_iterator(m_directory, ec))
+  {
+    if (!entry.is_regular_file(ec) || entry.path().extension() != ".spv")
+      continue;
+    std::uintmax_t size = entry.file_size(ec);
+    if (ec)
+      continue;
+    auto last_write_time = entry.last_write_time(ec);
+    if (ec)
+      continue;
+    entries.emplace_back(entry.path(), last_write_time, size);
+    total_size += size;
+  }
+
+  // Least recently used first.
+  std::sort(entries.begin(), entries.end(), [](Entry const& e1, Entry const& e2){ return e1.last_write_time < e2.last_write_time; });
+
+  std::uintmax_t const low_water_mark = m_max_size / 4 * 3;
+  for (Entry const& entry : entries)
+  {
+    if (total_size <= low_water_mark)
+      break;
+    if (std::filesystem::remove(entry.path, ec))
+    {
+      total_size -= entry.size;
+      m_evictions.fetch_add(1, std::memory_order::relaxed);
+    }
+  }
+  m_total_size = total_size;
+  Dout(dc::vulkan, "Total size of SPIR-V disk cache after eviction: " << total_size << " bytes.");
+}
+
+void SPIRVDiskCache::print_on(std::ostream& os) const
+{
+  using namespace std::chrono;
+  os << "{hits:" << hits() <<
+      ", misses:" << misses() <<
+      ", stores:" << stores() <<
+      ", evictions:" << evictions() <<
+      ", load_time:" << duration_cast<microseconds>(load_time()).count() << " us" <<
+      ", compile_time:" << duration_cast<microseconds>(compile_time()).count() << " us" <<
+      ", total_size:" << total_size() << '}';
+}
+
+} // namespace vulkan::shader_builder
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <iosfwd>
+#ifdef CWDEBUG
+#include "../debug/vulkan_print_on.h"
+#endif
+
+namespace vulkan::shader_builder {
+
+class ShaderInfo;
+
+// A persistent, content addressed cache of compiled SPIR-V code.
+//
+// Each entry is keyed on a 128-bit fingerprint of
+//   - the preprocessed GLSL source code (as passed to SPIRVCache::compile),
+//   - the shader kind,
+//   - the values of all ShaderCompilerOptions that were set (see ShaderCompilerOptions::serialized),
+//   - the version of shaderc that we link with (so that a compiler upgrade invalidates all entries),
+//   - the SPIR-V version/revision that the linked shaderc generates, and
+//   - the file format version below.
+// and stored in its own file in the cache directory (normally Directory::cache / "spirv").
+//
+// Entries are written to a temporary file first and then renamed into place, so that a
+// crash, or another process using the same cache, never sees a partially written entry.
+// When the total size of the cache exceeds m_max_size the least recently used entries
+// are removed until the size drops below three quarters of m_max_size; a cache hit
+// updates the last write time of an entry.
+//
+// All public member functions, except initialize, are thread-safe.
+class SPIRVDiskCache
+{
+ public:
+  static constexpr uint32_t file_format_version = 2;
+  static constexpr std::uintmax_t default_max_size = 32 * 1024 * 1024;        // 32 MiB.
+
+  struct Key
+  {
+    uint64_t m_low;
+    uint64_t m_high;
+
+    // Returns the name of the file that an entry with this key is stored in.
+    std::string filename() const;
+
+    auto operator<=>(Key const& key) const = default;
+  };
+
+ private:
+  std::filesystem::path m_directory;                    // The directory to store the cache files in. Empty when the cache is disabled.
+  std::uintmax_t m_max_size{default_max_size};          // The maximum total size of all cache files, in bytes.
+  std::atomic<std::uintmax_t> m_total_size{0};          // The (approximate) total size of all cache files, in bytes.
+  std::mutex m_eviction_mutex;                          // Only one thread at a time runs evict().
+  std::atomic<unsigned int> m_tmp_file_counter{0};      // Used to generate unique temporary file names.
+
+  // Statistics.
+  std::atomic<size_t> m_hits{0};                        // Number of successful calls to load.
+  std::atomic<size_t> m_misses{0};                      // Number of calls to load that returned false.
+  std::atomic<size_t> m_stores{0};                      // Number of entries written to disk.
+  std::atomic<size_t> m_evictions{0};                   // Number of entries removed by evict().
+  std::atomic<int64_t> m_load_time_ns{0};               // Total time spent in successful calls to load.
+  std::atomic<int64_t> m_compile_time_ns{0};            // Total time spent by shaderc (reported by SPIRVCache::compile).
+
+ public:
+  // Enable the cache, using directory for storage (which is created if it doesn't exist).
+  void initialize(std::filesystem::path const& directory, std::uintmax_t max_size = default_max_size);
+
+  // Returns true if initialize was called.
+  bool enabled() const { return !m_directory.empty(); }
+
+  // Calculate the key for the given (preprocessed) source code.
+  // The hash of the compiler options of shader_info must already have been calculated (see ShaderInfo::hash).
+  // Only stable inputs are used (farmhash and text, no std::hash or boost::hash), so the key is the same for every build.
+  static Key make_key(std::string_view glsl_source_code, ShaderInfo const& shader_info);
+
+  // Try to load the entry for key into spirv_code. Returns true on success.
+  bool load(Key const& key, std::vector<uint32_t>& spirv_code);
+
+  // Store spirv_code on disk under key.
+  void store(Key const& key, std::vector<uint32_t> const& spirv_code);
+
+  // Called by SPIRVCache::compile after a cache miss.
+  void add_compile_time(std::chrono::steady_clock::duration compile_time)
+  {
+    m_compile_time_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(compile_time).count(), std::memory_order::relaxed);
+  }
+
+  // Accessors for the statistics.
+  size_t hits() const { return m_hits.load(std::memory_order::relaxed); }
+  size_t misses() const { return m_misses.load(std::memory_order::relaxed); }
+  size_t stores() const { return m_stores.load(std::memory_order::relaxed); }
+  size_t evictions() const { return m_evictions.load(std::memory_order::relaxed); }
+  std::chrono::nanoseconds load_time() const { return std::chrono::nanoseconds{m_load_time_ns.load(std::memory_order::relaxed)}; }
+  std::chrono::nanoseconds compile_time() const { return std::chrono::nanoseconds{m_compile_time_ns.load(std::memory_order::relaxed)}; }
+  std::uintmax_t total_size() const { return m_total_size.load(std::memory_order::relaxed); }
+
+  // Print the statistics.
+  void print_on(std::ostream& os) const;
+
+ private:
+  // Remove least recently used entries until the total size is less than three quarters of m_max_size.
+  void evict();
+};
+
+} // namespace vulkan::shader_builder
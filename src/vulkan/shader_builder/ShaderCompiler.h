@@ -6,8 +6,10 @@
 #include <shaderc/shaderc.h>
 #include <vulkan/vulkan.hpp>
 #include <boost/container_hash/hash.hpp>
+#include <string>
 #include <string_view>
 #include <vector>
+#include <map>
 #include <set>
 #include "debug.h"
 
@@ -31,7 +33,14 @@ class ShaderCompilerOptions
  private:
   shaderc_compile_options_t m_options;
   std::map<std::string, std::string> m_macro_definitions;       // Macro definitions that are set. Used to calculate a hash for the ShaderCompilerOptions.
-  size_t m_hash{};                                              // The final hash (zero when no macro definitions were added).
+  std::map<std::string, std::string> m_option_values;           // The values of all other options that are set, by option name.
+  std::string m_serialized;                                     // All of the above as text; calculated by calculate_hash.
+  size_t m_hash{};                                              // The final hash (zero when calculate_hash wasn't called yet).
+
+  void set_option_value(std::string const& name, std::string value)
+  {
+    m_option_values[name] = std::move(value);
+  }
 
  public:
   // Default constructor.
@@ -44,7 +53,8 @@ class ShaderCompilerOptions
 
   // Copy constructor.
   ShaderCompilerOptions(ShaderCompilerOptions const& compiler_options) :
-    m_options(shaderc_compile_options_clone(compiler_options.m_options)), m_macro_definitions(compiler_options.m_macro_definitions), m_hash(compiler_options.m_hash)
+    m_options(shaderc_compile_options_clone(compiler_options.m_options)), m_macro_definitions(compiler_options.m_macro_definitions),
+    m_option_values(compiler_options.m_option_values), m_serialized(compiler_options.m_serialized), m_hash(compiler_options.m_hash)
   {
   }
 
@@ -53,6 +63,8 @@ class ShaderCompilerOptions
   {
     std::swap(m_options, compiler_options.m_options);
     std::swap(m_macro_definitions, compiler_options.m_macro_definitions);
+    std::swap(m_option_values, compiler_options.m_option_values);
+    std::swap(m_serialized, compiler_options.m_serialized);
     std::swap(m_hash, compiler_options.m_hash);
   }
 
@@ -61,6 +73,8 @@ class ShaderCompilerOptions
     shaderc_compile_options_release(m_options);
     m_options = shaderc_compile_options_clone(compiler_options.m_options);
     m_macro_definitions = compiler_options.m_macro_definitions;
+    m_option_values = compiler_options.m_option_values;
+    m_serialized = compiler_options.m_serialized;
     m_hash = compiler_options.m_hash;
     return *this;
   }
@@ -71,6 +85,8 @@ class ShaderCompilerOptions
     m_options = compiler_options.m_options;
     compiler_options.m_options = nullptr;
     m_macro_definitions = std::move(compiler_options.m_macro_definitions);
+    m_option_values = std::move(compiler_options.m_option_values);
+    m_serialized = std::move(compiler_options.m_serialized);
     m_hash = compiler_options.m_hash;
     compiler_options.m_hash = 0;
     return *this;
@@ -105,14 +121,20 @@ class ShaderCompilerOptions
 
   void calculate_hash()
   {
-    m_hash = 0xd74a35751489f799;        // Random non-zero value for the case that there are no macro definitions.
-    boost::hash<std::string> string_hash;
+    // Both maps are sorted, so the result doesn't depend on the order in which the options were set.
+    m_serialized.clear();
     for (std::map<std::string, std::string>::value_type const& definition : m_macro_definitions)
-      boost::hash_combine(m_hash, string_hash(definition.first + "=" + definition.second));
+      m_serialized += "-D" + definition.first + "=" + definition.second + "\n";
+    for (std::map<std::string, std::string>::value_type const& option : m_option_values)
+      m_serialized += option.first + "=" + option.second + "\n";
+    m_hash = 0xd74a35751489f799;        // Random non-zero value.
+    boost::hash_combine(m_hash, boost::hash<std::string>{}(m_serialized));
     // Free memory.
     m_macro_definitions.clear();
+    m_option_values.clear();
   }
 
+  // The hash is only meant for in-memory use (it depends on the boost version); use serialized() for anything that is stored.
   std::size_t hash() const
   {
     // First call calculate_hash().
@@ -120,10 +142,19 @@ class ShaderCompilerOptions
     return m_hash;
   }
 
+  // A canonical text representation of all options that were set.
+  std::string const& serialized() const
+  {
+    // First call calculate_hash().
+    ASSERT(m_hash != 0);
+    return m_serialized;
+  }
+
   // Sets the compiler mode to generate debug information in the output.
   ShaderCompilerOptions& set_generate_debug_info()
   {
     shaderc_compile_options_set_generate_debug_info(m_options);
+    set_option_value("generate_debug_info", "1");
     return *this;
   }
 
@@ -132,6 +163,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_optimization_level(shaderc_optimization_level level)
   {
     shaderc_compile_options_set_optimization_level(m_options, level);
+    set_option_value("optimization_level", std::to_string(level));
     return *this;
   }
 
@@ -143,6 +175,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_forced_version_profile(int version, shaderc_profile profile)
   {
     shaderc_compile_options_set_forced_version_profile(m_options, version, profile);
+    set_option_value("forced_version_profile", std::to_string(version) + "," + std::to_string(profile));
     return *this;
   }
 
@@ -153,6 +186,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_suppress_warnings()
   {
     shaderc_compile_options_set_suppress_warnings(m_options);
+    set_option_value("suppress_warnings", "1");
     return *this;
   }
 
@@ -164,6 +198,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_target_env(shaderc_target_env target, uint32_t version)
   {
     shaderc_compile_options_set_target_env(m_options, target, version);
+    set_option_value("target_env", std::to_string(target) + "," + std::to_string(version));
     return *this;
   }
 
@@ -175,6 +210,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_target_spirv(shaderc_spirv_version version)
   {
     shaderc_compile_options_set_target_spirv(m_options, version);
+    set_option_value("target_spirv", std::to_string(version));
     return *this;
   }
 
@@ -185,6 +221,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_warnings_as_errors()
   {
     shaderc_compile_options_set_warnings_as_errors(m_options);
+    set_option_value("warnings_as_errors", "1");
     return *this;
   }
 
@@ -192,6 +229,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_limit(shaderc_limit limit, int value)
   {
     shaderc_compile_options_set_limit(m_options, limit, value);
+    set_option_value("limit:" + std::to_string(limit), std::to_string(value));
     return *this;
   }
 
@@ -200,6 +238,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_auto_bind_uniforms(bool auto_bind)
   {
     shaderc_compile_options_set_auto_bind_uniforms(m_options, auto_bind);
+    set_option_value("auto_bind_uniforms", std::to_string(auto_bind));
     return *this;
   }
 
@@ -208,6 +247,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_auto_combined_image_sampler(bool upgrade)
   {
     shaderc_compile_options_set_auto_combined_image_sampler(m_options, upgrade);
+    set_option_value("auto_combined_image_sampler", std::to_string(upgrade));
     return *this;
   }
 
@@ -217,6 +257,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_binding_base(shaderc_uniform_kind kind, uint32_t base)
   {
     shaderc_compile_options_set_binding_base(m_options, kind, base);
+    set_option_value("binding_base:" + std::to_string(kind), std::to_string(base));
     return *this;
   }
 
@@ -226,6 +267,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_binding_base_for_stage(shaderc_shader_kind shader_kind, shaderc_uniform_kind kind, uint32_t base)
   {
     shaderc_compile_options_set_binding_base_for_stage(m_options, shader_kind, kind, base);
+    set_option_value("binding_base_for_stage:" + std::to_string(shader_kind) + "," + std::to_string(kind), std::to_string(base));
     return *this;
   }
 
@@ -234,6 +276,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_auto_map_locations(bool auto_map)
   {
     shaderc_compile_options_set_auto_map_locations(m_options, auto_map);
+    set_option_value("auto_map_locations", std::to_string(auto_map));
     return *this;
   }
 
@@ -241,6 +284,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_invert_y(bool enable)
   {
     shaderc_compile_options_set_invert_y(m_options, enable);
+    set_option_value("invert_y", std::to_string(enable));
     return *this;
   }
 
@@ -251,6 +295,7 @@ class ShaderCompilerOptions
   ShaderCompilerOptions& set_nan_clamp(bool enable)
   {
     shaderc_compile_options_set_nan_clamp(m_options, enable);
+    set_option_value("nan_clamp", std::to_string(enable));
     return *this;
   }
 
@@ -0,0 +1,58 @@
+// Test the index bookkeeping of the bindless texture table (BindlessTextureTable::SlotAllocator).
+//
+// This does not need a logical device: it checks that indices are handed out once,
+// that released indices are reused first and that a full table is detected.
+
+#include "sys.h"
+#include "descriptor/BindlessTextureTable.h"
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <vector>
+#include "debug.h"
+
+int main()
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  using vulkan::descriptor::BindlessTextureTable;
+  using index_type = BindlessTextureTable::index_type;
+
+  constexpr index_type capacity = 8;
+  BindlessTextureTable::SlotAllocator slots(capacity);
+
+  // Fill the table: every index is handed out exactly once.
+  std::set<index_type> allocated;
+  for (index_type n = 0; n < capacity; ++n)
+  {
+    index_type index = slots.allocate();
+    assert(index < capacity && slots.is_in_use(index));
+    [[maybe_unused]] bool inserted = allocated.insert(index).second;
+    assert(inserted);
+  }
+  assert(slots.in_use() == capacity && slots.peak() == capacity);
+  // The table is full.
+  assert(slots.allocate() == BindlessTextureTable::s_invalid_index);
+
+  // Released indices are reused, most recently released first.
+  slots.release(2);
+  slots.release(5);
+  assert(!slots.is_in_use(2) && !slots.is_in_use(5));
+  assert(slots.in_use() == capacity - 2 && slots.free_size() == 2);
+  assert(slots.allocate() == 5);
+  assert(slots.allocate() == 2);
+  assert(slots.allocate() == BindlessTextureTable::s_invalid_index);
+
+  // Release everything; the peak stays.
+  for (index_type index = 0; index < capacity; ++index)
+    slots.release(index);
+  assert(slots.in_use() == 0 && slots.peak() == capacity && slots.free_size() == capacity);
+  for (index_type index = 0; index < capacity; ++index)
+    assert(!slots.is_in_use(index));
+
+  // An index that was never handed out is not in use.
+  BindlessTextureTable::SlotAllocator empty_slots(capacity);
+  assert(!empty_slots.is_in_use(0) && !empty_slots.is_in_use(capacity));
+
+  std::cout << "Success!" << std::endl;
+}
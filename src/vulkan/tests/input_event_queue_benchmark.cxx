@@ -0,0 +1,170 @@
+// Measure the throughput and latency of InputEventQueue.
+//
+// Each producer thread pushes a number of discrete events, with a number of (coalesced) mouse
+// motion updates between every two of them, while the main thread pops events as fast as it can.
+// A push that fails because the queue is full is counted as a drop and retried, so that every
+// event arrives eventually. The latency of an event is the time between the start of its push
+// and the end of the pop that returned it.
+//
+// For comparison, the single producer case is also run with utils::threading::FIFOBuffer, the
+// queue that was used before (which can't be used with more than one producer).
+//
+// Usage: input_event_queue_benchmark [<events per producer> [<motion updates per event>]]
+
+#include "sys.h"
+#include "InputEventQueue.h"
+#include "utils/threading/FIFOBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+constexpr uint32_t capacity = 32;               // The same as SynchronousWindow::s_input_event_queue_capacity.
+
+struct Result
+{
+  double m_events_per_second;
+  size_t m_drops;
+  std::vector<double> m_latencies_us;           // Sorted.
+};
+
+// The event with sequence number keysym of producer.
+vulkan::InputEvent make_event(int producer, uint32_t keysym)
+{
+  return {
+    .mouse_position = { static_cast<int16_t>(producer), 0 },
+    .flags = { {}, (keysym & 1) ? vulkan::EventType::key_press : vulkan::EventType::key_release },
+    .keysym = keysym
+  };
+}
+
+// Run number_of_producers producers that each push events_per_producer events into a queue
+// through push (which must return false when the queue is full), and pop them with pop
+// (which must return true and fill in the event, or return false if the queue is empty).
+template<typename Push, typename Pop>
+Result run(int number_of_producers, uint32_t events_per_producer, Push push, Pop pop)
+{
+  std::vector<std::vector<clock_type::time_point>> push_times(number_of_producers, std::vector<clock_type::time_point>(events_per_producer));
+  std::atomic<size_t> drops{0};
+  std::atomic<bool> go{false};
+
+  std::vector<std::thread> producers;
+  for (int producer = 0; producer < number_of_producers; ++producer)
+    producers.emplace_back([&, producer](){
+      while (!go.load(std::memory_order_acquire))
+        ;
+      size_t local_drops = 0;
+      for (uint32_t keysym = 0; keysym < events_per_producer; ++keysym)
+      {
+        vulkan::InputEvent const event = make_event(producer, keysym);
+        push_times[producer][keysym] = clock_type::now();
+        while (!push(event))
+        {
+          ++local_drops;
+          std::this_thread::yield();
+        }
+      }
+      drops.fetch_add(local_drops, std::memory_order_relaxed);
+    });
+
+  size_t const total = static_cast<size_t>(number_of_producers) * events_per_producer;
+  Result result;
+  result.m_latencies_us.reserve(total);
+  vulkan::InputEvent event;
+  auto const start = clock_type::now();
+  go.store(true, std::memory_order_release);
+  for (size_t received = 0; received < total;)
+  {
+    if (!pop(event))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    auto const now = clock_type::now();
+    result.m_latencies_us.push_back(std::chrono::duration<double, std::micro>(now - push_times[event.mouse_position.x()][event.keysym]).count());
+    ++received;
+  }
+  double const seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  for (std::thread& producer : producers)
+    producer.join();
+
+  result.m_events_per_second = total / seconds;
+  result.m_drops = drops;
+  std::sort(result.m_latencies_us.begin(), result.m_latencies_us.end());
+  return result;
+}
+
+void report(std::string const& name, int number_of_producers, Result const& result)
+{
+  auto percentile = [&](size_t p){ return result.m_latencies_us[(result.m_latencies_us.size() - 1) * p / 100]; };
+  std::cout << std::setw(16) << name << std::setw(11) << number_of_producers << std::setw(16) << std::fixed << std::setprecision(0) <<
+      result.m_events_per_second << std::setw(10) << result.m_drops << std::setprecision(2) << std::setw(12) << percentile(50) <<
+      std::setw(12) << percentile(99) << std::setw(12) << result.m_latencies_us.back() << '\n';
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  uint32_t const events_per_producer = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  int const motion_per_event = argc > 2 ? std::stoi(argv[2]) : 8;
+  int const hardware_threads = std::max(2U, std::thread::hardware_concurrency());
+
+  std::cout << "Events per producer: " << events_per_producer << "; motion updates per event: " << motion_per_event << "; capacity: " << capacity << ".\n";
+  std::cout << std::setw(16) << "queue" << std::setw(11) << "producers" << std::setw(16) << "events/s" << std::setw(10) << "drops" <<
+      std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)" << '\n';
+
+  {
+    // The old queue; a motion event is not coalesced but costs a lock of MovedMousePosition, emulated with a mutex.
+    utils::threading::FIFOBuffer<1, vulkan::InputEvent> fifo_buffer;
+    fifo_buffer.reallocate_buffer(capacity);
+    std::mutex mouse_position_mutex;
+    vulkan::MousePosition mouse_position;
+    Result result = run(1, events_per_producer,
+        [&](vulkan::InputEvent const& event){
+          for (int i = 0; i < motion_per_event; ++i)
+          {
+            std::lock_guard<std::mutex> lock(mouse_position_mutex);
+            mouse_position.set(i, i);
+          }
+          return fifo_buffer.push(&event);
+        },
+        [&](vulkan::InputEvent& event_out){
+          vulkan::InputEvent const* event = fifo_buffer.pop();
+          if (!event)
+            return false;
+          event_out = *event;
+          return true;
+        });
+    report("FIFOBuffer", 1, result);
+  }
+
+  for (int number_of_producers = 1; number_of_producers < hardware_threads; number_of_producers *= 2)
+  {
+    vulkan::InputEventQueue queue;
+    queue.initialize(capacity);
+    Result result = run(number_of_producers, events_per_producer,
+        [&](vulkan::InputEvent const& event){
+          for (int i = 0; i < motion_per_event; ++i)
+            queue.move_mouse(i, i);
+          return queue.push(event);
+        },
+        [&](vulkan::InputEvent& event_out){
+          return queue.pop(event_out);
+        });
+    // The queue counted the drops too.
+    ASSERT(queue.consume_dropped() == result.m_drops);
+    report("InputEventQueue", number_of_producers, result);
+  }
+}
@@ -0,0 +1,112 @@
+// Measure the solution quality and run time of the descriptor set partition optimizer.
+//
+// For each number of elements, random pair scores are generated the same way as
+// PipelineFactory::fill_set_index_hints does (from preferences in the range (-1, 1)),
+// after which the partition is optimized with PartitionOptimizer using different
+// numbers of annealing runs, and with the old random restart search for comparison
+// (given the same amount of time as the default PartitionOptimizer).
+//
+// Usage: partition_benchmark [<max number of sets>]
+
+#include "sys.h"
+#include "pipeline/partitions/PartitionTask.h"
+#include "pipeline/partitions/PartitionOptimizer.h"
+#include "pipeline/partitions/ElementPair.h"
+#include "utils/RandomNumber.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include "debug.h"
+
+namespace {
+
+using namespace vulkan::pipeline::partitions;
+
+// Fill partition_task with random scores: about a third of all pairs gets a non-zero preference.
+void fill_random_scores(PartitionTask& partition_task, utils::RandomNumber& random_number)
+{
+  std::uniform_real_distribution<double> probability_distribution{0.0, 1.0};
+  std::uniform_real_distribution<double> preference_distribution{-0.95, 0.95};
+  for (ElementIndex i1 = partition_task.ibegin(); i1 != partition_task.iend(); ++i1)
+    for (ElementIndex i2 = i1 + 1; i2 != partition_task.iend(); ++i2)
+    {
+      if (random_number.generate(probability_distribution) > 0.33)
+        continue;
+      double preference = random_number.generate(preference_distribution);
+      partition_task.set_score(ElementPair{i1, i2}.score_index(), Score{preference / (1.0 - preference * preference)});
+    }
+  partition_task.initialize_set23_to_score();
+}
+
+// The search that PipelineFactory::fill_set_index_hints used before PartitionOptimizer existed: random restarts
+// followed by a local search, stopping after time_budget.
+Score random_restarts(PartitionTask& partition_task, std::chrono::steady_clock::duration time_budget)
+{
+  auto const deadline = std::chrono::steady_clock::now() + time_budget;
+  Score best_score(negative_inf);
+  do
+  {
+    Partition partition = partition_task.random();
+    Score score = partition.find_local_maximum(partition_task);
+    if (score > best_score)
+      best_score = score;
+  }
+  while (std::chrono::steady_clock::now() < deadline);
+  return best_score;
+}
+
+std::string to_string(Score const& score)
+{
+  if (score.is_infinite())
+    return "inf";
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(3) << score.value();
+  return oss.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  int8_t const max_number_of_sets = argc > 1 ? std::stoi(argv[1]) : 4;
+
+  std::cout << "Max. number of sets: " << static_cast<int>(max_number_of_sets) << ".\n";
+  std::cout << std::setw(9) << "elements" << std::setw(16) << "method" << std::setw(12) << "score" << std::setw(12) << "time (ms)" <<
+      std::setw(14) << "evaluated" << std::setw(10) << "restarts" << '\n';
+
+  utils::RandomNumber random_number(12345);
+  for (int8_t number_of_elements : { 8, 10, 12, 16, 24, 32, 48, 64 })
+  {
+    PartitionTask partition_task(number_of_elements, max_number_of_sets);
+    fill_random_scores(partition_task, random_number);
+
+    auto report = [&](std::string const& method, PartitionOptimizer const& partition_optimizer){
+      auto start = std::chrono::steady_clock::now();
+      PartitionOptimizer::Result result = partition_optimizer.optimize();
+      auto duration = std::chrono::steady_clock::now() - start;
+      double ms = std::chrono::duration<double, std::milli>(duration).count();
+      std::cout << std::setw(9) << static_cast<int>(number_of_elements) << std::setw(16) << method << std::setw(12) << to_string(result.m_score) <<
+          std::setw(12) << std::fixed << std::setprecision(2) << ms << std::setw(14) << result.m_evaluated << std::setw(10) << result.m_restarts << '\n';
+      return duration;
+    };
+
+    PartitionOptimizer exact_optimizer(partition_task);
+    if (exact_optimizer.will_enumerate())
+      report("exact", exact_optimizer);
+    report("anneal x1", PartitionOptimizer(partition_task, 1, 0));
+    auto const time_budget = report("anneal x" + std::to_string(PartitionOptimizer::default_number_of_restarts),
+        PartitionOptimizer(partition_task, PartitionOptimizer::default_number_of_restarts, 0));
+    report("anneal x16", PartitionOptimizer(partition_task, 16, 0));
+
+    auto start = std::chrono::steady_clock::now();
+    Score score = random_restarts(partition_task, time_budget);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::setw(9) << static_cast<int>(number_of_elements) << std::setw(16) << "random restart" << std::setw(12) << to_string(score) <<
+        std::setw(12) << std::fixed << std::setprecision(2) << ms << '\n';
+  }
+}
@@ -0,0 +1,184 @@
+// Compare cold (shaderc) versus warm (SPIRVDiskCache) compile times.
+//
+// The shaders below are the shaders of src/tests/frame_resources_count and src/tests/textures
+// as they look after preprocessing by AddShaderStage::preprocess2 (which needs a running
+// PipelineFactory and therefore can't be used here).
+//
+// Usage: spirv_cache_benchmark [<cache directory> [<iterations>]]
+
+#include "sys.h"
+#include "shader_builder/ShaderInfo.h"
+#include "shader_builder/ShaderCompiler.h"
+#include "shader_builder/SPIRVCache.h"
+#include "shader_builder/SPIRVDiskCache.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "debug.h"
+
+namespace {
+
+constexpr std::string_view intel_vert_glsl = R"glsl(#version 450
+
+layout(location = 0) in vec4 v4_0[2];	// VertexData::m_position
+layout(location = 2) in vec2 v2_0;	// VertexData::m_texture_coordinates
+layout(location = 3) in vec4 v4_1[2];	// InstanceData::m_position
+
+layout(push_constant) uniform PushConstant {
+  float aspect_scale;
+} v_PushConstant;
+
+out gl_PerVertex
+{
+  vec4 gl_Position;
+};
+
+layout(location = 0) out vec2 v_Texcoord;
+layout(location = 1) out float v_Distance;
+
+void main()
+{
+  v_Texcoord = v2_0;
+  v_Distance = 1.0 - v4_1[1].z;                         // Darken with distance.
+
+  vec4 position = v4_0[1];
+  position.y *= v_PushConstant.aspect_scale;            // Adjust to screen aspect ration.
+  position.xy *= pow(v_Distance, 0.5);                  // Scale with distance.
+  gl_Position = position + v4_1[1];
+}
+)glsl";
+
+constexpr std::string_view intel_frag_glsl = R"glsl(#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D CombinedImageSampler_background;
+layout(set = 0, binding = 1) uniform sampler2D CombinedImageSampler_benchmark;
+
+layout(location = 0) in vec2 v_Texcoord;
+layout(location = 1) in float v_Distance;
+
+layout(location = 0) out vec4 o_Color;
+
+void main()
+{
+  vec4 background_image = texture(CombinedImageSampler_background, v_Texcoord);
+  vec4 benchmark_image = texture(CombinedImageSampler_benchmark, v_Texcoord);
+  o_Color = v_Distance * mix(background_image, benchmark_image, benchmark_image.a);
+}
+)glsl";
+
+constexpr std::string_view squares_vert_glsl = R"glsl(#version 450
+
+layout(location = 0) in vec4 v4_0;	// VertexData::m_position
+layout(location = 1) in vec2 v2_0;	// VertexData::m_texture_coordinates
+layout(location = 2) in vec4 v4_1;	// InstanceData::m_position
+
+layout(push_constant) uniform PushConstant {
+  float m_x_position;
+  int m_texture_index;
+} v_PushConstant;
+
+out gl_PerVertex { vec4 gl_Position; };
+layout(location = 0) out vec2 v_Texcoord;
+layout(location = 1) out int instance_index;
+
+void main()
+{
+  instance_index = gl_InstanceIndex;
+  v_Texcoord = v2_0;
+  vec4 position = v4_0;
+  vec4 instance_position = v4_1;
+  position += instance_position;
+  position.x += v_PushConstant.m_x_position;
+  gl_Position = position;
+}
+)glsl";
+
+constexpr std::string_view squares_frag_glsl = R"glsl(#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D CombinedImageSampler_top[];
+layout(set = 1, binding = 0) uniform sampler2D CombinedImageSampler_bottom0[];
+
+layout(push_constant) uniform PushConstant {
+  float m_x_position;
+  int m_texture_index;
+} v_PushConstant;
+
+layout(location = 0) in vec2 v_Texcoord;
+layout(location = 1) flat in int instance_index;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+  if (instance_index == 0)
+    outColor = texture(CombinedImageSampler_top[v_PushConstant.m_texture_index], v_Texcoord);
+  else
+    outColor = texture(CombinedImageSampler_bottom0[v_PushConstant.m_texture_index], v_Texcoord);
+}
+)glsl";
+
+using namespace vulkan::shader_builder;
+
+// Compile all shaders once; return the elapsed time in microseconds.
+long run_pass(std::vector<ShaderInfo> const& shader_infos, ShaderCompiler const& compiler, SPIRVDiskCache* disk_cache)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (ShaderInfo const& shader_info : shader_infos)
+  {
+    SPIRVCache spirv_cache;
+    spirv_cache.compile(shader_info.glsl_template_code(), compiler, shader_info, disk_cache);
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Debug(NAMESPACE_DEBUG::init());
+
+  std::filesystem::path cache_directory = argc > 1 ? std::filesystem::path{argv[1]} : std::filesystem::temp_directory_path() / "spirv_cache_benchmark";
+  int const iterations = argc > 2 ? std::stoi(argv[2]) : 10;
+
+  std::vector<ShaderInfo> shader_infos;
+  shader_infos.emplace_back(vk::ShaderStageFlagBits::eVertex, "intel.vert.glsl");
+  shader_infos.emplace_back(vk::ShaderStageFlagBits::eFragment, "intel.frag.glsl");
+  shader_infos.emplace_back(vk::ShaderStageFlagBits::eVertex, "squares.vert.glsl");
+  shader_infos.emplace_back(vk::ShaderStageFlagBits::eFragment, "squares.frag0.glsl");
+  shader_infos[0].load(intel_vert_glsl);
+  shader_infos[1].load(intel_frag_glsl);
+  shader_infos[2].load(squares_vert_glsl);
+  shader_infos[3].load(squares_frag_glsl);
+  for (ShaderInfo& shader_info : shader_infos)
+    shader_info.hash();         // Calculates the hash of the compiler options.
+
+  ShaderCompiler compiler;
+  compiler.initialize();
+
+  long cold_us = 0;
+  long warm_us = 0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    // Start every cold pass with an empty cache.
+    std::filesystem::remove_all(cache_directory);
+    SPIRVDiskCache disk_cache;
+    disk_cache.initialize(cache_directory);
+    cold_us += run_pass(shader_infos, compiler, &disk_cache);
+    warm_us += run_pass(shader_infos, compiler, &disk_cache);
+    if (i == iterations - 1)
+    {
+      std::cout << "Statistics of last iteration: ";
+      disk_cache.print_on(std::cout);
+      std::cout << '\n';
+    }
+  }
+  std::filesystem::remove_all(cache_directory);
+
+  std::cout << "Compiled " << shader_infos.size() << " shaders " << iterations << " times.\n";
+  std::cout << "Cold (shaderc):           " << (cold_us / iterations) << " us per pass.\n";
+  std::cout << "Warm (SPIR-V disk cache): " << (warm_us / iterations) << " us per pass.\n";
+  if (warm_us > 0)
+    std::cout << "Speed up: " << (static_cast<double>(cold_us) / warm_us) << "x\n";
+}
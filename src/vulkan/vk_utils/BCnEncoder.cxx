@@ -0,0 +1,235 @@
+#include "sys.h"
+#include "BCnEncoder.h"
+#include "MipmapDataFeeder.h"
+#include "format.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "debug.h"
+
+namespace vk_utils {
+
+namespace {
+
+uint16_t to_rgb565(int const rgb[3])
+{
+  return ((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | (rgb[2] * 31 + 127) / 255;
+}
+
+void from_rgb565(uint16_t color, int rgb[3])
+{
+  int const r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Write the 8 byte color part of a BC1/BC3 block, always using four color mode.
+void encode_color(unsigned char const* texels, unsigned char* block)
+{
+  int min[3] = { 255, 255, 255 };
+  int max[3] = { 0, 0, 0 };
+  int sum[3] = { 0, 0, 0 };
+  for (int i = 0; i < 16; ++i)
+    for (int c = 0; c < 3; ++c)
+    {
+      int const v = texels[4 * i + c];
+      min[c] = std::min(min[c], v);
+      max[c] = std::max(max[c], v);
+      sum[c] += v;
+    }
+
+  // Use the diagonal of the bounding box that follows the colors: for every channel that is
+  // anti-correlated with the channel with the largest range, swap its min and max.
+  int const reference = max[1] - min[1] >= max[0] - min[0] ? (max[1] - min[1] >= max[2] - min[2] ? 1 : 2) : (max[0] - min[0] >= max[2] - min[2] ? 0 : 2);
+  for (int c = 0; c < 3; ++c)
+  {
+    if (c == reference)
+      continue;
+    int covariance = 0;
+    for (int i = 0; i < 16; ++i)
+      covariance += (16 * texels[4 * i + reference] - sum[reference]) * (16 * texels[4 * i + c] - sum[c]);
+    if (covariance < 0)
+      std::swap(min[c], max[c]);
+  }
+
+  // Inset the endpoints a little; the extremes are rarely hit exactly.
+  for (int c = 0; c < 3; ++c)
+  {
+    int const inset = (max[c] - min[c]) / 16;
+    max[c] -= inset;
+    min[c] += inset;
+  }
+
+  uint16_t color0 = to_rgb565(max);
+  uint16_t color1 = to_rgb565(min);
+  // Four color mode requires color0 > color1.
+  if (color0 < color1)
+    std::swap(color0, color1);
+
+  uint32_t indices = 0;
+  if (color0 != color1)
+  {
+    int palette[4][3];
+    from_rgb565(color0, palette[0]);
+    from_rgb565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+      int best_index = 0;
+      int best_distance = std::numeric_limits<int>::max();
+      for (int p = 0; p < 4; ++p)
+      {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+          int const d = texels[4 * i + c] - palette[p][c];
+          distance += d * d;
+        }
+        if (distance < best_distance)
+        {
+          best_distance = distance;
+          best_index = p;
+        }
+      }
+      indices |= static_cast<uint32_t>(best_index) << (2 * i);
+    }
+  }
+
+  block[0] = color0 & 0xff;
+  block[1] = color0 >> 8;
+  block[2] = color1 & 0xff;
+  block[3] = color1 >> 8;
+  for (int b = 0; b < 4; ++b)
+    block[4 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+// Write the 8 byte alpha part of a BC3 block, always using eight alpha mode.
+void encode_alpha(unsigned char const* texels, unsigned char* block)
+{
+  int alpha0 = 0;
+  int alpha1 = 255;
+  for (int i = 0; i < 16; ++i)
+  {
+    alpha0 = std::max<int>(alpha0, texels[4 * i + 3]);
+    alpha1 = std::min<int>(alpha1, texels[4 * i + 3]);
+  }
+
+  uint64_t indices = 0;
+  if (alpha0 != alpha1)
+  {
+    int palette[8] = { alpha0, alpha1 };
+    for (int p = 2; p < 8; ++p)
+      palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+    for (int i = 0; i < 16; ++i)
+    {
+      int best_index = 0;
+      int best_distance = std::numeric_limits<int>::max();
+      for (int p = 0; p < 8; ++p)
+      {
+        int const distance = std::abs(texels[4 * i + 3] - palette[p]);
+        if (distance < best_distance)
+        {
+          best_distance = distance;
+          best_index = p;
+        }
+      }
+      indices |= static_cast<uint64_t>(best_index) << (3 * i);
+    }
+  }
+
+  block[0] = alpha0;
+  block[1] = alpha1;
+  for (int b = 0; b < 6; ++b)
+    block[2 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+} // namespace
+
+void encode_bc1_block(unsigned char const* texels, unsigned char* block)
+{
+  encode_color(texels, block);
+}
+
+void encode_bc3_block(unsigned char const* texels, unsigned char* block)
+{
+  encode_alpha(texels, block);
+  encode_color(texels, block + 8);
+}
+
+bool can_encode_bc(vk::Format format)
+{
+  switch (format)
+  {
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbSrgbBlock:
+    case vk::Format::eBc1RgbaUnormBlock:
+    case vk::Format::eBc1RgbaSrgbBlock:
+    case vk::Format::eBc3UnormBlock:
+    case vk::Format::eBc3SrgbBlock:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void encode_bc(vk::Format format, unsigned char const* rgba, vk::Extent2D extent, unsigned char* destination)
+{
+  // Only call this function for formats for which can_encode_bc returns true.
+  ASSERT(can_encode_bc(format));
+  bool const bc3 = format == vk::Format::eBc3UnormBlock || format == vk::Format::eBc3SrgbBlock;
+  uint32_t const block_size = bc3 ? 16 : 8;
+
+  unsigned char texels[16 * 4];
+  for (uint32_t by = 0; by < extent.height; by += 4)
+    for (uint32_t bx = 0; bx < extent.width; bx += 4)
+    {
+      // Gather the block, repeating the last row and/or column at the edges.
+      for (uint32_t y = 0; y < 4; ++y)
+      {
+        unsigned char const* row = rgba + static_cast<size_t>(std::min(by + y, extent.height - 1)) * extent.width * 4;
+        for (uint32_t x = 0; x < 4; ++x)
+          std::copy_n(row + std::min(bx + x, extent.width - 1) * 4, 4, texels + (4 * y + x) * 4);
+      }
+      if (bc3)
+        encode_bc3_block(texels, destination);
+      else
+        encode_bc1_block(texels, destination);
+      destination += block_size;
+    }
+}
+
+BCnDataFeeder::BCnDataFeeder(std::unique_ptr<vulkan::DataFeeder> rgba_data_feeder, vk::Format format, vk::Extent2D extent, uint32_t level_count) :
+  m_rgba_data_feeder(std::move(rgba_data_feeder)), m_format(format), m_extent(extent), m_level_count(level_count),
+  m_size(image_data_size(format, extent, level_count))
+{
+  DoutEntering(dc::vulkan, "BCnDataFeeder::BCnDataFeeder(" << m_rgba_data_feeder << ", " << format << ", " << extent << ", " << level_count << ")");
+}
+
+void BCnDataFeeder::get_chunks(unsigned char* chunk_ptr)
+{
+  std::vector<unsigned char> level = read_all(*m_rgba_data_feeder);
+  ASSERT(level.size() == static_cast<size_t>(m_extent.width) * m_extent.height * 4);
+  std::vector<unsigned char> next_level;
+  for (uint32_t l = 0; l < m_level_count; ++l)
+  {
+    vk::Extent2D const level_extent = mip_level_extent(m_extent, l);
+    if (l > 0)
+    {
+      vk::Extent2D const next_extent = level_extent;
+      next_level.resize(static_cast<size_t>(next_extent.width) * next_extent.height * 4);
+      downsample_rgba8(level.data(), mip_level_extent(m_extent, l - 1), next_level.data());
+      level.swap(next_level);
+    }
+    encode_bc(m_format, level.data(), level_extent, chunk_ptr);
+    chunk_ptr += mip_level_size(m_format, m_extent, l);
+  }
+}
+
+} // namespace vk_utils
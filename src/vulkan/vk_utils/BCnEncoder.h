@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../memory/DataFeeder.h"
+#include <vulkan/vulkan.hpp>
+#include <memory>
+
+namespace vk_utils {
+
+// Compress one block of 4x4 RGBA8 texels (64 bytes, row by row) into 8 bytes of BC1 (opaque).
+void encode_bc1_block(unsigned char const* texels, unsigned char* block);
+
+// Compress one block of 4x4 RGBA8 texels (64 bytes, row by row) into 16 bytes of BC3.
+void encode_bc3_block(unsigned char const* texels, unsigned char* block);
+
+// Compress a tightly packed RGBA8 image with the given extent into format (BC1 or BC3), writing mip_level_size(format, extent, 0) bytes.
+void encode_bc(vk::Format format, unsigned char const* rgba, vk::Extent2D extent, unsigned char* destination);
+
+// Returns true if encode_bc supports format.
+bool can_encode_bc(vk::Format format);
+
+// A DataFeeder that compresses an RGBA8 image, provided by another DataFeeder, into BC1 or BC3, including
+// a full mip chain (generated on the CPU). The wrapped DataFeeder is read completely into memory first.
+//
+// The encoder is a fast "range fit": the endpoints are the extremes of the bounding box of the block (inset
+// a little and along the diagonal that best matches the color distribution). That is good enough for albedo
+// textures; use pre-compressed data (see DDSImageDataFeeder) when quality matters.
+class BCnDataFeeder final : public vulkan::DataFeeder
+{
+ private:
+  std::unique_ptr<vulkan::DataFeeder> m_rgba_data_feeder;
+  vk::Format m_format;
+  vk::Extent2D m_extent;                                // The extent of the first mip level.
+  uint32_t m_level_count;
+  uint32_t m_size;                                      // The size of all compressed mip levels in bytes.
+
+ public:
+  BCnDataFeeder(std::unique_ptr<vulkan::DataFeeder> rgba_data_feeder, vk::Format format, vk::Extent2D extent, uint32_t level_count);
+
+  uint32_t chunk_size() const override { return m_size; }
+  int chunk_count() const override { return 1; }
+  int next_batch() override { return 1; }
+  void get_chunks(unsigned char* chunk_ptr) override;
+};
+
+} // namespace vk_utils
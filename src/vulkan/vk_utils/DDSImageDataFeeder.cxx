@@ -0,0 +1,135 @@
+#include "sys.h"
+#include "DDSImageDataFeeder.h"
+#include "format.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include "debug.h"
+
+namespace vk_utils {
+
+namespace {
+
+uint32_t read_uint32(unsigned char const* ptr)
+{
+  return ptr[0] | ptr[1] << 8 | ptr[2] << 16 | static_cast<uint32_t>(ptr[3]) << 24;
+}
+
+constexpr uint32_t make_fourcc(char const (&fourcc)[5])
+{
+  return fourcc[0] | fourcc[1] << 8 | fourcc[2] << 16 | static_cast<uint32_t>(fourcc[3]) << 24;
+}
+
+// Offsets into the DDS_HEADER structure, which follows the four byte magic number.
+constexpr size_t dds_header_size = 124;
+constexpr size_t dds_height = 8;
+constexpr size_t dds_width = 12;
+constexpr size_t dds_mip_map_count = 24;
+constexpr size_t dds_pixel_format_fourcc = 80;
+
+// The DDS_HEADER_DXT10 structure that follows DDS_HEADER if the four character code is "DX10".
+constexpr size_t dds_dx10_header_size = 20;
+constexpr size_t dds_dx10_dxgi_format = 0;
+constexpr size_t dds_dx10_array_size = 12;
+
+vk::Format dxgi_format_to_vk_format(uint32_t dxgi_format)
+{
+  switch (dxgi_format)
+  {
+    case 71:    // DXGI_FORMAT_BC1_UNORM
+      return vk::Format::eBc1RgbaUnormBlock;
+    case 72:    // DXGI_FORMAT_BC1_UNORM_SRGB
+      return vk::Format::eBc1RgbaSrgbBlock;
+    case 77:    // DXGI_FORMAT_BC3_UNORM
+      return vk::Format::eBc3UnormBlock;
+    case 78:    // DXGI_FORMAT_BC3_UNORM_SRGB
+      return vk::Format::eBc3SrgbBlock;
+    case 98:    // DXGI_FORMAT_BC7_UNORM
+      return vk::Format::eBc7UnormBlock;
+    case 99:    // DXGI_FORMAT_BC7_UNORM_SRGB
+      return vk::Format::eBc7SrgbBlock;
+  }
+  return vk::Format::eUndefined;
+}
+
+} // namespace
+
+DDSImageDataFeeder::DDSImageDataFeeder(std::filesystem::path const& filename) : m_filename(filename)
+{
+  DoutEntering(dc::vulkan, "DDSImageDataFeeder::DDSImageDataFeeder(" << filename << ")");
+
+  m_file = std::fopen(filename.c_str(), "rb");
+  if (!m_file)
+    THROW_ALERT("Could not open file \"[FILENAME]\"", AIArgs("[FILENAME]", filename));
+
+  char const* error = nullptr;
+  std::array<unsigned char, 4 + dds_header_size> header;
+  std::array<unsigned char, dds_dx10_header_size> dx10_header;
+  if (std::fread(header.data(), header.size(), 1, m_file) != 1 || std::memcmp(header.data(), "DDS ", 4) != 0)
+    error = "not a DDS file";
+  else
+  {
+    unsigned char const* dds_header = header.data() + 4;
+    m_extent = vk::Extent2D{ read_uint32(dds_header + dds_width), read_uint32(dds_header + dds_height) };
+    m_level_count = std::max(1U, read_uint32(dds_header + dds_mip_map_count));
+    uint32_t const fourcc = read_uint32(dds_header + dds_pixel_format_fourcc);
+    if (fourcc == make_fourcc("DXT1"))
+      m_format = vk::Format::eBc1RgbaUnormBlock;
+    else if (fourcc == make_fourcc("DXT5"))
+      m_format = vk::Format::eBc3UnormBlock;
+    else if (fourcc == make_fourcc("DX10"))
+    {
+      if (std::fread(dx10_header.data(), dx10_header.size(), 1, m_file) != 1)
+        error = "truncated DX10 header";
+      else if (read_uint32(dx10_header.data() + dds_dx10_array_size) > 1)
+        error = "array textures are not supported";
+      else
+        m_format = dxgi_format_to_vk_format(read_uint32(dx10_header.data() + dds_dx10_dxgi_format));
+    }
+    if (!error && m_format == vk::Format::eUndefined)
+      error = "unsupported pixel format (only BC1, BC3 and BC7 are supported)";
+    else if (!error && (m_extent.width == 0 || m_extent.height == 0 || m_level_count > mip_level_count(m_extent)))
+      error = "invalid extent or mip map count";
+  }
+  if (!error)
+  {
+    m_block_size = format_block_size(m_format);
+    m_block_count = image_data_size(m_format, m_extent, m_level_count) / m_block_size;
+    m_blocks_per_batch = s_batch_size / m_block_size;
+    // Reject a truncated file before anything is uploaded.
+    long const data_start = std::ftell(m_file);
+    std::error_code ec;
+    uintmax_t const file_size = std::filesystem::file_size(filename, ec);
+    if (ec || data_start < 0 || file_size < static_cast<uintmax_t>(data_start) + static_cast<uintmax_t>(m_block_count) * m_block_size)
+      error = "file is truncated";
+  }
+  if (error)
+  {
+    std::fclose(m_file);
+    THROW_ALERT("Could not get image data for file \"[FILENAME]\" ([ERROR])", AIArgs("[FILENAME]", filename)("[ERROR]", error));
+  }
+}
+
+DDSImageDataFeeder::~DDSImageDataFeeder()
+{
+  std::fclose(m_file);
+}
+
+int DDSImageDataFeeder::next_batch()
+{
+  m_batch_blocks = std::min(m_blocks_per_batch, m_block_count - m_next_block);
+  return m_batch_blocks;
+}
+
+void DDSImageDataFeeder::get_chunks(unsigned char* chunk_ptr)
+{
+  size_t const blocks_read = std::fread(chunk_ptr, m_block_size, m_batch_blocks, m_file);
+  // The file was already checked to be large enough, but it could have been truncated since.
+  if (blocks_read < static_cast<size_t>(m_batch_blocks))
+    THROW_ALERT("Could not read block [BLOCK] of file \"[FILENAME]\" (file is truncated)",
+        AIArgs("[BLOCK]", m_next_block + blocks_read)("[FILENAME]", m_filename));
+  m_next_block += m_batch_blocks;
+}
+
+} // namespace vk_utils
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../memory/DataFeeder.h"
+#include <vulkan/vulkan.hpp>
+#include <cstdio>
+#include <filesystem>
+#include "debug.h"
+
+namespace vk_utils {
+
+// A DataFeeder that reads pre-compressed BC1, BC3 or BC7 image data, including any mip levels, from a DDS file.
+//
+// The data is read straight into the staging memory; the constructor only reads the header.
+// Supported are the legacy "DXT1" and "DXT5" four character codes, and the "DX10" extended header
+// with one of the BC1, BC3 or BC7 (UNORM or SRGB) DXGI formats. Only 2D images without array layers.
+//
+// A file that is too small for its header is rejected by the constructor; if it is truncated
+// after that (while it is being read), get_chunks throws an AIAlert::Error, which aborts the upload task.
+class DDSImageDataFeeder final : public vulkan::DataFeeder
+{
+ public:
+  static constexpr uint32_t s_batch_size = 64 * 1024;   // The approximate number of bytes to read per batch.
+
+ private:
+  std::filesystem::path m_filename;                     // For error messages.
+  std::FILE* m_file{};
+  vk::Extent2D m_extent;                                // The extent of the first mip level.
+  vk::Format m_format{};
+  uint32_t m_level_count{};
+  uint32_t m_block_size{};                              // The size of one compressed block in bytes.
+  int m_block_count{};                                  // The total number of blocks of all mip levels.
+  int m_blocks_per_batch{};
+  int m_next_block{};                                   // The first block that get_chunks will read.
+  int m_batch_blocks{};                                 // The number of blocks that get_chunks will read.
+
+ public:
+  DDSImageDataFeeder(std::filesystem::path const& filename);
+  ~DDSImageDataFeeder() override;
+
+  // Accessors.
+  vk::Extent2D extent() const { return m_extent; }
+  vk::Format format() const { return m_format; }
+  uint32_t level_count() const { return m_level_count; }
+
+  // Each chunk is one compressed block.
+  uint32_t chunk_size() const override { return m_block_size; }
+  int chunk_count() const override { return m_block_count; }
+  int next_batch() override;
+  void get_chunks(unsigned char* chunk_ptr) override;
+};
+
+} // namespace vk_utils
@@ -0,0 +1,71 @@
+#include "sys.h"
+#include "MipmapDataFeeder.h"
+#include "format.h"
+#include <algorithm>
+#include <cstring>
+#include "debug.h"
+
+namespace vk_utils {
+
+std::vector<unsigned char> read_all(vulkan::DataFeeder& data_feeder)
+{
+  uint32_t const chunk_size = data_feeder.chunk_size();
+  int const chunk_count = data_feeder.chunk_count();
+  std::vector<unsigned char> data(static_cast<size_t>(chunk_size) * chunk_count);
+  unsigned char* ptr = data.data();
+  int next_batch;
+  for (int chunks = 0; chunks < chunk_count; chunks += next_batch)
+  {
+    next_batch = data_feeder.next_batch();
+    data_feeder.get_chunks(ptr);
+    ptr += static_cast<size_t>(next_batch) * chunk_size;
+  }
+  return data;
+}
+
+void downsample_rgba8(unsigned char const* source, vk::Extent2D source_extent, unsigned char* destination)
+{
+  vk::Extent2D const destination_extent = mip_level_extent(source_extent, 1);
+  size_t const source_row_size = static_cast<size_t>(source_extent.width) * 4;
+  for (uint32_t y = 0; y < destination_extent.height; ++y)
+  {
+    unsigned char const* row0 = source + std::min(2 * y, source_extent.height - 1) * source_row_size;
+    unsigned char const* row1 = source + std::min(2 * y + 1, source_extent.height - 1) * source_row_size;
+    for (uint32_t x = 0; x < destination_extent.width; ++x)
+    {
+      uint32_t const x0 = std::min(2 * x, source_extent.width - 1) * 4;
+      uint32_t const x1 = std::min(2 * x + 1, source_extent.width - 1) * 4;
+      for (int c = 0; c < 4; ++c)
+        *destination++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+    }
+  }
+}
+
+MipmapDataFeeder::MipmapDataFeeder(std::unique_ptr<vulkan::DataFeeder> level0_data_feeder, vk::Format format, vk::Extent2D extent, uint32_t level_count) :
+  m_level0_data_feeder(std::move(level0_data_feeder)), m_format(format), m_extent(extent), m_level_count(level_count),
+  m_size(image_data_size(format, extent, level_count))
+{
+  DoutEntering(dc::vulkan, "MipmapDataFeeder::MipmapDataFeeder(" << m_level0_data_feeder << ", " << format << ", " << extent << ", " << level_count << ")");
+  // Only formats with four 8-bit components are supported.
+  ASSERT(!format_is_compressed(format) && format_block_size(format) == 4 && format_component_count(format) == 4);
+}
+
+void MipmapDataFeeder::get_chunks(unsigned char* chunk_ptr)
+{
+  // Don't read back from chunk_ptr (it likely points to write-combined memory); keep the previous level on the heap.
+  std::vector<unsigned char> level = read_all(*m_level0_data_feeder);
+  ASSERT(level.size() == mip_level_size(m_format, m_extent, 0));
+  std::memcpy(chunk_ptr, level.data(), level.size());
+  chunk_ptr += level.size();
+  std::vector<unsigned char> next_level;
+  for (uint32_t l = 1; l < m_level_count; ++l)
+  {
+    next_level.resize(mip_level_size(m_format, m_extent, l));
+    downsample_rgba8(level.data(), mip_level_extent(m_extent, l - 1), next_level.data());
+    std::memcpy(chunk_ptr, next_level.data(), next_level.size());
+    chunk_ptr += next_level.size();
+    level.swap(next_level);
+  }
+}
+
+} // namespace vk_utils
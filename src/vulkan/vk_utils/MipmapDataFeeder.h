@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../memory/DataFeeder.h"
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <vector>
+
+namespace vk_utils {
+
+// Read all data of data_feeder into a vector.
+std::vector<unsigned char> read_all(vulkan::DataFeeder& data_feeder);
+
+// Write the next mip level of the tightly packed, four bytes per texel, image source with the given extent to destination,
+// averaging each 2x2 block of texels (the last row and/or column are repeated when the extent is odd).
+void downsample_rgba8(unsigned char const* source, vk::Extent2D source_extent, unsigned char* destination);
+
+// A DataFeeder that adds a CPU generated mip chain to the first mip level provided by another DataFeeder.
+//
+// Texture::upload uses this when the GPU can't generate the mip levels (see LogicalDevice::supports_blit_mipmap_generation).
+// Only supports formats with four 8-bit components. Unlike the wrapped DataFeeder, this one needs a copy of the whole
+// image in memory.
+class MipmapDataFeeder final : public vulkan::DataFeeder
+{
+ private:
+  std::unique_ptr<vulkan::DataFeeder> m_level0_data_feeder;
+  vk::Format m_format;
+  vk::Extent2D m_extent;                                // The extent of the first mip level.
+  uint32_t m_level_count;
+  uint32_t m_size;                                      // The size of all mip levels in bytes.
+
+ public:
+  MipmapDataFeeder(std::unique_ptr<vulkan::DataFeeder> level0_data_feeder, vk::Format format, vk::Extent2D extent, uint32_t level_count);
+
+  uint32_t chunk_size() const override { return m_size; }
+  int chunk_count() const override { return 1; }
+  int next_batch() override { return 1; }
+  void get_chunks(unsigned char* chunk_ptr) override;
+};
+
+} // namespace vk_utils
@@ -0,0 +1,171 @@
+#include "sys.h"
+#include "PNGImageDataFeeder.h"
+#include "utils/AIAlert.h"
+#include <algorithm>
+#include <csetjmp>
+#include <vector>
+#include "debug.h"
+
+namespace vk_utils {
+namespace libpng {
+
+// Open a PNG file and read its header.
+ImageDataFeeder::ImageDataFeeder(std::filesystem::path const& filename, int requested_components) : m_filename(filename)
+{
+  DoutEntering(dc::vulkan, "libpng::ImageDataFeeder::ImageDataFeeder(" << filename << ", " << requested_components << ")");
+
+  m_file = std::fopen(filename.c_str(), "rb");
+  if (!m_file)
+    THROW_ALERT("Could not open file \"[FILENAME]\"", AIArgs("[FILENAME]", filename));
+
+  m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, this, &error_function, &warning_function);
+  if (m_png)
+    m_info = png_create_info_struct(m_png);
+
+  if (!m_info || !read_header(requested_components) ||
+      (requested_components > 0 && m_components != requested_components) || m_extent.width == 0 || m_extent.height == 0)
+  {
+    std::string error = m_error;
+    png_destroy_read_struct(&m_png, &m_info, nullptr);
+    std::fclose(m_file);
+    THROW_ALERT("Could not get image data for file \"[FILENAME]\" ([ERROR])", AIArgs("[FILENAME]", filename)("[ERROR]", error));
+  }
+
+  m_rows_per_batch = std::max(1U, s_batch_size / m_row_size);
+}
+
+ImageDataFeeder::~ImageDataFeeder()
+{
+  png_destroy_read_struct(&m_png, &m_info, nullptr);
+  std::fclose(m_file);
+}
+
+//static
+void ImageDataFeeder::error_function(png_structp png, png_const_charp message)
+{
+  ImageDataFeeder* self = static_cast<ImageDataFeeder*>(png_get_error_ptr(png));
+  self->m_error = message;
+  png_longjmp(png, 1);
+}
+
+//static
+void ImageDataFeeder::warning_function(png_structp UNUSED_ARG(png), png_const_charp message)
+{
+  Dout(dc::warning, "libpng: " << message);
+}
+
+// The functions that call setjmp must not have local variables with a non-trivial destructor,
+// nor use local variables after longjmp that were changed after the call to setjmp.
+
+bool ImageDataFeeder::read_header(int requested_components)
+{
+  if (setjmp(png_jmpbuf(m_png)))
+    return false;
+
+  png_init_io(m_png, m_file);
+  png_read_info(m_png, m_info);
+
+  png_uint_32 width, height;
+  int bit_depth, color_type, interlace_type;
+  png_get_IHDR(m_png, m_info, &width, &height, &bit_depth, &color_type, &interlace_type, nullptr, nullptr);
+
+  // Convert everything to 8 bits per component.
+  if (bit_depth == 16)
+    png_set_strip_16(m_png);
+  if (color_type == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(m_png);
+  if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+    png_set_expand_gray_1_2_4_to_8(m_png);
+  if (png_get_valid(m_png, m_info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(m_png);
+
+  // Convert to the requested number of components, like stbi_load does.
+  bool const is_gray = !(color_type & PNG_COLOR_MASK_COLOR);
+  if (requested_components == 1 || requested_components == 2)
+  {
+    if (!is_gray)
+      png_set_rgb_to_gray_fixed(m_png, 1, -1, -1);
+  }
+  else if (requested_components == 3 || requested_components == 4)
+  {
+    if (is_gray)
+      png_set_gray_to_rgb(m_png);
+  }
+  if (requested_components == 2 || requested_components == 4)
+    png_set_filler(m_png, 0xff, PNG_FILLER_AFTER);      // Does nothing if there already is an alpha channel.
+  else if (requested_components == 1 || requested_components == 3)
+    png_set_strip_alpha(m_png);
+
+  m_interlaced = interlace_type != PNG_INTERLACE_NONE;
+  if (m_interlaced)
+    png_set_interlace_handling(m_png);
+
+  png_read_update_info(m_png, m_info);
+
+  m_extent = vk::Extent2D{ width, height };
+  m_components = png_get_channels(m_png, m_info);
+  m_row_size = png_get_rowbytes(m_png, m_info);
+  return true;
+}
+
+bool ImageDataFeeder::read_rows(unsigned char* rows, int number_of_rows)
+{
+  if (setjmp(png_jmpbuf(m_png)))
+    return false;
+
+  for (int row = 0; row < number_of_rows; ++row)
+    png_read_row(m_png, rows + static_cast<size_t>(row) * m_row_size, nullptr);
+  return true;
+}
+
+bool ImageDataFeeder::read_image(png_bytepp row_pointers)
+{
+  if (setjmp(png_jmpbuf(m_png)))
+    return false;
+
+  png_read_image(m_png, row_pointers);
+  return true;
+}
+
+bool ImageDataFeeder::read_end()
+{
+  if (setjmp(png_jmpbuf(m_png)))
+    return false;
+
+  // Read (and verify the CRC of) the chunks after the image data.
+  png_read_end(m_png, nullptr);
+  return true;
+}
+
+int ImageDataFeeder::next_batch()
+{
+  if (m_interlaced)
+    return 1;
+  m_batch_rows = std::min(m_rows_per_batch, static_cast<int>(m_extent.height) - m_next_row);
+  return m_batch_rows;
+}
+
+void ImageDataFeeder::get_chunks(unsigned char* chunk_ptr)
+{
+  if (m_interlaced)
+  {
+    // All passes must be decoded before any row is complete; decode directly into the staging memory.
+    std::vector<png_bytep> row_pointers(m_extent.height);
+    for (uint32_t row = 0; row < m_extent.height; ++row)
+      row_pointers[row] = chunk_ptr + static_cast<size_t>(row) * m_row_size;
+    if (!read_image(row_pointers.data()) || !read_end())
+      THROW_ALERT("Could not decode image data of file \"[FILENAME]\" ([ERROR])", AIArgs("[FILENAME]", m_filename)("[ERROR]", m_error));
+    return;
+  }
+
+  if (!read_rows(chunk_ptr, m_batch_rows))
+    THROW_ALERT("Could not decode row [ROW] or higher of file \"[FILENAME]\" ([ERROR])",
+        AIArgs("[ROW]", m_next_row)("[FILENAME]", m_filename)("[ERROR]", m_error));
+
+  m_next_row += m_batch_rows;
+  if (m_next_row == static_cast<int>(m_extent.height) && !read_end())
+    THROW_ALERT("Could not decode image data of file \"[FILENAME]\" ([ERROR])", AIArgs("[FILENAME]", m_filename)("[ERROR]", m_error));
+}
+
+} // namespace libpng
+} // namespace vk_utils
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../memory/DataFeeder.h"
+#include <vulkan/vulkan.hpp>
+#include <png.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include "debug.h"
+
+namespace vk_utils {
+namespace libpng {
+
+// A DataFeeder that decodes a PNG file while it is being uploaded.
+//
+// Unlike stbi::ImageData, which first decodes the whole image into a heap buffer that is then
+// copied into the staging buffer, this feeder decodes the image one row at a time straight into
+// the (mapped) staging memory: there is no intermediate copy of the decoded image.
+//
+// The constructor only reads the header, so that extent() can be used to create the Texture.
+// Interlaced images can not be decoded row by row; those are decoded in a single batch.
+//
+// If the file turns out to be corrupt after the header was read, then get_chunks throws
+// an AIAlert::Error, which aborts the upload task.
+class ImageDataFeeder final : public vulkan::DataFeeder
+{
+ public:
+  static constexpr uint32_t s_batch_size = 64 * 1024;   // The approximate number of bytes to decode per batch.
+
+ private:
+  std::filesystem::path m_filename;                     // For error messages.
+  std::FILE* m_file{};
+  png_structp m_png{};
+  png_infop m_info{};
+  vk::Extent2D m_extent;
+  int m_components{};
+  uint32_t m_row_size{};                                // Size of one decoded row in bytes.
+  bool m_interlaced{};
+  int m_rows_per_batch{};
+  int m_next_row{};                                     // The first row that get_chunks will decode.
+  int m_batch_rows{};                                   // The number of rows that get_chunks will decode.
+  std::string m_error;                                  // The last error message reported by libpng.
+
+ public:
+  ImageDataFeeder(std::filesystem::path const& filename, int requested_components);
+  ~ImageDataFeeder() override;
+
+  // Accessors.
+  vk::Extent2D extent() const { return m_extent; }
+  int components() const { return m_components; }
+
+  // Each chunk is one row, or the whole image if it is interlaced.
+  uint32_t chunk_size() const override { return m_interlaced ? m_row_size * m_extent.height : m_row_size; }
+  int chunk_count() const override { return m_interlaced ? 1 : m_extent.height; }
+  int next_batch() override;
+  void get_chunks(unsigned char* chunk_ptr) override;
+
+ private:
+  static void error_function(png_structp png, png_const_charp message);
+  static void warning_function(png_structp png, png_const_charp message);
+
+  // These call libpng and return false if it reported an error.
+  bool read_header(int requested_components);
+  bool read_rows(unsigned char* rows, int number_of_rows);
+  bool read_image(png_bytepp row_pointers);
+  bool read_end();
+};
+
+} // namespace libpng
+} // namespace vk_utils
@@ -2,6 +2,8 @@
 
 #include "debug.h"
 #include <vulkan/utility/vk_format_utils.h>
+#include <algorithm>
+#include <bit>
 
 namespace vk_utils {
 
@@ -22,4 +24,53 @@ inline uint32_t format_component_count(vk::Format format)
   return vkuFormatComponentCount(static_cast<VkFormat>(format));
 }
 
+inline bool format_is_compressed(vk::Format format)
+{
+  return vkuFormatIsCompressed(static_cast<VkFormat>(format));
+}
+
+// The size in bytes of one texel block (of one texel for uncompressed formats).
+inline uint32_t format_block_size(vk::Format format)
+{
+  return vkuFormatElementSize(static_cast<VkFormat>(format));
+}
+
+// The size in texels of one texel block (1x1 for uncompressed formats).
+inline vk::Extent2D format_block_extent(vk::Format format)
+{
+  VkExtent3D const block_extent = vkuFormatTexelBlockExtent(static_cast<VkFormat>(format));
+  return { block_extent.width, block_extent.height };
+}
+
+// The number of mip levels of a full mip chain of an image with the given extent.
+inline uint32_t mip_level_count(vk::Extent2D extent)
+{
+  return std::bit_width(std::max(extent.width, extent.height));
+}
+
+// The extent of mip level 'level' of an image whose level 0 has the given extent.
+inline vk::Extent2D mip_level_extent(vk::Extent2D extent, uint32_t level)
+{
+  return { std::max(extent.width >> level, 1U), std::max(extent.height >> level, 1U) };
+}
+
+// The size in bytes of mip level 'level' of a tightly packed image of the given format and extent.
+inline size_t mip_level_size(vk::Format format, vk::Extent2D extent, uint32_t level)
+{
+  vk::Extent2D const level_extent = mip_level_extent(extent, level);
+  vk::Extent2D const block_extent = format_block_extent(format);
+  size_t const blocks_per_row = (level_extent.width + block_extent.width - 1) / block_extent.width;
+  size_t const blocks_per_column = (level_extent.height + block_extent.height - 1) / block_extent.height;
+  return blocks_per_row * blocks_per_column * format_block_size(format);
+}
+
+// The size in bytes of mip levels [0, level_count) of a tightly packed image of the given format and extent.
+inline size_t image_data_size(vk::Format format, vk::Extent2D extent, uint32_t level_count)
+{
+  size_t size = 0;
+  for (uint32_t level = 0; level < level_count; ++level)
+    size += mip_level_size(format, extent, level);
+  return size;
+}
+
 } // namespace vk_utils